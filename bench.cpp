@@ -0,0 +1,603 @@
+// Microbenchmark and load-test suite for block generation, hashing, chain linking and rendering.
+// Build with "make bench", run "./bench [--filter TEXT] [--repeat N] [--vehicles N] [--out FILE]".
+// Every benchmark reports its median time per operation; all results are also written as JSON so runs can be compared.
+#define TMS_NO_MAIN
+#include "code.cpp"     // The program is a single translation unit; pull it in without its main
+
+
+// Settings of a benchmark run
+struct BenchOptions {
+    string filter;                          // Only run benchmarks whose name contains this text
+    string outPath = "bench_results.json";  // Machine-readable results
+    unsigned repeats = 5;                   // Timed repetitions per benchmark (the median is reported)
+    double secondsPerRepeat = 0.1;          // Target duration of one timed repetition
+    uint64_t vehicles = 20000;              // Seven-stage chains built by the end-to-end test
+};
+
+// Outcome of one benchmark
+struct BenchResult {
+    string name;                 // Benchmark name ("group/case")
+    uint64_t iterations = 0;     // Operations per timed repetition
+    double nsPerOp = 0;          // Median nanoseconds per operation
+    double minNsPerOp = 0;       // Fastest repetition
+    double maxNsPerOp = 0;       // Slowest repetition
+    double bytesPerOp = 0;       // Bytes processed per operation (0 if not meaningful)
+};
+
+// Global variables
+BenchOptions benchOptions;           // Options of this run
+vector<BenchResult> benchResults;    // Results in run order
+volatile uint64_t benchSink = 0;     // Results are folded in here so the compiler cannot drop the measured work
+
+// Function to time a body that performs a given number of operations
+static double timeIterations(const function<void(uint64_t)>& body, uint64_t iterations) {
+    auto start = chrono::steady_clock::now();
+    body(iterations);
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+// Function to run one benchmark: calibrate the iteration count, then time several repetitions
+// body(n) must perform n operations; fixedIterations skips calibration (used by the end-to-end test)
+static void runBenchmark(const string& name, const function<void(uint64_t)>& body, double bytesPerOp = 0, uint64_t fixedIterations = 0) {
+    if (!benchOptions.filter.empty() && name.find(benchOptions.filter) == string::npos) {
+        return;
+    }
+    uint64_t iterations = fixedIterations;
+    if (iterations == 0) {
+        // Double until one run takes at least 10 ms, then scale to the target repetition time
+        iterations = 1;
+        double elapsed = timeIterations(body, iterations);
+        while (elapsed < 1e7 && iterations < (1ULL << 40)) {
+            iterations *= 2;
+            elapsed = timeIterations(body, iterations);
+        }
+        iterations = max<uint64_t>(1, uint64_t(iterations * (benchOptions.secondsPerRepeat * 1e9 / elapsed)));
+    } else {
+        timeIterations(body, iterations); // Warm-up
+    }
+
+    vector<double> samples;
+    for (unsigned r = 0; r < max(1u, benchOptions.repeats); ++r) {
+        samples.push_back(timeIterations(body, iterations) / double(iterations));
+    }
+    sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = samples[samples.size() / 2];
+    result.minNsPerOp = samples.front();
+    result.maxNsPerOp = samples.back();
+    result.bytesPerOp = bytesPerOp;
+    benchResults.push_back(result);
+
+    cout << left << setw(34) << name << right << fixed << setprecision(1)
+         << setw(14) << result.nsPerOp << " ns/op"
+         << setw(16) << setprecision(0) << 1e9 / result.nsPerOp << " op/s";
+    if (bytesPerOp > 0) {
+        cout << setw(10) << setprecision(1) << bytesPerOp / result.nsPerOp * 1e9 / (1024 * 1024) << " MiB/s";
+    }
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// Function to get a dataset field, treating missing trailing columns as empty like the loader does
+static string datasetField(size_t row, size_t column) {
+    return column < dataset[row].size() ? dataset[row][column] : string();
+}
+
+// Function to benchmark the hashing paths
+static void benchHashing() {
+    SupplierBlockchain supplier = generateSupplierBlockChain(datasetField(0, 0), datasetField(0, 1), datasetField(0, 2), datasetField(0, 3),
+                                                             datasetField(0, 4), datasetField(0, 5), datasetField(0, 6));
+    string content = blockContent(supplier);
+    runBenchmark("hash/generateBlockHash", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            content[1] = char(i); // Vary the input so nothing can be cached
+            benchSink += generateBlockHash(content)[0];
+        }
+    }, double(content.size()));
+
+    vector<string> contents(8, content);
+    runBenchmark("hash/generateBlockHashes x8", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            contents[0][1] = char(i);
+            benchSink += generateBlockHashes(contents)[7][0];
+        }
+    }, double(content.size() * 8));
+
+    // One batch block committing to 4096 transactions versus 4096 transaction blocks of their own
+    vector<TransactionBlockchain> transactions(4096);
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        transactions[i] = buildTransactionBlock("TRANS" + to_string(i), datasetField(6, 1), datasetField(6, 2), datasetField(6, 3),
+                                                datasetField(6, 4), datasetField(6, 5), datasetField(6, 6));
+    }
+    string body;
+    buildTransactionBatchBlock(transactions, body);
+    runBenchmark("merkle/buildTransactionBatchBlock 4096", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            body.clear();
+            benchSink += buildTransactionBatchBlock(transactions, body).merkleRoot[0];
+        }
+    }, double(body.size()));
+
+    vector<string> leafText(transactions.size());
+    vector<string_view> leaves(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        leafText[i] = transactionLeaf(transactions[i]);
+        leaves[i] = leafText[i];
+    }
+    MerkleTree tree;
+    buildMerkleTree(leaves, tree);
+    BlockHash root = merkleRoot(tree);
+    runBenchmark("merkle/verifyMerkleProof 4096", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            size_t leaf = size_t(i % leaves.size());
+            benchSink += verifyMerkleProof(leaves[leaf], merkleProof(tree, leaf), root);
+        }
+    });
+
+    // Proof-of-work search at a fixed 12-bit difficulty: about 4096 hashes per block
+    BlockHeader header = supplier.header;
+    header.difficulty = 12;
+    runBenchmark("pow/sealProofOfWork 12 bits", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            content[1] = char(i);
+            benchSink += sealProofOfWork(content, header)[0];
+        }
+    });
+
+    runBenchmark("time/generateTimestamp", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            benchSink += generateTimestamp();
+        }
+    });
+
+    // Cost a per-block metric adds to every block (one event in 16 reads the clock)
+    runBenchmark("metrics/MetricTimer sampled", [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            MetricTimer timer(METRIC_SEAL);
+            benchSink += i;
+        }
+    });
+
+    // Formatting a burst of timestamps within one second, as the renderer does for consecutive blocks
+    uint64_t base = generateTimestamp();
+    runBenchmark("time/formatTimestamp", [base](uint64_t n) {
+        string out;
+        for (uint64_t i = 0; i < n; ++i) {
+            out.clear();
+            appendTimestamp(out, base + (i & 0xffff), true);
+            benchSink += out.size();
+        }
+    });
+}
+
+// Function to benchmark Ed25519 signing and verification of transactions, one at a time and in batches
+static void benchSignatures() {
+    const size_t count = 4096;
+    vector<array<uint8_t, 32>> publicKeys(count);
+    vector<array<uint8_t, 64>> signatures(count);
+    vector<string> messages(count);
+    vector<SignatureCheck> checks(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t seed[32] = {uint8_t(i), uint8_t(i >> 8), 1};
+        ed25519PublicKey(seed, publicKeys[i].data());
+        TransactionBlockchain transaction = buildTransactionBlock("TRANS" + to_string(i), datasetField(6, 1), datasetField(6, 2),
+                                                                  datasetField(6, 3), datasetField(6, 4), datasetField(6, 5), datasetField(6, 6));
+        transactionSigningMessage(messages[i], transaction);
+        ed25519Sign(seed, publicKeys[i].data(), messages[i], signatures[i].data());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        checks[i] = SignatureCheck{publicKeys[i].data(), signatures[i].data(), messages[i]};
+    }
+    uint8_t seed[32] = {42};
+    runBenchmark("sig/ed25519Sign", [&](uint64_t n) {
+        uint8_t signature[64];
+        for (uint64_t i = 0; i < n; ++i) {
+            ed25519Sign(seed, publicKeys[0].data(), messages[i % count], signature);
+            benchSink += signature[0];
+        }
+    });
+    runBenchmark("sig/ed25519Verify", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            size_t at = size_t(i % count);
+            benchSink += ed25519Verify(publicKeys[at].data(), messages[at], signatures[at].data());
+        }
+    });
+    // Per signature, in runs of the whole set: one thread, then every core
+    vector<char> valid(count);
+    for (unsigned threads : {1u, 0u}) {
+        runBenchmark(threads == 1 ? "sig/ed25519VerifyBatch 1 thread" : "sig/ed25519VerifyBatch all cores", [&](uint64_t n) {
+            for (uint64_t done = 0; done < n; done += count) {
+                size_t run = size_t(min<uint64_t>(count, n - done));
+                benchSink += ed25519VerifyBatch(checks.data(), run, valid.data(), threads);
+            }
+        });
+    }
+}
+
+// Function to benchmark every generate*BlockChain function (interning, parsing, header and hash)
+static void benchGenerators() {
+    SupplierBlockchain supplier{};
+    PressBlockchain press{};
+    WeldingBlockchain welding{};
+    PaintingBlockchain painting{};
+    AssemblyBlockchain assembly{};
+    ShippingBlockchain shipping{};
+    TransactionBlockchain transaction{};
+    auto f = datasetField;
+
+    runBenchmark("generate/Supplier", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            supplier = generateSupplierBlockChain(f(0, 0), f(0, 1), f(0, 2), f(0, 3), f(0, 4), f(0, 5), f(0, 6), &transaction.header);
+        }
+        benchSink += supplier.header.blockNumber;
+    });
+    runBenchmark("generate/Press", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            press = generatePressBlockChain(f(1, 0), f(1, 1), f(1, 2), f(1, 3), f(1, 4), f(1, 5), &supplier.header);
+        }
+        benchSink += press.header.blockNumber;
+    });
+    runBenchmark("generate/Welding", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            welding = generateWeldingBlockChain(f(2, 0), f(2, 1), f(2, 2), f(2, 3), f(2, 4), f(2, 5), &press.header);
+        }
+        benchSink += welding.header.blockNumber;
+    });
+    runBenchmark("generate/Painting", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            painting = generatePaintingBlockChain(f(3, 0), f(3, 1), f(3, 2), f(3, 3), f(3, 4), f(3, 5), &welding.header);
+        }
+        benchSink += painting.header.blockNumber;
+    });
+    runBenchmark("generate/Assembly", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            assembly = generateAssemblyBlockChain(f(4, 0), f(4, 1), f(4, 2), f(4, 3), f(4, 4), f(4, 5), &painting.header);
+        }
+        benchSink += assembly.header.blockNumber;
+    });
+    runBenchmark("generate/Shipping", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            shipping = generateShippingBlockChain(f(5, 0), f(5, 1), f(5, 2), f(5, 3), f(5, 4), f(5, 5), &assembly.header);
+        }
+        benchSink += shipping.header.blockNumber;
+    });
+    runBenchmark("generate/Transaction", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            transaction = generateTransactionBlockChain(f(6, 0), f(6, 1), f(6, 2), f(6, 3), f(6, 4), f(6, 5), f(6, 6), &shipping.header);
+        }
+        benchSink += transaction.header.blockNumber;
+    });
+}
+
+// Function to benchmark linking prebuilt blocks onto a chain, privately and through a shared chain
+static void benchLinking() {
+    StageBlock previous = toStageBlock(buildSupplierBlock("SUP001", "ABC Suppliers", "Product X", "123 Main Street", "Branch A", "100", "50.75"));
+    sealStageBlock(previous, nullptr, nullptr);
+    StageBlock block = previous;
+    runBenchmark("chain/sealStageBlock", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            sealStageBlock(block, &blockHeader(previous), nullptr);
+            previous.supplier.header = block.supplier.header;
+        }
+        benchSink += blockHeader(block).blockNumber;
+    });
+
+    SharedChain chain;
+    initSharedChain(chain, nullptr, nullptr);
+    runBenchmark("chain/appendToChain", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            appendToChain(chain, block);
+        }
+        benchSink += blockHeader(block).blockNumber;
+    });
+}
+
+// Function to benchmark the buffered renderer in every mode and the console print path
+static void benchRendering() {
+    vector<StageBlock> blocks;
+    IngestState state;
+    state.onBatch = [&blocks](const BlockBatch& batch) {
+        blocks.insert(blocks.end(), batch.blocks.begin(), batch.blocks.end());
+    };
+    ingestDataset(dataset, state);
+    flushBatch(state);
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull < 0 || blocks.empty()) {
+        cerr << "Rendering benchmarks skipped" << endl;
+        return;
+    }
+
+    const pair<const char*, RenderMode> modes[] = {
+        {"render/console", RenderMode::Console}, {"render/plain", RenderMode::Plain},
+        {"render/jsonl", RenderMode::JsonLines}, {"render/csv", RenderMode::Csv},
+    };
+    for (const auto& mode : modes) {
+        Renderer renderer;
+        renderer.mode = mode.second;
+        renderer.fd = devNull;
+        runBenchmark(mode.first, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                renderBlock(renderer, blocks[i % blocks.size()]);
+            }
+            flushRenderer(renderer);
+        });
+    }
+
+    // printStageBlock writes to standard output; point it at /dev/null while timing
+    cout.flush();
+    int savedStdout = dup(STDOUT_FILENO);
+    dup2(devNull, STDOUT_FILENO);
+    runBenchmark("print/printStageBlock", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            printStageBlock(blocks[i % blocks.size()]);
+        }
+    });
+    cout.flush();
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    close(devNull);
+    // The result line went to /dev/null as well; repeat it on the terminal
+    if (!benchResults.empty() && benchResults.back().name == "print/printStageBlock") {
+        cout << left << setw(34) << "print/printStageBlock" << right << fixed << setprecision(1)
+             << setw(14) << benchResults.back().nsPerOp << " ns/op" << defaultfloat << setprecision(6) << endl;
+    }
+}
+
+// Function to benchmark dictionary-encoding canonical block records for the store and expanding them back
+static void benchStoreEncoding() {
+    vector<string> records;
+    IngestState state;
+    state.onBatch = [&records](const BlockBatch& batch) {
+        for (const StageBlock& block : batch.blocks) {
+            records.emplace_back();
+            encodeBlockRecord(records.back(), block);
+        }
+    };
+    ingestDataset(dataset, state);
+    flushBatch(state);
+    if (records.empty()) {
+        cerr << "Store encoding benchmarks skipped" << endl;
+        return;
+    }
+
+    // Encode each record once to fill the dictionaries, as a segment does after its first few thousand blocks
+    ChainStore store;
+    store.activeDictionary = make_shared<SegmentDictionary>();
+    vector<string> encoded(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        encodeStoredRecord(store, records[i], encoded[i], 0);
+        memcpy(store.lastHash.data(), records[i].data() + records[i].size() - 32, 32);
+        store.activeOffsets.push_back(0);
+    }
+    string out;
+    runBenchmark("store/encodeStoredRecord", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            encodeStoredRecord(store, records[i % records.size()], out, 0);
+            benchSink += out.size();
+        }
+    });
+    function<const char*(uint64_t)> noUpdates = [](uint64_t) { return nullptr; }; // The records hold no update blocks
+    runBenchmark("store/expandStoredRecord", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            size_t index = i % records.size();
+            const char* previousHash = index > 0 ? records[index - 1].data() + records[index - 1].size() - 32 : nullptr;
+            benchSink += expandStoredRecord(encoded[index], store.activeDictionary.get(), previousHash, noUpdates, out).size();
+        }
+    });
+}
+
+// Function to benchmark time-range scans of a store of N generated vehicles in 4 MiB segments: a 1% window in the
+// middle of the chain against a window covering every block (one operation = one scan; bytes = index and records read)
+static void benchTimeRange() {
+    char directory[] = "/tmp/tms-bench-XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        cerr << "Time-range benchmarks skipped: " << strerror(errno) << endl;
+        return;
+    }
+    ChainStoreOptions storeOptions;
+    storeOptions.directory = directory;
+    storeOptions.segmentSize = 4 * 1024 * 1024;
+    ChainStore store;
+    if (openChainStore(store, storeOptions)) {
+        Workload workload;
+        prepareWorkload(workload, WorkloadOptions());
+        IngestState state;
+        state.onBatch = [&store](const BlockBatch& batch) {
+            for (const StageBlock& block : batch.blocks) {
+                appendBlock(store, block);
+            }
+        };
+        ingestWorkload(workload, 0, benchOptions.vehicles, state);
+        flushBatch(state);
+        StoreReadView view;
+        if (openStoreReadView(store, view) && view.count > 0) {
+            string scratch;
+            uint8_t stage;
+            uint64_t oldest = 0, newest = 0;
+            storedRecordTime(storeViewRecord(view, 0, scratch), stage, oldest);
+            storedRecordTime(storeViewRecord(view, view.count - 1, scratch), stage, newest);
+            TimeRangeQuery window, everything;
+            window.fromTimestamp = oldest + (newest - oldest) / 200 * 99;
+            window.toTimestamp = oldest + (newest - oldest) / 200 * 101;
+            const pair<const char*, TimeRangeQuery> scans[] = {{"store/scanTimeRange 1% window", window},
+                                                               {"store/scanTimeRange all blocks", everything}};
+            for (const auto& scan : scans) {
+                TimeRangeStats probe;
+                auto count = [](uint64_t, uint8_t, uint64_t) { return true; };
+                scanTimeRange(view, scan.second, probe, count);
+                runBenchmark(scan.first, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        TimeRangeStats stats;
+                        benchSink += scanTimeRange(view, scan.second, stats, count);
+                    }
+                }, double(probe.bytesRead));
+            }
+        }
+        closeStoreReadView(view);
+    }
+    closeChainStore(store);
+    error_code error;
+    filesystem::remove_all(directory, error);
+}
+
+// Function to run the end-to-end tests: parse and ingest N full seven-stage vehicles (one operation = one vehicle)
+static void benchEndToEnd() {
+    // Pre-split rows with unique IDs per vehicle, so the timed loop measures ingestion and not text generation
+    vector<string> rows;
+    rows.reserve(benchOptions.vehicles * 7);
+    for (uint64_t v = 0; v < benchOptions.vehicles; ++v) {
+        for (size_t stage = 0; stage < 7; ++stage) {
+            string row = dataset[stage][0] + "-" + to_string(v);
+            for (size_t column = 1; column < dataset[stage].size(); ++column) {
+                row += "," + dataset[stage][column];
+            }
+            rows.push_back(row);
+        }
+    }
+    vector<vector<string_view>> fields(rows.size());
+    string scratch;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        splitRow(rows[i], ',', fields[i], scratch);
+    }
+
+    runBenchmark("e2e/ingest vehicles", [&](uint64_t n) {
+        IngestState state;
+        uint64_t blocks = 0;
+        state.onBatch = [&blocks](const BlockBatch& batch) { blocks += batch.blocks.size(); };
+        for (uint64_t i = 0; i < n * 7; ++i) {
+            ingestRow(state, fields[i % fields.size()]);
+        }
+        flushBatch(state);
+        benchSink += blocks;
+    }, 0, benchOptions.vehicles);
+
+    // The same with skewed, realistic rows from the workload generator, drawn inside the timed loop
+    Workload workload;
+    prepareWorkload(workload, WorkloadOptions());
+    runBenchmark("workload/generate vehicle rows", [&](uint64_t n) {
+        string rows;
+        for (uint64_t vehicle = 0; vehicle < n; ++vehicle) {
+            generateVehicleRows(workload, vehicle, rows);
+            benchSink += rows.size();
+        }
+    });
+    runBenchmark("e2e/ingest generated vehicles", [&](uint64_t n) {
+        IngestState state;
+        uint64_t blocks = 0;
+        state.onBatch = [&blocks](const BlockBatch& batch) { blocks += batch.blocks.size(); };
+        ingestWorkload(workload, 0, n, state);
+        flushBatch(state);
+        benchSink += blocks;
+    }, 0, benchOptions.vehicles);
+}
+
+// Function to benchmark the analytics kernels over 1M projected welding blocks (bytes = column bytes scanned)
+static void benchAnalytics() {
+    const size_t rows = 1 << 20;
+    StringId locations[16], types[2] = {internString("MIG"), internString("TIG")};
+    for (int i = 0; i < 16; ++i) {
+        locations[i] = internString("Bay " + to_string(i));
+    }
+    AnalyticsStore analytics;
+    BlockBatch batch;
+    uint64_t seed = 42;
+    for (size_t row = 0; row < rows; ++row) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        WeldingBlockchain block{};
+        block.header.blockNumber = row + 1;
+        block.header.timestamp = row;
+        block.weldingLocation = locations[seed >> 60];
+        block.weldingType = types[(seed >> 40) & 1];
+        block.weldingTemperature = 1000.0f + float((seed >> 20) & 2047);
+        batch.blocks.push_back(toStageBlock(block));
+    }
+    projectBlocks(analytics, batch);
+
+    const pair<const char*, AnalyticsQuery> queries[] = {
+        {"analytics/sum", {3, 5, -1, -1, 0, 0, UINT64_MAX}},
+        {"analytics/sum window+filter", {3, 5, -1, 3, types[0], rows / 4, rows / 4 * 3}},
+        {"analytics/sum by location", {3, 5, 1, -1, 0, 0, UINT64_MAX}},
+    };
+    for (const auto& query : queries) {
+        AnalyticsResult probe = runAnalyticsQuery(analytics, query.second, 1);
+        runBenchmark(query.first, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                benchSink += runAnalyticsQuery(analytics, query.second, 1).rowsSelected;
+            }
+        }, double(probe.bytesScanned));
+    }
+}
+
+// Function to write every result as JSON
+static bool writeBenchResults(const string& path) {
+    string out = "{\n  \"timestamp\": " + to_string(generateTimestamp()) + ",\n";
+    out += "  \"compiler\": \"" + string(__VERSION__) + "\",\n";
+    out += string("  \"sha256\": {\"shaNi\": ") + (sha256Features.shaNi ? "true" : "false") +
+           ", \"avx2\": " + (sha256Features.avx2 ? "true" : "false") + "},\n";
+    out += "  \"threads\": " + to_string(thread::hardware_concurrency()) + ",\n";
+    out += "  \"vehicles\": " + to_string(benchOptions.vehicles) + ",\n";
+    out += "  \"results\": [\n";
+    char number[64];
+    for (size_t i = 0; i < benchResults.size(); ++i) {
+        const BenchResult& r = benchResults[i];
+        out += "    {\"name\": \"" + r.name + "\", \"iterations\": " + to_string(r.iterations);
+        snprintf(number, sizeof(number), "%.3f", r.nsPerOp);
+        out += string(", \"nsPerOp\": ") + number;
+        snprintf(number, sizeof(number), "%.3f", r.minNsPerOp);
+        out += string(", \"minNsPerOp\": ") + number;
+        snprintf(number, sizeof(number), "%.3f", r.maxNsPerOp);
+        out += string(", \"maxNsPerOp\": ") + number;
+        snprintf(number, sizeof(number), "%.1f", 1e9 / r.nsPerOp);
+        out += string(", \"opsPerSecond\": ") + number;
+        snprintf(number, sizeof(number), "%.1f", r.bytesPerOp);
+        out += string(", \"bytesPerOp\": ") + number + "}";
+        out += i + 1 < benchResults.size() ? ",\n" : "\n";
+    }
+    out += "  ]\n}\n";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Cannot write " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    bool ok = writeAll(fd, out.data(), out.size());
+    close(fd);
+    return ok;
+}
+
+//Main function runs the benchmarks selected on the command line
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--filter" && i + 1 < argc) {
+            benchOptions.filter = argv[++i];
+        } else if (argument == "--out" && i + 1 < argc) {
+            benchOptions.outPath = argv[++i];
+        } else if (argument == "--repeat" && i + 1 < argc) {
+            benchOptions.repeats = unsigned(max(1, atoi(argv[++i])));
+        } else if (argument == "--vehicles" && i + 1 < argc) {
+            benchOptions.vehicles = max<uint64_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else {
+            cerr << "Usage: " << argv[0] << " [--filter TEXT] [--repeat N] [--vehicles N] [--out FILE]" << endl;
+            return 2;
+        }
+    }
+
+    cout << "SHA-256 paths: " << (sha256Features.shaNi ? "SHA-NI " : "") << (sha256Features.avx2 ? "AVX2 " : "") << "scalar" << endl;
+    benchHashing();
+    benchSignatures();
+    benchGenerators();
+    benchLinking();
+    benchRendering();
+    benchStoreEncoding();
+    benchTimeRange();
+    benchAnalytics();
+    benchEndToEnd();
+
+    if (!writeBenchResults(benchOptions.outPath)) {
+        return 1;
+    }
+    cout << "Results written to " << benchOptions.outPath << endl;
+    return 0;
+}
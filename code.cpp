@@ -1,777 +1,10546 @@
-#include <iostream>     // Standard input/output stream library
-#include <vector>       // Vector container library
-#include <random>       // Random number generation library
-#include <sstream>      // String stream processing library
-#include <string>       // String library
-#include <chrono>       // Time library for time-related functions
-#include <ctime>        // C-style time library for time manipulation
-#include <iomanip>      // Input/output manipulator library for formatting
-
-using namespace std;    // Standard namespace for C++ standard library
-
-// Forward declarations of blockchain structs
-struct SupplierBlockchain; // Supply
-struct PressBlockchain; // Press
-struct WeldingBlockchain; // Welding
-struct PaintingBlockchain; // Painting
-struct AssemblyBlockchain; // Assembly
-struct ShippingBlockchain; // Shipping
-struct TransactionBlockchain; // Transaction
-
-// Global variables
-int blockNumber = 1;                    // Variable to track the block number
-const string ANSI_GREEN = "\033[1;32m"; // ANSI escape code for green color
-const string ANSI_RESET = "\033[0m";    // ANSI escape code to reset color
-const string ANSI_BLUE = "\033[1;34m";  // ANSI escape code for blue color
-const string ANSI_RED = "\033[1;31m";   // ANSI escape code for red color
-
-// Dataset containing information about various stages of car manufacturing
-vector<vector<string>> dataset = {
-    // Supplier data: Supplier ID, Supplier Name, Product, Address, Branch, Quantity, Price
-    {"SUP001", "ABC Suppliers", "Product X", "123 Main Street", "Branch A", "100", "50.75"},
-
-    // Press data: Press ID, Location, Details, Type, Manufacturer
-    {"PRS001", "456 Industrial Avenue", "Heavy-duty press machine", "Hydraulic", "XYZ Machinery Inc."},
-
-    // Welding data: Welding ID, Location, Details, Type, Material, Temperature
-    {"WLD002", "789 Industrial Avenue", "Robotic welding station", "MIG", "Steel", "2200.0"},
-
-    // Painting data: Painting ID, Location, Details, Color, Type, Thickness
-    {"PNT003", "123 Main Street", "Automated painting booth", "Red", "Acrylic", "0.02"},
-
-    // Assembly data: Assembly ID, Location, Details, Type, Number of Parts, Weight
-    {"ASM004", "456 Elm Street", "Automated assembly line", "Car", "150", "1200.5"},
-
-    // Shipping data: Shipping ID, Destination, Details, Type, Carrier Name, Status
-    {"SHIP005", "New York", "Shipment of car parts", "Air", "ABC Airlines", "In transit"},
-
-    // Transaction data: Transaction ID, Type, Sender, Receiver, Currency, Amount, Status
-    {"TRANS007", "Purchase", "Company A", "Company B", "USD", "1500.75", "Completed"},
-};
-
-// Initialize the random number generator with the current time point including milliseconds
-mt19937 rng(chrono::high_resolution_clock::now().time_since_epoch().count());
-
-//Function prototypes
-// Function to generate a blockchain block for the supplier stage
-SupplierBlockchain generateSupplierBlockChain(string supplierId, string supplierName, string supplierItem, string location, string branch, string quantity, string price);
-// Function to generate a blockchain block for the press stage
-PressBlockchain generatePressBlockChain(string pressId, string pressLocation, string pressDetails, string pressType, string pressManufacturer, string pressCapacity, SupplierBlockchain *ptr);
-// Function to generate a blockchain block for the welding stage
-WeldingBlockchain generateWeldingBlockChain(string weldingId, string weldingLocation, string weldingDetails, string weldingType, string weldingMaterial, string weldingTemperature, PressBlockchain *ptr);
-// Function to generate a blockchain block for the painting stage
-PaintingBlockchain generatePaintingBlockChain(string paintingId, string paintingLocation, string paintingDetails, string PaintingColor, string paintingType, string paintingThickness, WeldingBlockchain *ptr);
-// Function to generate a blockchain block for the assembly stage
-AssemblyBlockchain generateAssemblyBlockChain(string assemblyId, string assemblyLocation, string assemblyDetails, string assemblyType, string numberOfParts, string assemblyWeight, PaintingBlockchain *ptr);
-// Function to generate a blockchain block for the shipping stage
-ShippingBlockchain generateShippingBlockChain(string shippingId, string shippingDestination, string shippingDetails, string shippingType, string carrierName, string shippingStatus, AssemblyBlockchain *ptr);
-// Function to generate a blockchain block for the transaction stage
-TransactionBlockchain generateTransactionBlockChain(string transactionId, string transactionType, string transactionAmount, string sender, string receiver, string currency, string transactionStatus, ShippingBlockchain *ptr);
-// Function to print the dataset
-void printDataset(const vector<vector<string>>& dataset);
-// Function to print a block in the SupplierBlockchain
-void printSupplierBlockchain(const SupplierBlockchain& block);
-// Function to print a block in the PressBlockchain
-void printPressBlockchain(const PressBlockchain& block);
-// Function to print a block in the WeldingBlockchain
-void printWeldingBlockchain(const WeldingBlockchain& block);
-// Function to print a block in the PaintingBlockchain
-void printPaintingBlockchain(const PaintingBlockchain& block);
-// Function to print a block in the AssemblyBlockchain
-void printAssemblyBlockchain(const AssemblyBlockchain& block);
-// Function to print a block in the ShippingBlockchain
-void printShippingBlockchain(const ShippingBlockchain& block);
-// Function to print a block in the TransactionBlockchain
-void printTransactionBlockchain(const TransactionBlockchain& block);
-// Function to generate a hash for a blockchain block
-string generateBlockHash();
-// Function to generate a timestamp for a blockchain block
-string generateTimestamp();
-
-
-//Structures
-struct User { // Define a struct to hold user credentials
-    string username; // username
-    string password; // password
-};
-
-struct SupplierBlockchain {
-    int blockNumber;             // Unique number or identifier of the block
-    string currentBlockHash;     // Hash value of the current block's data
-    string previousBlockHash;    // Hash value of the previous block's data
-    string timestamp;            // Timestamp indicating when the block was created
-    string supplierId;           // Identifier of the supplier associated with this block
-    string supplierName;         // Name of the supplier associated with this block
-    string supplierItem;         // Item provided by the supplier
-    string location;             // Location of the supplier
-    string branch;               // Branch of the supplier
-    string quantity;             // Quantity of the supplied item
-    string price;                // Price of the supplied item
-    PressBlockchain *ptr;        // Pointer to the next stage (PressBlockchain) in the blockchain
-};
-
-
-struct PressBlockchain {
-    int blockNumber;             // Unique number or identifier of the block
-    string currentBlockHash;     // Hash value of the current block's data
-    string previousBlockHash;    // Hash value of the previous block's data
-    string timestamp;            // Timestamp indicating when the block was created
-    string pressId;              // Identifier of the press associated with this block
-    string pressLocation;        // Location of the press
-    string pressDetails;         // Details or description of the press
-    string pressType;            // Type of the press (e.g., hydraulic, pneumatic)
-    string pressManufacturer;    // Manufacturer of the press
-    string pressCapacity;        // Capacity of the press (e.g., in tons)
-    WeldingBlockchain *ptr;      // Pointer to the next stage (WeldingBlockchain) in the blockchain
-};
-
-
-struct WeldingBlockchain {
-    int blockNumber;             // Unique number or identifier of the block
-    string currentBlockHash;     // Hash value of the current block's data
-    string previousBlockHash;    // Hash value of the previous block's data
-    string timestamp;            // Timestamp indicating when the block was created
-    string weldingId;            // Identifier of the welding process associated with this block
-    string weldingLocation;      // Location where welding took place
-    string weldingDetails;       // Details or description of the welding process
-    string weldingType;          // Type of welding process (e.g., MIG, TIG)
-    string weldingMaterial;      // Material being welded
-    string weldingTemperature;   // Temperature of the welding process
-    PaintingBlockchain *ptr;     // Pointer to the next stage (PaintingBlockchain) in the blockchain
-};
-
-struct PaintingBlockchain {
-    int blockNumber;             // Unique number or identifier of the block
-    string currentBlockHash;     // Hash value of the current block's data
-    string previousBlockHash;    // Hash value of the previous block's data
-    string timestamp;            // Timestamp indicating when the block was created
-    string paintingId;          // Identifier of the painting process associated with this block
-    string paintingLocation;    // Location where painting took place
-    string paintingDetails;     // Details or description of the painting process
-    string paintingColor;       // Color of the paint used
-    string paintingType;        // Type or method of painting (e.g., spray painting)
-    string paintingThickness;   // Thickness of the paint layer applied
-    AssemblyBlockchain *ptr;    // Pointer to the next stage (AssemblyBlockchain) in the blockchain
-};
-
-
-struct AssemblyBlockchain {
-    int blockNumber;             // Unique number or identifier of the block
-    string currentBlockHash;     // Hash value of the current block's data
-    string previousBlockHash;    // Hash value of the previous block's data
-    string timestamp;            // Timestamp indicating when the block was created
-    string assemblyId;          // Identifier of the assembly process associated with this block
-    string assemblyLocation;    // Location where assembly took place
-    string assemblyDetails;     // Details or description of the assembly process
-    string assemblyType;        // Type or category of assembly (e.g., vehicle assembly)
-    string numberOfParts;       // Number of parts used in the assembly
-    string assemblyWeight;      // Weight of the assembled product
-    ShippingBlockchain *ptr;    // Pointer to the next stage (ShippingBlockchain) in the blockchain
-};
-
-
-struct ShippingBlockchain {
-    int blockNumber;                // Unique number or identifier of the block
-    string currentBlockHash;        // Hash value of the current block's data
-    string previousBlockHash;       // Hash value of the previous block's data
-    string timestamp;               // Timestamp indicating when the block was created
-    string shippingId;             // Identifier of the shipping process associated with this block
-    string shippingDestination;    // Destination of the shipment
-    string shippingDetails;        // Details or description of the items being shipped
-    string shippingType;           // Type or mode of shipping (e.g., air, sea, land)
-    string carrierName;            // Name of the shipping carrier or company
-    string shippingStatus;         // Current status of the shipping process
-    TransactionBlockchain *ptr;    // Pointer to the next stage (TransactionBlockchain) in the blockchain
-};
-
-
-struct TransactionBlockchain {
-    int blockNumber;            // Unique number or identifier of the block
-    string currentBlockHash;    // Hash value of the current block's data
-    string previousBlockHash;   // Hash value of the previous block's data
-    string timestamp;           // Timestamp indicating when the block was created
-    string transactionId;       // Identifier of the transaction
-    string transactionType;     // Type or category of the transaction
-    string sender;              // Sender of the transaction
-    string receiver;            // Receiver of the transaction
-    string currency;            // Currency used in the transaction
-    string transactionAmount;   // Amount involved in the transaction
-    string transactionStatus;   // Current status of the transaction
-};
-
-
-//Functions
-// Function to perform user authentication
-bool authenticateUser(const std::string& inputUsername, const std::string& inputPassword, const User& validUser) {
-    // Check if the input credentials match the valid user's credentials
-    return (inputUsername == validUser.username && inputPassword == validUser.password);
-}
-
-void printDataset(const vector<vector<string>>& dataset){
-    cout << "\n===== Dataset =====\n" << endl;
-    cout << ANSI_RED;
-    for (const auto& row : dataset) {
-        for (const auto& element : row) {
-            cout << element << " | "; // Print each element followed by a separator
-        }
-        cout << endl; // Add newline after each row
-    }
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-
-}
-
-// Function to print a SupplierBlockchain block
-void printSupplierBlockchain(const SupplierBlockchain& block) {
-    cout << "\n===== Stage 1 : Supply =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Supplier ID    : " << block.supplierId << endl;
-    cout << "Supplier Name  : " << block.supplierName << endl;
-    cout << "Supplier Item  : " << block.supplierItem << endl;
-    cout << "Location       : " << block.location << endl;
-    cout << "Branch         : " << block.branch << endl;
-    cout << "Quantity       : " << block.quantity << endl;
-    cout << "Price          : " << block.price << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Supply Stage Overview]    : Initial phase of car manufacturing, sourcing raw materials and components." << endl;
-    cout << "2. [Key Activities]           : Identifying reliable suppliers, negotiating contracts, monitoring inventory." << endl;
-    cout << "3. [Materials and Components] : Metals, plastics, rubber, glass, electronics, and specialized parts." << endl;
-    cout << "4. [Quality Control]          : Ensuring received materials meet standards through inspections." << endl;
-    cout << "5. [Supply Chain Management]  : Efficient management practices to minimize delays and optimize production." << endl;
-    cout << "6. [Supplier Relationships]   : Building strong relationships for reliable and sustainable supply chains." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a PressBlockchain block
-void printPressBlockchain(const PressBlockchain& block) {
-    cout << "===== Stage 2 : Press =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Press ID            : " << block.pressId << endl;
-    cout << "Press Location      : " << block.pressLocation << endl;
-    cout << "Press Details       : " << block.pressDetails << endl;
-    cout << "Press Type          : " << block.pressType << endl;
-    cout << "Press Manufacturer  : " << block.pressManufacturer << endl;
-    cout << "Press Capacity      : " << block.pressCapacity << " tons" << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Press Stage Overview]         : Shaping metal components using hydraulic or mechanical presses." << endl;
-    cout << "2. [Press Types]                  : Hydraulic press, mechanical press, stamping press, forging press." << endl;
-    cout << "3. [Press Capacity]               : Indicates the maximum force exerted by the press, measured in tons." << endl;
-    cout << "4. [Press Manufacturer]           : Company responsible for designing, manufacturing, and supplying the press." << endl;
-    cout << "5. [Quality Assurance]            : Ensuring precise and consistent shaping of metal parts for assembly." << endl;
-    cout << "6. [Efficiency and Productivity]  : Optimization of press operations for higher output and reduced cycle times." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a WeldingBlockchain block
-void printWeldingBlockchain(const WeldingBlockchain& block) {
-    cout << "===== Stage 3 : Welding =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Welding ID           : " << block.weldingId << endl;
-    cout << "Welding Location     : " << block.weldingLocation << endl;
-    cout << "Welding Details      : " << block.weldingDetails << endl;
-    cout << "Welding Type         : " << block.weldingType << endl;
-    cout << "Welding Material     : " << block.weldingMaterial << endl;
-    cout << "Welding Temperature  : " << block.weldingTemperature << " Celsius" << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Welding Stage Overview]   : Joining metal components using various welding techniques and materials." << endl;
-    cout << "2. [Welding Types]            : MIG (Metal Inert Gas), TIG (Tungsten Inert Gas), Arc welding, Spot welding." << endl;
-    cout << "3. [Welding Materials]        : Metals, alloys, plastics, composites." << endl;
-    cout << "4. [Welding Temperature]      : Temperature at which the welding process occurs, measured in Celsius." << endl;
-    cout << "5. [Quality Assurance]        : Ensuring structural integrity and proper bonding of welded components." << endl;
-    cout << "6. [Efficiency and Precision] : Optimization of welding parameters for consistent and high-quality welds." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a PaintingBlockchain block
-void printPaintingBlockchain(const PaintingBlockchain& block) {
-    cout << "===== Stage 4 : Paint =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-
-    cout << ANSI_RESET;
-    cout << "Painting ID          : " << block.paintingId << endl;
-    cout << "Painting Location    : " << block.paintingLocation << endl;
-    cout << "Painting Details     : " << block.paintingDetails << endl;
-    cout << "Painting Color       : " << block.paintingColor << endl;
-    cout << "Painting Type        : " << block.paintingType << endl;
-    cout << "Painting Thickness   : " << block.paintingThickness << " mm" << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Painting Stage Overview]      : Applying protective and decorative coatings to car bodies." << endl;
-    cout << "2. [Painting Process]             : Surface preparation, primer application, base coat, clear coat." << endl;
-    cout << "3. [Painting Color]               : Choice of colors for aesthetics and brand identity." << endl;
-    cout << "4. [Painting Type]                : Solid, metallic, pearlescent, matte, gloss." << endl;
-    cout << "5. [Painting Thickness]           : Thickness of the paint layer applied, measured in millimeters." << endl;
-    cout << "6. [Quality Assurance]            : Ensuring uniformity, adhesion, and durability of the paint finish." << endl;
-    cout << "7. [Environmental Considerations] : Compliance with environmental regulations regarding paint application and waste disposal." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a AssemblyBlockchain block
-void printAssemblyBlockchain(const AssemblyBlockchain& block) {
-    cout << "===== Stage 5 : Assembly =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Assembly ID        : " << block.assemblyId << endl;
-    cout << "Assembly Location  : " << block.assemblyLocation << endl;
-    cout << "Assembly Details   : " << block.assemblyDetails << endl;
-    cout << "Assembly Type      : " << block.assemblyType << endl;
-    cout << "Number of Parts    : " << block.numberOfParts << endl;
-    cout << "Assembly Weight    : " << block.assemblyWeight << " kg" << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Assembly Stage Overview]  : Combining various components and subsystems to form complete vehicles." << endl;
-    cout << "2. [Assembly Process]         : Sequential assembly line process, with each station performing specific tasks." << endl;
-    cout << "3. [Assembly Type]            : Body assembly, chassis assembly, powertrain assembly, final assembly." << endl;
-    cout << "4. [Number of Parts]          : Total number of components required to assemble a vehicle." << endl;
-    cout << "5. [Assembly Weight]          : Total weight of the assembled vehicle, including all components." << endl;
-    cout << "6. [Quality Assurance]        : Ensuring fit, finish, and functionality of assembled vehicles." << endl;
-    cout << "7. [Testing]                  : Conducting final inspections and functional tests before vehicles are shipped." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a ShippingBlockchain block
-void printShippingBlockchain(const ShippingBlockchain& block) {
-    cout << "===== Stage 6 : Shipping =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Shipping ID            : " << block.shippingId << endl;
-    cout << "Shipping Destination   : " << block.shippingDestination << endl;
-    cout << "Shipping Details       : " << block.shippingDetails << endl;
-    cout << "Shipping Type          : " << block.shippingType << endl;
-    cout << "Carrier Name           : " << block.carrierName << endl;
-    cout << "Shipping Status        : " << block.shippingStatus << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Shipping Stage Overview]  : Transporting assembled vehicles from manufacturing plants to distribution centers or dealerships." << endl;
-    cout << "2. [Shipping Process]         : Coordinating logistics, loading vehicles onto carriers, and delivering them to their destinations." << endl;
-    cout << "3. [Shipping Type]            : Different modes of transportation such as road, rail, sea, or air shipping." << endl;
-    cout << "4. [Carrier Name]             : Name of the shipping company or carrier responsible for transporting vehicles." << endl;
-    cout << "5. [Shipping Status]          : Tracking the status of shipments, including in transit, delivered, or awaiting delivery." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to print a TransactionBlockchain block
-void printTransactionBlockchain(const TransactionBlockchain& block) {
-    cout << "===== Stage 7 : Transaction =====\n" << endl;
-    cout << ANSI_GREEN;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|     Block Number     |         Current Block Hash         |         Previous Block Hash         |     Timestamp     |" <<endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "|          " << block.blockNumber << "           |  " << block.currentBlockHash << "  |   " << block.previousBlockHash << "  | " <<block.timestamp << " |" << endl;
-    cout << "-----------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << endl;
-    cout << ANSI_RESET;
-
-    cout << "Transaction ID      : " << block.transactionId << endl;
-    cout << "Transaction Type    : " << block.transactionType << endl;
-    cout << "Transaction Amount  : " << block.transactionAmount << endl;
-    cout << "Sender              : " << block.sender << endl;
-    cout << "Receiver            : " << block.receiver << endl;
-    cout << "Currency            : " << block.currency << endl;
-    cout << "Transaction Status  : " << block.transactionStatus << endl;
-    cout << endl;
-
-    cout << ANSI_BLUE;
-    cout << "1. [Transaction Stage Overview] : Finalizing the purchase transaction for vehicles between entities involved, such as manufacturers, dealerships, or customers." << endl;
-    cout << "2. Transaction Type]            : Types of transactions include purchases, sales, payments, or transfers of ownership." << endl;
-    cout << "3. [Transaction Amount]         : Monetary value involved in the transaction, typically denoted in the specified currency." << endl;
-    cout << "4. [Sender and Receiver]        : Identifying parties involved in the transaction, indicating the entity sending or receiving the payment or vehicle." << endl;
-    cout << "5. [Currency]                   : The currency used for the transaction, such as USD (US Dollar), EUR (Euro), or any other applicable currency." << endl;
-    cout << "6. [Transaction Status]         : Indicating the status of the transaction, whether it's completed, pending, or failed." << endl;
-    cout << "\n" << endl;
-    cout << ANSI_RESET;
-}
-
-// Function to generate a block hash using SHA-256 algorithm
-string generateBlockHash() {
-    // Define the characters that can be used in the hash
-    const string charset = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
-
-    // Generate a hash of length 32 characters
-    const int hashLength = 32;
-    uniform_int_distribution<int> dist(0, charset.size() - 1);
-    stringstream ss;
-    for (int i = 0; i < hashLength; ++i) {
-        ss << charset[dist(rng)]; // Append a random character from the charset to the hash
-    }
-    return ss.str(); // Return the generated hash
-}
-
-// Function to generate a timestamp in the format "YYYYMMDD:HH:MM:SS"
-string generateTimestamp() {
-    // Get the current time using the time function and convert it to a tm struct
-    time_t currentTime = time(nullptr);
-    tm* localTime = localtime(&currentTime);
-
-    // Format the timestamp as "YYYYMMDD:HH:MM:SS"
-    ostringstream oss;
-    oss << put_time(localTime, "%Y%m%d:%H:%M:%S");
-    return oss.str();
-}
-
-
-// Function to generate a new SupplierBlockchain block
-SupplierBlockchain generateSupplierBlockChain(string supplierId, string supplierName, string supplierItem, string location, string branch, string quantity, string price) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new SupplierBlockchain block
-    SupplierBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = newBlockHash; // Assuming the first block's previous hash is also the current hash
-    block.timestamp = newTimestamp;
-
-    // Set the supplier-specific data
-    block.supplierId = supplierId;
-    block.supplierName = supplierName;
-    block.supplierItem = supplierItem;
-    block.location = location;
-    block.branch = branch;
-    block.quantity = quantity;
-    block.price = price;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new PressBlockchain block
-PressBlockchain generatePressBlockChain(string pressId, string pressLocation, string pressDetails, string pressType, string pressManufacturer, string pressCapacity, SupplierBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new PressBlockchain block
-    PressBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the press-specific data
-    block.pressId = pressId;
-    block.pressLocation = pressLocation;
-    block.pressDetails = pressDetails;
-    block.pressType = pressType;
-    block.pressManufacturer = pressManufacturer;
-    block.pressCapacity = pressCapacity;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new WeldingBlockchain block
-WeldingBlockchain generateWeldingBlockChain(string weldingId, string weldingLocation, string weldingDetails, string weldingType, string weldingMaterial, string weldingTemperature, PressBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new WeldingBlockchain block
-    WeldingBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the welding-specific data
-    block.weldingId = weldingId;
-    block.weldingLocation = weldingLocation;
-    block.weldingDetails = weldingDetails;
-    block.weldingType = weldingType;
-    block.weldingMaterial = weldingMaterial;
-    block.weldingTemperature = weldingTemperature;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new PaintingBlockchain block
-PaintingBlockchain generatePaintingBlockChain(string paintingId, string paintingLocation, string paintingDetails, string PaintingColor, string paintingType, string paintingThickness, WeldingBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new PaintingBlockchain block
-    PaintingBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the painting-specific data
-    block.paintingId = paintingId;
-    block.paintingLocation = paintingLocation;
-    block.paintingDetails = paintingDetails;
-    block.paintingColor = PaintingColor; // Renamed variable to adhere to camelCase naming convention
-    block.paintingType = paintingType;
-    block.paintingThickness = paintingThickness;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new AssemblyBlockchain block
-AssemblyBlockchain generateAssemblyBlockChain(string assemblyId, string assemblyLocation, string assemblyDetails, string assemblyType, string numberOfParts, string assemblyWeight, PaintingBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new AssemblyBlockchain block
-    AssemblyBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the assembly-specific data
-    block.assemblyId = assemblyId;
-    block.assemblyLocation = assemblyLocation;
-    block.assemblyDetails = assemblyDetails;
-    block.assemblyType = assemblyType;
-    block.numberOfParts = numberOfParts;
-    block.assemblyWeight = assemblyWeight;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new ShippingBlockchain block
-ShippingBlockchain generateShippingBlockChain(string shippingId, string shippingDestination, string shippingDetails, string shippingType, string carrierName, string shippingStatus, AssemblyBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new ShippingBlockchain block
-    ShippingBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the shipping-specific data
-    block.shippingId = shippingId;
-    block.shippingDestination = shippingDestination;
-    block.shippingDetails = shippingDetails;
-    block.shippingType = shippingType;
-    block.carrierName = carrierName;
-    block.shippingStatus = shippingStatus;
-
-    // Return the created block
-    return block;
-}
-
-
-// Function to generate a new TransactionBlockchain block
-TransactionBlockchain generateTransactionBlockChain(string transactionId, string transactionType, string transactionAmount, string sender, string receiver, string currency, string transactionStatus, ShippingBlockchain *ptr) {
-    // Generate a new block hash and timestamp for the block
-    string newBlockHash = generateBlockHash();
-    string newTimestamp = generateTimestamp();
-
-    // Create a new TransactionBlockchain block
-    TransactionBlockchain block;
-
-    // Set the block number (blockNumber is a global variable and increment it)
-    block.blockNumber = blockNumber++;
-
-    // Set the current block hash, previous block hash, and timestamp
-    block.currentBlockHash = newBlockHash;
-    block.previousBlockHash = ptr->currentBlockHash; // Get the current hash from the previous block
-    block.timestamp = newTimestamp;
-
-    // Set the transaction-specific data
-    block.transactionId = transactionId;
-    block.transactionType = transactionType;
-    block.transactionAmount = transactionAmount;
-    block.sender = sender;
-    block.receiver = receiver;
-    block.currency = currency;
-    block.transactionStatus = transactionStatus;
-
-    // Return the created block
-    return block;
-}
-
-//Main function allows users to display the dataset, view the blockchains, or quit the program based on their input
-int main() {
-
-    // Define a valid user
-    User validUser;
-    validUser.username = "username";
-    validUser.password = "password";
-    bool isAuthenticated = false;
-    while (!isAuthenticated){
-        // Get input username and password from the user
-        string inputUsername, inputPassword;
-        cout << "=== User Authentication ===\n";
-        cout << "Enter username: ";
-        cin >> inputUsername;
-        cout << "Enter password: ";
-        cin >> inputPassword;
-        cout << endl;
-
-        // Perform user authentication
-        if (authenticateUser(inputUsername, inputPassword, validUser)) {
-            cout << "Authentication successful.Welcome, " << inputUsername << "!\n" <<endl;
-            break;
-        } else {
-            cout << "Authentication failed. Invalid username or password.\n" << endl;
-        }
-    }
-
-    // Declare variables for each blockchain stage
-    SupplierBlockchain supplier;
-    PressBlockchain press;
-    WeldingBlockchain welding;
-    PaintingBlockchain painting;
-    AssemblyBlockchain assembly;
-    ShippingBlockchain shipping;
-    TransactionBlockchain transaction;
-
-    // Loop through the dataset and generate corresponding blockchain blocks
-    vector<string> data;
-    for (int i = 0; i < 7; i++) {
-        data = dataset[i];
-        if (i == 0) {
-            supplier = generateSupplierBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], data[6]);
-        } else if (i == 1) {
-            press = generatePressBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], &supplier);
-        } else if (i == 2) {
-            welding = generateWeldingBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], &press);
-        } else if (i == 3) {
-            painting = generatePaintingBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], &welding);
-        } else if (i == 4) {
-            assembly = generateAssemblyBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], &painting);
-        } else if (i == 5) {
-            shipping = generateShippingBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], &assembly);
-        } else if (i == 6) {
-            transaction = generateTransactionBlockChain(data[0], data[1], data[2], data[3], data[4], data[5], data[6], &shipping);
-        }
-    }
-
-    // Menu loop for interacting with the blockchains
-    int input;
-    bool isLoop = true;
-    while (isLoop) {
-
-        // Display menu options
-        cout << "--------------- Menu --------------" << endl;
-        cout << "|   1. Display the dataset        |" << endl;
-        cout << "|   2. Display the blockchains    |" << endl;
-        cout << "|   3. Quit                       |" << endl;
-        cout << "-----------------------------------" << endl;
-        cout << "Enter the number: ";
-        cin >> input;
-
-        // Perform action based on user input
-        switch (input) {
-            case 1:
-                printDataset(dataset);
-                break;
-            case 2:
-                printSupplierBlockchain(supplier);
-                printPressBlockchain(press);
-                printWeldingBlockchain(welding);
-                printPaintingBlockchain(painting);
-                printAssemblyBlockchain(assembly);
-                printShippingBlockchain(shipping);
-                printTransactionBlockchain(transaction);
-                break;
-            case 3:
-                isLoop = false;
-                break;
-            default:
-                cout << "Please enter the correct number!" << endl;
-        }
-    }
-
-    return 0;
-}
+#include <iostream>     // Standard input/output stream library
+#include <vector>       // Vector container library
+#include <random>       // Random number generation library
+#include <sstream>      // String stream processing library
+#include <string>       // String library
+#include <chrono>       // Time library for time-related functions
+#include <ctime>        // C-style time library for time manipulation
+#include <iomanip>      // Input/output manipulator library for formatting
+#include <cstdint>      // Fixed-width integer types
+#include <cstring>      // C-style memory functions (memcpy, strerror)
+#include <string_view>  // Non-owning string views for zero-copy parsing
+#include <functional>   // Function objects for batch consumers
+#include <cerrno>       // Error numbers reported by system calls
+#include <fcntl.h>      // POSIX file open flags
+#include <sys/mman.h>   // Memory-mapped file I/O
+#include <sys/stat.h>   // File size queries
+#include <unistd.h>     // POSIX close
+#include <array>        // Fixed-size arrays for binary hashes
+#include <memory>       // Smart pointers for arena chunks
+#include <charconv>     // Locale-free number parsing
+#include <algorithm>    // Sorting and binary search
+#include <filesystem>   // Directory creation and listing for segment files
+#include <mutex>        // Mutual exclusion for shared stores
+#include <thread>       // Background threads
+#include <condition_variable> // Waking background threads
+#include <atomic>       // Lock-free shared counters
+#include <map>          // Ordered maps for in-memory transaction batches
+#include <deque>        // Stable storage behind dictionary values
+#include <cmath>        // Infinities for empty aggregates
+#include <csignal>      // Signal sets for the service's shutdown signals
+#include <sys/socket.h> // Unix domain sockets for the service
+#include <sys/un.h>     // Unix socket addresses
+#include <sys/epoll.h>  // Readiness notification for the service's event loop
+#include <sys/signalfd.h> // Shutdown signals delivered as events of the service loop
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // x86 SIMD intrinsics (AVX2, SHA-NI)
+#include <cpuid.h>      // CPU feature detection
+#endif
+
+using namespace std;    // Standard namespace for C++ standard library
+
+// Forward declarations of blockchain structs
+struct SupplierBlockchain; // Supply
+struct PressBlockchain; // Press
+struct WeldingBlockchain; // Welding
+struct PaintingBlockchain; // Painting
+struct AssemblyBlockchain; // Assembly
+struct ShippingBlockchain; // Shipping
+struct TransactionBlockchain; // Transaction
+struct TransactionBatchBlock; // Many transactions under one Merkle root
+struct UpdateBlock; // Changed fields of an earlier block
+struct MerkleTree; // Hashes of every level of a Merkle tree
+struct MerkleProof; // Inclusion proof of one Merkle leaf
+struct BlockBatch; // Blocks produced by one ingestion batch
+struct IngestState; // Streaming ingestion state
+struct MappedFile; // Memory-mapped input file
+struct StringPool; // Interned strings shared by all blocks
+struct BlockHeader; // Fields shared by every block
+struct Sha256Midstate; // Partially computed SHA-256
+struct FieldElement; // Element of the field edwards25519 is defined over
+struct EdwardsPoint; // Point of edwards25519 in extended coordinates
+struct CachedPoint; // Point of edwards25519 prepared for addition
+struct SignatureCheck; // Public key, signature and message of one Ed25519 check
+struct SignerKey; // Ed25519 key registered for a transaction sender
+struct StageBlock; // A block of any stage
+struct ChainStoreOptions; // Persistent store settings
+struct ChainStore; // Persistent append-only chain store
+struct StoreReadView; // Read-only view of a store for parallel readers
+struct SegmentDictionary; // Dictionary-coded field values of one store segment
+struct VerifyReport; // Result of a chain verification
+struct TimeRangeQuery; // Time window and stage a range scan selects
+struct TimeRangeStats; // What a range scan skipped and read
+struct SharedChain; // Chain appended to by many threads at once
+struct BlockIndex; // Lookup tables from hashes and business IDs to blocks
+struct BlockClock; // Source of block timestamps
+struct ProofOfWork; // Proof-of-work difficulty and search counters
+struct MetricShard; // One thread's latency histograms and counters
+struct MetricRegistry; // Every thread's metric shard plus the clock calibration
+struct PipelineOptions; // Settings of the stage pipeline
+struct PipelineReport; // Throughput and queue depths of a pipeline run
+struct WorkloadOptions; // Size, seed, skew and cardinalities of a synthetic workload
+struct Workload; // Prepared distributions of a synthetic workload
+struct ProvenanceGraph; // Stage-to-stage edges of every vehicle
+struct AnalyticsStore; // Columnar projection of every stage's payload
+struct AnalyticsQuery; // Filtered, grouped aggregation over one stage
+struct AnalyticsResult; // Groups and scan statistics of a query
+struct CommandOptions; // Settings taken from the command line
+struct ChainSession; // Store, ingestion state and lookup structures of a running instance
+struct ShardedStore; // Independent shard chains plus the anchor chain committing to their tips
+struct ShardVerifyReport; // Result of verifying every shard chain and every anchor
+struct ServiceClient; // Connection to the local service
+struct Renderer; // Buffered block output
+enum class RenderMode; // Output format of the renderer
+
+typedef array<uint8_t, 32> BlockHash;  // Raw 32-byte SHA-256 digest
+typedef uint32_t StringId;             // Handle of an interned string (0 is the empty string)
+typedef int64_t Money;                 // Fixed-point amount in ten-thousandths of a currency unit
+const Money MONEY_SCALE = 10000;       // Money units per whole currency unit
+const unsigned STRING_POOL_SHARDS = 16;  // Independently locked parts of the string pool
+const size_t STRING_PAGE_SIZE = 16384;   // Strings per page of a string pool shard
+const size_t STRING_MAX_PAGES = 4096;    // Pages per shard (64M strings per shard)
+const size_t CHAIN_TIP_RING = 64;        // Recently published block hashes kept by a shared chain
+const unsigned BLOCK_INDEX_SHARDS = 16;  // Independently built parts of the block indexes
+const size_t TRACE_BATCH_PER_THREAD = 4096; // Vehicle traces per worker thread in a batched trace
+typedef array<uint64_t, 7> VehicleTrace; // Block numbers of one vehicle's Supply..Transaction blocks (0 = missing)
+const uint8_t TRANSACTION_BATCH_STAGE = 8;  // Stage tag of a transaction batch block
+const size_t BATCH_BODY_OFFSET = 1 + 8 + 8 + 4 + 32; // Where a batch record's transactions sit (after the Merkle root)
+const size_t BLOCK_FOOTER_SIZE = 1 + 8 + 4 + 32; // Hashed tail of every block: difficulty, nonce, upstream offset, previous hash
+const unsigned POW_PARALLEL_DIFFICULTY = 14;  // Fewest difficulty bits whose search is worth spreading over all cores
+const unsigned POW_MAX_DIFFICULTY = 48;       // Highest accepted difficulty (2^48 hashes per block is already days)
+const size_t MERKLE_LEAVES_PER_THREAD = 2048; // Fewest leaves worth handing to another hashing thread
+const size_t ANALYTICS_CHUNK = 2048;              // Rows selected and aggregated per kernel call (masks stay in L1)
+const size_t ANALYTICS_ROWS_PER_THREAD = 1 << 16; // Fewest rows worth handing to another scan thread
+const size_t ANALYTICS_REBUILD_BATCH = 1 << 16;   // Records decoded per round when rebuilding the projection
+const size_t CHECKPOINTS_KEPT = 1;                // Newest checkpoint files kept (a damaged one means a full rebuild)
+const size_t CHECKPOINT_REPLAY_BATCH = 4096;      // Blocks replayed per batch after a checkpoint is loaded
+const uint8_t ENCODED_RECORD_FLAG = 0x80;         // Set on the stage byte of a dictionary-encoded store record
+const size_t DICTIONARY_MAX_ENTRIES = 1 << 16;    // Values one field's dictionary holds per segment
+const size_t DICTIONARY_TRIAL_ENTRIES = 1024;     // Entries after which a field that is mostly new values stops defining more
+const size_t DETAILS_DELTA_MIN = 8;               // Bytes a details value must share with its base to be stored as a delta
+const uint64_t TIME_INDEX_STRIDE = 64;            // Records summarized by one entry of a segment's time index
+const size_t TIME_INDEX_ENTRY = 8 + 8 + 4;        // Bytes of a time index entry: oldest and newest timestamp, mask of the stages present
+const int SHIFT_START_HOUR = 6;                   // Local hour the first of the day's shifts starts
+const int SHIFT_HOURS = 8;                        // Length of a shift in a shift report
+const int SERVICE_MAX_EVENTS = 64;                // Readiness events taken per pass of the service loop
+const size_t SERVICE_MAX_LINE = 1 << 20;          // Longest request line the service accepts
+const size_t SERVICE_OUTPUT_LIMIT = 4 << 20;      // Unsent reply bytes at which a client is no longer read from
+const unsigned METRIC_SUB_BUCKET_BITS = 3;        // Histogram buckets per power of two = 2^bits (12.5% relative precision)
+const size_t METRIC_BUCKETS = (64 - METRIC_SUB_BUCKET_BITS + 1) << METRIC_SUB_BUCKET_BITS; // Buckets covering every 64-bit tick count
+const size_t METRICS_MAX_THREADS = 1024;          // Threads recording at the same time (more are not measured)
+const unsigned METRIC_BLOCK_SAMPLE_SHIFT = 4;     // Per-block metrics time one event in 16 (reading the clock costs more than 1% there)
+const uint8_t SHARD_ANCHOR_STAGE = 9;             // Stage tag of an anchor block committing to every shard's tip
+const unsigned MAX_SHARDS = 256;                  // Most independent chains one store is split into
+const uint8_t UPDATE_STAGE = 10;                  // Stage tag of an update block (changed fields of an earlier block)
+const size_t SIGNATURE_BATCH_SIZE = 1024;         // Signatures checked by one multi-scalar multiplication (per thread)
+typedef array<uint64_t, 4> Scalar;                // Integer modulo the edwards25519 group order, little-endian limbs
+const char TRANSACTION_SIGNING_CONTEXT[] = "tms-transaction-v1"; // Prefix of every signed transaction message
+const size_t TRANSACTION_SIGNATURE_SIZE = 32 + 64;  // Stored signature field: public key, then signature
+const size_t UPDATE_MAX_FIELDS = 6;               // Fields one update block changes (every column but the ID of the widest stage)
+
+// Global variables
+atomic<uint64_t> blockNumber{1};       // Variable to track the block number (atomic so producer threads can share it)
+const string ANSI_GREEN = "\033[1;32m"; // ANSI escape code for green color
+const string ANSI_RESET = "\033[0m";    // ANSI escape code to reset color
+const string ANSI_BLUE = "\033[1;34m";  // ANSI escape code for blue color
+const string ANSI_RED = "\033[1;31m";   // ANSI escape code for red color
+
+// Dataset containing information about various stages of car manufacturing
+vector<vector<string>> dataset = {
+    // Supplier data: Supplier ID, Supplier Name, Product, Address, Branch, Quantity, Price
+    {"SUP001", "ABC Suppliers", "Product X", "123 Main Street", "Branch A", "100", "50.75"},
+
+    // Press data: Press ID, Location, Details, Type, Manufacturer
+    {"PRS001", "456 Industrial Avenue", "Heavy-duty press machine", "Hydraulic", "XYZ Machinery Inc."},
+
+    // Welding data: Welding ID, Location, Details, Type, Material, Temperature
+    {"WLD002", "789 Industrial Avenue", "Robotic welding station", "MIG", "Steel", "2200.0"},
+
+    // Painting data: Painting ID, Location, Details, Color, Type, Thickness
+    {"PNT003", "123 Main Street", "Automated painting booth", "Red", "Acrylic", "0.02"},
+
+    // Assembly data: Assembly ID, Location, Details, Type, Number of Parts, Weight
+    {"ASM004", "456 Elm Street", "Automated assembly line", "Car", "150", "1200.5"},
+
+    // Shipping data: Shipping ID, Destination, Details, Type, Carrier Name, Status
+    {"SHIP005", "New York", "Shipment of car parts", "Air", "ABC Airlines", "In transit"},
+
+    // Transaction data: Transaction ID, Type, Amount, Sender, Receiver, Currency, Status
+    {"TRANS007", "Purchase", "1500.75", "Company A", "Company B", "USD", "Completed"},
+};
+
+// Initialize the random number generator with the current time point including milliseconds (one generator per thread)
+thread_local mt19937 rng(uint32_t(chrono::high_resolution_clock::now().time_since_epoch().count()) ^ uint32_t(hash<thread::id>()(this_thread::get_id())));
+
+//Function prototypes
+// Function to build the payload of a supplier block before it is sealed
+SupplierBlockchain buildSupplierBlock(string_view supplierId, string_view supplierName, string_view supplierItem, string_view location, string_view branch, string_view quantity, string_view price);
+// Function to generate a blockchain block for the supplier stage
+SupplierBlockchain generateSupplierBlockChain(string_view supplierId, string_view supplierName, string_view supplierItem, string_view location, string_view branch, string_view quantity, string_view price, const BlockHeader* previous = nullptr);
+// Function to build the payload of a press block before it is sealed
+PressBlockchain buildPressBlock(string_view pressId, string_view pressLocation, string_view pressDetails, string_view pressType, string_view pressManufacturer, string_view pressCapacity);
+// Function to generate a blockchain block for the press stage
+PressBlockchain generatePressBlockChain(string_view pressId, string_view pressLocation, string_view pressDetails, string_view pressType, string_view pressManufacturer, string_view pressCapacity, const BlockHeader* previous);
+// Function to build the payload of a welding block before it is sealed
+WeldingBlockchain buildWeldingBlock(string_view weldingId, string_view weldingLocation, string_view weldingDetails, string_view weldingType, string_view weldingMaterial, string_view weldingTemperature);
+// Function to generate a blockchain block for the welding stage
+WeldingBlockchain generateWeldingBlockChain(string_view weldingId, string_view weldingLocation, string_view weldingDetails, string_view weldingType, string_view weldingMaterial, string_view weldingTemperature, const BlockHeader* previous);
+// Function to build the payload of a painting block before it is sealed
+PaintingBlockchain buildPaintingBlock(string_view paintingId, string_view paintingLocation, string_view paintingDetails, string_view PaintingColor, string_view paintingType, string_view paintingThickness);
+// Function to generate a blockchain block for the painting stage
+PaintingBlockchain generatePaintingBlockChain(string_view paintingId, string_view paintingLocation, string_view paintingDetails, string_view PaintingColor, string_view paintingType, string_view paintingThickness, const BlockHeader* previous);
+// Function to build the payload of a assembly block before it is sealed
+AssemblyBlockchain buildAssemblyBlock(string_view assemblyId, string_view assemblyLocation, string_view assemblyDetails, string_view assemblyType, string_view numberOfParts, string_view assemblyWeight);
+// Function to generate a blockchain block for the assembly stage
+AssemblyBlockchain generateAssemblyBlockChain(string_view assemblyId, string_view assemblyLocation, string_view assemblyDetails, string_view assemblyType, string_view numberOfParts, string_view assemblyWeight, const BlockHeader* previous);
+// Function to build the payload of a shipping block before it is sealed
+ShippingBlockchain buildShippingBlock(string_view shippingId, string_view shippingDestination, string_view shippingDetails, string_view shippingType, string_view carrierName, string_view shippingStatus);
+// Function to generate a blockchain block for the shipping stage
+ShippingBlockchain generateShippingBlockChain(string_view shippingId, string_view shippingDestination, string_view shippingDetails, string_view shippingType, string_view carrierName, string_view shippingStatus, const BlockHeader* previous);
+// Function to build the payload of a transaction block before it is sealed
+TransactionBlockchain buildTransactionBlock(string_view transactionId, string_view transactionType, string_view transactionAmount, string_view sender, string_view receiver, string_view currency, string_view transactionStatus);
+// Function to generate a blockchain block for the transaction stage
+TransactionBlockchain generateTransactionBlockChain(string_view transactionId, string_view transactionType, string_view transactionAmount, string_view sender, string_view receiver, string_view currency, string_view transactionStatus, const BlockHeader* previous);
+// Function to serialize the canonical payload of a transaction (a Merkle leaf of a batch block)
+string transactionLeaf(const TransactionBlockchain& transaction);
+// Function to find the Ed25519 key registered for a transaction sender
+const SignerKey* findSignerKey(string_view sender);
+// Function to attach a row's signature and the sender's registered key to a transaction
+bool attachTransactionSignature(TransactionBlockchain& transaction, string_view signatureHex);
+// Function to check the signature of one transaction
+bool verifyTransactionSignature(const TransactionBlockchain& transaction);
+// Function to check the signatures of many transactions in batches on all cores
+size_t verifyTransactionSignatures(const vector<TransactionBlockchain>& transactions, vector<char>& valid);
+// Function to build the Merkle tree over a batch of leaves, hashing the leaves on several threads
+void buildMerkleTree(const vector<string_view>& leaves, MerkleTree& tree, unsigned threadCount = 0);
+// Function to get the root of a Merkle tree (all zeros for an empty tree)
+BlockHash merkleRoot(const MerkleTree& tree);
+// Function to build the inclusion proof of one leaf
+MerkleProof merkleProof(const MerkleTree& tree, uint64_t leafIndex);
+// Function to check that a leaf is part of the tree with the given root
+bool verifyMerkleProof(string_view leaf, const MerkleProof& proof, const BlockHash& root);
+// Function to build the inclusion proof of the transaction with a given ID within a batch
+bool proveTransaction(const vector<TransactionBlockchain>& transactions, string_view transactionId, MerkleProof& proof);
+// Function to build the payload of a transaction batch block and append the encoded transactions stored with it to body
+TransactionBatchBlock buildTransactionBatchBlock(const vector<TransactionBlockchain>& transactions, string& body);
+// Function to decode the transactions stored in a batch block's record
+bool decodeBatchTransactions(string_view record, vector<TransactionBlockchain>& transactions);
+// Function to check a transaction against a batch block header with a compact proof (no other transaction needed)
+bool verifyTransactionInclusion(const TransactionBatchBlock& block, const TransactionBlockchain& transaction, const MerkleProof& proof);
+// Function to print the dataset
+void printDataset(const vector<vector<string>>& dataset);
+// Function to memory-map a file read-only
+bool mapFile(const string& path, MappedFile& file);
+// Function to release a file mapping
+void unmapFile(MappedFile& file);
+// Function to split one CSV/TSV row into fields without copying
+void splitRow(string_view row, char delimiter, vector<string_view>& fields, string& scratch);
+// Function to turn one parsed row into the next block of the chain
+bool ingestRow(IngestState& state, const vector<string_view>& fields);
+// Function to hand the open batch to its consumer and start a new one
+void flushBatch(IngestState& state);
+// Function to seal the waiting transactions of an ingestion into one batch block
+void sealTransactionBatch(IngestState& state);
+// Function to seal whatever an ingestion still holds and hand over the last batch
+void finishIngest(IngestState& state);
+// Function to stream every row of a memory-mapped CSV or TSV file into the blockchain generators
+bool ingestFile(const string& path, IngestState& state);
+// Function to feed the built-in demo dataset through the same row path as file ingestion
+void ingestDataset(const vector<vector<string>>& rows, IngestState& state);
+// Function to prepare the Zipf tables of a synthetic workload
+void prepareWorkload(Workload& workload, const WorkloadOptions& options);
+// Function to write the seven rows of one generated vehicle
+void generateVehicleRows(const Workload& workload, uint64_t vehicle, string& out);
+// Function to give every company of a workload a signing key derived from the workload seed
+void deriveWorkloadKeys(const WorkloadOptions& options);
+// Function to load sender keys from a file
+bool loadSignerKeys(const string& path);
+// Function to write every sender key to a file
+bool writeSignerKeys(const string& path);
+// Function to load or create the sender keys named on the command line
+bool prepareSignerKeys(const CommandOptions& options);
+// Function to get the supplierId of one generated vehicle without generating its rows
+void workloadSupplierId(const Workload& workload, uint64_t vehicle, string& out);
+// Function to feed a range of generated vehicles through the same row path as file ingestion
+void ingestWorkload(const Workload& workload, uint64_t first, uint64_t end, IngestState& state);
+// Function to write generated vehicles to a CSV file
+bool writeWorkloadFile(const Workload& workload, const string& path);
+// Function to open (or create) a persistent chain store
+bool openChainStore(ChainStore& store, const ChainStoreOptions& options);
+// Function to append one block to the store, applying the configured durability policy
+bool appendBlock(ChainStore& store, const StageBlock& block, string_view batchBody = string_view());
+// Function to append an already encoded record body to the store
+bool appendBlockRecord(ChainStore& store, string_view record);
+// Function to commit every block appended so far (group commit)
+bool commitChainStore(ChainStore& store);
+// Function to count the blocks in the store
+uint64_t storeBlockCount(ChainStore& store);
+// Function to read the record body of the block at a chain position
+bool readStoreRecord(ChainStore& store, uint64_t index, string_view& record, string& scratch);
+// Function to read and decode the block at a chain position
+bool readStoredBlock(ChainStore& store, uint64_t index, StageBlock& block);
+// Function to sync and close a chain store
+void closeChainStore(ChainStore& store);
+// Function to continue ingestion where a reopened store left off
+void restoreIngestState(ChainStore& store, IngestState& state);
+// Function to open a consistent read-only view of every record in the store
+bool openStoreReadView(ChainStore& store, StoreReadView& view);
+// Function to release a store read view
+void closeStoreReadView(StoreReadView& view);
+// Function to get the canonical record at a chain position from a read view
+string_view storeViewRecord(const StoreReadView& view, uint64_t index, string& scratch);
+// Function to visit the blocks of a read view inside a time window, skipping what the time index rules out
+uint64_t scanTimeRange(const StoreReadView& view, const TimeRangeQuery& query, TimeRangeStats& stats,
+                       const function<bool(uint64_t, uint8_t, uint64_t)>& visit);
+// Function to parse a local time (YYYYMMDD[:HH[:MM[:SS]]]) into nanoseconds since the Unix epoch
+bool parseLocalTime(string_view text, uint64_t& timestamp);
+// Function to turn the --from, --to and --stage texts of a range export or report into a range query
+bool parseTimeRange(const string& from, const string& to, const string& stage, TimeRangeQuery& query, string& error);
+// Function to verify every hash and link of the stored chain on all cores
+VerifyReport verifyChainStore(ChainStore& store, unsigned threadCount = 0);
+// Function to print the result of a chain verification
+void printVerifyReport(const VerifyReport& report);
+// Function to start a shared chain after the given tip block (nullptr for an empty chain)
+void initSharedChain(SharedChain& chain, ChainStore* store, const BlockHeader* tip);
+// Function to number, link, hash and publish a block on a shared chain from any thread
+bool appendToChain(SharedChain& chain, StageBlock& block, uint64_t upstreamNumber = 0, string_view batchBody = string_view());
+// Function to read the newest published block of a shared chain without blocking appenders
+uint64_t sharedChainTip(const SharedChain& chain, BlockHash& hash);
+// Function to run input files through the seven-stage pipeline onto a shared chain
+bool runPipeline(const vector<string>& paths, SharedChain& chain, const PipelineOptions& options,
+                 const function<void(const BlockBatch&)>& onBatch, PipelineReport& report);
+// Function to print the per-stage statistics of a pipeline run
+void printPipelineReport(const PipelineReport& report);
+// Function to add every block of a batch to the hash and business-ID indexes
+void indexBlocks(BlockIndex& index, const BlockBatch& batch);
+// Function to rebuild the indexes from every block in the store on all cores
+void rebuildBlockIndex(BlockIndex& index, ChainStore& store, unsigned threadCount = 0);
+// Function to find the number of the block with a given hash (0 if there is none)
+uint64_t findBlockByHash(BlockIndex& index, const BlockHash& hash);
+// Function to find the numbers of every block carrying a business ID, in chain order
+vector<uint64_t> findBlocksById(BlockIndex& index, string_view id);
+// Function to add the vehicle edges of every block of a batch to the provenance graph
+void linkProvenance(ProvenanceGraph& graph, const BlockBatch& batch);
+// Function to rebuild the provenance graph from every block in the store on all cores
+void rebuildProvenanceGraph(ProvenanceGraph& graph, ChainStore& store, unsigned threadCount = 0);
+// Function to trace the whole vehicle (supplier to transaction) of each of many blocks in one call
+vector<VehicleTrace> traceVehicles(ProvenanceGraph& graph, const vector<uint64_t>& numbers, unsigned threadCount = 0);
+// Function to append every block of a batch to the columnar projection
+void projectBlocks(AnalyticsStore& analytics, const BlockBatch& batch);
+// Function to rebuild the columnar projection from every block in the store, decoding on all cores
+void rebuildAnalytics(AnalyticsStore& analytics, ChainStore& store, unsigned threadCount = 0);
+// Function to find a stage table by name (Supply ... Transaction); 0 if there is none
+int findAnalyticsStage(string_view name);
+// Function to find a column of a stage table by its key (as in the JSON export); -1 if there is none
+int findAnalyticsColumn(int stage, string_view key);
+// Function to run a filtered, grouped aggregation over one stage table on all cores
+AnalyticsResult runAnalyticsQuery(AnalyticsStore& analytics, const AnalyticsQuery& query, unsigned threadCount = 0);
+// Function to print the groups and scan statistics of a query
+void printAnalyticsResult(const AnalyticsQuery& query, const AnalyticsResult& result);
+// Function to turn the text of an analytics query (stage, value column, group column, column=value filter, hours) into a query
+bool parseAnalyticsQuery(const string& stage, const string& value, const string& group, const string& filter, double hours,
+                         AnalyticsQuery& query, string& error);
+// Function to parse an output format name (console, plain, jsonl, csv)
+bool parseRenderMode(string_view name, RenderMode& mode);
+// Function to format a block into the renderer's buffer, writing it out when the buffer is full
+void renderBlock(Renderer& renderer, const StageBlock& block);
+// Function to write out everything the renderer has buffered
+bool flushRenderer(Renderer& renderer);
+// Function to render every block of the store in chain order
+uint64_t renderStoredChain(ChainStore& store, Renderer& renderer);
+// Function to render the stored blocks inside a time window in chain order
+uint64_t renderStoredRange(ChainStore& store, const TimeRangeQuery& query, Renderer& renderer, TimeRangeStats& stats);
+// Function to print a block in the SupplierBlockchain
+void printSupplierBlockchain(const SupplierBlockchain& block);
+// Function to print a block in the PressBlockchain
+void printPressBlockchain(const PressBlockchain& block);
+// Function to print a block in the WeldingBlockchain
+void printWeldingBlockchain(const WeldingBlockchain& block);
+// Function to print a block in the PaintingBlockchain
+void printPaintingBlockchain(const PaintingBlockchain& block);
+// Function to print a block in the AssemblyBlockchain
+void printAssemblyBlockchain(const AssemblyBlockchain& block);
+// Function to print a block in the ShippingBlockchain
+void printShippingBlockchain(const ShippingBlockchain& block);
+// Function to print a block in the TransactionBlockchain
+void printTransactionBlockchain(const TransactionBlockchain& block);
+// Function to print a transaction together with its inclusion proof
+void printTransactionProof(const TransactionBatchBlock& block, const TransactionBlockchain& transaction, const MerkleProof& proof);
+// Functions to append a block's hashed content (stage, number, timestamp, payload, previous hash) to a byte string
+void appendBlockContent(string& out, const SupplierBlockchain& block);
+void appendBlockContent(string& out, const PressBlockchain& block);
+void appendBlockContent(string& out, const WeldingBlockchain& block);
+void appendBlockContent(string& out, const PaintingBlockchain& block);
+void appendBlockContent(string& out, const AssemblyBlockchain& block);
+void appendBlockContent(string& out, const ShippingBlockchain& block);
+void appendBlockContent(string& out, const TransactionBlockchain& block);
+void appendBlockContent(string& out, const TransactionBatchBlock& block);
+void appendBlockContent(string& out, const UpdateBlock& block);
+// Function to serialize a block's hashed content into a new string
+template <typename Block>
+string blockContent(const Block& block);
+// Function to generate a hash for a blockchain block from its canonical content
+BlockHash generateBlockHash(const string& content);
+// Function to search on all cores for the nonce that gives a block's content a hash with the header's difficulty
+BlockHash sealProofOfWork(string& content, BlockHeader& header);
+// Function to print the proof-of-work search statistics
+void printProofOfWorkReport();
+// Function to record a timed event of a metric in the calling thread's shard, standing for weight events
+void recordMetric(unsigned metric, uint64_t ticks, uint64_t weight = 1);
+// Function to add to a counter in the calling thread's shard
+void countMetric(unsigned counter, uint64_t amount = 1);
+// Function to render every metric, merged over all threads, in the Prometheus text exposition format
+string formatMetrics();
+// Function to print a latency summary (count, mean and percentiles) of every metric that has events
+void printMetricsReport(ostream& out);
+// Function to write the Prometheus text of every metric to a file (replaced atomically)
+bool writeMetricsFile(const string& path);
+// Function to hash several block contents in one call (multi-buffer SIMD where available)
+vector<BlockHash> generateBlockHashes(const vector<string>& contents);
+// Function to convert a binary digest to lowercase hexadecimal text
+string hashToHex(const uint8_t* digest, size_t length);
+// Function to parse hexadecimal text into a fixed number of bytes
+bool hexToBytes(string_view hex, uint8_t* bytes, size_t length);
+// Function to parse 64 hexadecimal digits into a block hash
+bool hexToHash(string_view hex, BlockHash& hash);
+// Function to compute the SHA-256 digest of a byte range
+void sha256(const void* data, size_t length, uint8_t digest[32]);
+// Function to compute SHA-256 digests of several byte ranges at once
+void sha256Batch(const uint8_t* const* data, const size_t* lengths, size_t count, uint8_t* digests);
+// Function to absorb every whole 64-byte block of a message prefix into a midstate
+void sha256Begin(Sha256Midstate& midstate, const void* data, size_t length);
+// Function to finish a digest from a midstate and the rest of the message
+void sha256Finish(const Sha256Midstate& midstate, const void* rest, size_t restLength, uint8_t digest[32]);
+// Function to compute the SHA-512 digest of a byte range
+void sha512(const void* data, size_t length, uint8_t digest[64]);
+// Function to derive the Ed25519 public key of a 32-byte secret seed
+void ed25519PublicKey(const uint8_t seed[32], uint8_t publicKey[32]);
+// Function to sign a message with an Ed25519 secret seed
+void ed25519Sign(const uint8_t seed[32], const uint8_t publicKey[32], string_view message, uint8_t signature[64]);
+// Function to check one Ed25519 signature
+bool ed25519Verify(const uint8_t publicKey[32], string_view message, const uint8_t signature[64]);
+// Function to check many Ed25519 signatures with batched multi-scalar multiplications on all cores
+size_t ed25519VerifyBatch(const SignatureCheck* checks, size_t count, char* valid, unsigned threadCount = 0);
+// Function to generate a timestamp for a blockchain block
+uint64_t generateTimestamp();
+// Function to format a nanosecond timestamp as "YYYYMMDD:HH:MM:SS"
+string formatTimestamp(uint64_t timestamp);
+// Function to append a formatted timestamp to a buffer, optionally with its nanoseconds
+void appendTimestamp(string& out, uint64_t timestamp, bool withNanoseconds);
+// Function to return the handle of a string, adding it to the pool the first time it is seen
+StringId internString(string_view value);
+// Function to look up the text behind a string handle
+string_view lookupString(StringId id);
+// Function to find the handle of a string without adding it to the pool
+bool findString(string_view value, StringId& id);
+// Function to parse a whole-number field
+uint32_t parseCount(string_view text);
+// Function to parse a decimal measurement
+float parseMeasure(string_view text);
+// Function to parse a decimal amount into fixed-point Money
+bool parseMoney(string_view text, Money& value);
+// Function to format fixed-point Money
+string formatMoney(Money value);
+// Function to read the subcommand, options, input files and lookup keys from the command line
+bool parseCommandLine(int argc, char* argv[], CommandOptions& options);
+// Function to print the command-line usage
+void printUsage(const char* program);
+// Function to open the store (if any) and rebuild every lookup structure from it
+bool openSession(ChainSession& session, const CommandOptions& options);
+// Function to close the session's store
+void closeSession(ChainSession& session);
+// Function to write a checkpoint of the session's lookup structures next to the store
+bool writeCheckpoint(ChainSession& session);
+// Function to write a checkpoint once enough blocks have been committed since the last one
+void maybeCheckpoint(ChainSession& session);
+// Function to restore the session's lookup structures from the newest valid checkpoint and replay the blocks after it
+bool loadCheckpoint(ChainSession& session);
+// Function to add a batch of new blocks to the session's indexes (and its in-memory chain when there is no store)
+void keepSessionBlocks(ChainSession& session, const BlockBatch& batch);
+// Function to fetch a block by number from the store or the in-memory chain
+bool fetchSessionBlock(ChainSession& session, uint64_t number, StageBlock& block);
+// Function to fetch the transactions a batch block commits to
+bool fetchSessionBatch(ChainSession& session, uint64_t number, vector<TransactionBlockchain>& transactions);
+// Function to find the blocks named by a hash (64 hex digits) or a business ID such as SUP001 or TRANS007
+vector<uint64_t> findSessionBlocks(ChainSession& session, const string& key);
+// Function to find the blocks named by a hash or business ID with the changes of their update blocks applied
+vector<StageBlock> findSessionView(ChainSession& session, const string& key);
+// Function to ingest the input files, then any generated vehicles (sequentially, one thread per file or as a pipeline) into the session
+bool ingestInputs(ChainSession& session, const CommandOptions& options);
+// Function to render every block of the session in chain order
+uint64_t exportSession(ChainSession& session, Renderer& renderer);
+// Function to run a headless subcommand; returns the process exit code
+int runCommand(ChainSession& session, const CommandOptions& options);
+// Function to serve appends and lookups on a Unix domain socket until SIGINT or SIGTERM
+bool runService(ChainSession& session, const string& socketPath);
+// Function to find how many shard chains a store directory holds (0 for an unsharded store)
+unsigned countShards(const string& directory);
+// Function to pick the shard of a vehicle from its supplierId
+unsigned shardOfSupplier(string_view supplierId, unsigned shardCount);
+// Function to open every shard chain of a sharded store and its anchor chain
+bool openShardedStore(ShardedStore& sharded, const CommandOptions& options);
+// Function to close every shard chain and the anchor chain
+void closeShardedStore(ShardedStore& sharded);
+// Function to append an anchor block committing to the current tip of every shard
+bool anchorShards(ShardedStore& sharded, const vector<SharedChain>& chains);
+// Function to ingest the input files into a sharded store, one thread per shard
+bool ingestShards(ShardedStore& sharded, const CommandOptions& options);
+// Function to verify every shard chain, the anchor chain and every shard tip the anchors commit to
+ShardVerifyReport verifyShardedStore(ShardedStore& sharded);
+// Function to print the result of a sharded store verification
+void printShardVerifyReport(const ShardVerifyReport& report);
+// Function to run a headless subcommand on a sharded store; returns the process exit code
+int runShardedCommand(ShardedStore& sharded, const CommandOptions& options);
+
+
+//Structures
+struct User { // Define a struct to hold user credentials
+    string username; // username
+    string password; // password
+};
+
+// One independently locked part of the string pool; a string always lands in the shard picked by its hash
+struct StringPoolShard {
+    mutex lock;                                        // Taken only to add strings, never to look them up
+    atomic<string_view*> pages[STRING_MAX_PAGES] = {}; // Fixed-address pages of interned strings (views into the arena)
+    vector<unique_ptr<string_view[]>> ownedPages;      // Storage behind pages
+    atomic<uint32_t> count{0};                         // Strings published in this shard
+    vector<unique_ptr<char[]>> chunks;                 // Arena chunks holding the characters of every interned string
+    size_t chunkUsed = 0;                              // Bytes used in the newest chunk
+    size_t chunkCapacity = 0;                          // Size of the newest chunk
+    vector<uint32_t> slots;                            // Open-addressing table: shard-local index + 1 per slot, 0 marks an empty slot
+};
+
+// Arena-backed pool of interned strings; repeated values (locations, manufacturers, carriers...) are stored once.
+// StringId = shard-local index * STRING_POOL_SHARDS + shard, so lookups need no lock and no shared counter.
+struct StringPool {
+    StringPoolShard shards[STRING_POOL_SHARDS]; // Independent shards so interning threads rarely contend
+};
+
+// Pool holding the text of every interned block field
+StringPool stringPool;
+
+// Block timestamps: UTC nanoseconds read once at startup and advanced by the monotonic clock, so they never
+// jump with wall-clock adjustments, and each one handed out is strictly later than the one before
+struct BlockClock {
+    int64_t utcAnchor = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count(); // UTC at the anchor
+    int64_t steadyAnchor = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count(); // Monotonic time at the anchor
+    atomic<uint64_t> last{0}; // Newest timestamp handed out
+};
+
+// Clock shared by every thread that creates blocks
+BlockClock blockClock;
+
+// Proof-of-work setting applied to every new block, with counters of the nonce search
+struct ProofOfWork {
+    unsigned difficulty = 0;          // Leading zero bits new block hashes must have (0 = no proof of work)
+    atomic<uint64_t> blocks{0};       // Blocks sealed with a proof
+    atomic<uint64_t> hashes{0};       // Nonces tried
+    atomic<uint64_t> nanoseconds{0};  // Wall-clock time spent searching
+};
+
+// Proof-of-work setting shared by every thread that seals blocks
+ProofOfWork proofOfWork;
+
+// Ed25519 key registered for one transaction sender
+struct SignerKey {
+    array<uint8_t, 32> publicKey{}; // Key every signature of the sender must verify under
+    array<uint8_t, 32> seed{};      // Secret seed (only known for keys this instance signs with)
+    bool canSign = false;           // Whether seed is set
+};
+
+// Sender keys loaded with --keys (read-only once loaded): with a key registered, a sender's transactions must be
+// signed by it. Names are not interned, so loading the keys leaves the string pool alone
+map<string, SignerKey, less<>> signerKeys;
+
+// Timed operations, each with a latency histogram (the build metrics are in stage order)
+enum MetricId : unsigned {
+    METRIC_BUILD_SUPPLY,        // build*Block per stage: parse and intern a row's fields
+    METRIC_BUILD_PRESS,
+    METRIC_BUILD_WELDING,
+    METRIC_BUILD_PAINTING,
+    METRIC_BUILD_ASSEMBLY,
+    METRIC_BUILD_SHIPPING,
+    METRIC_BUILD_TRANSACTION,
+    METRIC_BUILD_BATCH,         // Merkle tree and body of a transaction batch block
+    METRIC_SEAL,                // Header and hash of a block sealed onto a private chain
+    METRIC_LINK,                // appendToChain: wait for the turn, link, hash and store
+    METRIC_VERIFY,              // One full verification of the store
+    METRIC_STORE_APPEND,        // Encoding and buffering one record
+    METRIC_STORE_WRITE,         // Handing the write buffer to the kernel
+    METRIC_STORE_SYNC,          // fdatasync of the active segment
+    METRIC_STORE_ROTATE,        // Sealing a full segment and opening the next
+    METRIC_STORE_READ,          // Reading one record by position
+    METRIC_STORE_SCAN,          // One time-range scan of a store read view
+    METRIC_CHECKPOINT,          // Writing a checkpoint
+    METRIC_RENDER_FLUSH,        // Writing rendered blocks out
+    METRIC_SERVICE_REQUEST,     // Handling one service request line
+    METRIC_COUNT
+};
+
+// Plain event counters
+enum CounterId : unsigned {
+    COUNTER_ROWS_INGESTED,      // Rows that became blocks or batched transactions
+    COUNTER_ROWS_SKIPPED,       // Rows rejected (unknown stage, out of vehicle order or a bad or missing signature)
+    COUNTER_STORE_BYTES,        // Record bytes appended to the store
+    COUNTER_RENDER_BYTES,       // Rendered bytes written
+    COUNTER_BLOCKS_VERIFIED,    // Blocks checked by verifications
+    COUNTER_COUNT
+};
+
+// Name, labels and help text of a metric as exported
+struct MetricInfo {
+    const char* name;   // Prometheus metric name (histograms get _bucket, _sum and _count)
+    const char* labels; // Label set without braces (empty for none)
+    const char* help;   // HELP text, shared by every metric of the same name
+    unsigned sampleShift; // Only every 2^shift-th event is timed, and counts 2^shift times (per-block metrics)
+};
+
+// One thread's histograms and counters. Only the owning thread writes (plain load + store, no read-modify-write),
+// any thread may read, so merging needs no lock
+struct MetricShard {
+    atomic<uint64_t> buckets[METRIC_COUNT][METRIC_BUCKETS]; // Events per log-linear bucket of tick counts
+    atomic<uint64_t> ticks[METRIC_COUNT];                   // Total ticks of every metric
+    atomic<uint64_t> counters[COUNTER_COUNT];               // Counter values
+    atomic<bool> inUse{false};                              // Owned by a running thread (a finished thread's shard is reused, counts kept)
+};
+
+// Shards of every thread that has recorded, plus the calibration that turns ticks into seconds
+struct MetricRegistry {
+    atomic<MetricShard*> shards[METRICS_MAX_THREADS] = {}; // Shards ever created (never freed)
+    atomic<unsigned> shardCount{0};                         // Slots of shards in use
+    bool tsc = false;                                       // Ticks are TSC cycles (invariant TSC), otherwise steady-clock nanoseconds
+    uint64_t startTicks = 0;                                // Ticks when the program started
+    int64_t startNanoseconds = 0;                           // Steady clock when the program started
+};
+
+// Registry of every thread's metric shard
+MetricRegistry metricRegistry;
+
+// Calling thread's shard: claimed on first use, handed back when the thread ends
+struct MetricThreadSlot {
+    MetricShard* shard = nullptr; // Shard this thread writes (nullptr until it records something)
+    ~MetricThreadSlot() {
+        if (shard != nullptr) shard->inUse.store(false, memory_order_release);
+    }
+};
+
+#ifndef TMS_NO_METRICS
+// Times the enclosing scope into a metric's histogram
+struct MetricTimer {
+    unsigned metric;      // Metric the scope is recorded in
+    uint32_t weight = 0;  // Events this one stands for when timed (0 = not timed)
+    uint64_t start = 0;   // Ticks when the scope began
+    explicit MetricTimer(unsigned id);
+    ~MetricTimer();
+};
+#else
+// Metrics compiled out: the timer does nothing and costs nothing
+struct MetricTimer {
+    explicit MetricTimer(unsigned) {}
+};
+#endif
+
+// Formatted "YYYYMMDD:HH:MM:SS" text of the last second a thread displayed (blocks arrive in bursts within a second)
+struct TimestampCache {
+    int64_t second = INT64_MIN; // Unix second the text belongs to
+    char text[18] = {};         // Formatted second
+};
+
+// Fields shared by every block of every stage (96 bytes, no heap allocations)
+struct BlockHeader {
+    uint64_t blockNumber;           // Unique number or identifier of the block
+    uint64_t timestamp;             // Creation time in nanoseconds since the Unix epoch (UTC)
+    BlockHash currentBlockHash;     // SHA-256 of the block's canonical content
+    BlockHash previousBlockHash;    // SHA-256 of the previous block in the chain
+    uint32_t upstreamOffset;        // Block numbers back to the same vehicle's previous-stage block (0 for a supplier block)
+    uint8_t difficulty;             // Leading zero bits currentBlockHash must have (0 = sealed without proof of work)
+    uint64_t nonce;                 // Value that gives the hash its leading zero bits
+};
+
+struct SupplierBlockchain {
+    BlockHeader header;          // Block number, timestamp and hash links
+    StringId supplierId;         // Identifier of the supplier associated with this block
+    StringId supplierName;       // Name of the supplier associated with this block
+    StringId supplierItem;       // Item provided by the supplier
+    StringId location;           // Location of the supplier
+    StringId branch;             // Branch of the supplier
+    uint32_t quantity;           // Quantity of the supplied item
+    Money price;                 // Price of the supplied item
+};
+
+
+struct PressBlockchain {
+    BlockHeader header;          // Block number, timestamp and hash links
+    StringId pressId;            // Identifier of the press associated with this block
+    StringId pressLocation;      // Location of the press
+    StringId pressDetails;       // Details or description of the press
+    StringId pressType;          // Type of the press (e.g., hydraulic, pneumatic)
+    StringId pressManufacturer;  // Manufacturer of the press
+    float pressCapacity;         // Capacity of the press (e.g., in tons)
+};
+
+
+struct WeldingBlockchain {
+    BlockHeader header;          // Block number, timestamp and hash links
+    StringId weldingId;          // Identifier of the welding process associated with this block
+    StringId weldingLocation;    // Location where welding took place
+    StringId weldingDetails;     // Details or description of the welding process
+    StringId weldingType;        // Type of welding process (e.g., MIG, TIG)
+    StringId weldingMaterial;    // Material being welded
+    float weldingTemperature;    // Temperature of the welding process
+};
+
+struct PaintingBlockchain {
+    BlockHeader header;          // Block number, timestamp and hash links
+    StringId paintingId;        // Identifier of the painting process associated with this block
+    StringId paintingLocation;  // Location where painting took place
+    StringId paintingDetails;   // Details or description of the painting process
+    StringId paintingColor;     // Color of the paint used
+    StringId paintingType;      // Type or method of painting (e.g., spray painting)
+    float paintingThickness;    // Thickness of the paint layer applied
+};
+
+
+struct AssemblyBlockchain {
+    BlockHeader header;          // Block number, timestamp and hash links
+    StringId assemblyId;        // Identifier of the assembly process associated with this block
+    StringId assemblyLocation;  // Location where assembly took place
+    StringId assemblyDetails;   // Details or description of the assembly process
+    StringId assemblyType;      // Type or category of assembly (e.g., vehicle assembly)
+    uint32_t numberOfParts;     // Number of parts used in the assembly
+    float assemblyWeight;       // Weight of the assembled product
+};
+
+
+struct ShippingBlockchain {
+    BlockHeader header;             // Block number, timestamp and hash links
+    StringId shippingId;           // Identifier of the shipping process associated with this block
+    StringId shippingDestination;  // Destination of the shipment
+    StringId shippingDetails;      // Details or description of the items being shipped
+    StringId shippingType;         // Type or mode of shipping (e.g., air, sea, land)
+    StringId carrierName;          // Name of the shipping carrier or company
+    StringId shippingStatus;       // Current status of the shipping process
+};
+
+
+struct TransactionBlockchain {
+    BlockHeader header;         // Block number, timestamp and hash links
+    StringId transactionId;     // Identifier of the transaction
+    StringId transactionType;   // Type or category of the transaction
+    StringId sender;            // Sender of the transaction
+    StringId receiver;          // Receiver of the transaction
+    StringId currency;          // Currency used in the transaction
+    StringId transactionStatus; // Current status of the transaction
+    Money transactionAmount;    // Amount involved in the transaction
+    StringId signature;         // Signer's Ed25519 public key (32 bytes) and signature (64 bytes); empty if unsigned
+};
+
+// Block committing to many transactions at once. Only the count and the Merkle root are hashed into the chain;
+// the transactions travel with the block (outside its hash), so one of them is proven with a header and a path
+struct TransactionBatchBlock {
+    BlockHeader header;         // Block number, timestamp and hash links
+    uint32_t transactionCount;  // Transactions committed to by the block
+    BlockHash merkleRoot;       // Root of the Merkle tree over the transactions' canonical payloads
+};
+
+// Block changing some fields of an earlier Supply..Transaction block, which is never rewritten: only the target's
+// hash and stage and the changed values are hashed and stored, and reads merge the changes into the target
+struct UpdateBlock {
+    BlockHeader header;                     // Block number, timestamp and hash links (upstreamOffset reaches back to the target)
+    BlockHash targetHash;                   // Hash of the block whose fields change
+    StringId targetId;                      // Business ID of that block (looked up, not stored: the update is indexed under it)
+    uint8_t targetStage;                    // Stage of that block
+    uint8_t fieldCount;                     // Changed fields
+    uint8_t columns[UPDATE_MAX_FIELDS];     // Render column of every changed field, ascending (never 0, the ID)
+    StringId values[UPDATE_MAX_FIELDS];     // New value of every changed field, as text
+};
+
+// Merkle tree over the transactions of a batch block. Leaves are hashed as SHA-256(0x00 || leaf) and inner
+// nodes as SHA-256(0x01 || left || right), so a leaf can never pass for a node; the last node of an odd level
+// is carried up unchanged
+struct MerkleTree {
+    vector<vector<BlockHash>> levels;  // Node hashes of every level, leaves first, root last
+};
+
+// Inclusion proof of one leaf: 32 bytes per level instead of the whole batch
+struct MerkleProof {
+    uint64_t leafIndex = 0;        // Position of the leaf in the batch
+    uint64_t leafCount = 0;        // Leaves in the batch (tells which levels carry a node up without a sibling)
+    vector<BlockHash> siblings;    // Sibling hash of every level that has one, leaf level first
+};
+
+// One block of any stage, tagged with its stage number (1 = Supply ... 7 = Transaction, 8 = transaction batch, 10 = update)
+struct StageBlock {
+    uint8_t stage;                          // Which member of the union holds the block
+    union {
+        SupplierBlockchain supplier;        // Stage 1
+        PressBlockchain press;              // Stage 2
+        WeldingBlockchain welding;          // Stage 3
+        PaintingBlockchain painting;        // Stage 4
+        AssemblyBlockchain assembly;        // Stage 5
+        ShippingBlockchain shipping;        // Stage 6
+        TransactionBlockchain transaction;  // Stage 7
+        TransactionBatchBlock batch;        // Transaction batch
+        UpdateBlock update;                 // Update of an earlier block
+    };
+};
+
+// Blocks produced by one bounded ingestion batch, in chain order
+struct BlockBatch {
+    vector<StageBlock> blocks;  // Blocks generated since the last flush
+    vector<TransactionBlockchain> batchedTransactions; // Transactions of the batch blocks above, in order (header number and time = their batch block's)
+    string batchBodies;          // Stored transactions of every batch block above, back to back (one buffer reused across flushes)
+    vector<size_t> batchBodyEnds; // End of each batch block's transactions in batchBodies
+};
+
+// Running state of a streaming ingestion: the latest block of every stage plus the open batch
+struct IngestState {
+    SupplierBlockchain supplier{};       // Latest supplier block (upstream link for the next press row)
+    PressBlockchain press{};             // Latest press block
+    WeldingBlockchain welding{};         // Latest welding block
+    PaintingBlockchain painting{};       // Latest painting block
+    AssemblyBlockchain assembly{};       // Latest assembly block
+    ShippingBlockchain shipping{};       // Latest shipping block
+    TransactionBlockchain transaction{}; // Latest transaction block (links the next vehicle's supplier block)
+    TransactionBatchBlock transactionBatch{}; // Latest transaction batch block
+    UpdateBlock update{};                // Latest update block
+    int lastStage = 0;                   // Stage of the latest row (0 = nothing ingested yet, 1..7 = Supply..Transaction; updates leave it)
+    int tipStage = 0;                    // Stage of the newest sealed block (8 = transaction batch, 10 = update)
+    size_t transactionBatchSize = 0;     // Transactions per batch block (0 = one block per transaction)
+    vector<TransactionBlockchain> pendingTransactions; // Transactions waiting for their batch block
+    BlockBatch batch;                    // Blocks generated since the last flush
+    size_t batchLimit = 4096;            // Number of blocks that triggers a flush
+    function<void(const BlockBatch&)> onBatch; // Consumer called with every full (and the final partial) batch
+    size_t rowsRead = 0;                 // Rows turned into blocks
+    size_t rowsSkipped = 0;              // Blank, header, unknown or out-of-order rows
+    size_t updatesApplied = 0;           // Update rows turned into update blocks (counted in rowsRead too)
+    size_t updatesMissed = 0;            // Update rows skipped: no such target, an unknown key or too many fields (counted in rowsSkipped too)
+    size_t signaturesVerified = 0;       // Signed transaction rows whose signature checked out
+    size_t signaturesRejected = 0;       // Transaction rows dropped for a bad, unregistered or missing signature (counted in rowsSkipped too)
+    SharedChain* chain = nullptr;        // Shared chain to append to instead of linking this state's own blocks
+    function<bool(string_view, StageBlock&)> findTarget; // Finds the block an update row names by hash or ID (unset: update rows are skipped)
+};
+
+// Read-only memory mapping of an input file
+struct MappedFile {
+    const char* data = nullptr; // First byte of the mapping
+    size_t size = 0;            // Length of the file in bytes
+    int fd = -1;                // Open file descriptor backing the mapping
+};
+
+// Bounds-checked cursor over an encoded record
+struct ByteReader {
+    const char* position;   // Next byte to read
+    const char* end;        // One past the last readable byte
+    bool ok = true;         // Cleared as soon as a read runs past the end
+};
+
+// Output formats of the block renderer
+enum class RenderMode {
+    Console,    // Coloured tables with stage descriptions, as shown in the menu
+    Plain,      // One tab-separated line per block, no colour
+    JsonLines,  // One JSON object per block
+    Csv         // Header row, then one comma-separated row per block
+};
+
+// One payload column of a stage as the renderer shows it
+struct RenderColumn {
+    const char* label;  // Console label, padded to the stage's alignment
+    const char* key;    // JSON key
+    const char* unit;   // Console unit suffix
+    bool numeric;       // Written unquoted in JSON
+};
+
+// Everything the renderer shows about a stage apart from the block's own values
+struct StageRenderInfo {
+    const char* title;           // Console title line
+    const char* name;            // Short stage name for machine formats
+    unsigned columnCount;        // Payload columns in use
+    RenderColumn columns[7];     // Payload columns in blockContent() order
+    const char* description;     // Console stage description
+};
+
+// Buffered block renderer: blocks are formatted into one reusable buffer that is written with large writes
+struct Renderer {
+    RenderMode mode = RenderMode::Console;  // Output format
+    int fd = STDOUT_FILENO;                 // Destination file descriptor
+    string buffer;                          // Formatted text not yet written
+    size_t flushSize = 1 << 20;             // Buffered bytes that trigger a write
+    bool describeOnce = false;              // Console: show each stage's description only the first time
+    bool described[UPDATE_STAGE + 1] = {};  // Console: stages whose description has been shown
+    bool headerWritten = false;             // CSV: column header already written
+    bool failed = false;                    // Set when a write failed
+};
+
+// When appended blocks are forced to disk
+enum class Durability {
+    PerBlock,    // fdatasync after every block
+    PerBatch,    // fdatasync when the caller commits a batch (group commit)
+    TimeBounded  // fdatasync at most syncIntervalMs after a block is appended
+};
+
+// Settings of a persistent chain store
+struct ChainStoreOptions {
+    string directory;                            // Directory holding the segment files
+    size_t segmentSize = 64 * 1024 * 1024;       // Segment size that triggers rotation (bytes)
+    Durability durability = Durability::PerBatch; // When appended blocks are synced
+    uint64_t syncIntervalMs = 100;               // Upper bound on unsynced time for Durability::TimeBounded
+    bool readOnly = false;                       // Never write, truncate or create a file (commands that only read)
+    bool recover = true;                         // Fail the open on a damaged active segment record (verify keeps it to report it)
+};
+
+// Values of every dictionary-coded field of one segment, in code order. A sealed segment's values are views
+// into its mapping; the active segment's live in owned
+struct SegmentDictionary {
+    vector<string_view> values[7][7];   // Stage - 1, field -> value of every code
+    vector<uint32_t> locations[7][7];   // File offset of every value's bytes in the segment (UINT32_MAX = not in a record)
+    deque<string> owned;                // Storage behind values that are not views into a mapping
+    uint64_t footerBytes = 0;           // Size of the dictionary part of the segment's footer once sealed
+};
+
+// Encoder state of one dictionary-coded field of the active segment
+struct FieldEncoder {
+    vector<uint32_t> slots;             // Open-addressing table: code + 1 per slot, 0 marks an empty slot
+    uint32_t lastCode = UINT32_MAX;     // Newest code defined or used (the delta base of a details value)
+    uint64_t uses = 0;                  // Values encoded in this segment
+    bool closed = false;                // Mostly new values: stop defining them
+};
+
+// A sealed, read-only segment file mapped into memory
+struct StoreSegment {
+    string path;                  // Segment file name
+    uint64_t firstIndex = 0;      // Chain position of the segment's first record
+    const char* data = nullptr;   // Mapping of the whole file
+    size_t size = 0;              // File size in bytes
+    const uint32_t* offsets = nullptr; // Record offsets, read straight from the mapped footer
+    uint64_t count = 0;           // Number of records in the segment
+    shared_ptr<const SegmentDictionary> dictionary; // Field values the segment's encoded records refer to
+    const char* timeIndex = nullptr; // Time index: one entry per TIME_INDEX_STRIDE records, read straight from the mapped footer
+    uint64_t oldestTimestamp = 0; // Oldest block timestamp in the segment
+    uint64_t newestTimestamp = 0; // Newest block timestamp in the segment
+};
+
+// Append-only store of length-prefixed block records split into size-bounded segment files
+struct ChainStore {
+    ChainStoreOptions options;        // Directory, rotation size and durability policy
+    vector<StoreSegment> segments;    // Sealed segments, oldest first
+    int activeFd = -1;                // Segment currently being appended to
+    string activePath;                // File name of the active segment
+    uint64_t activeFirstIndex = 0;    // Chain position of the active segment's first record
+    uint64_t activeSize = 0;          // Bytes in the active segment, including unwritten buffered bytes
+    vector<uint32_t> activeOffsets;   // Offsets of the active segment's records
+    shared_ptr<SegmentDictionary> activeDictionary; // Field values defined by the active segment's records
+    string activeTimeIndex;           // Time index entries of the active segment, as its footer will hold them
+    FieldEncoder encoders[7][7];      // Lookup state of every dictionary-coded field of the active segment
+    BlockHash lastHash{};             // Stored hash of the newest record (an encoded record omits a previous hash equal to it)
+    uint64_t canonicalBytes = 0;      // Size of the records appended since opening, before encoding
+    uint64_t storedBytes = 0;         // Size of the same records as stored
+    string writeBuffer;               // Appended bytes not yet handed to the kernel
+    bool dirty = false;               // Whether written bytes still await fdatasync
+    mutex lock;                       // Serializes appends with the background flusher
+    condition_variable wake;          // Wakes the flusher on close
+    thread flusher;                   // Background sync thread for Durability::TimeBounded
+    bool closing = false;             // Tells the flusher to exit
+};
+
+// Lock-free view of every record in a store at one point in time (used by parallel readers)
+struct StoreReadView {
+    vector<StoreSegment> parts;       // Sealed segments plus the mapped active segment, oldest first
+    vector<uint32_t> activeOffsets;   // Copy of the active segment's record offsets
+    string activeTimeIndex;           // Copy of the active segment's time index
+    MappedFile activeMapping;         // Read-only mapping of the active segment
+    uint64_t count = 0;               // Number of records visible through the view
+};
+
+// Time window and stage a range scan selects
+struct TimeRangeQuery {
+    uint64_t fromTimestamp = 0;          // Oldest timestamp included
+    uint64_t toTimestamp = UINT64_MAX;   // Newest timestamp included
+    uint8_t stage = 0;                   // Stage tag of the selected blocks (0 = every stage)
+};
+
+// What a range scan skipped and what it had to read
+struct TimeRangeStats {
+    uint64_t segmentsSkipped = 0;   // Segments whose time bounds miss the window
+    uint64_t segmentsRead = 0;      // Segments whose time index was consulted
+    uint64_t groupsSkipped = 0;     // Index entries (TIME_INDEX_STRIDE records each) that rule their records out
+    uint64_t groupsRead = 0;        // Index entries whose records were read
+    uint64_t recordsRead = 0;       // Records whose stage and timestamp were read
+    uint64_t bytesRead = 0;         // Index and record bytes read
+    uint64_t blocksMatched = 0;     // Blocks inside the window
+};
+
+// Outcome of a full-chain integrity check
+struct VerifyReport {
+    bool ok = true;                        // Whether every hash and link checked out
+    uint64_t blocksChecked = 0;            // Blocks whose hash and link were verified
+    uint64_t bytesChecked = 0;             // Record bytes hashed
+    uint64_t signaturesChecked = 0;        // Transaction signatures verified
+    uint64_t signaturesUnregistered = 0;   // Of those, checked only against the key they carry (no key registered for the sender)
+    uint64_t firstBadIndex = UINT64_MAX;   // Chain position of the first invalid block
+    uint64_t firstBadBlockNumber = 0;      // Block number of the first invalid block
+    string reason;                         // Why the first invalid block failed
+    unsigned threads = 0;                  // Worker threads used
+    double seconds = 0;                    // Wall-clock time of the check
+};
+
+// Chain that many producer threads append to at once. Block numbers are handed out as tickets; every
+// thread hashes the bulk of its block in parallel and only the link to the tip is done in ticket order
+struct SharedChain {
+    atomic<uint64_t> nextNumber{1};                       // Next block number (ticket) to hand out
+    atomic<uint64_t> publishedNumber{0};                  // Newest published block; ticket n publishes once this is n - 1
+    atomic<uint64_t> tipRing[CHAIN_TIP_RING][4] = {};     // Hashes of recently published blocks, indexed by number % ring size
+    ChainStore* store = nullptr;                          // Store receiving every block in chain order (optional)
+    atomic<bool> failed{false};                           // Set when the store rejected a block
+};
+
+// One vehicle moving through the stage pipeline: its raw rows and the block its next stage links to
+struct PipelineVehicle {
+    string rows[7];             // Raw Supply..Transaction rows (owned copies, parsed by the stage workers)
+    char delimiter = ',';       // Field separator of the file the rows came from
+    int stages = 0;             // Stages present (a trailing partial vehicle has fewer than seven)
+    uint64_t upstream = 0;      // Number of the vehicle's latest block (the next stage's upstream link)
+};
+
+// Bounded single-producer/single-consumer ring carrying vehicles between two pipeline stages. Producer and
+// consumer each own one index and keep a cached copy of the other, so the shared cache lines are touched rarely
+struct PipelineQueue {
+    vector<PipelineVehicle*> slots;        // Ring storage; capacity is a power of two
+    size_t mask = 0;                       // Capacity - 1
+    alignas(64) atomic<size_t> head{0};    // Next slot to pop (written by the consumer)
+    size_t cachedTail = 0;                 // Consumer's copy of tail
+    uint64_t emptyWaits = 0;               // Times the consumer found the ring empty (stage starved)
+    uint64_t depthSum = 0;                 // Sum of the depth seen at every pop
+    uint64_t pops = 0;                     // Vehicles popped
+    size_t maxDepth = 0;                   // Deepest the ring was seen at a pop
+    alignas(64) atomic<size_t> tail{0};    // Next slot to push (written by the producer)
+    size_t cachedHead = 0;                 // Producer's copy of head
+    uint64_t fullWaits = 0;                // Times the producer found the ring full (backpressure)
+};
+
+// Settings of the stage pipeline
+struct PipelineOptions {
+    size_t queueCapacity = 256;  // Vehicles each stage queue holds before its producer is held back
+    size_t batchLimit = 4096;    // Blocks a stage collects before handing them to the batch consumer
+};
+
+// Statistics of one pipeline stage
+struct PipelineStageStats {
+    uint64_t blocks = 0;         // Blocks the stage built
+    double averageDepth = 0;     // Average depth of the stage's input queue
+    size_t maxDepth = 0;         // Deepest the input queue was seen
+    uint64_t starved = 0;        // Times the stage waited for input
+    uint64_t blocked = 0;        // Times the stage waited for room downstream (backpressure)
+};
+
+// Result of a pipeline run
+struct PipelineReport {
+    PipelineStageStats stages[7];  // Supply..Transaction workers
+    uint64_t vehicles = 0;         // Vehicles fed into the pipeline
+    uint64_t rowsSkipped = 0;      // Rows that were not the next stage of a vehicle
+    uint64_t signaturesVerified = 0; // Signed transaction rows whose signature checked out
+    uint64_t signaturesRejected = 0; // Transaction rows dropped for a bad, unregistered or missing signature
+    double seconds = 0;            // Wall-clock time of the run
+    bool ok = true;                // Every file was read and every block stored
+};
+
+// Slot of the hash index (blockNumber 0 marks an empty slot)
+struct HashIndexSlot {
+    BlockHash hash;           // Block hash (the key)
+    uint64_t blockNumber;     // Number of the block with this hash
+};
+
+// Slot of the business-ID index (key 0 marks an empty slot)
+struct IdIndexSlot {
+    uint32_t key;             // StringId of the business ID + 1
+    uint32_t head;            // First posting of the ID (chain order)
+    uint32_t tail;            // Last posting of the ID, where appends go
+};
+
+// One part of the block indexes; a key always lands in the same shard, so shards can be built in parallel
+struct BlockIndexShard {
+    vector<HashIndexSlot> hashSlots;  // Open-addressing table: block hash -> block number
+    size_t hashCount = 0;             // Occupied hash slots
+    vector<IdIndexSlot> idSlots;      // Open-addressing table: business ID -> posting list
+    size_t idCount = 0;               // Occupied ID slots
+    vector<uint64_t> postingNumber;   // Block number of every posting
+    vector<uint32_t> postingNext;     // Next posting of the same ID (UINT32_MAX ends the list)
+};
+
+// In-memory lookup tables from block hash and from business ID (supplierId, pressId, ... transactionId)
+// to block numbers; a block number resolves to chain position blockNumber - 1
+struct BlockIndex {
+    BlockIndexShard shards[BLOCK_INDEX_SHARDS]; // Shards picked by the key's hash
+    mutex lock;                                 // Serializes incremental updates and lookups
+    uint64_t blocks = 0;                        // Blocks indexed
+};
+
+// Vehicle provenance: for every block (slot blockNumber - 1) its edges to the previous and the next stage of
+// the same vehicle, stored as distances in block numbers (0 = no edge) so a block costs 9 bytes
+struct ProvenanceGraph {
+    vector<uint8_t> stage;          // Stage of every block (0 = not in the graph)
+    vector<uint32_t> upstream;      // Distance back to the vehicle's previous-stage block
+    vector<uint32_t> downstream;    // Distance forward to the vehicle's next-stage block
+    mutex lock;                     // Serializes updates against traces
+};
+
+// Kind of a column in the columnar projection
+enum class ColumnKind {
+    Dictionary,  // Interned string, stored as a dense code into the column's own dictionary
+    Count,       // Whole number, stored as int64
+    Amount,      // Fixed-point Money, stored as int64
+    Measure      // Decimal measurement, stored as float
+};
+
+// One column of a stage table; exactly one of codes, integers and measures is filled, one value per row
+struct AnalyticsColumn {
+    ColumnKind kind = ColumnKind::Dictionary; // How the values are stored
+    vector<uint32_t> codes;       // Dictionary codes
+    vector<int64_t> integers;     // Counts and Money
+    vector<float> measures;       // Measurements
+    vector<StringId> dictionary;  // Code -> interned string
+    vector<uint64_t> codeSlots;   // Open-addressing table: (StringId + 1) << 32 | code per slot, 0 marks an empty slot
+};
+
+// Columnar copy of one stage: one row per block (per transaction for batch blocks), columns in blockContent() order
+struct AnalyticsTable {
+    vector<uint64_t> blockNumber;     // Block holding the row
+    vector<uint64_t> timestamp;       // Block timestamp (nanoseconds since the Unix epoch, UTC)
+    vector<AnalyticsColumn> columns;  // Payload columns
+};
+
+// Columnar projection of the chain kept next to the blocks, so aggregations never re-read or re-parse records
+struct AnalyticsStore {
+    AnalyticsTable tables[7];   // Supply..Transaction
+    mutex lock;                 // Serializes appends against queries
+};
+
+// Aggregation over one stage table: rows in a time window, optionally filtered on a dictionary column,
+// optionally grouped by another, summarizing one numeric column
+struct AnalyticsQuery {
+    int stage = 7;                       // Table to scan (1 = Supply ... 7 = Transaction)
+    int valueColumn = -1;                // Numeric column to summarize (-1 only counts rows)
+    int groupColumn = -1;                // Dictionary column to group by (-1 for one total)
+    int filterColumn = -1;               // Dictionary column the filter compares (-1 for no filter)
+    StringId filterValue = 0;            // Value the filter column must equal
+    uint64_t fromTimestamp = 0;          // Oldest timestamp included
+    uint64_t toTimestamp = UINT64_MAX;   // Newest timestamp included
+};
+
+// Aggregate of one group of a query
+struct AnalyticsGroup {
+    StringId key = 0;              // Group value (0 when the query is not grouped)
+    uint64_t rows = 0;             // Rows in the group
+    int64_t integerSum = 0;        // Sum of a Count or Amount column
+    double measureSum = 0;         // Sum of a Measure column
+    double minimum = HUGE_VAL;     // Smallest value
+    double maximum = -HUGE_VAL;    // Largest value
+};
+
+// Result of a query
+struct AnalyticsResult {
+    vector<AnalyticsGroup> groups;  // Non-empty groups, largest total first
+    uint64_t rowsScanned = 0;       // Rows in the table
+    uint64_t rowsSelected = 0;      // Rows that passed the time window and the filter
+    uint64_t bytesScanned = 0;      // Column bytes read
+    unsigned threads = 0;           // Scan threads used
+    double seconds = 0;             // Wall-clock time of the scan
+};
+
+// Settings of a synthetic workload: every vehicle is seven coherent rows, Supply .. Transaction
+struct WorkloadOptions {
+    uint64_t vehicles = 0;      // Vehicles to generate (0 = none)
+    uint64_t seed = 1;          // The same seed always gives the same rows
+    double skew = 0.99;         // Zipf exponent of ID, location and party picks (0 = uniform)
+    uint32_t suppliers = 5000;  // Distinct suppliers
+    uint32_t products = 400;    // Distinct supplied items
+    uint32_t plants = 12;       // Distinct plants (where pressing, welding, painting and assembly happen)
+    uint32_t stations = 300;    // Distinct machines or lines per production stage
+    uint32_t locations = 2000;  // Distinct supplier addresses and shipping destinations
+    uint32_t companies = 500;   // Distinct carriers and transaction parties
+};
+
+// Workload ready to generate from: cumulative Zipf probabilities by popularity rank, shared read-only by threads
+struct Workload {
+    WorkloadOptions options;       // Settings it was prepared from
+    vector<double> suppliers;      // Supplier ranks
+    vector<double> products;       // Item ranks
+    vector<double> plants;         // Plant ranks
+    vector<double> stations;       // Machine ranks
+    vector<double> locations;      // Address and destination ranks
+    vector<double> companies;      // Carrier and party ranks
+};
+
+// Settings taken from the command line
+struct CommandOptions {
+    string command;                        // Headless subcommand (ingest, verify, query, export, report, serve, generate); empty for the menu
+    vector<string> arguments;              // Input files (ingest and the menu) or lookup keys (query)
+    ChainStoreOptions storeOptions;        // Persistent store settings
+    bool parallelIngest = false;           // One producer thread per input file
+    bool pipelineIngest = false;           // Stage-per-thread pipeline
+    size_t transactionBatchSize = 0;       // Transactions per Merkle batch block (0 = one block per transaction)
+    PipelineOptions pipelineOptions;       // Queue depth of the pipeline
+    unsigned powDifficulty = 0;            // Proof-of-work difficulty of new blocks in leading zero bits (0 = off)
+    uint64_t checkpointInterval = 1 << 18; // Committed blocks between checkpoints of the lookup structures (0 = none)
+    string metricsPath;                    // Prometheus text file written on exit and on SIGUSR1 while serving (empty = none)
+    string keysPath;                       // Sender keys: transactions of a listed sender must carry its signature (empty = none)
+    unsigned shardCount = 0;               // Independent chains a new store is split into by supplierId (0 = one chain)
+    unsigned anchorIntervalMs = 1000;      // Time between anchor blocks while a sharded store ingests (0 = only at the end)
+    WorkloadOptions workload;              // Synthetic vehicles ingest adds after its files, or generate writes out
+    string format = "jsonl";               // Output format of query and export
+    string outPath = "-";                  // Output file of export (- for standard output)
+    string socketPath;                     // Unix socket the service listens on
+    string stage;                          // Stage table of an analytics query (empty for a lookup)
+    string value = "-";                    // Analytics value column (- counts rows)
+    string group = "-";                    // Analytics group column (- for one total)
+    string filter = "-";                   // Analytics filter as column=value (- for none)
+    double hours = 0;                      // Analytics time window (0 for all blocks)
+    string from;                           // Start of the time window of export and report (local YYYYMMDD[:HH[:MM[:SS]]]; empty = oldest block)
+    string to;                             // End of that window, excluded (empty = newest block)
+    string period = "day";                 // Rows of a report: day or shift
+};
+
+// Everything a running instance keeps about its chain, shared by the menu, the subcommands and the service
+struct ChainSession {
+    ChainStoreOptions storeOptions;        // Settings the store was opened with
+    bool useStore = false;                 // Whether blocks are persisted (otherwise they live in memoryChain)
+    ChainStore store;                      // Persistent chain store
+    IngestState state;                     // Streaming ingestion state continuing the chain
+    BlockIndex index;                      // Hash and business ID lookups
+    ProvenanceGraph provenance;            // Stage-to-stage edges of every vehicle
+    AnalyticsStore analytics;              // Columnar projection for analytics queries
+    vector<StageBlock> memoryChain;        // Without a store: every block, at slot blockNumber - 1
+    map<uint64_t, vector<TransactionBlockchain>> memoryBatches; // Without a store: transactions of every batch block
+    mutex memoryChainLock;                 // Guards the in-memory chain against producer threads
+    size_t totalBlocks = 0;                // Blocks built since the session was opened
+    bool storeFailed = false;              // Set once a block could not be written
+    uint64_t checkpointInterval = 0;       // Committed blocks between checkpoints (0 = no checkpoints)
+    uint64_t checkpointedBlocks = 0;       // Store blocks covered by the newest checkpoint
+    uint64_t restoredBlocks = 0;           // Blocks restored from a checkpoint at startup
+    uint64_t replayedBlocks = 0;           // Blocks replayed at startup (all of them when no checkpoint was usable)
+    double startupSeconds = 0;             // Time spent restoring the lookup structures at startup
+    string metricsPath;                    // Where the service writes its metrics on SIGUSR1 (empty = standard error summary only)
+};
+
+// Store split into independent chains, one directory and one session per shard, so shards append in parallel
+// without a shared tip; the blocks of the anchor chain each commit to every shard's tip through a Merkle root
+struct ShardedStore {
+    vector<unique_ptr<ChainSession>> shards; // One complete session per shard chain (shard-NNN/)
+    ChainStore anchors;                      // Anchor blocks (anchors/)
+    uint64_t anchorCount = 0;                // Anchor blocks stored
+    BlockHash anchorTip{};                   // Hash of the newest anchor block
+    vector<uint64_t> anchoredNumbers;        // Shard tips the newest anchor commits to (0 = empty shard)
+};
+
+// Result of verifying a sharded store
+struct ShardVerifyReport {
+    vector<VerifyReport> shards;           // Verification of every shard chain
+    uint64_t anchorsChecked = 0;           // Anchor blocks whose hash, link, root and shard tips checked out
+    uint64_t firstBadAnchor = 0;           // Number of the first invalid anchor block (0 if none)
+    string reason;                         // Why the first invalid anchor failed
+    vector<uint64_t> unanchoredBlocks;     // Blocks of every shard after the tip the newest anchor commits to
+    bool ok = true;                        // Whether every shard chain and every anchor checked out
+    double seconds = 0;                    // Wall-clock time of the check
+};
+
+// Connection to the local service: its own ingestion state (each producer sends whole vehicles in order, as
+// one input file would), request bytes not yet parsed and reply bytes not yet sent
+struct ServiceClient {
+    int fd = -1;            // Non-blocking socket
+    IngestState ingest;     // Vehicle order and pending blocks of this producer, appended to the shared chain
+    string input;           // Received bytes, up to the last incomplete line
+    string output;          // Replies waiting for the socket to accept them
+    bool closing = false;   // Close once the replies are sent (QUIT, end of input or an oversized line)
+};
+
+// Index entries decoded by one rebuild thread, bucketed by destination shard
+struct IndexRebuildPart {
+    vector<pair<BlockHash, uint64_t>> hashes[BLOCK_INDEX_SHARDS]; // (hash, block number) per shard
+    vector<pair<StringId, uint64_t>> ids[BLOCK_INDEX_SHARDS];     // (business ID, block number) per shard
+};
+
+//Functions
+// Function to perform user authentication
+bool authenticateUser(const std::string& inputUsername, const std::string& inputPassword, const User& validUser) {
+    // Check if the input credentials match the valid user's credentials
+    return (inputUsername == validUser.username && inputPassword == validUser.password);
+}
+
+// Function to hash a string for the intern table (64-bit FNV-1a)
+static uint64_t hashString(string_view value) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : value) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Function to copy a string into a shard's arena and return a view of the stored copy (caller holds shard.lock)
+static string_view storeInArena(StringPoolShard& shard, string_view value) {
+    if (shard.chunkUsed + value.size() > shard.chunkCapacity) {
+        shard.chunkCapacity = max<size_t>(64 * 1024, value.size());
+        shard.chunks.emplace_back(new char[shard.chunkCapacity]);
+        shard.chunkUsed = 0;
+    }
+    char* destination = shard.chunks.back().get() + shard.chunkUsed;
+    memcpy(destination, value.data(), value.size());
+    shard.chunkUsed += value.size();
+    return string_view(destination, value.size());
+}
+
+// Function to return the handle of a string, adding it to the pool the first time it is seen (thread-safe)
+StringId internString(string_view value) {
+    if (value.empty()) {
+        return 0; // StringId 0 is always the empty string
+    }
+    uint64_t hash = hashString(value);
+    unsigned shardIndex = unsigned(hash >> 60) % STRING_POOL_SHARDS;
+    StringPoolShard& shard = stringPool.shards[shardIndex];
+    lock_guard<mutex> guard(shard.lock);
+
+    uint32_t count = shard.count.load(memory_order_relaxed);
+    if (shard.slots.empty()) {
+        shard.slots.assign(1024, 0);
+        if (shardIndex == 0) {
+            // Shard 0 reserves local index 0 so that StringId 0 stays the empty string
+            shard.ownedPages.emplace_back(new string_view[STRING_PAGE_SIZE]);
+            shard.pages[0].store(shard.ownedPages.back().get(), memory_order_release);
+            shard.count.store(count = 1, memory_order_release);
+        }
+    }
+    auto textAt = [&shard](uint32_t local) {
+        return shard.pages[local / STRING_PAGE_SIZE].load(memory_order_relaxed)[local % STRING_PAGE_SIZE];
+    };
+
+    // Grow the table at 50% load so probe sequences stay short
+    if ((size_t(count) + 1) * 2 > shard.slots.size()) {
+        vector<uint32_t> slots(shard.slots.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (uint32_t local = (shardIndex == 0 ? 1 : 0); local < count; ++local) {
+            size_t slot = hashString(textAt(local)) & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = local + 1;
+        }
+        shard.slots.swap(slots);
+    }
+
+    // Linear probing until the string or an empty slot is found
+    size_t mask = shard.slots.size() - 1;
+    size_t slot = hash & mask;
+    while (shard.slots[slot] != 0) {
+        uint32_t local = shard.slots[slot] - 1;
+        if (textAt(local) == value) {
+            return StringId(local) * STRING_POOL_SHARDS + shardIndex;
+        }
+        slot = (slot + 1) & mask;
+    }
+    uint32_t local = count;
+    if (local / STRING_PAGE_SIZE >= STRING_MAX_PAGES) {
+        cerr << "String pool shard " << shardIndex << " is full" << endl;
+        abort();
+    }
+    if (local % STRING_PAGE_SIZE == 0) {
+        shard.ownedPages.emplace_back(new string_view[STRING_PAGE_SIZE]);
+        shard.pages[local / STRING_PAGE_SIZE].store(shard.ownedPages.back().get(), memory_order_release);
+    }
+    shard.pages[local / STRING_PAGE_SIZE].load(memory_order_relaxed)[local % STRING_PAGE_SIZE] = storeInArena(shard, value);
+    shard.slots[slot] = local + 1;
+    shard.count.store(local + 1, memory_order_release); // Publish the new string to lock-free readers
+    return StringId(local) * STRING_POOL_SHARDS + shardIndex;
+}
+
+// Function to look up the text behind a string handle (lock-free; safe while other threads intern)
+string_view lookupString(StringId id) {
+    const StringPoolShard& shard = stringPool.shards[id % STRING_POOL_SHARDS];
+    uint32_t local = id / STRING_POOL_SHARDS;
+    if (id == 0 || local >= shard.count.load(memory_order_acquire)) {
+        return string_view();
+    }
+    return shard.pages[local / STRING_PAGE_SIZE].load(memory_order_acquire)[local % STRING_PAGE_SIZE];
+}
+
+// Function to check whether the pool holds nothing but the empty string
+static bool stringPoolEmpty() {
+    for (unsigned s = 0; s < STRING_POOL_SHARDS; ++s) {
+        if (stringPool.shards[s].count.load() > (s == 0 ? 1u : 0u)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to refill an empty pool shard with strings in their original order (shard-local index 0 first), so
+// every string gets back the StringId it had when the strings were saved
+static bool restoreStringShard(unsigned shardIndex, const uint32_t* lengths, const char* text, uint64_t count) {
+    StringPoolShard& shard = stringPool.shards[shardIndex];
+    lock_guard<mutex> guard(shard.lock);
+    if (count == 0) {
+        return true;
+    }
+    if (count > STRING_PAGE_SIZE * STRING_MAX_PAGES) {
+        return false;
+    }
+    size_t textSize = 0;
+    for (uint64_t local = 0; local < count; ++local) {
+        textSize += lengths[local];
+    }
+    shard.chunkCapacity = max<size_t>(64 * 1024, textSize);
+    shard.chunks.emplace_back(new char[shard.chunkCapacity]);
+    memcpy(shard.chunks.back().get(), text, textSize);
+    shard.chunkUsed = textSize;
+
+    // Size the table for the final count at once, keeping the 50% load internString maintains
+    size_t slotCount = 1024;
+    while (slotCount < (count + 1) * 2) {
+        slotCount *= 2;
+    }
+    shard.slots.assign(slotCount, 0);
+    size_t mask = slotCount - 1;
+    const char* position = shard.chunks.back().get();
+    for (uint64_t local = 0; local < count; position += lengths[local], ++local) {
+        if (local % STRING_PAGE_SIZE == 0) {
+            shard.ownedPages.emplace_back(new string_view[STRING_PAGE_SIZE]);
+            shard.pages[local / STRING_PAGE_SIZE].store(shard.ownedPages.back().get(), memory_order_relaxed);
+        }
+        string_view value(position, lengths[local]);
+        shard.pages[local / STRING_PAGE_SIZE].load(memory_order_relaxed)[local % STRING_PAGE_SIZE] = value;
+        if (shardIndex == 0 && local == 0) {
+            continue; // The reserved empty string is never looked up by text
+        }
+        size_t slot = hashString(value) & mask;
+        while (shard.slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        shard.slots[slot] = uint32_t(local + 1);
+    }
+    shard.count.store(uint32_t(count), memory_order_release);
+    return true;
+}
+
+// Function to find the handle of a string without adding it to the pool; false if it was never interned
+bool findString(string_view value, StringId& id) {
+    if (value.empty()) {
+        id = 0;
+        return true;
+    }
+    uint64_t hash = hashString(value);
+    unsigned shardIndex = unsigned(hash >> 60) % STRING_POOL_SHARDS;
+    StringPoolShard& shard = stringPool.shards[shardIndex];
+    lock_guard<mutex> guard(shard.lock);
+    if (shard.slots.empty()) {
+        return false;
+    }
+    size_t mask = shard.slots.size() - 1;
+    for (size_t slot = hash & mask; shard.slots[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t local = shard.slots[slot] - 1;
+        if (shard.pages[local / STRING_PAGE_SIZE].load(memory_order_relaxed)[local % STRING_PAGE_SIZE] == value) {
+            id = StringId(local) * STRING_POOL_SHARDS + shardIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to parse a whole-number field (0 if empty or malformed)
+uint32_t parseCount(string_view text) {
+    uint32_t value = 0;
+    from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// Function to parse a decimal measurement such as a temperature or thickness (0 if empty or malformed)
+float parseMeasure(string_view text) {
+    float value = 0;
+    from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// Function to parse a decimal amount into fixed-point Money, exactly (extra decimal places are truncated).
+// Returns false, leaving 0, unless the text is an optional '-' and digits with at most one '.' that fit in Money
+bool parseMoney(string_view text, Money& value) {
+    value = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    size_t position = negative ? 1 : 0;
+    size_t digits = 0;
+    Money whole = 0, fraction = 0, scale = MONEY_SCALE;
+    for (; position < text.size() && isdigit((unsigned char) text[position]); ++position, ++digits) {
+        if (whole > (INT64_MAX / MONEY_SCALE - 9) / 10) {
+            return false;
+        }
+        whole = whole * 10 + (text[position] - '0');
+    }
+    if (position < text.size() && text[position] == '.') {
+        for (++position; position < text.size() && isdigit((unsigned char) text[position]); ++position, ++digits) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (text[position] - '0') * scale;
+            }
+        }
+    }
+    if (digits == 0 || position != text.size()) {
+        return false;
+    }
+    value = whole * MONEY_SCALE + fraction;
+    value = negative ? -value : value;
+    return true;
+}
+
+// Function to format fixed-point Money with at least two decimal places ("50.75", "1500.00", "0.1234")
+string formatMoney(Money value) {
+    string text = value < 0 ? "-" : "";
+    uint64_t magnitude = value < 0 ? uint64_t(-value) : uint64_t(value);
+    text += to_string(magnitude / MONEY_SCALE);
+    string fraction = to_string(magnitude % MONEY_SCALE + MONEY_SCALE).substr(1); // Zero-padded to four digits
+    while (fraction.size() > 2 && fraction.back() == '0') {
+        fraction.pop_back();
+    }
+    return text + "." + fraction;
+}
+
+// Function to append a nanosecond timestamp as "YYYYMMDD:HH:MM:SS" in local time, optionally followed by
+// ".nnnnnnnnn"; the calendar conversion runs once per second per thread, other calls reuse the cached text
+void appendTimestamp(string& out, uint64_t timestamp, bool withNanoseconds) {
+    thread_local TimestampCache cache;
+    int64_t second = int64_t(timestamp / 1000000000ULL);
+    if (second != cache.second) {
+        time_t seconds = time_t(second);
+        tm localTime;
+        localtime_r(&seconds, &localTime);
+        strftime(cache.text, sizeof(cache.text), "%Y%m%d:%H:%M:%S", &localTime);
+        cache.second = second;
+    }
+    out += cache.text;
+    if (withNanoseconds) {
+        char fraction[11];
+        uint32_t nanoseconds = uint32_t(timestamp % 1000000000ULL);
+        fraction[0] = '.';
+        for (int digit = 9; digit >= 1; --digit) {
+            fraction[digit] = char('0' + nanoseconds % 10);
+            nanoseconds /= 10;
+        }
+        out.append(fraction, 10);
+    }
+}
+
+// Function to format a nanosecond timestamp as "YYYYMMDD:HH:MM:SS" in local time
+string formatTimestamp(uint64_t timestamp) {
+    string text;
+    appendTimestamp(text, timestamp, false);
+    return text;
+}
+
+void printDataset(const vector<vector<string>>& dataset){
+    cout << "\n===== Dataset =====\n" << endl;
+    cout << ANSI_RED;
+    for (const auto& row : dataset) {
+        for (const auto& element : row) {
+            cout << element << " | "; // Print each element followed by a separator
+        }
+        cout << endl; // Add newline after each row
+    }
+    cout << "\n" << endl;
+    cout << ANSI_RESET;
+
+}
+
+// SHA-256 round constants (first 32 bits of the fractional parts of the cube roots of the first 64 primes)
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// SHA-256 initial hash state
+static const uint32_t SHA256_INIT[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// Function to read a big-endian 32-bit word
+static inline uint32_t loadBigEndian32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Function to write a big-endian 32-bit word
+static inline void storeBigEndian32(uint8_t* p, uint32_t value) {
+    p[0] = uint8_t(value >> 24);
+    p[1] = uint8_t(value >> 16);
+    p[2] = uint8_t(value >> 8);
+    p[3] = uint8_t(value);
+}
+
+// Function to rotate a 32-bit word right
+static inline uint32_t rotateRight32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Function to run the SHA-256 compression function over whole 64-byte blocks (portable version)
+static void sha256CompressScalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    while (blocks--) {
+        // Expand the message schedule
+        for (int t = 0; t < 16; ++t) {
+            w[t] = loadBigEndian32(data + 4 * t);
+        }
+        for (int t = 16; t < 64; ++t) {
+            uint32_t s0 = rotateRight32(w[t - 15], 7) ^ rotateRight32(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = rotateRight32(w[t - 2], 17) ^ rotateRight32(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        // Run the 64 rounds
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t) {
+            uint32_t s1 = rotateRight32(e, 6) ^ rotateRight32(e, 11) ^ rotateRight32(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t temp1 = h + s1 + ch + SHA256_K[t] + w[t];
+            uint32_t s0 = rotateRight32(a, 2) ^ rotateRight32(a, 13) ^ rotateRight32(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t temp2 = s0 + maj;
+            h = g; g = f; f = e; e = d + temp1;
+            d = c; c = b; b = a; a = temp1 + temp2;
+        }
+
+        // Add the compressed chunk to the current hash value
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += 64;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Function to run the SHA-256 compression function with the Intel SHA extensions (SHA-NI)
+__attribute__((target("sha,sse4.1")))
+static void sha256CompressShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Rearrange the state into the ABEF/CDGH layout used by the SHA instructions
+    __m128i temp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+    while (blocks--) {
+        __m128i savedState0 = state0;
+        __m128i savedState1 = state1;
+        __m128i w[4];
+
+        // Each group handles four rounds; groups 4..15 derive their schedule words from the last four groups
+        for (int group = 0; group < 16; ++group) {
+            __m128i words;
+            if (group < 4) {
+                words = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 16 * group)), byteSwap);
+            } else {
+                __m128i w16 = w[group & 3], w12 = w[(group + 1) & 3], w8 = w[(group + 2) & 3], w4 = w[(group + 3) & 3];
+                words = _mm_sha256msg1_epu32(w16, w12);
+                words = _mm_add_epi32(words, _mm_alignr_epi8(w4, w8, 4));
+                words = _mm_sha256msg2_epu32(words, w4);
+            }
+            w[group & 3] = words;
+
+            __m128i message = _mm_add_epi32(words, _mm_loadu_si128((const __m128i*) &SHA256_K[4 * group]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, savedState0);
+        state1 = _mm_add_epi32(state1, savedState1);
+        data += 64;
+    }
+
+    // Restore the regular A..H word order
+    temp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*) &state[0], _mm_blend_epi16(temp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*) &state[4], _mm_alignr_epi8(state1, temp, 8));
+}
+
+// Function to rotate each 32-bit lane of an AVX2 register right
+__attribute__((target("avx2")))
+static inline __m256i rotateRight256(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// Function to compress one 64-byte block for each of eight independent messages at once (AVX2)
+__attribute__((target("avx2")))
+static void sha256Compress8Avx2(uint32_t states[8][8], const uint8_t* const blocks[8]) {
+    __m256i w[64];
+
+    // Transpose the eight message blocks so each register holds word t of every lane
+    for (int t = 0; t < 16; ++t) {
+        w[t] = _mm256_setr_epi32(
+            (int) loadBigEndian32(blocks[0] + 4 * t), (int) loadBigEndian32(blocks[1] + 4 * t),
+            (int) loadBigEndian32(blocks[2] + 4 * t), (int) loadBigEndian32(blocks[3] + 4 * t),
+            (int) loadBigEndian32(blocks[4] + 4 * t), (int) loadBigEndian32(blocks[5] + 4 * t),
+            (int) loadBigEndian32(blocks[6] + 4 * t), (int) loadBigEndian32(blocks[7] + 4 * t));
+    }
+    for (int t = 16; t < 64; ++t) {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotateRight256(w[t - 15], 7), rotateRight256(w[t - 15], 18)), _mm256_srli_epi32(w[t - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotateRight256(w[t - 2], 17), rotateRight256(w[t - 2], 19)), _mm256_srli_epi32(w[t - 2], 10));
+        w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+
+    // Load the working variables, one register per state word
+    __m256i v[8];
+    for (int i = 0; i < 8; ++i) {
+        v[i] = _mm256_setr_epi32((int) states[0][i], (int) states[1][i], (int) states[2][i], (int) states[3][i],
+                                 (int) states[4][i], (int) states[5][i], (int) states[6][i], (int) states[7][i]);
+    }
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int t = 0; t < 64; ++t) {
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotateRight256(e, 6), rotateRight256(e, 11)), rotateRight256(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i temp1 = _mm256_add_epi32(_mm256_add_epi32(h, s1), _mm256_add_epi32(ch, _mm256_add_epi32(_mm256_set1_epi32((int) SHA256_K[t]), w[t])));
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotateRight256(a, 2), rotateRight256(a, 13)), rotateRight256(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)), _mm256_and_si256(b, c));
+        __m256i temp2 = _mm256_add_epi32(s0, maj);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, temp1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(temp1, temp2);
+    }
+
+    // Add the compressed chunk back into every lane's state
+    v[0] = _mm256_add_epi32(v[0], a); v[1] = _mm256_add_epi32(v[1], b);
+    v[2] = _mm256_add_epi32(v[2], c); v[3] = _mm256_add_epi32(v[3], d);
+    v[4] = _mm256_add_epi32(v[4], e); v[5] = _mm256_add_epi32(v[5], f);
+    v[6] = _mm256_add_epi32(v[6], g); v[7] = _mm256_add_epi32(v[7], h);
+    for (int i = 0; i < 8; ++i) {
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256((__m256i*) lanes, v[i]);
+        for (int lane = 0; lane < 8; ++lane) {
+            states[lane][i] = lanes[lane];
+        }
+    }
+}
+#endif
+
+// SHA-256 state after a whole number of 64-byte blocks, so the rest of a message can be hashed later
+struct Sha256Midstate {
+    uint32_t state[8];  // Compression state after the absorbed prefix
+    uint64_t length;    // Bytes absorbed so far (a multiple of 64)
+};
+
+// Hardware SHA-256 paths detected once at startup
+struct Sha256Features {
+    bool shaNi = false; // CPU supports the SHA extensions
+    bool avx2 = false;  // CPU and OS support 256-bit AVX2 registers
+};
+
+// Function to detect which SHA-256 paths the current CPU supports
+static Sha256Features detectSha256Features() {
+    Sha256Features features;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        bool osSavesYmm = false;
+        if ((ecx & bit_OSXSAVE) != 0) {
+            unsigned int xcrLow, xcrHigh;
+            __asm__("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+            osSavesYmm = (xcrLow & 0x6) == 0x6;
+        }
+        bool hasSse41 = (ecx & bit_SSE4_1) != 0;
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            features.shaNi = hasSse41 && (ebx & bit_SHA) != 0;
+            features.avx2 = osSavesYmm && (ebx & bit_AVX2) != 0;
+        }
+    }
+#endif
+    return features;
+}
+
+const Sha256Features sha256Features = detectSha256Features();
+
+// Function to compress whole blocks with the fastest single-message path available
+static void sha256Compress(uint32_t state[8], const uint8_t* data, size_t blocks) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (sha256Features.shaNi) {
+        sha256CompressShaNi(state, data, blocks);
+        return;
+    }
+#endif
+    sha256CompressScalar(state, data, blocks);
+}
+
+// Function to build the padded final block(s) of a message; returns how many 64-byte blocks were written
+// (data/length are the bytes not yet compressed, messageLength is the length of the whole message)
+static size_t sha256PadTail(const uint8_t* data, size_t length, uint64_t messageLength, uint8_t tail[128]) {
+    size_t remainder = length % 64;
+    size_t tailBlocks = (remainder + 9 > 64) ? 2 : 1;
+    memset(tail, 0, 128);
+    memcpy(tail, data + (length - remainder), remainder);
+    tail[remainder] = 0x80;
+    uint64_t bitLength = messageLength * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailBlocks * 64 - 1 - i] = uint8_t(bitLength >> (8 * i));
+    }
+    return tailBlocks;
+}
+
+// Function to write the final state as a 32-byte big-endian digest
+static void sha256StoreDigest(const uint32_t state[8], uint8_t digest[32]) {
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian32(digest + 4 * i, state[i]);
+    }
+}
+
+// Function to compute the SHA-256 digest of a byte range
+void sha256(const void* data, size_t length, uint8_t digest[32]) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t state[8];
+    memcpy(state, SHA256_INIT, sizeof(state));
+
+    // Hash every full block straight from the input, then the padded tail
+    sha256Compress(state, bytes, length / 64);
+    uint8_t tail[128];
+    size_t tailBlocks = sha256PadTail(bytes, length, length, tail);
+    sha256Compress(state, tail, tailBlocks);
+    sha256StoreDigest(state, digest);
+}
+
+// Function to absorb every whole 64-byte block of a message prefix into a midstate
+void sha256Begin(Sha256Midstate& midstate, const void* data, size_t length) {
+    memcpy(midstate.state, SHA256_INIT, sizeof(midstate.state));
+    size_t blocks = length / 64;
+    sha256Compress(midstate.state, static_cast<const uint8_t*>(data), blocks);
+    midstate.length = uint64_t(blocks) * 64;
+}
+
+// Function to finish a digest from a midstate; rest holds the message bytes after the absorbed prefix
+void sha256Finish(const Sha256Midstate& midstate, const void* rest, size_t restLength, uint8_t digest[32]) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(rest);
+    uint32_t state[8];
+    memcpy(state, midstate.state, sizeof(state));
+    sha256Compress(state, bytes, restLength / 64);
+    uint8_t tail[128];
+    size_t tailBlocks = sha256PadTail(bytes, restLength, midstate.length + restLength, tail);
+    sha256Compress(state, tail, tailBlocks);
+    sha256StoreDigest(state, digest);
+}
+
+// Function to compute SHA-256 digests of several byte ranges at once
+// (digests receives count consecutive 32-byte results)
+void sha256Batch(const uint8_t* const* data, const size_t* lengths, size_t count, uint8_t* digests) {
+    size_t index = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    // Eight AVX2 lanes out-run one SHA-NI stream on batches, so groups of four or more messages go through them
+    if (sha256Features.avx2) {
+        while (count - index >= 4) {
+            size_t lanes = min<size_t>(8, count - index);
+            uint32_t states[8][8];
+            uint8_t tails[8][128];
+            size_t fullBlocks[8], totalBlocks[8];
+            size_t commonBlocks = SIZE_MAX;
+
+            // Prepare each lane; idle lanes repeat lane 0 and their results are discarded
+            for (size_t lane = 0; lane < 8; ++lane) {
+                size_t source = index + (lane < lanes ? lane : 0);
+                memcpy(states[lane], SHA256_INIT, sizeof(SHA256_INIT));
+                fullBlocks[lane] = lengths[source] / 64;
+                totalBlocks[lane] = fullBlocks[lane] + sha256PadTail(data[source], lengths[source], lengths[source], tails[lane]);
+                commonBlocks = min(commonBlocks, totalBlocks[lane]);
+            }
+
+            // Run all lanes in lockstep for as many blocks as they have in common
+            for (size_t block = 0; block < commonBlocks; ++block) {
+                const uint8_t* blockPointers[8];
+                for (size_t lane = 0; lane < 8; ++lane) {
+                    size_t source = index + (lane < lanes ? lane : 0);
+                    blockPointers[lane] = block < fullBlocks[lane] ? data[source] + 64 * block
+                                                                   : tails[lane] + 64 * (block - fullBlocks[lane]);
+                }
+                sha256Compress8Avx2(states, blockPointers);
+            }
+
+            // Finish longer messages one lane at a time (through SHA-NI when the CPU has it): the rest of the
+            // message's whole blocks, then the rest of its padded tail
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                size_t block = commonBlocks;
+                if (block < fullBlocks[lane]) {
+                    sha256Compress(states[lane], data[index + lane] + 64 * block, fullBlocks[lane] - block);
+                    block = fullBlocks[lane];
+                }
+                sha256Compress(states[lane], tails[lane] + 64 * (block - fullBlocks[lane]), totalBlocks[lane] - block);
+                sha256StoreDigest(states[lane], digests + 32 * (index + lane));
+            }
+            index += lanes;
+        }
+    }
+#endif
+    // Hash whatever is left (or everything, without AVX2) one message at a time
+    for (; index < count; ++index) {
+        sha256(data[index], lengths[index], digests + 32 * index);
+    }
+}
+
+// Function to convert a binary digest to lowercase hexadecimal text
+string hashToHex(const uint8_t* digest, size_t length) {
+    static const char hexDigits[] = "0123456789abcdef";
+    string hex(length * 2, '0');
+    for (size_t i = 0; i < length; ++i) {
+        hex[2 * i] = hexDigits[digest[i] >> 4];
+        hex[2 * i + 1] = hexDigits[digest[i] & 0x0f];
+    }
+    return hex;
+}
+
+// Function to parse exactly 2 * length hexadecimal digits into bytes; false if the text is anything else
+bool hexToBytes(string_view hex, uint8_t* bytes, size_t length) {
+    if (hex.size() != length * 2) {
+        return false;
+    }
+    auto digit = [](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+    };
+    for (size_t i = 0; i < length; ++i) {
+        int high = digit(hex[2 * i]), low = digit(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes[i] = uint8_t(high << 4 | low);
+    }
+    return true;
+}
+
+// Function to parse 64 hexadecimal digits into a block hash; false if the text is not a hash
+bool hexToHash(string_view hex, BlockHash& hash) {
+    return hexToBytes(hex, hash.data(), hash.size());
+}
+
+// Element of the field GF(2^255 - 19) as five 51-bit limbs (limbs may run a few bits over between reductions)
+struct FieldElement {
+    uint64_t v[5]; // Limbs, least significant first
+};
+
+// Point of edwards25519 in extended coordinates: x = X/Z, y = Y/Z, x*y = T/Z
+struct EdwardsPoint {
+    FieldElement X; // Projective x
+    FieldElement Y; // Projective y
+    FieldElement Z; // Common denominator
+    FieldElement T; // Projective x*y
+};
+
+// Point prepared for being added to others (saves a multiplication per addition)
+struct CachedPoint {
+    FieldElement yPlusX;  // Y + X
+    FieldElement yMinusX; // Y - X
+    FieldElement z2;      // 2 Z
+    FieldElement t2d;     // 2 d T
+};
+
+// One signature to check: all three point into memory owned by the caller
+struct SignatureCheck {
+    const uint8_t* publicKey = nullptr; // 32-byte Ed25519 public key
+    const uint8_t* signature = nullptr; // 64-byte signature (R, S)
+    string_view message;                // Signed bytes
+};
+
+// SHA-512 round constants (first 64 bits of the fractional parts of the cube roots of the first 80 primes)
+static const uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+// SHA-512 initial hash state
+static const uint64_t SHA512_INIT[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+// Function to read a big-endian 64-bit word
+static inline uint64_t loadBigEndian64(const uint8_t* p) {
+    return uint64_t(loadBigEndian32(p)) << 32 | loadBigEndian32(p + 4);
+}
+
+// Function to rotate a 64-bit word right
+static inline uint64_t rotateRight64(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+// Function to run the SHA-512 compression function over whole 128-byte blocks
+static void sha512Compress(uint64_t state[8], const uint8_t* data, size_t blocks) {
+    uint64_t w[80];
+    for (size_t block = 0; block < blocks; ++block, data += 128) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = loadBigEndian64(data + 8 * i);
+        }
+        for (int i = 16; i < 80; ++i) {
+            uint64_t s0 = rotateRight64(w[i - 15], 1) ^ rotateRight64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            uint64_t s1 = rotateRight64(w[i - 2], 19) ^ rotateRight64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 80; ++i) {
+            uint64_t t1 = h + (rotateRight64(e, 14) ^ rotateRight64(e, 18) ^ rotateRight64(e, 41)) + ((e & f) ^ (~e & g)) + SHA512_K[i] + w[i];
+            uint64_t t2 = (rotateRight64(a, 28) ^ rotateRight64(a, 34) ^ rotateRight64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+// Function to compute the SHA-512 digest of a byte range
+void sha512(const void* data, size_t length, uint8_t digest[64]) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t state[8];
+    memcpy(state, SHA512_INIT, sizeof(state));
+    sha512Compress(state, bytes, length / 128);
+
+    // Pad the tail: 0x80, zeros, then the message length in bits as a 128-bit big-endian number
+    uint8_t tail[256] = {};
+    size_t rest = length % 128;
+    memcpy(tail, bytes + length - rest, rest);
+    tail[rest] = 0x80;
+    size_t tailBlocks = rest + 17 > 128 ? 2 : 1;
+    uint64_t bits = uint64_t(length) * 8;
+    storeBigEndian32(tail + tailBlocks * 128 - 8, uint32_t(bits >> 32));
+    storeBigEndian32(tail + tailBlocks * 128 - 4, uint32_t(bits));
+    sha512Compress(state, tail, tailBlocks);
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian32(digest + 8 * i, uint32_t(state[i] >> 32));
+        storeBigEndian32(digest + 8 * i + 4, uint32_t(state[i]));
+    }
+}
+
+// Ed25519 (RFC 8032) over edwards25519: -x^2 + y^2 = 1 + d x^2 y^2 modulo p = 2^255 - 19, with the base point B
+// of prime order L. Field elements are five 51-bit limbs multiplied through 128-bit products
+static const uint64_t FIELD_MASK = (uint64_t(1) << 51) - 1;
+static const FieldElement FIELD_ZERO = {{0, 0, 0, 0, 0}};
+static const FieldElement FIELD_ONE = {{1, 0, 0, 0, 0}};
+static const FieldElement EDWARDS_D = {{0x34dca135978a3, 0x1a8283b156ebd, 0x5e7a26001c029, 0x739c663a03cbb, 0x52036cee2b6ff}};
+static const FieldElement EDWARDS_2D = {{0x69b9426b2f159, 0x35050762add7a, 0x3cf44c0038052, 0x6738cc7407977, 0x2406d9dc56dff}};
+static const FieldElement FIELD_SQRT_M1 = {{0x61b274a0ea0b0, 0xd5a5fc8f189d, 0x7ef5e9cbd0c60, 0x78595a6804c9e, 0x2b8324804fc1d}};
+// Group order L = 2^252 + 27742317777372353535851937790883648493 and floor(2^512 / L) for Barrett reduction
+static const uint64_t GROUP_ORDER[4] = {0x5812631a5cf5d3ed, 0x14def9dea2f79cd6, 0, 0x1000000000000000};
+static const uint64_t GROUP_ORDER_MU[5] = {0xed9ce5a30a2c131b, 0x2106215d086329a7, 0xffffffffffffffeb, 0xffffffffffffffff, 0xf};
+
+// Function to carry every limb into the next one (the top limb's carry wraps around times 19)
+static inline void fieldCarry(FieldElement& h) {
+    for (int i = 0; i < 4; ++i) {
+        h.v[i + 1] += h.v[i] >> 51;
+        h.v[i] &= FIELD_MASK;
+    }
+    h.v[0] += 19 * (h.v[4] >> 51);
+    h.v[4] &= FIELD_MASK;
+}
+
+// Function to add two field elements
+static inline FieldElement fieldAdd(const FieldElement& f, const FieldElement& g) {
+    FieldElement h;
+    for (int i = 0; i < 5; ++i) {
+        h.v[i] = f.v[i] + g.v[i];
+    }
+    fieldCarry(h);
+    return h;
+}
+
+// Function to subtract two field elements (4p is added first, so no limb goes negative)
+static inline FieldElement fieldSub(const FieldElement& f, const FieldElement& g) {
+    FieldElement h;
+    h.v[0] = f.v[0] + 0x1FFFFFFFFFFFB4 - g.v[0];
+    for (int i = 1; i < 5; ++i) {
+        h.v[i] = f.v[i] + 0x1FFFFFFFFFFFFC - g.v[i];
+    }
+    fieldCarry(h);
+    return h;
+}
+
+// Function to reduce five 128-bit limb products into a field element
+static inline FieldElement fieldReduceWide(unsigned __int128 r[5]) {
+    FieldElement h;
+    for (int i = 0; i < 4; ++i) {
+        r[i + 1] += uint64_t(r[i] >> 51);
+        h.v[i] = uint64_t(r[i]) & FIELD_MASK;
+    }
+    h.v[4] = uint64_t(r[4]) & FIELD_MASK;
+    h.v[0] += 19 * uint64_t(r[4] >> 51);
+    h.v[1] += h.v[0] >> 51;
+    h.v[0] &= FIELD_MASK;
+    return h;
+}
+
+// Function to multiply two field elements
+static inline FieldElement fieldMul(const FieldElement& f, const FieldElement& g) {
+    typedef unsigned __int128 Wide;
+    const uint64_t* a = f.v;
+    const uint64_t* b = g.v;
+    uint64_t b1 = 19 * b[1], b2 = 19 * b[2], b3 = 19 * b[3], b4 = 19 * b[4];
+    Wide r[5];
+    r[0] = Wide(a[0]) * b[0] + Wide(a[1]) * b4 + Wide(a[2]) * b3 + Wide(a[3]) * b2 + Wide(a[4]) * b1;
+    r[1] = Wide(a[0]) * b[1] + Wide(a[1]) * b[0] + Wide(a[2]) * b4 + Wide(a[3]) * b3 + Wide(a[4]) * b2;
+    r[2] = Wide(a[0]) * b[2] + Wide(a[1]) * b[1] + Wide(a[2]) * b[0] + Wide(a[3]) * b4 + Wide(a[4]) * b3;
+    r[3] = Wide(a[0]) * b[3] + Wide(a[1]) * b[2] + Wide(a[2]) * b[1] + Wide(a[3]) * b[0] + Wide(a[4]) * b4;
+    r[4] = Wide(a[0]) * b[4] + Wide(a[1]) * b[3] + Wide(a[2]) * b[2] + Wide(a[3]) * b[1] + Wide(a[4]) * b[0];
+    return fieldReduceWide(r);
+}
+
+// Function to square a field element (the cross products are shared)
+static inline FieldElement fieldSquare(const FieldElement& f) {
+    typedef unsigned __int128 Wide;
+    const uint64_t* a = f.v;
+    uint64_t a0x2 = 2 * a[0], a1x2 = 2 * a[1], a3x19 = 19 * a[3], a4x19 = 19 * a[4];
+    Wide r[5];
+    r[0] = Wide(a[0]) * a[0] + Wide(a1x2) * a4x19 + Wide(2 * a[2]) * a3x19;
+    r[1] = Wide(a0x2) * a[1] + Wide(2 * a[2]) * a4x19 + Wide(a[3]) * a3x19;
+    r[2] = Wide(a0x2) * a[2] + Wide(a[1]) * a[1] + Wide(2 * a[3]) * a4x19;
+    r[3] = Wide(a0x2) * a[3] + Wide(a1x2) * a[2] + Wide(a[4]) * a4x19;
+    r[4] = Wide(a0x2) * a[4] + Wide(a1x2) * a[3] + Wide(a[2]) * a[2];
+    return fieldReduceWide(r);
+}
+
+// Function to square a field element n times
+static FieldElement fieldSquareTimes(FieldElement f, int n) {
+    while (n-- > 0) {
+        f = fieldSquare(f);
+    }
+    return f;
+}
+
+// Function to raise a field element to 2^250 - 1, the shared start of inversion and square roots; also
+// returns z^11 which inversion needs at the end
+static FieldElement fieldPow2250Minus1(const FieldElement& z, FieldElement& z11) {
+    FieldElement z2 = fieldSquare(z);
+    FieldElement z9 = fieldMul(fieldSquareTimes(z2, 2), z);
+    z11 = fieldMul(z9, z2);
+    FieldElement t = fieldMul(fieldSquare(z11), z9);             // 2^5 - 1
+    t = fieldMul(fieldSquareTimes(t, 5), t);                      // 2^10 - 1
+    FieldElement t10 = t;
+    t = fieldMul(fieldSquareTimes(t, 10), t10);                   // 2^20 - 1
+    t = fieldMul(fieldSquareTimes(t, 20), t);                     // 2^40 - 1
+    t = fieldMul(fieldSquareTimes(t, 10), t10);                   // 2^50 - 1
+    FieldElement t50 = t;
+    t = fieldMul(fieldSquareTimes(t, 50), t50);                   // 2^100 - 1
+    t = fieldMul(fieldSquareTimes(t, 100), t);                    // 2^200 - 1
+    return fieldMul(fieldSquareTimes(t, 50), t50);                // 2^250 - 1
+}
+
+// Function to invert a field element (z^(p - 2); zero stays zero)
+static FieldElement fieldInvert(const FieldElement& z) {
+    FieldElement z11;
+    FieldElement t = fieldPow2250Minus1(z, z11);
+    return fieldMul(fieldSquareTimes(t, 5), z11);                 // 2^255 - 21
+}
+
+// Function to raise a field element to (p - 5) / 8 = 2^252 - 3, the core of a square root
+static FieldElement fieldPow22523(const FieldElement& z) {
+    FieldElement z11;
+    FieldElement t = fieldPow2250Minus1(z, z11);
+    return fieldMul(fieldSquareTimes(t, 2), z);
+}
+
+// Function to write the canonical 32-byte little-endian encoding of a field element
+static void fieldToBytes(const FieldElement& f, uint8_t out[32]) {
+    FieldElement h = f;
+    fieldCarry(h);
+    fieldCarry(h);
+    // h < 2^255 now; subtract p once if h + 19 reaches 2^255
+    uint64_t q = (h.v[0] + 19) >> 51;
+    for (int i = 1; i < 5; ++i) {
+        q = (h.v[i] + q) >> 51;
+    }
+    h.v[0] += 19 * q;
+    for (int i = 0; i < 4; ++i) {
+        h.v[i + 1] += h.v[i] >> 51;
+        h.v[i] &= FIELD_MASK;
+    }
+    h.v[4] &= FIELD_MASK;
+    uint64_t words[4] = {h.v[0] | h.v[1] << 51, h.v[1] >> 13 | h.v[2] << 38, h.v[2] >> 26 | h.v[3] << 25, h.v[3] >> 39 | h.v[4] << 12};
+    for (int i = 0; i < 32; ++i) {
+        out[i] = uint8_t(words[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+// Function to read a field element from 32 little-endian bytes (the top bit is ignored)
+static FieldElement fieldFromBytes(const uint8_t in[32]) {
+    uint64_t words[4] = {};
+    for (int i = 0; i < 32; ++i) {
+        words[i / 8] |= uint64_t(in[i]) << (8 * (i % 8));
+    }
+    FieldElement h;
+    h.v[0] = words[0] & FIELD_MASK;
+    h.v[1] = (words[0] >> 51 | words[1] << 13) & FIELD_MASK;
+    h.v[2] = (words[1] >> 38 | words[2] << 26) & FIELD_MASK;
+    h.v[3] = (words[2] >> 25 | words[3] << 39) & FIELD_MASK;
+    h.v[4] = (words[3] >> 12) & FIELD_MASK;
+    return h;
+}
+
+// Function to compare two field elements by their canonical encodings
+static bool fieldEqual(const FieldElement& f, const FieldElement& g) {
+    uint8_t a[32], b[32];
+    fieldToBytes(f, a);
+    fieldToBytes(g, b);
+    return memcmp(a, b, 32) == 0;
+}
+
+// Function to tell whether a field element is "negative" (odd in its canonical encoding)
+static bool fieldIsNegative(const FieldElement& f) {
+    uint8_t bytes[32];
+    fieldToBytes(f, bytes);
+    return (bytes[0] & 1) != 0;
+}
+
+// Function to get the identity point (0, 1)
+static EdwardsPoint pointIdentity() {
+    return EdwardsPoint{FIELD_ZERO, FIELD_ONE, FIELD_ONE, FIELD_ZERO};
+}
+
+// Function to prepare a point for being added to others
+static CachedPoint toCachedPoint(const EdwardsPoint& p) {
+    return CachedPoint{fieldAdd(p.Y, p.X), fieldSub(p.Y, p.X), fieldAdd(p.Z, p.Z), fieldMul(p.T, EDWARDS_2D)};
+}
+
+// Function to negate a prepared point
+static CachedPoint negateCachedPoint(const CachedPoint& q) {
+    return CachedPoint{q.yMinusX, q.yPlusX, q.z2, fieldSub(FIELD_ZERO, q.t2d)};
+}
+
+// Function to add a prepared point to a point (unified formula, complete on edwards25519, so doubling and the
+// identity need no special cases)
+static EdwardsPoint pointAdd(const EdwardsPoint& p, const CachedPoint& q) {
+    FieldElement a = fieldMul(fieldSub(p.Y, p.X), q.yMinusX);
+    FieldElement b = fieldMul(fieldAdd(p.Y, p.X), q.yPlusX);
+    FieldElement c = fieldMul(p.T, q.t2d);
+    FieldElement d = fieldMul(p.Z, q.z2);
+    FieldElement e = fieldSub(b, a), f = fieldSub(d, c), g = fieldAdd(d, c), h = fieldAdd(b, a);
+    return EdwardsPoint{fieldMul(e, f), fieldMul(g, h), fieldMul(f, g), fieldMul(e, h)};
+}
+
+// Function to double a point
+static EdwardsPoint pointDouble(const EdwardsPoint& p) {
+    FieldElement a = fieldSquare(p.X);
+    FieldElement b = fieldSquare(p.Y);
+    FieldElement c = fieldAdd(fieldSquare(p.Z), fieldSquare(p.Z));
+    FieldElement h = fieldAdd(a, b);
+    FieldElement e = fieldSub(h, fieldSquare(fieldAdd(p.X, p.Y)));
+    FieldElement g = fieldSub(a, b);
+    FieldElement f = fieldAdd(c, g);
+    return EdwardsPoint{fieldMul(e, f), fieldMul(g, h), fieldMul(f, g), fieldMul(e, h)};
+}
+
+// Function to tell whether a point is the identity
+static bool pointIsIdentity(const EdwardsPoint& p) {
+    return fieldEqual(p.X, FIELD_ZERO) && fieldEqual(p.Y, p.Z);
+}
+
+// Function to decode a 32-byte point encoding (y, with the sign of x in the top bit); false if the encoding
+// is not canonical or not on the curve
+static bool pointDecode(EdwardsPoint& p, const uint8_t in[32]) {
+    FieldElement y = fieldFromBytes(in);
+    uint8_t canonical[32];
+    fieldToBytes(y, canonical);
+    canonical[31] |= in[31] & 0x80;
+    if (memcmp(canonical, in, 32) != 0) {
+        return false; // y >= p
+    }
+    // x^2 = (y^2 - 1) / (d y^2 + 1) = u / v, so x = u v^3 (u v^7)^((p - 5) / 8), times sqrt(-1) if that squares to -u/v
+    FieldElement y2 = fieldSquare(y);
+    FieldElement u = fieldSub(y2, FIELD_ONE);
+    FieldElement v = fieldAdd(fieldMul(y2, EDWARDS_D), FIELD_ONE);
+    FieldElement v3 = fieldMul(fieldSquare(v), v);
+    FieldElement x = fieldMul(fieldMul(u, v3), fieldPow22523(fieldMul(u, fieldMul(fieldSquare(v3), v))));
+    FieldElement check = fieldMul(v, fieldSquare(x));
+    if (!fieldEqual(check, u)) {
+        if (!fieldEqual(check, fieldSub(FIELD_ZERO, u))) {
+            return false;
+        }
+        x = fieldMul(x, FIELD_SQRT_M1);
+    }
+    bool negative = (in[31] >> 7) != 0;
+    if (negative && fieldEqual(x, FIELD_ZERO)) {
+        return false;
+    }
+    if (fieldIsNegative(x) != negative) {
+        x = fieldSub(FIELD_ZERO, x);
+    }
+    p = EdwardsPoint{x, y, FIELD_ONE, fieldMul(x, y)};
+    return true;
+}
+
+// Function to encode a point as 32 bytes
+static void pointEncode(const EdwardsPoint& p, uint8_t out[32]) {
+    FieldElement inverse = fieldInvert(p.Z);
+    FieldElement x = fieldMul(p.X, inverse);
+    fieldToBytes(fieldMul(p.Y, inverse), out);
+    out[31] |= uint8_t(fieldIsNegative(x)) << 7;
+}
+
+// Function to get the multiples 0*P .. 15*P of a point, prepared for addition
+static array<CachedPoint, 16> multiplesTable(const EdwardsPoint& p) {
+    array<CachedPoint, 16> table;
+    EdwardsPoint multiple = pointIdentity();
+    CachedPoint cached = toCachedPoint(p);
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = toCachedPoint(multiple);
+        multiple = pointAdd(multiple, cached);
+    }
+    return table;
+}
+
+// Function to decode the base point B (y = 4/5, x even)
+static EdwardsPoint edwardsBasePoint() {
+    uint8_t encoding[32];
+    memset(encoding, 0x66, sizeof(encoding));
+    encoding[0] = 0x58;
+    EdwardsPoint base;
+    pointDecode(base, encoding);
+    return base;
+}
+
+static const array<CachedPoint, 16> BASE_MULTIPLES = multiplesTable(edwardsBasePoint()); // 0*B .. 15*B
+
+// Function to reduce a number of up to 512 bits (eight little-endian limbs) modulo L (Barrett reduction with
+// 64-bit digits: the quotient estimate is off by at most two)
+static Scalar scalarReduce(const uint64_t x[8]) {
+    typedef unsigned __int128 Wide;
+    // q = floor(floor(x / 2^192) * mu / 2^320)
+    uint64_t product[10] = {};
+    for (int i = 0; i < 5; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < 5; ++j) {
+            Wide t = Wide(x[3 + i]) * GROUP_ORDER_MU[j] + product[i + j] + carry;
+            product[i + j] = uint64_t(t);
+            carry = uint64_t(t >> 64);
+        }
+        product[i + 5] = carry;
+    }
+    const uint64_t* q = product + 5;
+    // r = (x - q L) mod 2^320, then at most two subtractions of L
+    uint64_t ql[5] = {};
+    for (int i = 0; i < 5; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; i + j < 5 && j < 4; ++j) {
+            Wide t = Wide(q[i]) * GROUP_ORDER[j] + ql[i + j] + carry;
+            ql[i + j] = uint64_t(t);
+            carry = uint64_t(t >> 64);
+        }
+        if (i + 4 < 5) {
+            ql[i + 4] += carry;
+        }
+    }
+    uint64_t r[5];
+    uint64_t borrow = 0;
+    for (int i = 0; i < 5; ++i) {
+        Wide t = Wide(x[i]) - ql[i] - borrow;
+        r[i] = uint64_t(t);
+        borrow = uint64_t(t >> 64) & 1;
+    }
+    for (;;) {
+        uint64_t difference[5];
+        borrow = 0;
+        for (int i = 0; i < 5; ++i) {
+            Wide t = Wide(r[i]) - (i < 4 ? GROUP_ORDER[i] : 0) - borrow;
+            difference[i] = uint64_t(t);
+            borrow = uint64_t(t >> 64) & 1;
+        }
+        if (borrow != 0) {
+            break; // r < L
+        }
+        memcpy(r, difference, sizeof(r));
+    }
+    return Scalar{r[0], r[1], r[2], r[3]};
+}
+
+// Function to read a little-endian number of up to 64 bytes as a scalar modulo L
+static Scalar scalarFromBytes(const uint8_t* bytes, size_t length) {
+    uint64_t x[8] = {};
+    for (size_t i = 0; i < length && i < 64; ++i) {
+        x[i / 8] |= uint64_t(bytes[i]) << (8 * (i % 8));
+    }
+    return scalarReduce(x);
+}
+
+// Function to write a scalar as 32 little-endian bytes
+static void scalarToBytes(const Scalar& s, uint8_t out[32]) {
+    for (int i = 0; i < 32; ++i) {
+        out[i] = uint8_t(s[i / 8] >> (8 * (i % 8)));
+    }
+}
+
+// Function to tell whether 32 little-endian bytes hold a number below L (a signature's S must)
+static bool scalarIsCanonical(const uint8_t bytes[32]) {
+    for (int i = 3; i >= 0; --i) {
+        uint64_t word = 0;
+        for (int b = 7; b >= 0; --b) {
+            word = word << 8 | bytes[8 * i + b];
+        }
+        if (word != GROUP_ORDER[i]) {
+            return word < GROUP_ORDER[i];
+        }
+    }
+    return false;
+}
+
+// Function to multiply two scalars modulo L
+static Scalar scalarMul(const Scalar& a, const Scalar& b) {
+    typedef unsigned __int128 Wide;
+    uint64_t product[8] = {};
+    for (int i = 0; i < 4; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            Wide t = Wide(a[i]) * b[j] + product[i + j] + carry;
+            product[i + j] = uint64_t(t);
+            carry = uint64_t(t >> 64);
+        }
+        product[i + 4] = carry;
+    }
+    return scalarReduce(product);
+}
+
+// Function to add two scalars modulo L
+static Scalar scalarAdd(const Scalar& a, const Scalar& b) {
+    uint64_t sum[8] = {};
+    uint64_t carry = 0;
+    for (int i = 0; i < 4; ++i) {
+        unsigned __int128 t = (unsigned __int128) a[i] + b[i] + carry;
+        sum[i] = uint64_t(t);
+        carry = uint64_t(t >> 64);
+    }
+    sum[4] = carry;
+    return scalarReduce(sum);
+}
+
+// Function to negate a scalar modulo L
+static Scalar scalarNegate(const Scalar& a) {
+    if (a == Scalar{}) {
+        return a;
+    }
+    Scalar r;
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        unsigned __int128 t = (unsigned __int128) GROUP_ORDER[i] - a[i] - borrow;
+        r[i] = uint64_t(t);
+        borrow = uint64_t(t >> 64) & 1;
+    }
+    return r;
+}
+
+// Function to read `width` bits of a scalar starting at bit `position`
+static inline unsigned scalarWindow(const Scalar& s, unsigned position, unsigned width) {
+    unsigned limb = position / 64, shift = position % 64;
+    uint64_t bits = s[limb] >> shift;
+    if (shift + width > 64 && limb + 1 < 4) {
+        bits |= s[limb + 1] << (64 - shift);
+    }
+    return unsigned(bits & ((uint64_t(1) << width) - 1));
+}
+
+// Function to compute [s]B for a secret scalar: fixed 4-bit windows, each table entry read with masks so the
+// memory access pattern does not depend on s
+static EdwardsPoint baseMultiply(const Scalar& s) {
+    EdwardsPoint result = pointIdentity();
+    for (int window = 63; window >= 0; --window) {
+        for (int i = 0; i < 4; ++i) {
+            result = pointDouble(result);
+        }
+        unsigned digit = scalarWindow(s, unsigned(window) * 4, 4);
+        CachedPoint selected = BASE_MULTIPLES[0];
+        for (unsigned j = 1; j < 16; ++j) {
+            uint64_t mask = 0 - uint64_t(j == digit);
+            const CachedPoint& entry = BASE_MULTIPLES[j];
+            for (int k = 0; k < 5; ++k) {
+                selected.yPlusX.v[k] ^= mask & (selected.yPlusX.v[k] ^ entry.yPlusX.v[k]);
+                selected.yMinusX.v[k] ^= mask & (selected.yMinusX.v[k] ^ entry.yMinusX.v[k]);
+                selected.z2.v[k] ^= mask & (selected.z2.v[k] ^ entry.z2.v[k]);
+                selected.t2d.v[k] ^= mask & (selected.t2d.v[k] ^ entry.t2d.v[k]);
+            }
+        }
+        result = pointAdd(result, selected);
+    }
+    return result;
+}
+
+// Function to compute [a]A + [b]B for public scalars (Straus: both 4-bit window tables share the doublings)
+static EdwardsPoint doubleScalarMultiply(const Scalar& a, const EdwardsPoint& point, const Scalar& b) {
+    array<CachedPoint, 16> table = multiplesTable(point);
+    EdwardsPoint result = pointIdentity();
+    for (int window = 63; window >= 0; --window) {
+        for (int i = 0; i < 4; ++i) {
+            result = pointDouble(result);
+        }
+        unsigned digitA = scalarWindow(a, unsigned(window) * 4, 4), digitB = scalarWindow(b, unsigned(window) * 4, 4);
+        if (digitA != 0) result = pointAdd(result, table[digitA]);
+        if (digitB != 0) result = pointAdd(result, BASE_MULTIPLES[digitB]);
+    }
+    return result;
+}
+
+// Function to compute the sum of [scalars[i]] points[i] (Pippenger's bucket method: per window of c bits every
+// point is added to the bucket of its digit once, then the buckets are summed with their weights by running
+// sums, so n points cost about n / c additions per bit instead of one)
+static EdwardsPoint multiScalarMultiply(const vector<CachedPoint>& points, const vector<Scalar>& scalars) {
+    size_t count = points.size();
+    unsigned width = count < 32 ? 3 : min(12u, 61u - unsigned(__builtin_clzll(count)));
+    unsigned windows = (253 + width - 1) / width; // Scalars are below L < 2^253
+    vector<EdwardsPoint> buckets(size_t(1) << width);
+    vector<char> used(buckets.size());
+    EdwardsPoint total = pointIdentity();
+    for (int window = int(windows) - 1; window >= 0; --window) {
+        for (unsigned i = 0; i < width && window != int(windows) - 1; ++i) {
+            total = pointDouble(total);
+        }
+        fill(used.begin(), used.end(), 0);
+        for (size_t i = 0; i < count; ++i) {
+            unsigned digit = scalarWindow(scalars[i], unsigned(window) * width, width);
+            if (digit == 0) {
+                continue;
+            }
+            if (used[digit]) {
+                buckets[digit] = pointAdd(buckets[digit], points[i]);
+            } else {
+                buckets[digit] = pointAdd(pointIdentity(), points[i]);
+                used[digit] = 1;
+            }
+        }
+        // sum = 1*bucket[1] + 2*bucket[2] + ...: each running sum of the buckets from the top down is added once
+        EdwardsPoint running = pointIdentity(), sum = pointIdentity();
+        for (size_t digit = buckets.size() - 1; digit >= 1; --digit) {
+            if (used[digit]) {
+                running = pointAdd(running, toCachedPoint(buckets[digit]));
+            }
+            sum = pointAdd(sum, toCachedPoint(running));
+        }
+        total = pointAdd(total, toCachedPoint(sum));
+    }
+    return total;
+}
+
+// Function to compute k = SHA-512(R || A || message) mod L, the challenge a signature answers
+static Scalar signatureChallenge(const uint8_t r[32], const uint8_t publicKey[32], string_view message) {
+    thread_local string input;
+    input.assign(reinterpret_cast<const char*>(r), 32);
+    input.append(reinterpret_cast<const char*>(publicKey), 32);
+    input.append(message.data(), message.size());
+    uint8_t digest[64];
+    sha512(input.data(), input.size(), digest);
+    return scalarFromBytes(digest, 64);
+}
+
+// Function to expand a 32-byte secret seed into the signing scalar a and the nonce prefix (RFC 8032 5.1.5)
+static Scalar expandSecretSeed(const uint8_t seed[32], uint8_t prefix[32]) {
+    uint8_t digest[64];
+    sha512(seed, 32, digest);
+    digest[0] &= 248;
+    digest[31] &= 127;
+    digest[31] |= 64;
+    memcpy(prefix, digest + 32, 32);
+    return scalarFromBytes(digest, 32);
+}
+
+// Function to derive the public key of a 32-byte secret seed
+void ed25519PublicKey(const uint8_t seed[32], uint8_t publicKey[32]) {
+    uint8_t prefix[32];
+    pointEncode(baseMultiply(expandSecretSeed(seed, prefix)), publicKey);
+}
+
+// Function to sign a message: R = [r]B with r = SHA-512(prefix || message), then S = r + k a
+void ed25519Sign(const uint8_t seed[32], const uint8_t publicKey[32], string_view message, uint8_t signature[64]) {
+    uint8_t prefix[32], digest[64];
+    Scalar a = expandSecretSeed(seed, prefix);
+    string input(reinterpret_cast<const char*>(prefix), 32);
+    input.append(message.data(), message.size());
+    sha512(input.data(), input.size(), digest);
+    Scalar r = scalarFromBytes(digest, 64);
+    pointEncode(baseMultiply(r), signature);
+    Scalar k = signatureChallenge(signature, publicKey, message);
+    scalarToBytes(scalarAdd(r, scalarMul(k, a)), signature + 32);
+}
+
+// Function to check one signature with the cofactored equation [8][S]B = [8]R + [8][k]A, the same one batches
+// check, so a signature never passes alone and fails in a batch or the other way round
+bool ed25519Verify(const uint8_t publicKey[32], string_view message, const uint8_t signature[64]) {
+    EdwardsPoint a, r;
+    if (!pointDecode(a, publicKey) || !pointDecode(r, signature) || !scalarIsCanonical(signature + 32)) {
+        return false;
+    }
+    Scalar k = signatureChallenge(signature, publicKey, message);
+    Scalar s = scalarFromBytes(signature + 32, 32);
+    EdwardsPoint check = pointAdd(doubleScalarMultiply(scalarNegate(k), a, s), negateCachedPoint(toCachedPoint(r)));
+    for (int i = 0; i < 3; ++i) {
+        check = pointDouble(check);
+    }
+    return pointIsIdentity(check);
+}
+
+// Function to check a run of signatures at once: with random 128-bit weights z, every signature holds (except
+// with probability 2^-128 for a bad one) when [8](sum z R + sum (z k) A - (sum z S) B) is the identity.
+// That is one multi-scalar multiplication of 2n + 1 points; if it fails, each signature is checked alone
+static void verifySignatureRun(const SignatureCheck* checks, size_t count, char* valid) {
+    vector<CachedPoint> points;
+    vector<Scalar> scalars;
+    points.reserve(2 * count + 1);
+    scalars.reserve(2 * count + 1);
+    Scalar sum{};
+    // The weights come from SHA-512 in counter mode over a fresh random key, so a signer cannot aim for them
+    uint8_t key[40], weights[64];
+    random_device entropy;
+    for (size_t i = 0; i < 32; i += 4) {
+        uint32_t word = entropy();
+        memcpy(key + i, &word, 4);
+    }
+    size_t candidates = 0;
+    for (size_t i = 0; i < count; ++i) {
+        EdwardsPoint a, r;
+        valid[i] = pointDecode(a, checks[i].publicKey) && pointDecode(r, checks[i].signature) &&
+                   scalarIsCanonical(checks[i].signature + 32);
+        if (!valid[i]) {
+            continue;
+        }
+        if (candidates % 4 == 0) {
+            uint64_t counter = candidates / 4;
+            memcpy(key + 32, &counter, 8);
+            sha512(key, sizeof(key), weights);
+        }
+        Scalar z{};
+        memcpy(z.data(), weights + 16 * (candidates++ % 4), 16);
+        Scalar k = signatureChallenge(checks[i].signature, checks[i].publicKey, checks[i].message);
+        points.push_back(toCachedPoint(r));
+        scalars.push_back(z);
+        points.push_back(toCachedPoint(a));
+        scalars.push_back(scalarMul(z, k));
+        sum = scalarAdd(sum, scalarMul(z, scalarFromBytes(checks[i].signature + 32, 32)));
+    }
+    if (candidates == 0) {
+        return;
+    }
+    points.push_back(BASE_MULTIPLES[1]);
+    scalars.push_back(scalarNegate(sum));
+    EdwardsPoint check = multiScalarMultiply(points, scalars);
+    for (int i = 0; i < 3; ++i) {
+        check = pointDouble(check);
+    }
+    if (pointIsIdentity(check)) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        valid[i] = valid[i] && ed25519Verify(checks[i].publicKey, checks[i].message, checks[i].signature);
+    }
+}
+
+// Function to check many signatures on all cores: each thread takes a contiguous share and checks it in runs
+// of SIGNATURE_BATCH_SIZE. valid receives one flag per signature; returns how many failed
+size_t ed25519VerifyBatch(const SignatureCheck* checks, size_t count, char* valid, unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    threadCount = unsigned(min<size_t>(threadCount, (count + SIGNATURE_BATCH_SIZE - 1) / SIGNATURE_BATCH_SIZE));
+    auto verifyShare = [&](size_t begin, size_t end) {
+        for (size_t run = begin; run < end; run += SIGNATURE_BATCH_SIZE) {
+            verifySignatureRun(checks + run, min(SIGNATURE_BATCH_SIZE, end - run), valid + run);
+        }
+    };
+    if (threadCount <= 1) {
+        verifyShare(0, count);
+    } else {
+        vector<thread> workers;
+        size_t share = (count + threadCount - 1) / threadCount;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            workers.emplace_back(verifyShare, min(count, t * share), min(count, (t + 1) * share));
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+    return size_t(count - size_t(count_if(valid, valid + count, [](char ok) { return ok != 0; })));
+}
+
+// Function to append a 64-bit integer to a byte string in little-endian order
+static void appendUint64(string& out, uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = char(value >> (8 * i));
+    }
+    out.append(bytes, 8);
+}
+
+// Function to append an unsigned integer as a LEB128 varint (seven bits per byte, low bits first)
+static void appendVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+// Function to append a 32-bit integer to a byte string in little-endian order
+static void appendUint32(string& out, uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = char(value >> (8 * i));
+    }
+    out.append(bytes, 4);
+}
+
+// Function to append a float's IEEE-754 bit pattern to a byte string
+static void appendFloat(string& out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    appendUint32(out, bits);
+}
+
+// Function to append a length-prefixed text field to a byte string
+static void appendTextField(string& out, string_view value) {
+    appendUint32(out, uint32_t(value.size()));
+    out.append(value.data(), value.size());
+}
+
+// Function to append an interned string field, length-prefixed, to a byte string
+static void appendField(string& out, StringId id) {
+    appendTextField(out, lookupString(id));
+}
+
+// Function to start a block's canonical content with its stage tag, block number and timestamp
+static void blockContentHeader(string& out, uint8_t stage, const BlockHeader& header) {
+    out.push_back(char(stage));
+    appendUint64(out, header.blockNumber);
+    appendUint64(out, header.timestamp);
+}
+
+// Function to finish a block's canonical content with the proof of work, the vehicle link and the link to the
+// previous block (hashed last)
+static void blockContentFooter(string& out, const BlockHeader& header) {
+    out.push_back(char(header.difficulty));
+    appendUint64(out, header.nonce);
+    appendUint32(out, header.upstreamOffset);
+    out.append(reinterpret_cast<const char*>(header.previousBlockHash.data()), header.previousBlockHash.size());
+}
+
+// Function to append the hashed content of a SupplierBlockchain block
+void appendBlockContent(string& out, const SupplierBlockchain& block) {
+    blockContentHeader(out, 1, block.header);
+    appendField(out, block.supplierId);
+    appendField(out, block.supplierName);
+    appendField(out, block.supplierItem);
+    appendField(out, block.location);
+    appendField(out, block.branch);
+    appendUint32(out, block.quantity);
+    appendUint64(out, uint64_t(block.price));
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of a PressBlockchain block
+void appendBlockContent(string& out, const PressBlockchain& block) {
+    blockContentHeader(out, 2, block.header);
+    appendField(out, block.pressId);
+    appendField(out, block.pressLocation);
+    appendField(out, block.pressDetails);
+    appendField(out, block.pressType);
+    appendField(out, block.pressManufacturer);
+    appendFloat(out, block.pressCapacity);
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of a WeldingBlockchain block
+void appendBlockContent(string& out, const WeldingBlockchain& block) {
+    blockContentHeader(out, 3, block.header);
+    appendField(out, block.weldingId);
+    appendField(out, block.weldingLocation);
+    appendField(out, block.weldingDetails);
+    appendField(out, block.weldingType);
+    appendField(out, block.weldingMaterial);
+    appendFloat(out, block.weldingTemperature);
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of a PaintingBlockchain block
+void appendBlockContent(string& out, const PaintingBlockchain& block) {
+    blockContentHeader(out, 4, block.header);
+    appendField(out, block.paintingId);
+    appendField(out, block.paintingLocation);
+    appendField(out, block.paintingDetails);
+    appendField(out, block.paintingColor);
+    appendField(out, block.paintingType);
+    appendFloat(out, block.paintingThickness);
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of an AssemblyBlockchain block
+void appendBlockContent(string& out, const AssemblyBlockchain& block) {
+    blockContentHeader(out, 5, block.header);
+    appendField(out, block.assemblyId);
+    appendField(out, block.assemblyLocation);
+    appendField(out, block.assemblyDetails);
+    appendField(out, block.assemblyType);
+    appendUint32(out, block.numberOfParts);
+    appendFloat(out, block.assemblyWeight);
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of a ShippingBlockchain block
+void appendBlockContent(string& out, const ShippingBlockchain& block) {
+    blockContentHeader(out, 6, block.header);
+    appendField(out, block.shippingId);
+    appendField(out, block.shippingDestination);
+    appendField(out, block.shippingDetails);
+    appendField(out, block.shippingType);
+    appendField(out, block.carrierName);
+    appendField(out, block.shippingStatus);
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the signed fields of a transaction: everything but the signature, in canonical order
+static void appendTransactionFields(string& out, string_view transactionId, string_view transactionType, string_view sender,
+                                    string_view receiver, string_view currency, Money amount, string_view transactionStatus) {
+    appendTextField(out, transactionId);
+    appendTextField(out, transactionType);
+    appendTextField(out, sender);
+    appendTextField(out, receiver);
+    appendTextField(out, currency);
+    appendUint64(out, uint64_t(amount));
+    appendTextField(out, transactionStatus);
+}
+
+// Function to append the payload fields of a transaction (shared by transaction blocks and batch leaves)
+static void appendTransactionPayload(string& out, const TransactionBlockchain& block) {
+    appendTransactionFields(out, lookupString(block.transactionId), lookupString(block.transactionType), lookupString(block.sender),
+                            lookupString(block.receiver), lookupString(block.currency), block.transactionAmount,
+                            lookupString(block.transactionStatus));
+    appendField(out, block.signature);
+}
+
+// Function to build the message a transaction's sender signs: a context string, so a signature made for
+// anything else never verifies here, then the transaction's payload without the signature
+static void transactionSigningMessage(string& out, const TransactionBlockchain& block) {
+    out.assign(TRANSACTION_SIGNING_CONTEXT);
+    appendTransactionFields(out, lookupString(block.transactionId), lookupString(block.transactionType), lookupString(block.sender),
+                            lookupString(block.receiver), lookupString(block.currency), block.transactionAmount,
+                            lookupString(block.transactionStatus));
+}
+
+// Function to append the hashed content of a TransactionBlockchain block
+void appendBlockContent(string& out, const TransactionBlockchain& block) {
+    blockContentHeader(out, 7, block.header);
+    appendTransactionPayload(out, block);
+    blockContentFooter(out, block.header);
+}
+
+// Function to serialize the canonical payload of a transaction: the same bytes a transaction block hashes,
+// without the block fields, so a leaf means the same thing whichever batch it lands in (a batch body appends
+// it in place with appendTransactionPayload)
+string transactionLeaf(const TransactionBlockchain& transaction) {
+    string out;
+    out.reserve(128);
+    appendTransactionPayload(out, transaction);
+    return out;
+}
+
+// Function to find the key registered for a sender (nullptr if it has none)
+const SignerKey* findSignerKey(string_view sender) {
+    auto it = signerKeys.find(sender);
+    return it != signerKeys.end() ? &it->second : nullptr;
+}
+
+// Function to attach a row's signature (128 hex digits) to a transaction together with the sender's registered
+// key. False when the signature is malformed or the sender has no key, and for an unsigned row of a sender that has one
+bool attachTransactionSignature(TransactionBlockchain& transaction, string_view signatureHex) {
+    const SignerKey* key = findSignerKey(lookupString(transaction.sender));
+    if (signatureHex.empty()) {
+        return key == nullptr;
+    }
+    uint8_t field[TRANSACTION_SIGNATURE_SIZE];
+    if (key == nullptr || !hexToBytes(signatureHex, field + 32, 64)) {
+        return false;
+    }
+    memcpy(field, key->publicKey.data(), 32);
+    transaction.signature = internString(string_view(reinterpret_cast<const char*>(field), sizeof(field)));
+    return true;
+}
+
+// Function to check the signature of one transaction (an unsigned transaction passes)
+bool verifyTransactionSignature(const TransactionBlockchain& transaction) {
+    string_view field = lookupString(transaction.signature);
+    if (field.empty()) {
+        return true;
+    }
+    thread_local string message;
+    transactionSigningMessage(message, transaction);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(field.data());
+    return field.size() == TRANSACTION_SIGNATURE_SIZE && ed25519Verify(bytes, message, bytes + 32);
+}
+
+// Function to check the signatures of many transactions in batches on all cores; valid gets one flag per
+// transaction (unsigned ones pass). Returns how many failed
+size_t verifyTransactionSignatures(const vector<TransactionBlockchain>& transactions, vector<char>& valid) {
+    valid.assign(transactions.size(), 1);
+    vector<string> messages;
+    vector<size_t> signedAt;
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        string_view field = lookupString(transactions[i].signature);
+        if (field.size() == TRANSACTION_SIGNATURE_SIZE) {
+            messages.emplace_back();
+            transactionSigningMessage(messages.back(), transactions[i]);
+            signedAt.push_back(i);
+        } else if (!field.empty()) {
+            valid[i] = 0;
+        }
+    }
+    // The checks point into the messages, so they are made once every message is in place
+    vector<SignatureCheck> checks(signedAt.size());
+    for (size_t j = 0; j < checks.size(); ++j) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(lookupString(transactions[signedAt[j]].signature).data());
+        checks[j] = SignatureCheck{bytes, bytes + 32, messages[j]};
+    }
+    vector<char> results(checks.size());
+    ed25519VerifyBatch(checks.data(), checks.size(), results.data());
+    for (size_t j = 0; j < checks.size(); ++j) {
+        valid[signedAt[j]] = results[j];
+    }
+    return size_t(count(valid.begin(), valid.end(), 0));
+}
+
+// Function to append the hashed content of a TransactionBatchBlock (the transactions themselves are not part of it)
+void appendBlockContent(string& out, const TransactionBatchBlock& block) {
+    blockContentHeader(out, TRANSACTION_BATCH_STAGE, block.header);
+    appendUint32(out, block.transactionCount);
+    out.append(reinterpret_cast<const char*>(block.merkleRoot.data()), block.merkleRoot.size());
+    blockContentFooter(out, block.header);
+}
+
+// Function to append the hashed content of an UpdateBlock: the target's hash and stage, then (column, value) per
+// changed field. The target's business ID is not part of it; the hash already names the block
+void appendBlockContent(string& out, const UpdateBlock& block) {
+    blockContentHeader(out, UPDATE_STAGE, block.header);
+    out.append(reinterpret_cast<const char*>(block.targetHash.data()), block.targetHash.size());
+    out.push_back(char(block.targetStage));
+    out.push_back(char(block.fieldCount));
+    for (uint8_t i = 0; i < block.fieldCount; ++i) {
+        out.push_back(char(block.columns[i]));
+        appendField(out, block.values[i]);
+    }
+    blockContentFooter(out, block.header);
+}
+
+// Function to generate a block hash using the SHA-256 algorithm over the block's canonical content
+BlockHash generateBlockHash(const string& content) {
+    BlockHash hash;
+    sha256(content.data(), content.size(), hash.data());
+    return hash; // Return the raw 32-byte digest
+}
+
+// Function to count the leading zero bits of a digest
+static unsigned leadingZeroBits(const uint8_t* digest) {
+    for (unsigned i = 0; i < 32; ++i) {
+        if (digest[i] != 0) {
+            return 8 * i + unsigned(__builtin_clz(digest[i])) - 24;
+        }
+    }
+    return 256;
+}
+
+// Function to try the nonces first, first + stride, ... until one gives a hash with enough leading zero bits
+// or another thread has found one. The message is the absorbed midstate plus one or two padded blocks
+// (padded, with the nonce at nonceOffset), so every try costs at most two compressions
+static void searchNonces(const Sha256Midstate& midstate, const uint8_t* padded, size_t blocks, size_t nonceOffset,
+                         unsigned difficulty, uint64_t first, uint64_t stride, atomic<uint64_t>& found, atomic<uint64_t>& tried) {
+    uint64_t tries = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (sha256Features.avx2) {
+        // Eight nonces per step, one per AVX2 lane
+        uint8_t lanes[8][128];
+        for (size_t lane = 0; lane < 8; ++lane) {
+            memcpy(lanes[lane], padded, 128);
+        }
+        for (uint64_t nonce = first; found.load(memory_order_relaxed) == UINT64_MAX; nonce += stride * 8) {
+            uint32_t states[8][8];
+            for (size_t lane = 0; lane < 8; ++lane) {
+                uint64_t value = nonce + lane * stride;
+                for (int i = 0; i < 8; ++i) {
+                    lanes[lane][nonceOffset + i] = uint8_t(value >> (8 * i));
+                }
+                memcpy(states[lane], midstate.state, sizeof(midstate.state));
+            }
+            for (size_t block = 0; block < blocks; ++block) {
+                const uint8_t* pointers[8];
+                for (size_t lane = 0; lane < 8; ++lane) {
+                    pointers[lane] = lanes[lane] + 64 * block;
+                }
+                sha256Compress8Avx2(states, pointers);
+            }
+            tries += 8;
+            for (size_t lane = 0; lane < 8; ++lane) {
+                uint8_t digest[32];
+                sha256StoreDigest(states[lane], digest);
+                uint64_t expected = UINT64_MAX;
+                if (leadingZeroBits(digest) >= difficulty) {
+                    found.compare_exchange_strong(expected, nonce + lane * stride);
+                    break;
+                }
+            }
+        }
+        tried += tries;
+        return;
+    }
+#endif
+    uint8_t message[128];
+    memcpy(message, padded, 128);
+    for (uint64_t nonce = first; found.load(memory_order_relaxed) == UINT64_MAX; nonce += stride) {
+        for (int i = 0; i < 8; ++i) {
+            message[nonceOffset + i] = uint8_t(nonce >> (8 * i));
+        }
+        uint32_t state[8];
+        memcpy(state, midstate.state, sizeof(state));
+        sha256Compress(state, message, blocks);
+        tries++;
+        uint8_t digest[32];
+        sha256StoreDigest(state, digest);
+        uint64_t expected = UINT64_MAX;
+        if (leadingZeroBits(digest) >= difficulty) {
+            found.compare_exchange_strong(expected, nonce);
+        }
+    }
+    tried += tries;
+}
+
+// Function to search on all cores for the nonce that gives a block's content a hash with at least
+// header.difficulty leading zero bits. Everything before the nonce is absorbed into a midstate once; each
+// thread then walks its own interleaved slice of nonces and all of them stop as soon as one finds a solution.
+// The nonce is written into the header and the content; returns the hash
+BlockHash sealProofOfWork(string& content, BlockHeader& header) {
+    auto start = chrono::steady_clock::now();
+    size_t nonceAt = content.size() - (BLOCK_FOOTER_SIZE - 1);
+    Sha256Midstate midstate;
+    sha256Begin(midstate, content.data(), nonceAt);
+    size_t restLength = content.size() - midstate.length; // Below 64 + BLOCK_FOOTER_SIZE, so at most two padded blocks
+    uint8_t padded[128] = {};
+    memcpy(padded, content.data() + midstate.length, restLength);
+    padded[restLength] = 0x80;
+    size_t blocks = (restLength + 9 + 63) / 64;
+    uint64_t bitLength = uint64_t(content.size()) * 8;
+    for (int i = 0; i < 8; ++i) {
+        padded[blocks * 64 - 1 - i] = uint8_t(bitLength >> (8 * i));
+    }
+
+    // Easy targets are found before extra threads would even start
+    unsigned threadCount = header.difficulty >= POW_PARALLEL_DIFFICULTY ? max(1u, thread::hardware_concurrency()) : 1;
+    atomic<uint64_t> found(UINT64_MAX);
+    atomic<uint64_t> tried(0);
+    size_t nonceOffset = nonceAt - midstate.length;
+    vector<thread> workers;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        workers.emplace_back(searchNonces, cref(midstate), padded, blocks, nonceOffset, unsigned(header.difficulty),
+                             uint64_t(t), uint64_t(threadCount), ref(found), ref(tried));
+    }
+    searchNonces(midstate, padded, blocks, nonceOffset, header.difficulty, 0, threadCount, found, tried);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    header.nonce = found.load();
+    for (int i = 0; i < 8; ++i) {
+        content[nonceAt + i] = char(uint8_t(header.nonce >> (8 * i)));
+    }
+    proofOfWork.blocks++;
+    proofOfWork.hashes += tried.load();
+    proofOfWork.nanoseconds += uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    return generateBlockHash(content);
+}
+
+// Function to print the proof-of-work search statistics
+void printProofOfWorkReport() {
+    uint64_t blocks = proofOfWork.blocks.load();
+    double seconds = max(proofOfWork.nanoseconds.load() / 1e9, 1e-9);
+    cout << "\n===== Proof of Work =====\n" << endl;
+    cout << "Difficulty       : " << proofOfWork.difficulty << " leading zero bits" << endl;
+    cout << "Blocks sealed    : " << blocks << endl;
+    cout << "Hashes tried     : " << proofOfWork.hashes.load() << " (" << fixed << setprecision(1)
+         << (blocks != 0 ? double(proofOfWork.hashes.load()) / blocks : 0.0) << " per block)" << endl;
+    cout << "Search time      : " << setprecision(3) << seconds << " s" << endl;
+    cout << "Throughput       : " << setprecision(2) << proofOfWork.hashes.load() / seconds / 1e6 << " MH/s, "
+         << setprecision(1) << blocks / seconds << " blocks/s" << endl;
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// Exported form of every metric and counter, in MetricId and CounterId order
+const MetricInfo METRIC_INFO[METRIC_COUNT] = {
+    {"tms_block_build_seconds", "stage=\"Supply\"", "Time to build a block's payload from a row (parsing and interning)", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Press\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Welding\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Painting\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Assembly\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Shipping\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"Transaction\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_block_build_seconds", "stage=\"TransactionBatch\"", "", 0},
+    {"tms_block_seal_seconds", "", "Time to give a block its header and hash (including any proof of work)", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_chain_append_seconds", "", "Time to link, hash and store a block on a shared chain, waiting for its turn included", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_verify_seconds", "", "Time of a full chain verification", 0},
+    {"tms_store_seconds", "operation=\"append\"", "Time of chain store operations", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_store_seconds", "operation=\"write\"", "", 0},
+    {"tms_store_seconds", "operation=\"sync\"", "", 0},
+    {"tms_store_seconds", "operation=\"rotate\"", "", 0},
+    {"tms_store_seconds", "operation=\"read\"", "", METRIC_BLOCK_SAMPLE_SHIFT},
+    {"tms_store_seconds", "operation=\"scan\"", "", 0},
+    {"tms_checkpoint_seconds", "", "Time to write a checkpoint", 0},
+    {"tms_render_flush_seconds", "", "Time to write a buffer of rendered blocks", 0},
+    {"tms_service_request_seconds", "", "Time to handle one service request", 0},
+};
+const MetricInfo COUNTER_INFO[COUNTER_COUNT] = {
+    {"tms_rows_ingested_total", "", "Rows that became blocks or batched transactions", 0},
+    {"tms_rows_skipped_total", "", "Rows rejected as an unknown stage, out of vehicle order or with a bad or missing signature", 0},
+    {"tms_store_bytes_total", "", "Record bytes appended to the chain store", 0},
+    {"tms_render_bytes_total", "", "Rendered bytes written", 0},
+    {"tms_blocks_verified_total", "", "Blocks checked by chain verifications", 0},
+};
+
+// Function to read the metric clock: TSC cycles where the TSC runs at a constant rate, otherwise nanoseconds
+static inline uint64_t metricTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (metricRegistry.tsc) {
+        return __rdtsc();
+    }
+#endif
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Function to pick the metric clock and remember its starting point (runs before main)
+static bool initMetricClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    metricRegistry.tsc = __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)) != 0; // Invariant TSC
+#endif
+    metricRegistry.startTicks = metricTicks();
+    metricRegistry.startNanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    return true;
+}
+static const bool metricClockReady = initMetricClock();
+
+// Function to get the seconds per tick, calibrated against the steady clock over the program's run so far
+static double metricSecondsPerTick() {
+    if (!metricRegistry.tsc) {
+        return 1e-9;
+    }
+    int64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count() -
+                          metricRegistry.startNanoseconds;
+    uint64_t ticks = metricTicks() - metricRegistry.startTicks;
+    return ticks > 0 && nanoseconds > 0 ? nanoseconds / 1e9 / double(ticks) : 1e-9;
+}
+
+// Function to map a tick count to its histogram bucket: exact below 2^bits, then 2^bits buckets per power of two
+static inline size_t metricBucket(uint64_t ticks) {
+    if (ticks < (1u << METRIC_SUB_BUCKET_BITS)) {
+        return size_t(ticks);
+    }
+    unsigned exponent = 63 - unsigned(__builtin_clzll(ticks));
+    unsigned shift = exponent - METRIC_SUB_BUCKET_BITS;
+    return (size_t(shift + 1) << METRIC_SUB_BUCKET_BITS) + size_t((ticks >> shift) & ((1u << METRIC_SUB_BUCKET_BITS) - 1));
+}
+
+// Function to get the largest tick count that falls into a bucket
+static uint64_t metricBucketLimit(size_t bucket) {
+    if (bucket < (1u << METRIC_SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+    unsigned shift = unsigned(bucket >> METRIC_SUB_BUCKET_BITS) - 1;
+    uint64_t mantissa = (1u << METRIC_SUB_BUCKET_BITS) + (bucket & ((1u << METRIC_SUB_BUCKET_BITS) - 1));
+    return shift >= 60 ? UINT64_MAX : ((mantissa + 1) << shift) - 1;
+}
+
+#ifndef TMS_NO_METRICS
+// Function to get the calling thread's shard, claiming a free one (or creating one) on first use
+static MetricShard* metricShard() {
+    thread_local MetricThreadSlot slot;
+    if (slot.shard != nullptr) {
+        return slot.shard;
+    }
+    unsigned count = metricRegistry.shardCount.load(memory_order_acquire);
+    for (unsigned i = 0; i < count; ++i) {
+        MetricShard* shard = metricRegistry.shards[i].load(memory_order_acquire);
+        bool idle = false;
+        if (shard != nullptr && shard->inUse.compare_exchange_strong(idle, true, memory_order_acquire)) {
+            return slot.shard = shard;
+        }
+    }
+    unsigned index = metricRegistry.shardCount.fetch_add(1, memory_order_acq_rel);
+    if (index >= METRICS_MAX_THREADS) {
+        metricRegistry.shardCount.store(METRICS_MAX_THREADS);
+        return nullptr;
+    }
+    MetricShard* shard = new MetricShard(); // Value-initialized: every count starts at zero
+    shard->inUse.store(true, memory_order_relaxed);
+    metricRegistry.shards[index].store(shard, memory_order_release);
+    return slot.shard = shard;
+}
+
+// Function to start timing a scope: every event, or for a sampled metric this thread's first event and then every
+// 2^shift-th one, standing for itself and the events skipped before it (counts fall short by under 2^shift per thread)
+MetricTimer::MetricTimer(unsigned id) : metric(id) {
+    thread_local uint32_t countdown[METRIC_COUNT] = {}; // Events of each metric left until the next timed one
+    thread_local bool started[METRIC_COUNT] = {};       // Whether the thread has timed the metric before
+    if (countdown[id] == 0) {
+        uint32_t period = 1u << METRIC_INFO[id].sampleShift;
+        weight = started[id] ? period : 1;
+        started[id] = true;
+        countdown[id] = period - 1;
+        start = metricTicks();
+    } else {
+        countdown[id]--;
+    }
+}
+
+// Function to record the scope's duration if it was timed
+MetricTimer::~MetricTimer() {
+    if (weight != 0) {
+        recordMetric(metric, metricTicks() - start, weight);
+    }
+}
+
+// Function to record a timed event of a metric in the calling thread's shard, standing for weight events
+void recordMetric(unsigned metric, uint64_t ticks, uint64_t weight) {
+    MetricShard* shard = metricShard();
+    if (shard == nullptr) {
+        return;
+    }
+    // Single writer: a relaxed load and store replace a locked read-modify-write
+    atomic<uint64_t>& bucket = shard->buckets[metric][metricBucket(ticks)];
+    bucket.store(bucket.load(memory_order_relaxed) + weight, memory_order_relaxed);
+    shard->ticks[metric].store(shard->ticks[metric].load(memory_order_relaxed) + ticks * weight, memory_order_relaxed);
+}
+
+// Function to add to a counter in the calling thread's shard
+void countMetric(unsigned counter, uint64_t amount) {
+    MetricShard* shard = metricShard();
+    if (shard != nullptr) {
+        shard->counters[counter].store(shard->counters[counter].load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+}
+#else
+// Function to record a timed event of a metric (metrics compiled out)
+void recordMetric(unsigned, uint64_t, uint64_t) {
+}
+
+// Function to add to a counter (metrics compiled out)
+void countMetric(unsigned, uint64_t) {
+}
+#endif
+
+// Function to merge one metric's histogram over every thread's shard; returns the total ticks
+static uint64_t mergeMetric(unsigned metric, vector<uint64_t>& buckets) {
+    buckets.assign(METRIC_BUCKETS, 0);
+    uint64_t ticks = 0;
+    unsigned count = min<unsigned>(metricRegistry.shardCount.load(memory_order_acquire), METRICS_MAX_THREADS);
+    for (unsigned i = 0; i < count; ++i) {
+        const MetricShard* shard = metricRegistry.shards[i].load(memory_order_acquire);
+        if (shard == nullptr) continue;
+        for (size_t b = 0; b < METRIC_BUCKETS; ++b) {
+            buckets[b] += shard->buckets[metric][b].load(memory_order_relaxed);
+        }
+        ticks += shard->ticks[metric].load(memory_order_relaxed);
+    }
+    return ticks;
+}
+
+// Function to merge one counter over every thread's shard
+static uint64_t mergeCounter(unsigned counter) {
+    uint64_t total = 0;
+    unsigned count = min<unsigned>(metricRegistry.shardCount.load(memory_order_acquire), METRICS_MAX_THREADS);
+    for (unsigned i = 0; i < count; ++i) {
+        const MetricShard* shard = metricRegistry.shards[i].load(memory_order_acquire);
+        if (shard != nullptr) total += shard->counters[counter].load(memory_order_relaxed);
+    }
+    return total;
+}
+
+// Function to render every metric, merged over all threads, in the Prometheus text exposition format.
+// Histograms list only the buckets that have events (plus +Inf), each bound being the bucket's upper edge
+string formatMetrics() {
+    ostringstream out;
+    out << setprecision(9);
+    double secondsPerTick = metricSecondsPerTick();
+    vector<uint64_t> buckets;
+    const char* previousName = "";
+    for (unsigned metric = 0; metric < METRIC_COUNT; ++metric) {
+        const MetricInfo& info = METRIC_INFO[metric];
+        if (strcmp(info.name, previousName) != 0) {
+            out << "# HELP " << info.name << " " << info.help << "\n# TYPE " << info.name << " histogram\n";
+            previousName = info.name;
+        }
+        uint64_t ticks = mergeMetric(metric, buckets);
+        string labels = info.labels;
+        string separator = labels.empty() ? "" : ",";
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < METRIC_BUCKETS; ++b) {
+            if (buckets[b] == 0) continue;
+            cumulative += buckets[b];
+            out << info.name << "_bucket{" << labels << separator << "le=\"" << (metricBucketLimit(b) + 1) * secondsPerTick
+                << "\"} " << cumulative << "\n";
+        }
+        string braces = labels.empty() ? "" : "{" + labels + "}";
+        out << info.name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << cumulative << "\n"
+            << info.name << "_sum" << braces << " " << ticks * secondsPerTick << "\n"
+            << info.name << "_count" << braces << " " << cumulative << "\n";
+    }
+    for (unsigned counter = 0; counter < COUNTER_COUNT; ++counter) {
+        const MetricInfo& info = COUNTER_INFO[counter];
+        out << "# HELP " << info.name << " " << info.help << "\n# TYPE " << info.name << " counter\n"
+            << info.name << " " << mergeCounter(counter) << "\n";
+    }
+    return out.str();
+}
+
+// Function to print a latency summary (count, mean and percentiles) of every metric that has events
+void printMetricsReport(ostream& out) {
+#ifdef TMS_NO_METRICS
+    out << "Metrics are compiled out (TMS_NO_METRICS)" << endl;
+#else
+    double microsecondsPerTick = metricSecondsPerTick() * 1e6;
+    vector<uint64_t> buckets;
+    out << "\n===== Metrics (microseconds) =====\n\n" << left << setw(52) << "Metric" << right << setw(10) << "Count"
+        << setw(11) << "Mean" << setw(11) << "p50" << setw(11) << "p90" << setw(11) << "p99" << setw(11) << "Max" << "\n";
+    out << fixed << setprecision(2);
+    for (unsigned metric = 0; metric < METRIC_COUNT; ++metric) {
+        uint64_t ticks = mergeMetric(metric, buckets);
+        uint64_t count = 0;
+        for (uint64_t events : buckets) count += events;
+        if (count == 0) continue;
+        // A percentile is reported as the upper edge of the bucket it falls in
+        auto percentile = [&](double fraction) {
+            uint64_t rank = max<uint64_t>(1, uint64_t(ceil(fraction * count))), seen = 0;
+            for (size_t b = 0; b < METRIC_BUCKETS; ++b) {
+                seen += buckets[b];
+                if (seen >= rank) return metricBucketLimit(b) * microsecondsPerTick;
+            }
+            return 0.0;
+        };
+        string name = string(METRIC_INFO[metric].name) + (*METRIC_INFO[metric].labels ? "{" + string(METRIC_INFO[metric].labels) + "}" : "");
+        out << left << setw(52) << name << right << setw(10) << count << setw(11) << ticks * microsecondsPerTick / count
+            << setw(11) << percentile(0.5) << setw(11) << percentile(0.9) << setw(11) << percentile(0.99) << setw(11)
+            << percentile(1.0) << "\n";
+    }
+    for (unsigned counter = 0; counter < COUNTER_COUNT; ++counter) {
+        out << left << setw(52) << COUNTER_INFO[counter].name << right << setw(10) << mergeCounter(counter) << "\n";
+    }
+    out << defaultfloat << setprecision(6) << endl;
+#endif
+}
+
+// Function to hash several block contents in one call (multi-buffer SIMD where available)
+vector<BlockHash> generateBlockHashes(const vector<string>& contents) {
+    vector<const uint8_t*> data(contents.size());
+    vector<size_t> lengths(contents.size());
+    for (size_t i = 0; i < contents.size(); ++i) {
+        data[i] = reinterpret_cast<const uint8_t*>(contents[i].data());
+        lengths[i] = contents[i].size();
+    }
+    vector<BlockHash> hashes(contents.size());
+    static_assert(sizeof(BlockHash) == 32, "BlockHash must be a bare 32-byte digest");
+    sha256Batch(data.data(), lengths.data(), contents.size(), hashes.empty() ? nullptr : hashes[0].data());
+    return hashes;
+}
+
+// Function to hash leaves [begin, end) as SHA-256(0x00 || leaf), eight lanes at a time
+static void hashMerkleLeaves(const vector<string_view>& leaves, size_t begin, size_t end, BlockHash* out) {
+    string prefixed[8];
+    const uint8_t* data[8];
+    size_t lengths[8];
+    for (size_t first = begin; first < end; first += 8) {
+        size_t lanes = min<size_t>(8, end - first);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            prefixed[lane].assign(1, '\0');
+            prefixed[lane].append(leaves[first + lane].data(), leaves[first + lane].size());
+            data[lane] = reinterpret_cast<const uint8_t*>(prefixed[lane].data());
+            lengths[lane] = prefixed[lane].size();
+        }
+        sha256Batch(data, lengths, lanes, out[first].data());
+    }
+}
+
+// Function to hash parent nodes [begin, end) as SHA-256(0x01 || left || right), eight lanes at a time
+static void hashMerkleNodes(const vector<BlockHash>& below, size_t begin, size_t end, BlockHash* out) {
+    uint8_t messages[8][65];
+    const uint8_t* data[8];
+    size_t lengths[8];
+    for (size_t first = begin; first < end; first += 8) {
+        size_t lanes = min<size_t>(8, end - first);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            size_t node = first + lane;
+            messages[lane][0] = 0x01;
+            memcpy(messages[lane] + 1, below[2 * node].data(), 32);
+            memcpy(messages[lane] + 33, below[2 * node + 1].data(), 32);
+            data[lane] = messages[lane];
+            lengths[lane] = sizeof(messages[lane]);
+        }
+        sha256Batch(data, lengths, lanes, out[first].data());
+    }
+}
+
+// Function to split [0, count) into one range per thread (multiples of eight, so SIMD lanes stay full) and run them;
+// small counts run on the calling thread
+static void runMerkleRanges(size_t count, unsigned threadCount, const function<void(size_t, size_t)>& work) {
+    size_t threads = min<size_t>(threadCount, max<size_t>(1, count / MERKLE_LEAVES_PER_THREAD));
+    if (threads <= 1) {
+        work(0, count);
+        return;
+    }
+    size_t rangeSize = ((count + threads - 1) / threads + 7) & ~size_t(7);
+    vector<thread> workers;
+    for (size_t begin = rangeSize; begin < count; begin += rangeSize) {
+        workers.emplace_back(work, begin, min(count, begin + rangeSize));
+    }
+    work(0, min(count, rangeSize));
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Function to build the Merkle tree over a batch of leaves: the leaves (the bulk of the bytes) and any wide
+// level are hashed on several threads, each using the multi-buffer SHA-256 path
+void buildMerkleTree(const vector<string_view>& leaves, MerkleTree& tree, unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    tree.levels.assign(1, vector<BlockHash>(leaves.size()));
+    runMerkleRanges(leaves.size(), threadCount, [&](size_t begin, size_t end) {
+        hashMerkleLeaves(leaves, begin, end, tree.levels[0].data());
+    });
+    while (tree.levels.back().size() > 1) {
+        const vector<BlockHash>& below = tree.levels.back();
+        vector<BlockHash> level((below.size() + 1) / 2);
+        runMerkleRanges(below.size() / 2, threadCount, [&](size_t begin, size_t end) {
+            hashMerkleNodes(below, begin, end, level.data());
+        });
+        if (below.size() % 2 != 0) {
+            level.back() = below.back(); // No sibling: carried up unchanged
+        }
+        tree.levels.push_back(move(level));
+    }
+}
+
+// Function to get the root of a Merkle tree (all zeros for an empty tree)
+BlockHash merkleRoot(const MerkleTree& tree) {
+    BlockHash root{};
+    if (!tree.levels.empty() && !tree.levels.back().empty()) {
+        root = tree.levels.back()[0];
+    }
+    return root;
+}
+
+// Function to build the inclusion proof of one leaf: its sibling at every level that has one
+MerkleProof merkleProof(const MerkleTree& tree, uint64_t leafIndex) {
+    MerkleProof proof;
+    proof.leafIndex = leafIndex;
+    proof.leafCount = tree.levels.empty() ? 0 : tree.levels[0].size();
+    uint64_t position = leafIndex;
+    for (size_t level = 0; level + 1 < tree.levels.size(); ++level, position /= 2) {
+        uint64_t sibling = position ^ 1;
+        if (sibling < tree.levels[level].size()) {
+            proof.siblings.push_back(tree.levels[level][sibling]);
+        }
+    }
+    return proof;
+}
+
+// Function to check that a leaf is part of the tree with the given root by hashing up along the proof
+bool verifyMerkleProof(string_view leaf, const MerkleProof& proof, const BlockHash& root) {
+    if (proof.leafIndex >= proof.leafCount) {
+        return false;
+    }
+    string message(1, '\0');
+    message.append(leaf.data(), leaf.size());
+    BlockHash node;
+    sha256(message.data(), message.size(), node.data());
+
+    uint8_t pair[65];
+    pair[0] = 0x01;
+    size_t used = 0;
+    uint64_t position = proof.leafIndex;
+    for (uint64_t width = proof.leafCount; width > 1; width = (width + 1) / 2, position /= 2) {
+        if ((position ^ 1) >= width) {
+            continue; // Last node of an odd level: carried up unchanged
+        }
+        if (used == proof.siblings.size()) {
+            return false;
+        }
+        const BlockHash& sibling = proof.siblings[used++];
+        const BlockHash& left = (position & 1) != 0 ? sibling : node;
+        const BlockHash& right = (position & 1) != 0 ? node : sibling;
+        memcpy(pair + 1, left.data(), 32);
+        memcpy(pair + 33, right.data(), 32);
+        sha256(pair, sizeof(pair), node.data());
+    }
+    return used == proof.siblings.size() && node == root;
+}
+
+// Function to build the payload of a transaction batch block (count and Merkle root; the header is filled in when
+// the block is sealed) and append the body stored next to it to body: every leaf as [u32 length][leaf]
+TransactionBatchBlock buildTransactionBatchBlock(const vector<TransactionBlockchain>& transactions, string& body) {
+    MetricTimer timer(METRIC_BUILD_BATCH);
+    // Each leaf is serialized straight into the body and its length prefix patched afterwards
+    vector<size_t> offsets(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        appendUint32(body, 0);
+        offsets[i] = body.size();
+        appendTransactionPayload(body, transactions[i]);
+        uint32_t length = uint32_t(body.size() - offsets[i]);
+        memcpy(&body[offsets[i] - 4], &length, 4);
+    }
+    // Views into the finished body, so the leaves are serialized once and never copied again
+    vector<string_view> leaves(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        size_t end = i + 1 < transactions.size() ? offsets[i + 1] - 4 : body.size();
+        leaves[i] = string_view(body.data() + offsets[i], end - offsets[i]);
+    }
+    MerkleTree tree;
+    buildMerkleTree(leaves, tree);
+
+    TransactionBatchBlock block{};
+    block.transactionCount = uint32_t(transactions.size());
+    block.merkleRoot = merkleRoot(tree);
+    return block;
+}
+
+// Function to build the inclusion proof of the transaction with a given ID within a batch; proof.leafIndex
+// tells which transaction it is (false if no transaction of the batch carries the ID)
+bool proveTransaction(const vector<TransactionBlockchain>& transactions, string_view transactionId, MerkleProof& proof) {
+    size_t match = transactions.size();
+    vector<string> leafText(transactions.size());
+    vector<string_view> leaves(transactions.size());
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (match == transactions.size() && lookupString(transactions[i].transactionId) == transactionId) {
+            match = i;
+        }
+        leafText[i] = transactionLeaf(transactions[i]);
+        leaves[i] = leafText[i];
+    }
+    if (match == transactions.size()) {
+        return false;
+    }
+    MerkleTree tree;
+    buildMerkleTree(leaves, tree);
+    proof = merkleProof(tree, match);
+    return true;
+}
+
+// Function to check a transaction against a batch block header with a compact proof: the header's hash must
+// match its content and the transaction must hash up to the header's Merkle root
+bool verifyTransactionInclusion(const TransactionBatchBlock& block, const TransactionBlockchain& transaction, const MerkleProof& proof) {
+    return generateBlockHash(blockContent(block)) == block.header.currentBlockHash &&
+           proof.leafCount == block.transactionCount &&
+           verifyMerkleProof(transactionLeaf(transaction), proof, block.merkleRoot);
+}
+
+// Function to generate a timestamp: nanoseconds since the Unix epoch (UTC)
+// Only the monotonic clock is read per call (no time zone work); formatting happens when a block is displayed.
+// Timestamps are strictly increasing across all threads, so even blocks created within the same nanosecond are ordered
+uint64_t generateTimestamp() {
+    int64_t steady = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t now = uint64_t(blockClock.utcAnchor + (steady - blockClock.steadyAnchor));
+    uint64_t last = blockClock.last.load(memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = now > last ? now : last + 1;
+    } while (!blockClock.last.compare_exchange_weak(last, next, memory_order_relaxed));
+    return next;
+}
+
+// Function to start a new block header: take the next block number, stamp the time and link to the previous block
+static BlockHeader newBlockHeader(const BlockHeader* previous) {
+    BlockHeader header{};
+    header.blockNumber = blockNumber.fetch_add(1, memory_order_relaxed); // blockNumber is a global variable, so increment it
+    header.timestamp = generateTimestamp();
+    header.difficulty = uint8_t(proofOfWork.difficulty);
+    if (previous != nullptr) {
+        header.previousBlockHash = previous->currentBlockHash; // Get the current hash from the previous block
+    } else {
+        header.previousBlockHash.fill(0); // The first block of the chain links to the all-zero genesis hash
+    }
+    return header;
+}
+
+// Function to seal a block onto the chain: give it a header, record its vehicle's upstream block and hash its content
+template <typename Block>
+void sealBlock(Block& block, const BlockHeader* previous, const BlockHeader* upstream) {
+    MetricTimer timer(METRIC_SEAL);
+    block.header = newBlockHeader(previous);
+    block.header.upstreamOffset = upstream != nullptr ? uint32_t(block.header.blockNumber - upstream->blockNumber) : 0;
+    thread_local string content; // Reused by every block this thread seals
+    content.clear();
+    appendBlockContent(content, block);
+    block.header.currentBlockHash = block.header.difficulty != 0 ? sealProofOfWork(content, block.header) : generateBlockHash(content);
+}
+
+
+// Function to build the payload of a new SupplierBlockchain block (the header is filled in when the block is sealed)
+SupplierBlockchain buildSupplierBlock(string_view supplierId, string_view supplierName, string_view supplierItem, string_view location, string_view branch, string_view quantity, string_view price) {
+    MetricTimer timer(METRIC_BUILD_SUPPLY);
+    // Create a new SupplierBlockchain block
+    SupplierBlockchain block{};
+
+    // Set the supplier-specific data
+    block.supplierId = internString(supplierId);
+    block.supplierName = internString(supplierName);
+    block.supplierItem = internString(supplierItem);
+    block.location = internString(location);
+    block.branch = internString(branch);
+    block.quantity = parseCount(quantity);
+    parseMoney(price, block.price); // Rows are checked before they are built (rowMoneyValid)
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new SupplierBlockchain block
+SupplierBlockchain generateSupplierBlockChain(string_view supplierId, string_view supplierName, string_view supplierItem, string_view location, string_view branch, string_view quantity, string_view price, const BlockHeader* previous) {
+    // Build the supplier-specific data, then seal the block onto the chain
+    // A vehicle's supplier block links to the previous vehicle's transaction block; the very first one links to the all-zero genesis hash
+    SupplierBlockchain block = buildSupplierBlock(supplierId, supplierName, supplierItem, location, branch, quantity, price);
+    sealBlock(block, previous, nullptr);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new PressBlockchain block (the header is filled in when the block is sealed)
+PressBlockchain buildPressBlock(string_view pressId, string_view pressLocation, string_view pressDetails, string_view pressType, string_view pressManufacturer, string_view pressCapacity) {
+    MetricTimer timer(METRIC_BUILD_PRESS);
+    // Create a new PressBlockchain block
+    PressBlockchain block{};
+
+    // Set the press-specific data
+    block.pressId = internString(pressId);
+    block.pressLocation = internString(pressLocation);
+    block.pressDetails = internString(pressDetails);
+    block.pressType = internString(pressType);
+    block.pressManufacturer = internString(pressManufacturer);
+    block.pressCapacity = parseMeasure(pressCapacity);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new PressBlockchain block
+PressBlockchain generatePressBlockChain(string_view pressId, string_view pressLocation, string_view pressDetails, string_view pressType, string_view pressManufacturer, string_view pressCapacity, const BlockHeader* previous) {
+    // Build the press-specific data, then seal the block onto the chain
+    PressBlockchain block = buildPressBlock(pressId, pressLocation, pressDetails, pressType, pressManufacturer, pressCapacity);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new WeldingBlockchain block (the header is filled in when the block is sealed)
+WeldingBlockchain buildWeldingBlock(string_view weldingId, string_view weldingLocation, string_view weldingDetails, string_view weldingType, string_view weldingMaterial, string_view weldingTemperature) {
+    MetricTimer timer(METRIC_BUILD_WELDING);
+    // Create a new WeldingBlockchain block
+    WeldingBlockchain block{};
+
+    // Set the welding-specific data
+    block.weldingId = internString(weldingId);
+    block.weldingLocation = internString(weldingLocation);
+    block.weldingDetails = internString(weldingDetails);
+    block.weldingType = internString(weldingType);
+    block.weldingMaterial = internString(weldingMaterial);
+    block.weldingTemperature = parseMeasure(weldingTemperature);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new WeldingBlockchain block
+WeldingBlockchain generateWeldingBlockChain(string_view weldingId, string_view weldingLocation, string_view weldingDetails, string_view weldingType, string_view weldingMaterial, string_view weldingTemperature, const BlockHeader* previous) {
+    // Build the welding-specific data, then seal the block onto the chain
+    WeldingBlockchain block = buildWeldingBlock(weldingId, weldingLocation, weldingDetails, weldingType, weldingMaterial, weldingTemperature);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new PaintingBlockchain block (the header is filled in when the block is sealed)
+PaintingBlockchain buildPaintingBlock(string_view paintingId, string_view paintingLocation, string_view paintingDetails, string_view PaintingColor, string_view paintingType, string_view paintingThickness) {
+    MetricTimer timer(METRIC_BUILD_PAINTING);
+    // Create a new PaintingBlockchain block
+    PaintingBlockchain block{};
+
+    // Set the painting-specific data
+    block.paintingId = internString(paintingId);
+    block.paintingLocation = internString(paintingLocation);
+    block.paintingDetails = internString(paintingDetails);
+    block.paintingColor = internString(PaintingColor); // Renamed variable to adhere to camelCase naming convention
+    block.paintingType = internString(paintingType);
+    block.paintingThickness = parseMeasure(paintingThickness);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new PaintingBlockchain block
+PaintingBlockchain generatePaintingBlockChain(string_view paintingId, string_view paintingLocation, string_view paintingDetails, string_view PaintingColor, string_view paintingType, string_view paintingThickness, const BlockHeader* previous) {
+    // Build the painting-specific data, then seal the block onto the chain
+    PaintingBlockchain block = buildPaintingBlock(paintingId, paintingLocation, paintingDetails, PaintingColor, paintingType, paintingThickness);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new AssemblyBlockchain block (the header is filled in when the block is sealed)
+AssemblyBlockchain buildAssemblyBlock(string_view assemblyId, string_view assemblyLocation, string_view assemblyDetails, string_view assemblyType, string_view numberOfParts, string_view assemblyWeight) {
+    MetricTimer timer(METRIC_BUILD_ASSEMBLY);
+    // Create a new AssemblyBlockchain block
+    AssemblyBlockchain block{};
+
+    // Set the assembly-specific data
+    block.assemblyId = internString(assemblyId);
+    block.assemblyLocation = internString(assemblyLocation);
+    block.assemblyDetails = internString(assemblyDetails);
+    block.assemblyType = internString(assemblyType);
+    block.numberOfParts = parseCount(numberOfParts);
+    block.assemblyWeight = parseMeasure(assemblyWeight);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new AssemblyBlockchain block
+AssemblyBlockchain generateAssemblyBlockChain(string_view assemblyId, string_view assemblyLocation, string_view assemblyDetails, string_view assemblyType, string_view numberOfParts, string_view assemblyWeight, const BlockHeader* previous) {
+    // Build the assembly-specific data, then seal the block onto the chain
+    AssemblyBlockchain block = buildAssemblyBlock(assemblyId, assemblyLocation, assemblyDetails, assemblyType, numberOfParts, assemblyWeight);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new ShippingBlockchain block (the header is filled in when the block is sealed)
+ShippingBlockchain buildShippingBlock(string_view shippingId, string_view shippingDestination, string_view shippingDetails, string_view shippingType, string_view carrierName, string_view shippingStatus) {
+    MetricTimer timer(METRIC_BUILD_SHIPPING);
+    // Create a new ShippingBlockchain block
+    ShippingBlockchain block{};
+
+    // Set the shipping-specific data
+    block.shippingId = internString(shippingId);
+    block.shippingDestination = internString(shippingDestination);
+    block.shippingDetails = internString(shippingDetails);
+    block.shippingType = internString(shippingType);
+    block.carrierName = internString(carrierName);
+    block.shippingStatus = internString(shippingStatus);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new ShippingBlockchain block
+ShippingBlockchain generateShippingBlockChain(string_view shippingId, string_view shippingDestination, string_view shippingDetails, string_view shippingType, string_view carrierName, string_view shippingStatus, const BlockHeader* previous) {
+    // Build the shipping-specific data, then seal the block onto the chain
+    ShippingBlockchain block = buildShippingBlock(shippingId, shippingDestination, shippingDetails, shippingType, carrierName, shippingStatus);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+
+// Function to build the payload of a new TransactionBlockchain block (the header is filled in when the block is sealed)
+TransactionBlockchain buildTransactionBlock(string_view transactionId, string_view transactionType, string_view transactionAmount, string_view sender, string_view receiver, string_view currency, string_view transactionStatus) {
+    MetricTimer timer(METRIC_BUILD_TRANSACTION);
+    // Create a new TransactionBlockchain block
+    TransactionBlockchain block{};
+
+    // Set the transaction-specific data
+    block.transactionId = internString(transactionId);
+    block.transactionType = internString(transactionType);
+    parseMoney(transactionAmount, block.transactionAmount); // Rows are checked before they are built (rowMoneyValid)
+    block.sender = internString(sender);
+    block.receiver = internString(receiver);
+    block.currency = internString(currency);
+    block.transactionStatus = internString(transactionStatus);
+
+    // Return the created block
+    return block;
+}
+
+// Function to generate a new TransactionBlockchain block
+TransactionBlockchain generateTransactionBlockChain(string_view transactionId, string_view transactionType, string_view transactionAmount, string_view sender, string_view receiver, string_view currency, string_view transactionStatus, const BlockHeader* previous) {
+    // Build the transaction-specific data, then seal the block onto the chain
+    TransactionBlockchain block = buildTransactionBlock(transactionId, transactionType, transactionAmount, sender, receiver, currency, transactionStatus);
+    sealBlock(block, previous, previous);
+
+    // Return the created block
+    return block;
+}
+
+// Function to wrap a stage block in a tagged StageBlock
+StageBlock toStageBlock(const SupplierBlockchain& block) { StageBlock any; any.stage = 1; any.supplier = block; return any; }
+StageBlock toStageBlock(const PressBlockchain& block) { StageBlock any; any.stage = 2; any.press = block; return any; }
+StageBlock toStageBlock(const WeldingBlockchain& block) { StageBlock any; any.stage = 3; any.welding = block; return any; }
+StageBlock toStageBlock(const PaintingBlockchain& block) { StageBlock any; any.stage = 4; any.painting = block; return any; }
+StageBlock toStageBlock(const AssemblyBlockchain& block) { StageBlock any; any.stage = 5; any.assembly = block; return any; }
+StageBlock toStageBlock(const ShippingBlockchain& block) { StageBlock any; any.stage = 6; any.shipping = block; return any; }
+StageBlock toStageBlock(const TransactionBlockchain& block) { StageBlock any; any.stage = 7; any.transaction = block; return any; }
+StageBlock toStageBlock(const TransactionBatchBlock& block) { StageBlock any; any.stage = TRANSACTION_BATCH_STAGE; any.batch = block; return any; }
+StageBlock toStageBlock(const UpdateBlock& block) { StageBlock any; any.stage = UPDATE_STAGE; any.update = block; return any; }
+
+// Function to access the header shared by every stage (it is the first member of each stage struct)
+const BlockHeader& blockHeader(const StageBlock& block) {
+    return block.supplier.header;
+}
+
+// Function to append the hashed content of a block of any stage
+void appendBlockContent(string& out, const StageBlock& block) {
+    switch (block.stage) {
+        case 1: appendBlockContent(out, block.supplier); break;
+        case 2: appendBlockContent(out, block.press); break;
+        case 3: appendBlockContent(out, block.welding); break;
+        case 4: appendBlockContent(out, block.painting); break;
+        case 5: appendBlockContent(out, block.assembly); break;
+        case 6: appendBlockContent(out, block.shipping); break;
+        case TRANSACTION_BATCH_STAGE: appendBlockContent(out, block.batch); break;
+        case UPDATE_STAGE: appendBlockContent(out, block.update); break;
+        default: appendBlockContent(out, block.transaction); break;
+    }
+}
+
+// Function to serialize the hashed content of a block into a new string (hot paths append into a reused buffer)
+template <typename Block>
+string blockContent(const Block& block) {
+    string out;
+    out.reserve(256);
+    appendBlockContent(out, block);
+    return out;
+}
+
+// Function to print a block of any stage to the console
+void printStageBlock(const StageBlock& block) {
+    Renderer renderer;
+    renderBlock(renderer, block);
+    flushRenderer(renderer);
+}
+
+// Function to print a SupplierBlockchain block
+void printSupplierBlockchain(const SupplierBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a PressBlockchain block
+void printPressBlockchain(const PressBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a WeldingBlockchain block
+void printWeldingBlockchain(const WeldingBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a PaintingBlockchain block
+void printPaintingBlockchain(const PaintingBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a AssemblyBlockchain block
+void printAssemblyBlockchain(const AssemblyBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a ShippingBlockchain block
+void printShippingBlockchain(const ShippingBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to print a TransactionBlockchain block
+void printTransactionBlockchain(const TransactionBlockchain& block) {
+    printStageBlock(toStageBlock(block));
+}
+
+// Function to memory-map a file read-only; returns false (with a message) if it cannot be opened
+bool mapFile(const string& path, MappedFile& file) {
+    file.fd = open(path.c_str(), O_RDONLY);
+    if (file.fd < 0) {
+        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(file.fd, &info) != 0) {
+        cerr << "Cannot stat " << path << ": " << strerror(errno) << endl;
+        unmapFile(file);
+        return false;
+    }
+    file.size = size_t(info.st_size);
+    if (file.size == 0) {
+        return true; // Nothing to map; an empty file simply yields no rows
+    }
+    void* mapping = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (mapping == MAP_FAILED) {
+        cerr << "Cannot map " << path << ": " << strerror(errno) << endl;
+        unmapFile(file);
+        return false;
+    }
+    file.data = static_cast<const char*>(mapping);
+    madvise(mapping, file.size, MADV_SEQUENTIAL); // Rows are read front to back exactly once
+    return true;
+}
+
+// Function to release a file mapping
+void unmapFile(MappedFile& file) {
+    if (file.data != nullptr) {
+        munmap(const_cast<char*>(file.data), file.size);
+    }
+    if (file.fd >= 0) {
+        close(file.fd);
+    }
+    file = MappedFile();
+}
+
+// Function to split one CSV/TSV row into fields without copying
+// (fields point into the row; only quoted fields containing "" escapes are unescaped into scratch)
+void splitRow(string_view row, char delimiter, vector<string_view>& fields, string& scratch) {
+    fields.clear();
+    scratch.clear();
+    scratch.reserve(row.size()); // Never reallocates below, so views into scratch stay valid
+    size_t position = 0;
+    while (true) {
+        if (position < row.size() && row[position] == '"') {
+            // Quoted field: the delimiter may appear inside, and "" stands for a literal quote
+            size_t start = ++position;
+            bool escaped = false;
+            while (position < row.size()) {
+                if (row[position] == '"') {
+                    if (position + 1 < row.size() && row[position + 1] == '"') {
+                        escaped = true;
+                        position += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++position;
+            }
+            string_view field = row.substr(start, position - start);
+            if (escaped) {
+                size_t begin = scratch.size();
+                for (size_t i = 0; i < field.size(); ++i) {
+                    scratch.push_back(field[i]);
+                    if (field[i] == '"') {
+                        ++i; // Skip the second quote of the pair
+                    }
+                }
+                field = string_view(scratch.data() + begin, scratch.size() - begin);
+            }
+            fields.push_back(field);
+            position = row.find(delimiter, position);
+        } else {
+            size_t end = row.find(delimiter, position);
+            fields.push_back(row.substr(position, end == string_view::npos ? string_view::npos : end - position));
+            position = end;
+        }
+        if (position == string_view::npos || position >= row.size()) {
+            break;
+        }
+        ++position; // Step over the delimiter
+    }
+}
+
+// Function to work out which stage a row belongs to from its ID prefix (0 if unknown)
+int stageOfRow(string_view id) {
+    // Longer prefixes first so "SHIP" is not mistaken for a supplier row
+    if (id.compare(0, 5, "TRANS") == 0) return 7;
+    if (id.compare(0, 4, "SHIP") == 0) return 6;
+    if (id.compare(0, 3, "SUP") == 0) return 1;
+    if (id.compare(0, 3, "PRS") == 0) return 2;
+    if (id.compare(0, 3, "WLD") == 0) return 3;
+    if (id.compare(0, 3, "PNT") == 0) return 4;
+    if (id.compare(0, 3, "ASM") == 0) return 5;
+    return 0;
+}
+
+// Function to hand the open batch to its consumer and start a new one
+void flushBatch(IngestState& state) {
+    if (state.batch.blocks.empty()) {
+        return;
+    }
+    if (state.onBatch) {
+        state.onBatch(state.batch);
+    }
+    state.batch.blocks.clear();
+    state.batch.batchedTransactions.clear();
+    state.batch.batchBodies.clear();
+    state.batch.batchBodyEnds.clear();
+}
+
+// Function to seal a block of any stage onto the chain after the given block
+static void sealStageBlock(StageBlock& block, const BlockHeader* previous, const BlockHeader* upstream) {
+    switch (block.stage) {
+        case 1: sealBlock(block.supplier, previous, upstream); break;
+        case 2: sealBlock(block.press, previous, upstream); break;
+        case 3: sealBlock(block.welding, previous, upstream); break;
+        case 4: sealBlock(block.painting, previous, upstream); break;
+        case 5: sealBlock(block.assembly, previous, upstream); break;
+        case 6: sealBlock(block.shipping, previous, upstream); break;
+        case TRANSACTION_BATCH_STAGE: sealBlock(block.batch, previous, upstream); break;
+        case UPDATE_STAGE: sealBlock(block.update, previous, upstream); break;
+        default: sealBlock(block.transaction, previous, upstream); break;
+    }
+}
+
+// Function to get the header of an ingestion's newest block of one stage (nullptr before the first one)
+static const BlockHeader* stageHeader(const IngestState& state, int stage) {
+    switch (stage) {
+        case 1: return &state.supplier.header;
+        case 2: return &state.press.header;
+        case 3: return &state.welding.header;
+        case 4: return &state.painting.header;
+        case 5: return &state.assembly.header;
+        case 6: return &state.shipping.header;
+        case 7: return &state.transaction.header;
+        case TRANSACTION_BATCH_STAGE: return &state.transactionBatch.header;
+        case UPDATE_STAGE: return &state.update.header;
+        default: return nullptr;
+    }
+}
+
+// Function to get the header of the newest block of an ingestion (nullptr before the first block)
+static const BlockHeader* latestHeader(const IngestState& state) {
+    return stageHeader(state, state.tipStage);
+}
+
+// Function to record a block as the newest one of its stage
+static void rememberStageBlock(IngestState& state, const StageBlock& block) {
+    switch (block.stage) {
+        case 1: state.supplier = block.supplier; break;
+        case 2: state.press = block.press; break;
+        case 3: state.welding = block.welding; break;
+        case 4: state.painting = block.painting; break;
+        case 5: state.assembly = block.assembly; break;
+        case 6: state.shipping = block.shipping; break;
+        case 7: state.transaction = block.transaction; break;
+        case TRANSACTION_BATCH_STAGE: state.transactionBatch = block.batch; break;
+        case UPDATE_STAGE: state.update = block.update; break;
+    }
+    // A batch block is sealed right after a transaction row, so the vehicle order continues from stage 7;
+    // an update may come between any two rows and leaves the vehicle order alone
+    if (block.stage != UPDATE_STAGE) {
+        state.lastStage = block.stage == TRANSACTION_BATCH_STAGE ? 7 : block.stage;
+    }
+    state.tipStage = block.stage;
+}
+
+// Function to build the payload of a block of any stage from a parsed row (the header is filled in when sealed)
+static StageBlock buildStageBlock(int stage, const vector<string_view>& fields) {
+    // Missing trailing columns are treated as empty values; the views are interned or parsed, never copied
+    auto field = [&fields](size_t index) {
+        return index < fields.size() ? fields[index] : string_view();
+    };
+
+    StageBlock block;
+    switch (stage) {
+        case 1: block = toStageBlock(buildSupplierBlock(field(0), field(1), field(2), field(3), field(4), field(5), field(6))); break;
+        case 2: block = toStageBlock(buildPressBlock(field(0), field(1), field(2), field(3), field(4), field(5))); break;
+        case 3: block = toStageBlock(buildWeldingBlock(field(0), field(1), field(2), field(3), field(4), field(5))); break;
+        case 4: block = toStageBlock(buildPaintingBlock(field(0), field(1), field(2), field(3), field(4), field(5))); break;
+        case 5: block = toStageBlock(buildAssemblyBlock(field(0), field(1), field(2), field(3), field(4), field(5))); break;
+        case 6: block = toStageBlock(buildShippingBlock(field(0), field(1), field(2), field(3), field(4), field(5))); break;
+        case 7: block = toStageBlock(buildTransactionBlock(field(0), field(1), field(2), field(3), field(4), field(5), field(6))); break;
+    }
+    return block;
+}
+
+// Function to get the Money column of a stage's rows (a supplier's price, a transaction's amount; 0 if none)
+static size_t moneyColumn(int stage) {
+    return stage == 1 ? 6 : stage == 7 ? 2 : 0;
+}
+
+// Function to check that a row's Money column holds a decimal amount, so text is refused instead of stored as 0
+static bool rowMoneyValid(int stage, const vector<string_view>& fields) {
+    size_t column = moneyColumn(stage);
+    Money amount;
+    return column == 0 || (column < fields.size() && parseMoney(fields[column], amount));
+}
+
+// Function to get the business ID of a block (supplierId, pressId, ... transactionId; an update's is its target's)
+static StringId stageBlockId(const StageBlock& block) {
+    switch (block.stage) {
+        case 1: return block.supplier.supplierId;
+        case 2: return block.press.pressId;
+        case 3: return block.welding.weldingId;
+        case 4: return block.painting.paintingId;
+        case 5: return block.assembly.assemblyId;
+        case 6: return block.shipping.shippingId;
+        case TRANSACTION_BATCH_STAGE: return 0; // A batch is found through the IDs of its transactions
+        case UPDATE_STAGE: return block.update.targetId;
+        default: return block.transaction.transactionId;
+    }
+}
+
+// Function to seal the waiting transactions of an ingestion into one batch block committing to all of them
+void sealTransactionBatch(IngestState& state) {
+    // Every signature of the batch is checked in one go; transactions that fail are dropped before sealing
+    vector<char> valid;
+    size_t rejected = verifyTransactionSignatures(state.pendingTransactions, valid);
+    if (rejected != 0) {
+        size_t kept = 0;
+        for (size_t i = 0; i < state.pendingTransactions.size(); ++i) {
+            if (valid[i]) {
+                state.pendingTransactions[kept++] = state.pendingTransactions[i];
+            }
+        }
+        state.pendingTransactions.resize(kept);
+        state.rowsRead -= rejected;
+        state.rowsSkipped += rejected;
+        state.signaturesRejected += rejected;
+        countMetric(COUNTER_ROWS_SKIPPED, rejected);
+    }
+    // A batched row only counts as ingested once its signature has passed
+    countMetric(COUNTER_ROWS_INGESTED, state.pendingTransactions.size());
+    for (const TransactionBlockchain& transaction : state.pendingTransactions) {
+        state.signaturesVerified += transaction.signature != 0;
+    }
+    if (state.pendingTransactions.empty()) {
+        return;
+    }
+    // The body goes straight into the batch's shared buffer
+    string& bodies = state.batch.batchBodies;
+    size_t start = bodies.size();
+    StageBlock block = toStageBlock(buildTransactionBatchBlock(state.pendingTransactions, bodies));
+    string_view body = string_view(bodies).substr(start);
+    if (state.chain != nullptr) {
+        appendToChain(*state.chain, block, 0, body);
+    } else {
+        sealStageBlock(block, latestHeader(state), nullptr);
+    }
+    rememberStageBlock(state, block);
+    for (TransactionBlockchain& transaction : state.pendingTransactions) {
+        transaction.header.blockNumber = block.batch.header.blockNumber;
+        transaction.header.timestamp = block.batch.header.timestamp;
+        state.batch.batchedTransactions.push_back(transaction);
+    }
+    state.pendingTransactions.clear();
+    state.batch.batchBodyEnds.push_back(bodies.size());
+    state.batch.blocks.push_back(block);
+    if (state.batch.blocks.size() >= state.batchLimit) {
+        flushBatch(state);
+    }
+}
+
+// Function to seal whatever an ingestion still holds (a partial transaction batch) and hand over the last batch
+void finishIngest(IngestState& state) {
+    sealTransactionBatch(state);
+    flushBatch(state);
+}
+
+// Function to find the block an update row names by hash or ID: the newest Supply..Transaction block of the
+// open batch (not handed over, so not indexed yet), otherwise whatever the state's lookup finds
+static bool findUpdateTarget(IngestState& state, string_view key, StageBlock& target) {
+    BlockHash hash;
+    bool byHash = hexToHash(key, hash);
+    StringId id = 0;
+    if (byHash || findString(key, id)) {
+        for (auto it = state.batch.blocks.rbegin(); it != state.batch.blocks.rend(); ++it) {
+            if (it->stage >= 1 && it->stage <= 7 &&
+                (byHash ? blockHeader(*it).currentBlockHash == hash : stageBlockId(*it) == id)) {
+                target = *it;
+                return true;
+            }
+        }
+    }
+    return state.findTarget && state.findTarget(key, target);
+}
+
+// Function to turn an update row into an update block: UPDATE,<hash or ID of the target>,<key>=<value>,...
+// where the keys are the target stage's column keys (shippingStatus, transactionStatus, ...; never the ID).
+// Rows naming no block, an unknown key or too many fields are skipped
+static bool ingestUpdateRow(IngestState& state, const vector<string_view>& fields) {
+    StageBlock target;
+    bool found = fields.size() > 2 && fields.size() - 2 <= UPDATE_MAX_FIELDS && findUpdateTarget(state, fields[1], target);
+    UpdateBlock update{};
+    if (found) {
+        StringId values[7] = {};
+        bool changed[7] = {};
+        for (size_t f = 2; f < fields.size() && found; ++f) {
+            size_t equals = fields[f].find('=');
+            int column = findAnalyticsColumn(target.stage, fields[f].substr(0, equals));
+            Money amount;
+            found = equals != string_view::npos && column > 0 &&
+                    (size_t(column) != moneyColumn(target.stage) || parseMoney(fields[f].substr(equals + 1), amount));
+            if (found) {
+                values[column] = internString(fields[f].substr(equals + 1));
+                changed[column] = true;
+            }
+        }
+        // Columns go in ascending order, so one set of changes always has one canonical form
+        for (unsigned column = 1; column < 7 && found; ++column) {
+            if (changed[column]) {
+                update.columns[update.fieldCount] = uint8_t(column);
+                update.values[update.fieldCount++] = values[column];
+            }
+        }
+    }
+    if (!found) {
+        state.rowsSkipped++;
+        state.updatesMissed++;
+        countMetric(COUNTER_ROWS_SKIPPED);
+        return false;
+    }
+    countMetric(COUNTER_ROWS_INGESTED);
+    const BlockHeader& targetHeader = blockHeader(target);
+    update.targetHash = targetHeader.currentBlockHash;
+    update.targetId = stageBlockId(target);
+    update.targetStage = target.stage;
+
+    // The upstream link reaches back to the target, wherever the update lands in the chain
+    StageBlock block = toStageBlock(update);
+    if (state.chain != nullptr) {
+        appendToChain(*state.chain, block, targetHeader.blockNumber);
+    } else {
+        sealStageBlock(block, latestHeader(state), &targetHeader);
+    }
+    rememberStageBlock(state, block);
+    state.batch.blocks.push_back(block);
+    state.rowsRead++;
+    state.updatesApplied++;
+    if (state.batch.blocks.size() >= state.batchLimit) {
+        flushBatch(state);
+    }
+    return true;
+}
+
+// Function to turn one parsed row into the next block of the chain
+// Rows must follow each vehicle's Supply -> Press -> ... -> Transaction order; anything else is skipped.
+// Update rows may come anywhere
+bool ingestRow(IngestState& state, const vector<string_view>& fields) {
+    if (!fields.empty() && fields[0] == "UPDATE") {
+        return ingestUpdateRow(state, fields);
+    }
+    int stage = fields.empty() ? 0 : stageOfRow(fields[0]);
+    int expected = state.lastStage % 7 + 1;
+    if (stage == 0 || stage != expected) {
+        state.rowsSkipped++;
+        countMetric(COUNTER_ROWS_SKIPPED);
+        return false;
+    }
+    if (!rowMoneyValid(stage, fields)) {
+        if (stage == 7) {
+            state.lastStage = 7; // The next vehicle still starts with its supplier row
+        }
+        state.rowsSkipped++;
+        countMetric(COUNTER_ROWS_SKIPPED);
+        return false;
+    }
+
+    // Build the stage-specific data from the row
+    StageBlock block = buildStageBlock(stage, fields);
+    if (stage == 7) {
+        // An eighth column is the sender's signature. Batched transactions are checked together when their batch
+        // is sealed; a transaction with a block of its own is checked now
+        bool signedRow = fields.size() > 7 && !fields[7].empty();
+        if (!attachTransactionSignature(block.transaction, signedRow ? fields[7] : string_view()) ||
+            (signedRow && state.transactionBatchSize == 0 && !verifyTransactionSignature(block.transaction))) {
+            state.lastStage = 7; // The next vehicle still starts with its supplier row
+            state.rowsSkipped++;
+            state.signaturesRejected++;
+            countMetric(COUNTER_ROWS_SKIPPED);
+            return false;
+        }
+        state.signaturesVerified += signedRow && state.transactionBatchSize == 0;
+    }
+    if (stage == 7 && state.transactionBatchSize > 0) {
+        // Batched: the transaction waits for its batch block instead of getting a block of its own
+        state.pendingTransactions.push_back(block.transaction);
+        state.lastStage = 7;
+        state.rowsRead++;
+        if (state.pendingTransactions.size() >= state.transactionBatchSize) {
+            sealTransactionBatch(state);
+        }
+        return true;
+    }
+    countMetric(COUNTER_ROWS_INGESTED);
+
+    // Seal it: a shared chain links it to whatever block any thread published last,
+    // otherwise it links to this state's previous block
+    // Either way the block also records the vehicle's previous stage, this state's latest block of stage - 1
+    const BlockHeader* upstream = stage > 1 ? stageHeader(state, stage - 1) : nullptr;
+    if (state.chain != nullptr) {
+        appendToChain(*state.chain, block, upstream != nullptr ? upstream->blockNumber : 0);
+    } else {
+        sealStageBlock(block, latestHeader(state), upstream);
+    }
+    rememberStageBlock(state, block);
+    state.batch.blocks.push_back(block);
+    state.rowsRead++;
+    if (state.batch.blocks.size() >= state.batchLimit) {
+        flushBatch(state);
+    }
+    return true;
+}
+
+// Function to split every row of a memory-mapped CSV or TSV file and hand it to a callback
+// (the callback also gets the raw row and the delimiter; views are only valid during the call)
+// Rows the optional filter rejects, given the raw row and the delimiter, are neither split nor handed over
+static bool scanFileRows(const string& path, const function<void(const vector<string_view>&, string_view, char)>& onRow,
+                         const function<bool(string_view, char)>& accept = nullptr) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return false;
+    }
+    string_view text(file.data, file.size);
+
+    // A tab anywhere in the first line selects TSV, otherwise the file is read as CSV
+    size_t firstLineEnd = text.find('\n');
+    char delimiter = text.substr(0, firstLineEnd).find('\t') != string_view::npos ? '\t' : ',';
+
+    vector<string_view> fields;
+    string scratch;
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t end = text.find('\n', position);
+        if (end == string_view::npos) {
+            end = text.size();
+        }
+        string_view row = text.substr(position, end - position);
+        if (!row.empty() && row.back() == '\r') {
+            row.remove_suffix(1);
+        }
+        position = end + 1;
+        if (accept && !accept(row, delimiter)) {
+            continue;
+        }
+
+        // Blank lines, comments and header rows never match a stage prefix and are counted as skipped
+        splitRow(row, delimiter, fields, scratch);
+        onRow(fields, row, delimiter);
+    }
+
+    unmapFile(file);
+    return true;
+}
+
+// Function to stream every row of a memory-mapped CSV or TSV file into the blockchain generators
+bool ingestFile(const string& path, IngestState& state) {
+    return scanFileRows(path, [&state](const vector<string_view>& fields, string_view, char) {
+        ingestRow(state, fields);
+    });
+}
+
+// Function to feed the built-in demo dataset through the same row path as file ingestion
+void ingestDataset(const vector<vector<string>>& rows, IngestState& state) {
+    vector<string_view> fields;
+    for (const auto& row : rows) {
+        fields.assign(row.begin(), row.end());
+        ingestRow(state, fields);
+    }
+}
+
+// Function to step a workload's random sequence (SplitMix64: fast, and the same on every platform)
+static uint64_t nextWorkloadRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Function to start the random sequence of one vehicle from the workload's seed
+static uint64_t vehicleRandomState(const Workload& workload, uint64_t vehicle) {
+    uint64_t state = workload.options.seed ^ (vehicle * 0xD1B54A32D192ED03ULL);
+    nextWorkloadRandom(state);
+    return state;
+}
+
+// Function to build the cumulative Zipf distribution over a number of values (rank 0 is the most popular)
+static vector<double> zipfTable(uint32_t cardinality, double skew) {
+    vector<double> cumulative(max(1u, cardinality));
+    double total = 0;
+    for (size_t rank = 0; rank < cumulative.size(); ++rank) {
+        total += 1.0 / pow(double(rank + 1), skew);
+        cumulative[rank] = total;
+    }
+    for (double& value : cumulative) {
+        value /= total;
+    }
+    return cumulative;
+}
+
+// Function to draw a rank from a Zipf table with one random number
+static uint32_t drawZipf(const vector<double>& cumulative, uint64_t random) {
+    double uniform = double(random >> 11) * 0x1.0p-53;
+    size_t rank = size_t(upper_bound(cumulative.begin(), cumulative.end(), uniform) - cumulative.begin());
+    return uint32_t(min(rank, cumulative.size() - 1));
+}
+
+// Function to append a number in decimal, zero-padded to a minimum width
+static void appendPaddedNumber(string& out, uint64_t value, int width) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    out.append(size_t(max(0, width - int(result.ptr - digits))), '0');
+    out.append(digits, result.ptr);
+}
+
+// Function to append a fixed-point number given in units of 10^-decimals (1234 with 2 decimals is 12.34)
+static void appendFixedPoint(string& out, uint64_t units, int decimals) {
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; ++i) {
+        scale *= 10;
+    }
+    appendPaddedNumber(out, units / scale, 0);
+    out += '.';
+    appendPaddedNumber(out, units % scale, decimals);
+}
+
+// Function to prepare the Zipf tables of a synthetic workload
+void prepareWorkload(Workload& workload, const WorkloadOptions& options) {
+    workload.options = options;
+    workload.suppliers = zipfTable(options.suppliers, options.skew);
+    workload.products = zipfTable(options.products, options.skew);
+    workload.plants = zipfTable(options.plants, options.skew);
+    workload.stations = zipfTable(options.stations, options.skew);
+    workload.locations = zipfTable(options.locations, options.skew);
+    workload.companies = zipfTable(options.companies, options.skew);
+}
+
+// Function to get the supplierId of one generated vehicle without generating its rows (it is the first draw)
+void workloadSupplierId(const Workload& workload, uint64_t vehicle, string& out) {
+    uint64_t state = vehicleRandomState(workload, vehicle);
+    out = "SUP";
+    appendPaddedNumber(out, drawZipf(workload.suppliers, nextWorkloadRandom(state)), 6);
+}
+
+// Function to give every company of a workload ("Company 0000" ...) a signing key. The seeds follow from the
+// workload seed, so the same seed always gives the same keys
+void deriveWorkloadKeys(const WorkloadOptions& options) {
+    for (uint32_t company = 0; company < options.companies; ++company) {
+        string name = "Company ";
+        appendPaddedNumber(name, company, 4);
+        string input = "tms-workload-signer";
+        appendUint64(input, options.seed);
+        input += name;
+        uint8_t digest[64];
+        sha512(input.data(), input.size(), digest);
+        SignerKey& key = signerKeys[name];
+        memcpy(key.seed.data(), digest, 32);
+        ed25519PublicKey(key.seed.data(), key.publicKey.data());
+        key.canSign = true;
+    }
+}
+
+// Function to load sender keys from a file of name,publicKeyHex[,seedHex] rows (# starts a comment row)
+bool loadSignerKeys(const string& path) {
+    bool ok = true;
+    bool read = scanFileRows(path, [&](const vector<string_view>& fields, string_view, char) {
+        if (!ok || fields.empty() || fields[0].empty() || fields[0][0] == '#') {
+            return;
+        }
+        SignerKey key;
+        ok = fields.size() >= 2 && fields.size() <= 3 && hexToBytes(fields[1], key.publicKey.data(), key.publicKey.size());
+        if (ok && fields.size() == 3 && !fields[2].empty()) {
+            // A seed must belong to the key next to it, or this instance would sign with one key and verify with another
+            array<uint8_t, 32> derived;
+            ok = hexToBytes(fields[2], key.seed.data(), key.seed.size());
+            ed25519PublicKey(key.seed.data(), derived.data());
+            ok = ok && derived == key.publicKey;
+            key.canSign = ok;
+        }
+        if (!ok) {
+            cerr << path << ": the key of " << fields[0] << " is not name,publicKeyHex[,seedHex] with a matching seed" << endl;
+            return;
+        }
+        signerKeys[string(fields[0])] = key;
+    });
+    return read && ok;
+}
+
+// Function to sign the generated transaction row that starts at rowStart in out when this instance holds its
+// sender's key; the signature becomes the row's eighth column
+static void signTransactionRow(string& out, size_t rowStart) {
+    string_view fields[7];
+    string_view row = string_view(out).substr(rowStart);
+    for (size_t field = 0, position = 0; field < 7; ++field) {
+        size_t comma = min(row.find(',', position), row.size()); // Generated values never contain commas
+        fields[field] = row.substr(position, comma - position);
+        position = comma + 1;
+    }
+    const SignerKey* key = findSignerKey(fields[3]);
+    if (key == nullptr || !key->canSign) {
+        return;
+    }
+    thread_local string message;
+    message.assign(TRANSACTION_SIGNING_CONTEXT);
+    Money amount;
+    parseMoney(fields[2], amount);
+    appendTransactionFields(message, fields[0], fields[1], fields[3], fields[4], fields[5], amount, fields[6]);
+    uint8_t signature[64];
+    ed25519Sign(key->seed.data(), key->publicKey.data(), message, signature);
+    out += ',';
+    out += hashToHex(signature, sizeof(signature));
+}
+
+// Function to write the seven rows (Supply .. Transaction, one CSV line each) of one generated vehicle into out.
+// Every vehicle draws from its own random sequence, so vehicle v is the same in every run with the same seed
+// and any range of vehicles can be generated on any thread. Texts have the lengths of the demo dataset's
+// values; shipment and transaction IDs are unique per vehicle, every other ID and location comes from a skewed pool
+void generateVehicleRows(const Workload& workload, uint64_t vehicle, string& out) {
+    static const char* const STREETS[] = {"Main Street", "Industrial Avenue", "Elm Street", "Harbor Road",
+                                          "Mill Lane", "Station Road", "Park Avenue", "Foundry Way"};
+    static const char* const CITIES[] = {"New York", "Chicago", "Houston", "Detroit", "Atlanta", "Seattle",
+                                         "Denver", "Boston", "Toronto", "Monterrey", "Hamburg", "Yokohama"};
+    static const char* const PRESS_DETAILS[] = {"Heavy-duty press machine", "Transfer press line", "Servo stamping press", "Progressive die press"};
+    static const char* const PRESS_TYPES[] = {"Hydraulic", "Mechanical", "Servo", "Pneumatic"};
+    static const char* const MANUFACTURERS[] = {"XYZ Machinery Inc.", "Schuler Group", "AIDA Engineering", "Komatsu Industries"};
+    static const char* const WELDING_DETAILS[] = {"Robotic welding station", "Manual welding bay", "Laser welding cell", "Spot welding line"};
+    static const char* const WELDING_TYPES[] = {"MIG", "TIG", "Spot", "Laser"};
+    static const char* const MATERIALS[] = {"Steel", "Aluminium", "Stainless steel", "Galvanized steel"};
+    static const char* const PAINTING_DETAILS[] = {"Automated painting booth", "Electrostatic spray line", "Manual touch-up booth", "Dip coating tank"};
+    static const char* const COLORS[] = {"Red", "White", "Black", "Silver", "Blue", "Grey", "Green", "Yellow"};
+    static const char* const PAINT_TYPES[] = {"Acrylic", "Enamel", "Urethane", "Powder"};
+    static const char* const ASSEMBLY_DETAILS[] = {"Automated assembly line", "Final assembly station", "Sub-assembly cell", "Chassis marriage line"};
+    static const char* const ASSEMBLY_TYPES[] = {"Car", "Truck", "Van", "SUV", "Bus"};
+    static const char* const SHIPPING_DETAILS[] = {"Shipment of car parts", "Finished vehicle delivery", "Spare parts consignment", "Fleet order shipment"};
+    static const char* const SHIPPING_TYPES[] = {"Air", "Sea", "Rail", "Road"};
+    static const char* const SHIPPING_STATUSES[] = {"In transit", "Delivered", "Pending", "Delayed"};
+    static const char* const TRANSACTION_TYPES[] = {"Purchase", "Sale", "Refund", "Transfer"};
+    static const char* const CURRENCIES[] = {"USD", "EUR", "JPY", "GBP", "CNY"};
+    static const char* const TRANSACTION_STATUSES[] = {"Completed", "Pending", "Failed"};
+
+    uint64_t state = vehicleRandomState(workload, vehicle);
+    auto zipf = [&state](const vector<double>& table) { return drawZipf(table, nextWorkloadRandom(state)); };
+    auto uniform = [&state](uint64_t low, uint64_t high) { return low + nextWorkloadRandom(state) % (high - low + 1); };
+    auto pick = [&](const auto& values) { out += values[uniform(0, size(values) - 1)]; out += ','; };
+    auto address = [&out](uint64_t index) {
+        appendPaddedNumber(out, 1 + index / size(STREETS), 0);
+        out += ' ';
+        out += STREETS[index % size(STREETS)];
+        out += ',';
+    };
+    auto id = [&out](const char* prefix, uint64_t number, int width) {
+        out += prefix;
+        appendPaddedNumber(out, number, width);
+        out += ',';
+    };
+    out.clear();
+    uint32_t supplier = zipf(workload.suppliers); // The first draw, as workloadSupplierId expects
+    uint32_t plant = zipf(workload.plants);       // One plant builds the whole vehicle
+    id("SUP", supplier, 6);
+    id("Supplier ", supplier, 5);
+    id("Product ", zipf(workload.products), 4);
+    address(workload.options.plants + supplier * 2654435761ULL % workload.locations.size()); // A supplier keeps its address
+    out += "Branch ";
+    out += char('A' + supplier % 26);
+    out += ',';
+    appendPaddedNumber(out, uniform(1, 500), 0);
+    out += ',';
+    appendFixedPoint(out, uniform(100, 100000), 2);
+    out += '\n';
+
+    id("PRS", zipf(workload.stations), 5);
+    address(plant);
+    pick(PRESS_DETAILS);
+    pick(PRESS_TYPES);
+    out += MANUFACTURERS[uniform(0, size(MANUFACTURERS) - 1)];
+    out += '\n';
+
+    id("WLD", zipf(workload.stations), 5);
+    address(plant);
+    pick(WELDING_DETAILS);
+    pick(WELDING_TYPES);
+    pick(MATERIALS);
+    appendFixedPoint(out, uniform(15000, 35000), 1);
+    out += '\n';
+
+    id("PNT", zipf(workload.stations), 5);
+    address(plant);
+    pick(PAINTING_DETAILS);
+    pick(COLORS);
+    pick(PAINT_TYPES);
+    appendFixedPoint(out, uniform(10, 100), 3);
+    out += '\n';
+
+    id("ASM", zipf(workload.stations), 5);
+    address(plant);
+    pick(ASSEMBLY_DETAILS);
+    pick(ASSEMBLY_TYPES);
+    appendPaddedNumber(out, uniform(50, 400), 0);
+    out += ',';
+    appendFixedPoint(out, uniform(8000, 30000), 1);
+    out += '\n';
+
+    uint32_t destination = zipf(workload.locations);
+    id("SHIP", vehicle, 10);
+    out += CITIES[destination % size(CITIES)];
+    out += " Dealer ";
+    appendPaddedNumber(out, destination / size(CITIES), 3);
+    out += ',';
+    pick(SHIPPING_DETAILS);
+    pick(SHIPPING_TYPES);
+    id("Carrier ", zipf(workload.companies), 4);
+    out += SHIPPING_STATUSES[uniform(0, size(SHIPPING_STATUSES) - 1)];
+    out += '\n';
+
+    // Drawn in the same order as always, written in the column order ingestion reads (the amount comes third)
+    size_t transactionStart = out.size();
+    const char* transactionType = TRANSACTION_TYPES[uniform(0, size(TRANSACTION_TYPES) - 1)];
+    uint32_t sender = zipf(workload.companies);
+    uint32_t receiver = zipf(workload.companies);
+    const char* currency = CURRENCIES[uniform(0, size(CURRENCIES) - 1)];
+    uint64_t amount = uniform(10000, 5000000);
+    id("TRANS", vehicle, 10);
+    out += transactionType;
+    out += ',';
+    appendFixedPoint(out, amount, 2);
+    out += ',';
+    id("Company ", sender, 4);
+    id("Company ", receiver, 4);
+    out += currency;
+    out += ',';
+    out += TRANSACTION_STATUSES[uniform(0, size(TRANSACTION_STATUSES) - 1)];
+    signTransactionRow(out, transactionStart);
+    out += '\n';
+}
+
+// Function to feed generated vehicles [first, end) through the same row path as file ingestion
+void ingestWorkload(const Workload& workload, uint64_t first, uint64_t end, IngestState& state) {
+    thread_local string rows, scratch; // Reused by every vehicle this thread generates
+    thread_local vector<string_view> fields;
+    for (uint64_t vehicle = first; vehicle < end; ++vehicle) {
+        generateVehicleRows(workload, vehicle, rows);
+        for (size_t position = 0; position < rows.size();) {
+            size_t lineEnd = rows.find('\n', position);
+            splitRow(string_view(rows).substr(position, lineEnd - position), ',', fields, scratch);
+            ingestRow(state, fields);
+            position = lineEnd + 1;
+        }
+    }
+}
+
+// Function to read a fixed number of raw bytes from a record
+static const char* readBytes(ByteReader& reader, size_t length) {
+    if (!reader.ok || size_t(reader.end - reader.position) < length) {
+        reader.ok = false;
+        return nullptr;
+    }
+    const char* bytes = reader.position;
+    reader.position += length;
+    return bytes;
+}
+
+// Function to read a little-endian 64-bit integer from a record
+static uint64_t readUint64(ByteReader& reader) {
+    const char* bytes = readBytes(reader, 8);
+    uint64_t value = 0;
+    for (int i = 0; bytes != nullptr && i < 8; ++i) {
+        value |= uint64_t(uint8_t(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Function to read a little-endian 32-bit integer from a record
+static uint32_t readUint32(ByteReader& reader) {
+    const char* bytes = readBytes(reader, 4);
+    uint32_t value = 0;
+    for (int i = 0; bytes != nullptr && i < 4; ++i) {
+        value |= uint32_t(uint8_t(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Function to read a float's bit pattern from a record
+static float readFloat(ByteReader& reader) {
+    uint32_t bits = readUint32(reader);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Function to read a LEB128 varint from a record
+static uint64_t readVarint(ByteReader& reader) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64 && reader.position < reader.end; shift += 7) {
+        uint8_t byte = uint8_t(*reader.position++);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    reader.ok = false;
+    return 0;
+}
+
+// Function to read a length-prefixed string field from a record and intern it
+static StringId readField(ByteReader& reader) {
+    uint32_t length = readUint32(reader);
+    const char* bytes = readBytes(reader, length);
+    return bytes != nullptr ? internString(string_view(bytes, length)) : 0;
+}
+
+// Function to read a 32-byte hash from a record
+static void readHash(ByteReader& reader, BlockHash& hash) {
+    const char* bytes = readBytes(reader, hash.size());
+    if (bytes != nullptr) {
+        memcpy(hash.data(), bytes, hash.size());
+    }
+}
+
+// Function to encode a block as a store record body into record: canonical content followed by the block hash.
+// A batch block's transactions are stored inside its record, after the Merkle root, but are not hashed
+void encodeBlockRecord(string& record, const StageBlock& block, string_view batchBody = string_view()) {
+    record.clear();
+    appendBlockContent(record, block);
+    if (block.stage == TRANSACTION_BATCH_STAGE) {
+        record.insert(BATCH_BODY_OFFSET, batchBody.data(), batchBody.size());
+    }
+    const BlockHash& hash = blockHeader(block).currentBlockHash;
+    record.append(reinterpret_cast<const char*>(hash.data()), hash.size());
+}
+
+// Function to decode a store record body back into a block; returns false if the record is malformed
+bool decodeBlockRecord(string_view record, StageBlock& block) {
+    ByteReader reader{record.data(), record.data() + record.size()};
+    const char* stage = readBytes(reader, 1);
+    if (stage == nullptr || *stage < 1 || (*stage > TRANSACTION_BATCH_STAGE && *stage != UPDATE_STAGE)) {
+        return false;
+    }
+    block.stage = uint8_t(*stage);
+    BlockHeader header;
+    header.blockNumber = readUint64(reader);
+    header.timestamp = readUint64(reader);
+
+    // Payload fields in the same order blockContent() wrote them
+    switch (block.stage) {
+        case 1: {
+            SupplierBlockchain& b = block.supplier;
+            b.supplierId = readField(reader); b.supplierName = readField(reader); b.supplierItem = readField(reader);
+            b.location = readField(reader); b.branch = readField(reader);
+            b.quantity = readUint32(reader); b.price = Money(readUint64(reader));
+            break;
+        }
+        case 2: {
+            PressBlockchain& b = block.press;
+            b.pressId = readField(reader); b.pressLocation = readField(reader); b.pressDetails = readField(reader);
+            b.pressType = readField(reader); b.pressManufacturer = readField(reader);
+            b.pressCapacity = readFloat(reader);
+            break;
+        }
+        case 3: {
+            WeldingBlockchain& b = block.welding;
+            b.weldingId = readField(reader); b.weldingLocation = readField(reader); b.weldingDetails = readField(reader);
+            b.weldingType = readField(reader); b.weldingMaterial = readField(reader);
+            b.weldingTemperature = readFloat(reader);
+            break;
+        }
+        case 4: {
+            PaintingBlockchain& b = block.painting;
+            b.paintingId = readField(reader); b.paintingLocation = readField(reader); b.paintingDetails = readField(reader);
+            b.paintingColor = readField(reader); b.paintingType = readField(reader);
+            b.paintingThickness = readFloat(reader);
+            break;
+        }
+        case 5: {
+            AssemblyBlockchain& b = block.assembly;
+            b.assemblyId = readField(reader); b.assemblyLocation = readField(reader); b.assemblyDetails = readField(reader);
+            b.assemblyType = readField(reader);
+            b.numberOfParts = readUint32(reader); b.assemblyWeight = readFloat(reader);
+            break;
+        }
+        case 6: {
+            ShippingBlockchain& b = block.shipping;
+            b.shippingId = readField(reader); b.shippingDestination = readField(reader); b.shippingDetails = readField(reader);
+            b.shippingType = readField(reader); b.carrierName = readField(reader); b.shippingStatus = readField(reader);
+            break;
+        }
+        case 7: {
+            TransactionBlockchain& b = block.transaction;
+            b.transactionId = readField(reader); b.transactionType = readField(reader); b.sender = readField(reader);
+            b.receiver = readField(reader); b.currency = readField(reader);
+            b.transactionAmount = Money(readUint64(reader)); b.transactionStatus = readField(reader);
+            b.signature = readField(reader);
+            break;
+        }
+        case TRANSACTION_BATCH_STAGE: {
+            TransactionBatchBlock& b = block.batch;
+            b.transactionCount = readUint32(reader);
+            readHash(reader, b.merkleRoot);
+            // Skip the stored transactions; the rest of the record is the usual footer and hash
+            const char* footer = record.data() + record.size() - (BLOCK_FOOTER_SIZE + 32);
+            if (record.size() < BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE + 32 || reader.position > footer) {
+                return false;
+            }
+            reader.position = footer;
+            break;
+        }
+        case UPDATE_STAGE: {
+            // The target's business ID is not stored; whoever needs it looks the target up
+            UpdateBlock& b = block.update;
+            readHash(reader, b.targetHash);
+            const char* counts = readBytes(reader, 2);
+            b.targetId = 0;
+            b.targetStage = counts != nullptr ? uint8_t(counts[0]) : 0;
+            b.fieldCount = counts != nullptr ? uint8_t(counts[1]) : 0;
+            if (b.targetStage < 1 || b.targetStage > 7 || b.fieldCount == 0 || b.fieldCount > UPDATE_MAX_FIELDS) {
+                return false;
+            }
+            for (uint8_t i = 0; i < b.fieldCount; ++i) {
+                const char* column = readBytes(reader, 1);
+                b.columns[i] = column != nullptr ? uint8_t(*column) : 0;
+                b.values[i] = readField(reader);
+                if (b.columns[i] == 0 || b.columns[i] >= 7 || (i > 0 && b.columns[i] <= b.columns[i - 1])) {
+                    return false;
+                }
+            }
+            break;
+        }
+    }
+
+    const char* difficulty = readBytes(reader, 1);
+    header.difficulty = difficulty != nullptr ? uint8_t(*difficulty) : 0;
+    header.nonce = readUint64(reader);
+    header.upstreamOffset = readUint32(reader);
+    readHash(reader, header.previousBlockHash);
+    readHash(reader, header.currentBlockHash);
+    if (!reader.ok || reader.position != reader.end) {
+        return false;
+    }
+    block.supplier.header = header; // Every stage struct starts with its header
+    return true;
+}
+
+// Function to gather the hashed part of a batch block's record (everything but the stored transactions and the
+// hash); returns false if the record is not a batch block
+static bool batchHashedContent(string_view record, uint8_t (&content)[BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE]) {
+    if (record.size() < BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE + 32 || uint8_t(record[0]) != TRANSACTION_BATCH_STAGE) {
+        return false;
+    }
+    memcpy(content, record.data(), BATCH_BODY_OFFSET);
+    memcpy(content + BATCH_BODY_OFFSET, record.data() + record.size() - (BLOCK_FOOTER_SIZE + 32), BLOCK_FOOTER_SIZE);
+    return true;
+}
+
+// Function to compute the hash a record body must carry: SHA-256 of everything before the stored hash,
+// minus a batch block's transactions
+static void recordContentHash(string_view record, uint8_t digest[32]) {
+    uint8_t content[BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE];
+    if (batchHashedContent(record, content)) {
+        sha256(content, sizeof(content), digest);
+    } else {
+        sha256(record.data(), record.size() - 32, digest);
+    }
+}
+
+// Function to split the stored body of a batch block's record into its leaves; returns false if it is malformed
+static bool batchRecordLeaves(string_view record, vector<string_view>& leaves) {
+    leaves.clear();
+    if (record.empty() || uint8_t(record[0]) != TRANSACTION_BATCH_STAGE || record.size() < BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE + 32) {
+        return false;
+    }
+    ByteReader reader{record.data() + 17, record.data() + record.size() - (BLOCK_FOOTER_SIZE + 32)};
+    uint32_t count = readUint32(reader);
+    reader.position = record.data() + BATCH_BODY_OFFSET;
+    // Every leaf takes at least its 4-byte length, so a count the body cannot hold is malformed
+    if (count > size_t(reader.end - reader.position) / 4) {
+        return false;
+    }
+    leaves.reserve(count);
+    for (uint32_t i = 0; i < count && reader.ok; ++i) {
+        uint32_t length = readUint32(reader);
+        const char* bytes = readBytes(reader, length);
+        if (bytes != nullptr) {
+            leaves.emplace_back(bytes, length);
+        }
+    }
+    return reader.ok && reader.position == reader.end;
+}
+
+// Function to decode the transactions stored in a batch block's record (their header carries only the batch's number and time)
+bool decodeBatchTransactions(string_view record, vector<TransactionBlockchain>& transactions) {
+    vector<string_view> leaves;
+    transactions.clear();
+    if (!batchRecordLeaves(record, leaves)) {
+        return false;
+    }
+    uint64_t number, timestamp;
+    memcpy(&number, record.data() + 1, 8);
+    memcpy(&timestamp, record.data() + 9, 8);
+    transactions.resize(leaves.size());
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        ByteReader reader{leaves[i].data(), leaves[i].data() + leaves[i].size()};
+        TransactionBlockchain& b = transactions[i];
+        b.header = BlockHeader{};
+        b.header.blockNumber = number;
+        b.header.timestamp = timestamp;
+        b.transactionId = readField(reader); b.transactionType = readField(reader); b.sender = readField(reader);
+        b.receiver = readField(reader); b.currency = readField(reader);
+        b.transactionAmount = Money(readUint64(reader)); b.transactionStatus = readField(reader);
+        b.signature = readField(reader);
+        if (!reader.ok || reader.position != reader.end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Segment file layout: 16-byte preamble ("TMSSEG05" + first chain position), then records of
+// [u32 body length][body], each body either a canonical record or a dictionary-encoded one (see
+// encodeStoredRecord). Sealing appends a footer: values of delta-coded dictionary entries, the dictionary table
+// (per stage and field: u32 count, then u32 file offset and u32 length of every value), u32 record offsets,
+// the time index (per TIME_INDEX_STRIDE records: u64 oldest timestamp, u64 newest timestamp, u32 mask of the
+// stage tags present), u64 oldest and u64 newest timestamp of the segment, u64 table offset, u64 record count, "TMSSEAL3"
+const char SEGMENT_MAGIC[] = "TMSSEG05"; // 04: records are dictionary-encoded; 05: transactions carry a signature field
+const char SEAL_MAGIC[] = "TMSSEAL3";    // 3: the footer carries a time index
+const size_t SEGMENT_PREAMBLE = 16;
+const size_t SEGMENT_TRAILER = 40;
+
+// Payload layout of every stage's canonical content, one letter per field: I business ID (stored as it is),
+// S dictionary-coded string, D free-text details (dictionary or delta against an earlier value), u 32-bit
+// count, m Money, f float, x raw bytes that never repeat (a signature; stored as varint length and bytes)
+const char* const RECORD_FIELD_LAYOUT[7] = {"ISSSSum", "ISDSSf", "ISDSSf", "ISDSSf", "ISDSuf", "ISDSSS", "ISSSSmSx"};
+
+// How an encoded string field is stored: a varint tag whose low three bits pick the kind
+enum FieldTag : uint8_t {
+    TAG_CODE = 0,           // Dictionary code in the high bits
+    TAG_DEFINE = 1,         // Length in the high bits, then the bytes, which become the field's next code
+    TAG_LITERAL = 2,        // Length in the high bits, then the bytes
+    TAG_DELTA_DEFINE = 3,   // Base code in the high bits, then prefix, suffix and middle as TAG_DELTA; becomes the next code
+    TAG_DELTA = 4           // Base code in the high bits, then varint prefix and suffix lengths kept from the base and the middle
+};
+
+// Function to walk the payload fields of a canonical record in layout order, handing each one to visit(type,
+// field, text, number); false if the payload does not follow the layout
+template <typename Visit>
+static bool walkCanonicalPayload(ByteReader& reader, const char* layout, Visit&& visit) {
+    for (size_t field = 0; layout[field] != '\0' && reader.ok; ++field) {
+        char type = layout[field];
+        if (type == 'u' || type == 'f') {
+            visit(type, field, string_view(), uint64_t(readUint32(reader)));
+        } else if (type == 'm') {
+            visit(type, field, string_view(), readUint64(reader));
+        } else {
+            uint32_t length = readUint32(reader);
+            const char* bytes = readBytes(reader, length);
+            visit(type, field, bytes != nullptr ? string_view(bytes, length) : string_view(), 0);
+        }
+    }
+    return reader.ok;
+}
+
+// Function to find the code of a value in a field's dictionary (UINT32_MAX if it has none)
+static uint32_t findFieldCode(const FieldEncoder& encoder, const vector<string_view>& values, string_view value) {
+    if (encoder.slots.empty()) {
+        return UINT32_MAX;
+    }
+    size_t mask = encoder.slots.size() - 1;
+    for (size_t slot = hashString(value) & mask; encoder.slots[slot] != 0; slot = (slot + 1) & mask) {
+        if (values[encoder.slots[slot] - 1] == value) {
+            return encoder.slots[slot] - 1;
+        }
+    }
+    return UINT32_MAX;
+}
+
+// Function to add a value to a field's dictionary; location is the file offset of its bytes (UINT32_MAX if the
+// footer has to carry them). encoder may be null when only the values are needed
+static void defineFieldValue(SegmentDictionary& dictionary, FieldEncoder* encoder, size_t stage, size_t field,
+                             string_view value, uint32_t location) {
+    vector<string_view>& values = dictionary.values[stage][field];
+    dictionary.owned.emplace_back(value);
+    values.push_back(dictionary.owned.back());
+    dictionary.locations[stage][field].push_back(location);
+    dictionary.footerBytes += 8 + (location == UINT32_MAX ? value.size() : 0);
+    if (encoder == nullptr) {
+        return;
+    }
+    // Grow the table at 50% load so probe sequences stay short
+    if (values.size() * 2 > encoder->slots.size()) {
+        encoder->slots.assign(max<size_t>(64, encoder->slots.size() * 2), 0);
+        for (uint32_t code = 0; code + 1 < values.size(); ++code) {
+            size_t mask = encoder->slots.size() - 1;
+            size_t slot = hashString(values[code]) & mask;
+            while (encoder->slots[slot] != 0) slot = (slot + 1) & mask;
+            encoder->slots[slot] = code + 1;
+        }
+    }
+    size_t mask = encoder->slots.size() - 1;
+    size_t slot = hashString(value) & mask;
+    while (encoder->slots[slot] != 0) slot = (slot + 1) & mask;
+    encoder->slots[slot] = uint32_t(values.size());
+    encoder->lastCode = uint32_t(values.size() - 1);
+}
+
+// Function to encode one string field of a record for storage
+static void encodeStoredField(ChainStore& store, char type, size_t stage, size_t field, string_view value, string& out,
+                              uint64_t recordOffset) {
+    if (type == 'I') {
+        appendVarint(out, uint64_t(value.size()) << 3 | TAG_LITERAL);
+        out.append(value.data(), value.size());
+        return;
+    }
+    SegmentDictionary& dictionary = *store.activeDictionary;
+    FieldEncoder& encoder = store.encoders[stage][field];
+    const vector<string_view>& values = dictionary.values[stage][field];
+    encoder.uses++;
+    uint32_t code = findFieldCode(encoder, values, value);
+    if (code != UINT32_MAX) {
+        appendVarint(out, uint64_t(code) << 3 | TAG_CODE);
+        encoder.lastCode = code;
+        return;
+    }
+    // A field whose values are mostly new after the trial period (IDs in disguise) stops filling the dictionary
+    if (!encoder.closed && values.size() >= DICTIONARY_TRIAL_ENTRIES && values.size() * 2 > encoder.uses) {
+        encoder.closed = true;
+    }
+    bool define = !encoder.closed && values.size() < DICTIONARY_MAX_ENTRIES;
+
+    // Details text is mostly a variation of the previous one: keep the shared prefix and suffix of the base
+    if (type == 'D' && encoder.lastCode != UINT32_MAX) {
+        string_view base = values[encoder.lastCode];
+        size_t prefix = 0, suffix = 0;
+        size_t limit = min(base.size(), value.size());
+        while (prefix < limit && base[prefix] == value[prefix]) prefix++;
+        while (suffix < limit - prefix && base[base.size() - 1 - suffix] == value[value.size() - 1 - suffix]) suffix++;
+        if (prefix + suffix >= DETAILS_DELTA_MIN) {
+            uint32_t baseCode = encoder.lastCode;
+            appendVarint(out, uint64_t(baseCode) << 3 | (define ? TAG_DELTA_DEFINE : TAG_DELTA));
+            appendVarint(out, prefix);
+            appendVarint(out, suffix);
+            appendVarint(out, value.size() - prefix - suffix);
+            out.append(value.data() + prefix, value.size() - prefix - suffix);
+            if (define) {
+                defineFieldValue(dictionary, &encoder, stage, field, value, UINT32_MAX);
+            }
+            return;
+        }
+    }
+    appendVarint(out, uint64_t(value.size()) << 3 | (define ? TAG_DEFINE : TAG_LITERAL));
+    uint64_t location = recordOffset + out.size();
+    out.append(value.data(), value.size());
+    if (define) {
+        defineFieldValue(dictionary, &encoder, stage, field, value, location <= UINT32_MAX ? uint32_t(location) : UINT32_MAX);
+    }
+}
+
+// Function to encode the payload fields of a canonical record (already checked against its layout)
+static void encodeStoredPayload(ChainStore& store, ByteReader& reader, size_t stage, string& out, uint64_t recordOffset) {
+    walkCanonicalPayload(reader, RECORD_FIELD_LAYOUT[stage], [&](char type, size_t field, string_view text, uint64_t number) {
+        if (type == 'u') {
+            appendVarint(out, number);
+        } else if (type == 'm') {
+            int64_t value = int64_t(number);
+            appendVarint(out, (uint64_t(value) << 1) ^ uint64_t(value >> 63)); // Zigzag keeps small negative amounts short
+        } else if (type == 'f') {
+            appendUint32(out, uint32_t(number));
+        } else if (type == 'x') {
+            appendVarint(out, text.size());
+            out.append(text.data(), text.size());
+        } else {
+            encodeStoredField(store, type, stage, field, text, out, recordOffset);
+        }
+    });
+}
+
+// Function to get the payload field (RECORD_FIELD_LAYOUT position) of a stage's render column: the same one,
+// except that a transaction's amount is rendered third but stored sixth
+static size_t columnRecordField(size_t stage, size_t column) {
+    static const uint8_t TRANSACTION_FIELDS[7] = {0, 1, 5, 2, 3, 4, 6};
+    return stage == 7 && column < 7 ? TRANSACTION_FIELDS[column] : column;
+}
+
+// Function to read bytes of the active segment, whether they still sit in the write buffer or were written
+// (caller holds store.lock)
+static bool readActiveBytes(ChainStore& store, uint64_t offset, size_t length, char* out) {
+    uint64_t buffered = store.activeSize - store.writeBuffer.size(); // File offset of the first buffered byte
+    size_t written = offset < buffered ? size_t(min<uint64_t>(length, buffered - offset)) : 0;
+    if (written != 0 && pread(store.activeFd, out, written, off_t(offset)) != ssize_t(written)) {
+        return false;
+    }
+    if (offset + length > store.activeSize) {
+        return false;
+    }
+    memcpy(out + written, store.writeBuffer.data() + (offset + written - buffered), length - written);
+    return true;
+}
+
+// Function to check the payload of an update record: target hash, target stage, field count, then a column
+// and a length-prefixed value per field
+static bool checkUpdatePayload(ByteReader& reader) {
+    readBytes(reader, 32);
+    const char* counts = readBytes(reader, 2);
+    if (counts == nullptr || counts[0] < 1 || counts[0] > 7) {
+        return false;
+    }
+    for (uint8_t i = 0; i < uint8_t(counts[1]) && reader.ok; ++i) {
+        const char* column = readBytes(reader, 1);
+        uint32_t length = readUint32(reader);
+        if (column == nullptr || *column < 1 || *column >= 7 || readBytes(reader, length) == nullptr) {
+            return false;
+        }
+    }
+    return reader.ok;
+}
+
+// Function to encode the payload of an update record: its values share the dictionaries of the target stage's
+// fields, and its target hash is left out when it is the stored hash of an earlier record of the active segment
+// (the one upstreamOffset back; the target's record ends where the record after it starts)
+static void encodeStoredUpdate(ChainStore& store, ByteReader& reader, uint32_t back, string& out, uint64_t recordOffset) {
+    const char* targetHash = readBytes(reader, 32);
+    uint64_t local = store.activeOffsets.size();
+    char stored[32];
+    bool implied = back != 0 && back <= local &&
+                   readActiveBytes(store, (local - back + 1 < local ? store.activeOffsets[local - back + 1] : store.activeSize) - 32, 32, stored) &&
+                   memcmp(stored, targetHash, 32) == 0;
+    out.push_back(char(implied ? 1 : 0));
+    if (!implied) {
+        out.append(targetHash, 32);
+    }
+    const char* counts = readBytes(reader, 2);
+    out.append(counts, 2);
+    size_t stage = uint8_t(counts[0]) - 1;
+    for (uint8_t i = 0; i < uint8_t(counts[1]); ++i) {
+        uint8_t column = uint8_t(*readBytes(reader, 1));
+        out.push_back(char(column));
+        uint32_t length = readUint32(reader);
+        string_view value(readBytes(reader, length), length);
+        size_t field = columnRecordField(stage + 1, column);
+        char type = RECORD_FIELD_LAYOUT[stage][field];
+        // Numbers arrive as text here, so only string fields go through the dictionary
+        encodeStoredField(store, type == 'S' || type == 'D' ? type : 'I', stage, field, value, out, recordOffset);
+    }
+}
+
+// Function to encode a canonical record (content followed by hash) for the active segment: numbers become
+// varints, strings become dictionary codes, deltas or literals, and a previous hash equal to the newest record's
+// stored hash is left out. Returns false when the record does not follow its stage's layout (it is then stored
+// as it is). recordOffset is the file offset the encoded body will have
+static bool encodeStoredRecord(ChainStore& store, string_view record, string& out, uint64_t recordOffset) {
+    uint8_t stage = record.empty() ? 0 : uint8_t(record[0]);
+    if (stage < 1 || (stage > TRANSACTION_BATCH_STAGE && stage != UPDATE_STAGE) || record.size() < 17 + BLOCK_FOOTER_SIZE + 32) {
+        return false;
+    }
+    // Check the whole layout first, so nothing is defined for a record that ends up stored as it is
+    const char* footer = record.data() + record.size() - (BLOCK_FOOTER_SIZE + 32);
+    ByteReader check{record.data() + 17, footer};
+    if (stage == UPDATE_STAGE && (!checkUpdatePayload(check) || check.position != footer)) {
+        return false;
+    }
+    uint32_t leaves = stage == UPDATE_STAGE ? 0 : 1;
+    if (stage == TRANSACTION_BATCH_STAGE) {
+        leaves = readUint32(check);
+        readBytes(check, 32);
+    }
+    for (uint32_t leaf = 0; leaf < leaves && check.ok; ++leaf) {
+        const char* end = check.end;
+        if (stage == TRANSACTION_BATCH_STAGE) {
+            uint32_t length = readUint32(check);
+            end = check.ok && length <= size_t(check.end - check.position) ? check.position + length : nullptr;
+            if (end == nullptr) {
+                return false;
+            }
+        }
+        ByteReader fields{check.position, end};
+        auto ignore = [](char, size_t, string_view, uint64_t) {};
+        if (!walkCanonicalPayload(fields, RECORD_FIELD_LAYOUT[stage == TRANSACTION_BATCH_STAGE ? 6 : stage - 1], ignore) ||
+            fields.position != end) {
+            return false;
+        }
+        check.position = end;
+    }
+    if (!check.ok || check.position != footer) {
+        return false;
+    }
+
+    out.clear();
+    out.push_back(char(stage | ENCODED_RECORD_FLAG));
+    ByteReader reader{record.data() + 1, footer};
+    appendVarint(out, readUint64(reader));
+    out.append(reader.position, 8); // Timestamps are close to 2^61: a varint would not be shorter
+    reader.position += 8;
+    if (stage == TRANSACTION_BATCH_STAGE) {
+        appendVarint(out, readUint32(reader));
+        out.append(reader.position, 32);
+        reader.position += 32;
+        for (uint32_t leaf = 0; leaf < leaves; ++leaf) {
+            readUint32(reader); // The leaf length follows from its fields
+            encodeStoredPayload(store, reader, 6, out, recordOffset);
+        }
+    } else if (stage == UPDATE_STAGE) {
+        uint32_t back;
+        memcpy(&back, footer + 1 + 8, 4);
+        encodeStoredUpdate(store, reader, back, out, recordOffset);
+    } else {
+        encodeStoredPayload(store, reader, stage - 1, out, recordOffset);
+    }
+    ByteReader tail{footer, record.data() + record.size()};
+    appendVarint(out, uint8_t(*readBytes(tail, 1)));
+    appendVarint(out, readUint64(tail));
+    appendVarint(out, readUint32(tail));
+    const char* previous = readBytes(tail, 32);
+    bool linked = !store.activeOffsets.empty() && memcmp(previous, store.lastHash.data(), 32) == 0;
+    out.push_back(char(linked ? 1 : 0));
+    if (!linked) {
+        out.append(previous, 32);
+    }
+    out.append(tail.position, 32);
+    return true;
+}
+
+// Function to decode one string field of an encoded record into its canonical form
+static bool expandStoredField(ByteReader& reader, const SegmentDictionary& dictionary, size_t stage, size_t field,
+                              string& out, SegmentDictionary* define, uint64_t recordOffset, const char* recordStart) {
+    uint64_t tag = readVarint(reader);
+    uint64_t argument = tag >> 3;
+    // Codes past the dictionary are values defined earlier in the same record (a batch's leaves share fields)
+    const vector<string_view>& values = dictionary.values[stage][field];
+    const vector<string_view>* pending = define != nullptr ? &define->values[stage][field] : nullptr;
+    auto value = [&](uint64_t code, string_view& found) {
+        if (code < values.size()) {
+            found = values[code];
+        } else if (pending != nullptr && code - values.size() < pending->size()) {
+            found = (*pending)[code - values.size()];
+        } else {
+            return false;
+        }
+        return true;
+    };
+    string_view base;
+    switch (tag & 7) {
+        case TAG_CODE: {
+            if (!value(argument, base)) {
+                return false;
+            }
+            appendUint32(out, uint32_t(base.size()));
+            out.append(base.data(), base.size());
+            return true;
+        }
+        case TAG_DEFINE:
+        case TAG_LITERAL: {
+            const char* bytes = readBytes(reader, size_t(argument));
+            if (bytes == nullptr) {
+                return false;
+            }
+            appendUint32(out, uint32_t(argument));
+            out.append(bytes, size_t(argument));
+            if ((tag & 7) == TAG_DEFINE && define != nullptr) {
+                uint64_t location = recordOffset + uint64_t(bytes - recordStart);
+                defineFieldValue(*define, nullptr, stage, field, string_view(bytes, size_t(argument)),
+                                 location <= UINT32_MAX ? uint32_t(location) : UINT32_MAX);
+            }
+            return true;
+        }
+        case TAG_DELTA_DEFINE:
+        case TAG_DELTA: {
+            uint64_t prefix = readVarint(reader), suffix = readVarint(reader), middle = readVarint(reader);
+            const char* bytes = readBytes(reader, size_t(middle));
+            if (bytes == nullptr || !value(argument, base) || prefix + suffix > base.size()) {
+                return false;
+            }
+            size_t start = out.size() + 4;
+            appendUint32(out, uint32_t(prefix + middle + suffix));
+            out.append(base.data(), size_t(prefix));
+            out.append(bytes, size_t(middle));
+            out.append(base.data() + base.size() - suffix, size_t(suffix));
+            if ((tag & 7) == TAG_DELTA_DEFINE && define != nullptr) {
+                defineFieldValue(*define, nullptr, stage, field, string_view(out).substr(start), UINT32_MAX);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to decode the payload fields of an encoded record into their canonical form
+static bool expandStoredPayload(ByteReader& reader, const SegmentDictionary& dictionary, size_t stage, string& out,
+                                SegmentDictionary* define, uint64_t recordOffset, const char* recordStart) {
+    const char* layout = RECORD_FIELD_LAYOUT[stage];
+    for (size_t field = 0; layout[field] != '\0' && reader.ok; ++field) {
+        char type = layout[field];
+        if (type == 'u') {
+            appendUint32(out, uint32_t(readVarint(reader)));
+        } else if (type == 'm') {
+            uint64_t zigzag = readVarint(reader);
+            appendUint64(out, (zigzag >> 1) ^ (0 - (zigzag & 1)));
+        } else if (type == 'f') {
+            appendUint32(out, readUint32(reader));
+        } else if (type == 'x') {
+            uint64_t length = readVarint(reader);
+            const char* bytes = length <= size_t(reader.end - reader.position) ? readBytes(reader, size_t(length)) : nullptr;
+            if (bytes == nullptr) {
+                return false;
+            }
+            appendUint32(out, uint32_t(length));
+            out.append(bytes, size_t(length));
+        } else if (!expandStoredField(reader, dictionary, stage, field, out, define, recordOffset, recordStart)) {
+            return false;
+        }
+    }
+    return reader.ok;
+}
+
+// Function to expand a stored record into its canonical form (content followed by hash). previousHash points
+// at the stored hash of the record before it in the same segment (nullptr for a segment's first record);
+// storedHashBack(n) points at the stored hash of the record n positions back in the same segment (nullptr if
+// there is none), which an encoded update may have left out as its target hash. With
+// define set, the values the record defines are added to that dictionary (rebuilding the active segment's
+// dictionary after a restart; recordOffset is then the record's file offset). Returns a view of the canonical
+// record: the stored bytes themselves when they are canonical, otherwise out
+static string_view expandStoredRecord(string_view stored, const SegmentDictionary* dictionary, const char* previousHash,
+                                      const function<const char*(uint64_t)>& storedHashBack, string& out,
+                                      SegmentDictionary* define = nullptr, uint64_t recordOffset = 0) {
+    if (stored.empty() || (uint8_t(stored[0]) & ENCODED_RECORD_FLAG) == 0) {
+        return stored;
+    }
+    if (dictionary == nullptr || stored.size() < 32) {
+        return string_view();
+    }
+    uint8_t stage = uint8_t(stored[0]) & ~ENCODED_RECORD_FLAG;
+    ByteReader reader{stored.data() + 1, stored.data() + stored.size() - 32};
+    out.clear();
+    out.push_back(char(stage));
+    appendUint64(out, readVarint(reader));
+    const char* timestamp = readBytes(reader, 8);
+    if (timestamp == nullptr || stage < 1 || (stage > TRANSACTION_BATCH_STAGE && stage != UPDATE_STAGE)) {
+        return string_view();
+    }
+    out.append(timestamp, 8);
+    bool ok = true;
+    size_t impliedTarget = 0; // Where an update's left-out target hash goes (0 = none left out)
+    if (stage == TRANSACTION_BATCH_STAGE) {
+        uint64_t leaves = readVarint(reader);
+        const char* root = readBytes(reader, 32);
+        if (root == nullptr || leaves > stored.size()) {
+            return string_view();
+        }
+        appendUint32(out, uint32_t(leaves));
+        out.append(root, 32);
+        for (uint64_t leaf = 0; leaf < leaves && ok; ++leaf) {
+            size_t lengthAt = out.size();
+            appendUint32(out, 0);
+            ok = expandStoredPayload(reader, *dictionary, 6, out, define, recordOffset, stored.data());
+            uint32_t length = uint32_t(out.size() - lengthAt - 4);
+            memcpy(&out[lengthAt], &length, 4);
+        }
+    } else if (stage == UPDATE_STAGE) {
+        const char* implied = readBytes(reader, 1);
+        const char* target = implied != nullptr && *implied == 0 ? readBytes(reader, 32) : nullptr;
+        static const char unknownTarget[32] = {};
+        impliedTarget = target == nullptr ? out.size() : 0;
+        out.append(target != nullptr ? target : unknownTarget, 32);
+        const char* counts = readBytes(reader, 2);
+        if (counts == nullptr || counts[0] < 1 || counts[0] > 7) {
+            return string_view();
+        }
+        out.append(counts, 2);
+        for (uint8_t i = 0; i < uint8_t(counts[1]) && ok; ++i) {
+            const char* column = readBytes(reader, 1);
+            if (column == nullptr || *column < 1 || *column >= 7) {
+                return string_view();
+            }
+            out.push_back(*column);
+            size_t field = columnRecordField(size_t(counts[0]), size_t(*column));
+            ok = expandStoredField(reader, *dictionary, size_t(counts[0]) - 1, field, out, define, recordOffset, stored.data());
+        }
+    } else {
+        ok = expandStoredPayload(reader, *dictionary, stage - 1, out, define, recordOffset, stored.data());
+    }
+    uint64_t difficulty = readVarint(reader), nonce = readVarint(reader), upstream = readVarint(reader);
+    const char* link = readBytes(reader, 1);
+    const char* previous = link != nullptr && *link == 0 ? readBytes(reader, 32) : previousHash;
+    if (!ok || !reader.ok || link == nullptr || previous == nullptr || reader.position != reader.end) {
+        return string_view();
+    }
+    if (impliedTarget != 0) {
+        const char* target = storedHashBack ? storedHashBack(upstream) : nullptr;
+        if (target == nullptr) {
+            return string_view();
+        }
+        memcpy(&out[impliedTarget], target, 32);
+    }
+    out.push_back(char(difficulty));
+    appendUint64(out, nonce);
+    appendUint32(out, uint32_t(upstream));
+    out.append(previous, 32);
+    out.append(stored.data() + stored.size() - 32, 32);
+    return out;
+}
+
+// Function to copy a dictionary into storage of its own, so readers can keep it while the original grows
+static shared_ptr<const SegmentDictionary> copyDictionary(const SegmentDictionary& source) {
+    auto copy = make_shared<SegmentDictionary>();
+    for (size_t stage = 0; stage < 7; ++stage) {
+        for (size_t field = 0; field < 7; ++field) {
+            for (string_view value : source.values[stage][field]) {
+                copy->owned.emplace_back(value);
+                copy->values[stage][field].push_back(copy->owned.back());
+            }
+        }
+    }
+    return copy;
+}
+
+// Function to expand the record at a position of a segment (mapped sealed segment or a read view's active part)
+static string_view expandSegmentRecord(const StoreSegment& segment, uint64_t local, string& out) {
+    uint32_t offset = segment.offsets[local];
+    uint32_t length;
+    memcpy(&length, segment.data + offset, 4);
+    // The previous record's stored hash ends right where this record's length prefix starts (and so on back)
+    const char* previousHash = local > 0 ? segment.data + offset - 32 : nullptr;
+    auto storedHashBack = [&segment, local](uint64_t back) -> const char* {
+        return back != 0 && back <= local ? segment.data + segment.offsets[local - back + 1] - 32 : nullptr;
+    };
+    return expandStoredRecord(string_view(segment.data + offset + 4, length), segment.dictionary.get(), previousHash,
+                              storedHashBack, out);
+}
+
+// Function to read the stage tag and timestamp of a stored record, canonical or encoded, without expanding it
+static bool storedRecordTime(string_view stored, uint8_t& stage, uint64_t& timestamp) {
+    if (stored.empty()) {
+        return false;
+    }
+    stage = uint8_t(stored[0]) & ~ENCODED_RECORD_FLAG;
+    ByteReader reader{stored.data() + 1, stored.data() + stored.size()};
+    if ((uint8_t(stored[0]) & ENCODED_RECORD_FLAG) != 0) {
+        readVarint(reader); // Block number
+    } else {
+        readUint64(reader);
+    }
+    timestamp = readUint64(reader);
+    return reader.ok && stage < 32;
+}
+
+// Function to fold a record's stage and timestamp into a time index (local = the record's position in its segment):
+// the first record of every TIME_INDEX_STRIDE starts a new entry, the others widen the newest one
+static void addToTimeIndex(string& index, uint64_t local, uint8_t stage, uint64_t timestamp) {
+    uint64_t oldest = timestamp, newest = timestamp;
+    uint32_t stages = 1u << (stage % 32);
+    if (local % TIME_INDEX_STRIDE != 0 && index.size() >= TIME_INDEX_ENTRY) {
+        ByteReader reader{index.data() + index.size() - TIME_INDEX_ENTRY, index.data() + index.size()};
+        oldest = min(oldest, readUint64(reader));
+        newest = max(newest, readUint64(reader));
+        stages |= readUint32(reader);
+        index.resize(index.size() - TIME_INDEX_ENTRY);
+    }
+    appendUint64(index, oldest);
+    appendUint64(index, newest);
+    appendUint32(index, stages);
+}
+
+// Function to find the oldest and newest timestamp a time index covers
+static void timeIndexBounds(const char* index, uint64_t entries, uint64_t& oldest, uint64_t& newest) {
+    ByteReader reader{index, index + entries * TIME_INDEX_ENTRY};
+    oldest = entries == 0 ? 0 : UINT64_MAX;
+    newest = 0;
+    for (uint64_t entry = 0; entry < entries; ++entry) {
+        oldest = min(oldest, readUint64(reader));
+        newest = max(newest, readUint64(reader));
+        readUint32(reader);
+    }
+}
+
+// Function to write a whole buffer to a file descriptor, retrying short writes
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Chain store write failed: " << strerror(errno) << endl;
+            return false;
+        }
+        data += written;
+        length -= size_t(written);
+    }
+    return true;
+}
+
+// Function to write the Prometheus text of every metric to a file (replaced atomically, so a scraper reading
+// the file never sees half of it)
+bool writeMetricsFile(const string& path) {
+    string text = formatMetrics();
+    string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && writeAll(fd, text.data(), text.size());
+    if (fd >= 0) close(fd);
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        cerr << "Cannot write metrics to " << path << ": " << strerror(errno) << endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to write generated vehicles to a CSV file (- for standard output): the rows ingest --vehicles builds from
+bool writeWorkloadFile(const Workload& workload, const string& path) {
+    int fd = path == "-" ? STDOUT_FILENO : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    string buffer, rows;
+    bool ok = true;
+    for (uint64_t vehicle = 0; vehicle < workload.options.vehicles && ok; ++vehicle) {
+        generateVehicleRows(workload, vehicle, rows);
+        buffer += rows;
+        if (buffer.size() >= 1024 * 1024 || vehicle + 1 == workload.options.vehicles) {
+            ok = writeAll(fd, buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    if (fd != STDOUT_FILENO && close(fd) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        cerr << "Cannot write " << path << ": " << strerror(errno) << endl;
+    }
+    return ok;
+}
+
+// Function to write every sender key, seeds included, to a file only its owner can read
+bool writeSignerKeys(const string& path) {
+    string text = "# name,publicKey,seed (Ed25519, hexadecimal; keep this file secret)\n";
+    for (const auto& entry : signerKeys) {
+        text += entry.first;
+        text += ',';
+        text += hashToHex(entry.second.publicKey.data(), entry.second.publicKey.size());
+        if (entry.second.canSign) {
+            text += ',';
+            text += hashToHex(entry.second.seed.data(), entry.second.seed.size());
+        }
+        text += '\n';
+    }
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    bool ok = fd >= 0 && writeAll(fd, text.data(), text.size());
+    if (!ok) {
+        cerr << "Cannot write " << path << ": " << strerror(errno) << endl;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ok;
+}
+
+// Function to set up the sender keys of a run: load --keys FILE, or create it with a key for every company when
+// vehicles are generated and the file does not exist yet
+bool prepareSignerKeys(const CommandOptions& options) {
+    if (options.keysPath.empty()) {
+        return true;
+    }
+    if (access(options.keysPath.c_str(), F_OK) == 0 || options.workload.vehicles == 0) {
+        return loadSignerKeys(options.keysPath);
+    }
+    deriveWorkloadKeys(options.workload);
+    return writeSignerKeys(options.keysPath);
+}
+
+// Function to build the file name of the segment that starts at a chain position
+static string segmentPath(const ChainStore& store, uint64_t firstIndex) {
+    char name[40];
+    snprintf(name, sizeof(name), "segment-%016llx.log", (unsigned long long) firstIndex);
+    return store.options.directory + "/" + name;
+}
+
+// Function to hand buffered records to the kernel (caller holds store.lock)
+static bool flushWriteBuffer(ChainStore& store) {
+    if (store.writeBuffer.empty()) {
+        return true;
+    }
+    MetricTimer timer(METRIC_STORE_WRITE);
+    if (!writeAll(store.activeFd, store.writeBuffer.data(), store.writeBuffer.size())) {
+        return false;
+    }
+    store.writeBuffer.clear();
+    store.dirty = true;
+    return true;
+}
+
+// Function to make every appended record durable (caller holds store.lock)
+static bool syncStoreLocked(ChainStore& store) {
+    if (!flushWriteBuffer(store)) {
+        return false;
+    }
+    if (store.dirty) {
+        MetricTimer timer(METRIC_STORE_SYNC);
+        if (fdatasync(store.activeFd) != 0) {
+            cerr << "Chain store sync failed: " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    store.dirty = false;
+    return true;
+}
+
+// Function to map a sealed segment and locate its footer; returns false if the file is not a sealed segment
+static bool mapSealedSegment(const string& path, StoreSegment& segment) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return false;
+    }
+    const size_t trailer = SEGMENT_TRAILER;
+    if (file.size < SEGMENT_PREAMBLE + trailer || memcmp(file.data, SEGMENT_MAGIC, 8) != 0 ||
+        memcmp(file.data + file.size - 8, SEAL_MAGIC, 8) != 0) {
+        unmapFile(file);
+        return false;
+    }
+    uint64_t oldest, newest, tableOffset, count;
+    memcpy(&oldest, file.data + file.size - trailer, 8);
+    memcpy(&newest, file.data + file.size - 32, 8);
+    memcpy(&tableOffset, file.data + file.size - 24, 8);
+    memcpy(&count, file.data + file.size - 16, 8);
+    // The record offsets and the time index (one entry per TIME_INDEX_STRIDE records) sit right before the trailer
+    uint64_t entries = (count + TIME_INDEX_STRIDE - 1) / TIME_INDEX_STRIDE;
+    size_t offsetsAt = count <= (file.size - SEGMENT_PREAMBLE - trailer) / (4 + TIME_INDEX_ENTRY)
+                           ? file.size - trailer - entries * TIME_INDEX_ENTRY - 4 * count : 0;
+    if (offsetsAt == 0 || tableOffset < SEGMENT_PREAMBLE || tableOffset > offsetsAt) {
+        unmapFile(file);
+        return false;
+    }
+
+    // The dictionary table points at every value inside the mapping
+    auto dictionary = make_shared<SegmentDictionary>();
+    ByteReader table{file.data + tableOffset, file.data + offsetsAt};
+    for (size_t stage = 0; stage < 7 && table.ok; ++stage) {
+        for (size_t field = 0; field < 7 && table.ok; ++field) {
+            uint32_t entries = readUint32(table);
+            vector<string_view>& values = dictionary->values[stage][field];
+            values.reserve(min<size_t>(entries, size_t(table.end - table.position) / 8));
+            for (uint32_t i = 0; i < entries && table.ok; ++i) {
+                uint32_t offset = readUint32(table), length = readUint32(table);
+                if (uint64_t(offset) + length > offsetsAt) {
+                    table.ok = false;
+                    break;
+                }
+                values.emplace_back(file.data + offset, length);
+            }
+        }
+    }
+    if (!table.ok) {
+        unmapFile(file);
+        return false;
+    }
+    close(file.fd); // The mapping stays valid after the descriptor is closed
+    segment.path = path;
+    memcpy(&segment.firstIndex, file.data + 8, 8);
+    segment.data = file.data;
+    segment.size = file.size;
+    segment.count = count;
+    segment.offsets = reinterpret_cast<const uint32_t*>(file.data + offsetsAt);
+    segment.dictionary = dictionary;
+    segment.timeIndex = file.data + offsetsAt + 4 * count;
+    segment.oldestTimestamp = oldest;
+    segment.newestTimestamp = newest;
+    madvise(const_cast<char*>(file.data), file.size, MADV_RANDOM); // Lookups touch only the records they need
+    return true;
+}
+
+// Function to start a new, empty active segment at the current end of the chain (caller holds store.lock)
+static bool openNewSegment(ChainStore& store, uint64_t firstIndex) {
+    store.activePath = segmentPath(store, firstIndex);
+    store.activeFd = open(store.activePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (store.activeFd < 0) {
+        cerr << "Cannot create " << store.activePath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    store.activeFirstIndex = firstIndex;
+    store.activeOffsets.clear();
+    store.activeTimeIndex.clear();
+    store.activeDictionary = make_shared<SegmentDictionary>();
+    for (auto& stageEncoders : store.encoders) {
+        for (FieldEncoder& encoder : stageEncoders) {
+            encoder = FieldEncoder();
+        }
+    }
+    store.writeBuffer.assign(SEGMENT_MAGIC, 8);
+    for (int i = 0; i < 8; ++i) {
+        store.writeBuffer.push_back(char(firstIndex >> (8 * i)));
+    }
+    store.activeSize = SEGMENT_PREAMBLE;
+    return true;
+}
+
+// Function to seal the active segment (write its footer, sync, map it read-only) and open the next one
+static bool rotateSegment(ChainStore& store) {
+    MetricTimer timer(METRIC_STORE_ROTATE);
+    // Values that no record holds verbatim (delta-coded ones) go first, then the table pointing at every value
+    SegmentDictionary& dictionary = *store.activeDictionary;
+    for (size_t stage = 0; stage < 7; ++stage) {
+        for (size_t field = 0; field < 7; ++field) {
+            for (size_t code = 0; code < dictionary.values[stage][field].size(); ++code) {
+                if (dictionary.locations[stage][field][code] == UINT32_MAX) {
+                    dictionary.locations[stage][field][code] = uint32_t(store.activeSize);
+                    store.writeBuffer.append(dictionary.values[stage][field][code]);
+                    store.activeSize += dictionary.values[stage][field][code].size();
+                }
+            }
+        }
+    }
+    uint64_t tableOffset = store.activeSize;
+    for (size_t stage = 0; stage < 7; ++stage) {
+        for (size_t field = 0; field < 7; ++field) {
+            appendUint32(store.writeBuffer, uint32_t(dictionary.values[stage][field].size()));
+            for (size_t code = 0; code < dictionary.values[stage][field].size(); ++code) {
+                appendUint32(store.writeBuffer, dictionary.locations[stage][field][code]);
+                appendUint32(store.writeBuffer, uint32_t(dictionary.values[stage][field][code].size()));
+            }
+        }
+    }
+    for (uint32_t offset : store.activeOffsets) {
+        store.writeBuffer.append(reinterpret_cast<const char*>(&offset), 4);
+    }
+    uint64_t count = store.activeOffsets.size();
+    uint64_t oldest, newest;
+    timeIndexBounds(store.activeTimeIndex.data(), store.activeTimeIndex.size() / TIME_INDEX_ENTRY, oldest, newest);
+    store.writeBuffer.append(store.activeTimeIndex);
+    store.writeBuffer.append(reinterpret_cast<const char*>(&oldest), 8);
+    store.writeBuffer.append(reinterpret_cast<const char*>(&newest), 8);
+    store.writeBuffer.append(reinterpret_cast<const char*>(&tableOffset), 8);
+    store.writeBuffer.append(reinterpret_cast<const char*>(&count), 8);
+    store.writeBuffer.append(SEAL_MAGIC, 8);
+    if (!syncStoreLocked(store)) {
+        return false;
+    }
+    close(store.activeFd);
+    store.activeFd = -1;
+
+    StoreSegment segment;
+    if (!mapSealedSegment(store.activePath, segment)) {
+        cerr << "Cannot map sealed segment " << store.activePath << endl;
+        return false;
+    }
+    store.segments.push_back(segment);
+    return openNewSegment(store, segment.firstIndex + segment.count);
+}
+
+// Function to recover an unsealed segment after a restart: keep every intact record and drop a torn tail (a store
+// opened read-only keeps it on disk); a damaged record with more records after it fails the open instead, unless the
+// store is opened without recovery
+static bool recoverActiveSegment(ChainStore& store, const string& path) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return false;
+    }
+    // Only a file shorter than the preamble can be a torn preamble; a full one with the wrong magic is damage
+    bool hasPreamble = file.size >= SEGMENT_PREAMBLE && memcmp(file.data, SEGMENT_MAGIC, 8) == 0;
+    if (!hasPreamble && file.size >= SEGMENT_PREAMBLE) {
+        cerr << path << " is not a chain store segment" << endl;
+        unmapFile(file);
+        return false;
+    }
+    uint64_t firstIndex = store.segments.empty() ? 0 : store.segments.back().firstIndex + store.segments.back().count;
+    size_t validSize = 0;
+    store.activeOffsets.clear();
+    store.activeTimeIndex.clear();
+    store.activeDictionary = make_shared<SegmentDictionary>();
+    if (hasPreamble) {
+        memcpy(&firstIndex, file.data + 8, 8);
+        size_t position = SEGMENT_PREAMBLE;
+        string canonical;
+        // A torn tail is a length prefix cut short, a record running past the end of the file, or a last record
+        // whose bytes did not all reach the disk; anything else that does not check out is damage
+        while (position + 4 <= file.size) {
+            uint32_t length;
+            memcpy(&length, file.data + position, 4);
+            if (position + 4 + uint64_t(length) > file.size) {
+                break;
+            }
+            // A record only counts if its stored hash matches its content. Decoding it into a scratch dictionary
+            // first keeps the values a torn record defines out of the segment's dictionary
+            SegmentDictionary defined;
+            const char* previousHash = store.activeOffsets.empty() ? nullptr : file.data + position - 32;
+            uint64_t local = store.activeOffsets.size();
+            auto storedHashBack = [&](uint64_t back) -> const char* {
+                uint64_t next = local - back + 1;
+                return back != 0 && back <= local ? file.data + (next < local ? store.activeOffsets[next] : position) - 32 : nullptr;
+            };
+            string_view record;
+            if (length >= 32) {
+                record = expandStoredRecord(string_view(file.data + position + 4, length), store.activeDictionary.get(),
+                                            previousHash, storedHashBack, canonical, &defined, position + 4);
+            }
+            BlockHash hash;
+            bool intact = record.size() >= 32;
+            if (intact) {
+                recordContentHash(record, hash.data());
+                intact = memcmp(hash.data(), file.data + position + 4 + length - 32, 32) == 0;
+            }
+            if (!intact && position + 4 + length == file.size) {
+                break;
+            }
+            if (!intact && store.options.recover) {
+                cerr << "Block at chain position " << firstIndex + local << " (offset " << position << " of " << path
+                     << ") does not match its stored hash and more records follow it; the store is damaged" << endl;
+                unmapFile(file);
+                return false;
+            }
+            // Without recovery a damaged record stays in place for verify to report; values it defines are kept
+            // as long as it still decodes, so the records after it decode as well
+            for (size_t stage = 0; stage < 7 && record.size() >= 32; ++stage) {
+                for (size_t field = 0; field < 7; ++field) {
+                    for (size_t i = 0; i < defined.values[stage][field].size(); ++i) {
+                        defineFieldValue(*store.activeDictionary, &store.encoders[stage][field], stage, field,
+                                         defined.values[stage][field][i], defined.locations[stage][field][i]);
+                    }
+                }
+            }
+            memcpy(store.lastHash.data(), file.data + position + 4 + length - 32, 32);
+            uint8_t stage;
+            uint64_t timestamp;
+            if (storedRecordTime(record, stage, timestamp)) {
+                addToTimeIndex(store.activeTimeIndex, local, stage, timestamp);
+            }
+            store.activeOffsets.push_back(uint32_t(position));
+            position += 4 + length;
+        }
+        validSize = position;
+    }
+    size_t tornBytes = file.size - validSize;
+    unmapFile(file);
+
+    store.activePath = path;
+    store.activeFirstIndex = firstIndex;
+    store.activeSize = hasPreamble ? validSize : SEGMENT_PREAMBLE;
+    store.writeBuffer.clear();
+    if (store.options.readOnly) {
+        // Readers leave a torn tail where it is; the next writer drops it
+        store.activeFd = open(path.c_str(), O_RDONLY);
+        if (store.activeFd < 0) {
+            cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+            return false;
+        }
+        return true;
+    }
+    if (tornBytes != 0) {
+        cerr << "Dropping a torn record of " << tornBytes << " bytes at the end of " << path << endl;
+    }
+    store.activeFd = open(path.c_str(), O_RDWR);
+    if (store.activeFd < 0 || ftruncate(store.activeFd, off_t(validSize)) != 0 || lseek(store.activeFd, 0, SEEK_END) < 0) {
+        cerr << "Cannot reopen " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    if (!hasPreamble) {
+        // The preamble itself was torn; write it again
+        store.writeBuffer.assign(SEGMENT_MAGIC, 8);
+        for (int i = 0; i < 8; ++i) {
+            store.writeBuffer.push_back(char(firstIndex >> (8 * i)));
+        }
+    }
+    return true;
+}
+
+// Background loop that bounds how long appended blocks stay unsynced (Durability::TimeBounded)
+static void storeFlusherLoop(ChainStore* store) {
+    unique_lock<mutex> guard(store->lock);
+    while (!store->closing) {
+        store->wake.wait_for(guard, chrono::milliseconds(store->options.syncIntervalMs));
+        if (!store->writeBuffer.empty() || store->dirty) {
+            syncStoreLocked(*store);
+        }
+    }
+}
+
+// Function to open (or create) a chain store: sealed segments are memory-mapped, the last one is reopened for appends
+bool openChainStore(ChainStore& store, const ChainStoreOptions& options) {
+    store.options = options;
+    store.options.segmentSize = min<size_t>(max<size_t>(options.segmentSize, 4096), size_t(1) << 30); // Offsets are 32-bit
+    error_code error;
+    if (options.readOnly && !filesystem::is_directory(options.directory, error)) {
+        cerr << "No chain store in " << options.directory << endl;
+        return false;
+    }
+    filesystem::create_directories(options.directory, error);
+    if (error) {
+        cerr << "Cannot create " << options.directory << ": " << error.message() << endl;
+        return false;
+    }
+
+    // Segment names embed their first chain position in fixed-width hex, so name order is chain order
+    vector<string> paths;
+    for (const auto& entry : filesystem::directory_iterator(options.directory)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("segment-", 0) == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".log") == 0) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    sort(paths.begin(), paths.end());
+
+    lock_guard<mutex> guard(store.lock);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        StoreSegment segment;
+        if (mapSealedSegment(paths[i], segment)) {
+            store.segments.push_back(segment);
+        } else if (i + 1 == paths.size()) {
+            if (!recoverActiveSegment(store, paths[i])) {
+                return false;
+            }
+        } else {
+            cerr << "Segment " << paths[i] << " is not sealed but is not the newest segment" << endl;
+            return false;
+        }
+    }
+    if (store.activeFd < 0) {
+        uint64_t next = store.segments.empty() ? 0 : store.segments.back().firstIndex + store.segments.back().count;
+        if (store.options.readOnly) {
+            // Nothing follows the sealed segments; a reader has no segment to start
+            store.activeFirstIndex = next;
+            store.activeDictionary = make_shared<SegmentDictionary>();
+        } else if (!openNewSegment(store, next)) {
+            return false;
+        }
+    }
+    if (options.durability == Durability::TimeBounded && !options.readOnly) {
+        store.flusher = thread(storeFlusherLoop, &store);
+    }
+    return true;
+}
+
+// Function to append one block to the store, applying the configured durability policy
+bool appendBlock(ChainStore& store, const StageBlock& block, string_view batchBody) {
+    thread_local string record; // Reused by every block this thread appends
+    encodeBlockRecord(record, block, batchBody);
+    return appendBlockRecord(store, record);
+}
+
+// Function to append an already encoded record body (content followed by hash) to the store
+bool appendBlockRecord(ChainStore& store, string_view record) {
+    MetricTimer timer(METRIC_STORE_APPEND);
+    lock_guard<mutex> guard(store.lock);
+    if (store.options.readOnly) {
+        return false;
+    }
+    // Rotate before the record and the footer it will need would push the segment past its size limit
+    // (the canonical size bounds the encoded one)
+    if (store.activeSize + 4 + record.size() + 4 * (store.activeOffsets.size() + 1) + store.activeDictionary->footerBytes +
+            7 * 7 * 4 + store.activeTimeIndex.size() + TIME_INDEX_ENTRY + SEGMENT_TRAILER > store.options.segmentSize &&
+        !store.activeOffsets.empty() && !rotateSegment(store)) {
+        return false;
+    }
+    thread_local string encoded;
+    string_view body = encodeStoredRecord(store, record, encoded, store.activeSize + 4) ? string_view(encoded) : record;
+    memcpy(store.lastHash.data(), record.data() + record.size() - 32, 32);
+    store.canonicalBytes += 4 + record.size();
+    store.storedBytes += 4 + body.size();
+    countMetric(COUNTER_STORE_BYTES, 4 + body.size());
+    uint32_t length = uint32_t(body.size());
+    uint8_t stage;
+    uint64_t timestamp;
+    if (storedRecordTime(record, stage, timestamp)) {
+        addToTimeIndex(store.activeTimeIndex, store.activeOffsets.size(), stage, timestamp);
+    }
+    store.activeOffsets.push_back(uint32_t(store.activeSize));
+    store.writeBuffer.append(reinterpret_cast<const char*>(&length), 4);
+    store.writeBuffer.append(body.data(), body.size());
+    store.activeSize += 4 + body.size();
+
+    if (store.options.durability == Durability::PerBlock) {
+        return syncStoreLocked(store);
+    }
+    // Batch and time-bounded modes only hand large chunks to the kernel
+    if (store.writeBuffer.size() >= 1024 * 1024) {
+        return flushWriteBuffer(store);
+    }
+    return true;
+}
+
+// Function to commit every block appended so far (the group-commit point for Durability::PerBatch)
+bool commitChainStore(ChainStore& store) {
+    lock_guard<mutex> guard(store.lock);
+    return syncStoreLocked(store);
+}
+
+// Function to count the blocks in the store
+uint64_t storeBlockCount(ChainStore& store) {
+    lock_guard<mutex> guard(store.lock);
+    return store.activeFirstIndex + store.activeOffsets.size();
+}
+
+// Function to read the record body of the block at a chain position (views into mapped segments when sealed)
+bool readStoreRecord(ChainStore& store, uint64_t index, string_view& record, string& scratch) {
+    MetricTimer timer(METRIC_STORE_READ);
+    lock_guard<mutex> guard(store.lock);
+    if (index >= store.activeFirstIndex) {
+        // Active segment: make sure the bytes reached the file, then read them back
+        uint64_t local = index - store.activeFirstIndex;
+        if (local >= store.activeOffsets.size() || !flushWriteBuffer(store)) {
+            return false;
+        }
+        // Read the previous record's stored hash along with the record, as an encoded record may leave it out
+        uint32_t offset = store.activeOffsets[local];
+        uint32_t before = local > 0 ? 32 : 0;
+        uint32_t length;
+        if (pread(store.activeFd, &length, 4, offset) != 4) {
+            return false;
+        }
+        string stored(before + length, '\0');
+        if (pread(store.activeFd, &stored[0], before, offset - before) != ssize_t(before) ||
+            pread(store.activeFd, &stored[before], length, offset + 4) != ssize_t(length)) {
+            return false;
+        }
+        char target[32];
+        auto storedHashBack = [&](uint64_t back) -> const char* {
+            return back != 0 && back <= local &&
+                   pread(store.activeFd, target, 32, store.activeOffsets[local - back + 1] - 32) == 32 ? target : nullptr;
+        };
+        record = expandStoredRecord(string_view(stored).substr(before), store.activeDictionary.get(),
+                                    before != 0 ? stored.data() : nullptr, storedHashBack, scratch);
+        if (record.data() == stored.data() + before) {
+            scratch.assign(record.data(), record.size()); // A canonical record must outlive the local buffer
+            record = scratch;
+        }
+        return !record.empty();
+    }
+
+    // Sealed segments: binary search on first chain position, then read straight from the mapping
+    auto it = upper_bound(store.segments.begin(), store.segments.end(), index,
+                          [](uint64_t value, const StoreSegment& segment) { return value < segment.firstIndex; });
+    if (it == store.segments.begin()) {
+        return false;
+    }
+    const StoreSegment& segment = *(it - 1);
+    uint64_t local = index - segment.firstIndex;
+    if (local >= segment.count) {
+        return false;
+    }
+    record = expandSegmentRecord(segment, local, scratch);
+    return !record.empty();
+}
+
+// Function to read and decode the block at a chain position
+bool readStoredBlock(ChainStore& store, uint64_t index, StageBlock& block) {
+    string_view record;
+    string scratch;
+    return readStoreRecord(store, index, record, scratch) && decodeBlockRecord(record, block);
+}
+
+// Function to sync and close a chain store, unmapping its sealed segments
+void closeChainStore(ChainStore& store) {
+    {
+        lock_guard<mutex> guard(store.lock);
+        store.closing = true;
+    }
+    store.wake.notify_all();
+    if (store.flusher.joinable()) {
+        store.flusher.join();
+    }
+    lock_guard<mutex> guard(store.lock);
+    if (store.activeFd >= 0) {
+        syncStoreLocked(store);
+        close(store.activeFd);
+        store.activeFd = -1;
+    }
+    for (StoreSegment& segment : store.segments) {
+        munmap(const_cast<char*>(segment.data), segment.size);
+    }
+    store.segments.clear();
+}
+
+// Function to continue ingestion where a reopened store left off: block numbering and the latest block of every stage
+void restoreIngestState(ChainStore& store, IngestState& state) {
+    uint64_t count = storeBlockCount(store);
+    if (count == 0) {
+        return;
+    }
+    auto remember = [&](uint64_t index) {
+        StageBlock block;
+        if (!readStoredBlock(store, index, block)) {
+            return;
+        }
+        rememberStageBlock(state, block);
+        uint64_t next = blockHeader(block).blockNumber + 1;
+        if (next > blockNumber.load()) {
+            blockNumber.store(next);
+        }
+    };
+    // The last seven blocks ahead of any trailing updates cover one block of every stage; of the updates,
+    // only the newest matters (it is the tip)
+    uint64_t end = count;
+    string scratch;
+    string_view record;
+    while (end > 0 && readStoreRecord(store, end - 1, record, scratch) && uint8_t(record[0]) == UPDATE_STAGE) {
+        end--;
+    }
+    for (uint64_t index = end > 7 ? end - 7 : 0; index < end; ++index) {
+        remember(index);
+    }
+    if (end < count) {
+        remember(count - 1);
+    }
+}
+
+// Function to open a consistent read-only view of every record in the store (sealed and active segments)
+bool openStoreReadView(ChainStore& store, StoreReadView& view) {
+    lock_guard<mutex> guard(store.lock);
+    if (!flushWriteBuffer(store)) {
+        return false;
+    }
+    view.parts = store.segments;
+    view.activeOffsets = store.activeOffsets;
+    view.activeTimeIndex = store.activeTimeIndex;
+    view.count = store.activeFirstIndex + store.activeOffsets.size();
+    if (!view.activeOffsets.empty()) {
+        if (!mapFile(store.activePath, view.activeMapping)) {
+            return false;
+        }
+        StoreSegment active;
+        active.path = store.activePath;
+        active.firstIndex = store.activeFirstIndex;
+        active.data = view.activeMapping.data;
+        active.size = view.activeMapping.size;
+        active.offsets = view.activeOffsets.data();
+        active.count = view.activeOffsets.size();
+        active.dictionary = copyDictionary(*store.activeDictionary);
+        active.timeIndex = view.activeTimeIndex.data();
+        timeIndexBounds(active.timeIndex, view.activeTimeIndex.size() / TIME_INDEX_ENTRY, active.oldestTimestamp, active.newestTimestamp);
+        view.parts.push_back(active);
+    }
+    return true;
+}
+
+// Function to release the active-segment mapping held by a read view
+void closeStoreReadView(StoreReadView& view) {
+    unmapFile(view.activeMapping);
+    view.parts.clear();
+    view.activeOffsets.clear();
+    view.activeTimeIndex.clear();
+    view.count = 0;
+}
+
+// Function to get the canonical record at a chain position from a read view (no locking; encoded records are
+// expanded into scratch, which the result may point into)
+string_view storeViewRecord(const StoreReadView& view, uint64_t index, string& scratch) {
+    auto it = upper_bound(view.parts.begin(), view.parts.end(), index,
+                          [](uint64_t value, const StoreSegment& segment) { return value < segment.firstIndex; });
+    if (it == view.parts.begin() || index - (it - 1)->firstIndex >= (it - 1)->count) {
+        return string_view();
+    }
+    return expandSegmentRecord(*(it - 1), index - (it - 1)->firstIndex, scratch);
+}
+
+// Function to visit, in chain order, every block of a read view whose timestamp lies in the query's window and whose
+// stage it selects. Segments whose time bounds miss the window are skipped whole, then every index entry rules its
+// TIME_INDEX_STRIDE records in or out, so only the records of overlapping groups are read, and only their stage and
+// timestamp. visit(position, stage, timestamp) returns false to stop; returns the number of blocks visited
+uint64_t scanTimeRange(const StoreReadView& view, const TimeRangeQuery& query, TimeRangeStats& stats,
+                       const function<bool(uint64_t, uint8_t, uint64_t)>& visit) {
+    MetricTimer timer(METRIC_STORE_SCAN);
+    uint32_t wanted = query.stage == 0 ? UINT32_MAX : 1u << (query.stage % 32);
+    uint64_t visited = 0;
+    bool stopped = false;
+    for (const StoreSegment& part : view.parts) {
+        if (stopped) {
+            break;
+        }
+        if (part.count == 0 || part.timeIndex == nullptr || part.newestTimestamp < query.fromTimestamp ||
+            part.oldestTimestamp > query.toTimestamp) {
+            stats.segmentsSkipped++;
+            continue;
+        }
+        stats.segmentsRead++;
+        uint64_t entries = (part.count + TIME_INDEX_STRIDE - 1) / TIME_INDEX_STRIDE;
+        ByteReader index{part.timeIndex, part.timeIndex + entries * TIME_INDEX_ENTRY};
+        stats.bytesRead += entries * TIME_INDEX_ENTRY;
+        for (uint64_t first = 0; first < part.count && !stopped; first += TIME_INDEX_STRIDE) {
+            uint64_t oldest = readUint64(index), newest = readUint64(index);
+            uint32_t stages = readUint32(index);
+            if (newest < query.fromTimestamp || oldest > query.toTimestamp || (stages & wanted) == 0) {
+                stats.groupsSkipped++;
+                continue;
+            }
+            stats.groupsRead++;
+            uint64_t end = min(part.count, first + TIME_INDEX_STRIDE);
+            for (uint64_t local = first; local < end; ++local) {
+                uint32_t length;
+                memcpy(&length, part.data + part.offsets[local], 4);
+                uint8_t stage;
+                uint64_t timestamp;
+                stats.recordsRead++;
+                stats.bytesRead += 4 + length;
+                if (!storedRecordTime(string_view(part.data + part.offsets[local] + 4, length), stage, timestamp) ||
+                    timestamp < query.fromTimestamp || timestamp > query.toTimestamp || (wanted & (1u << stage)) == 0) {
+                    continue;
+                }
+                visited++;
+                if (!visit(part.firstIndex + local, stage, timestamp)) {
+                    stopped = true;
+                    break;
+                }
+            }
+        }
+    }
+    stats.blocksMatched += visited;
+    return visited;
+}
+
+// Function to split a transaction's canonical payload into its signed fields, its sender and its signature field;
+// false if the payload is malformed
+static bool splitTransactionPayload(string_view payload, string_view& fields, string_view& sender, string_view& signature) {
+    ByteReader reader{payload.data(), payload.data() + payload.size()};
+    for (int field = 0; field < 5; ++field) {
+        uint32_t length = readUint32(reader);
+        const char* bytes = readBytes(reader, length);
+        if (field == 2 && bytes != nullptr) {
+            sender = string_view(bytes, length);
+        }
+    }
+    readBytes(reader, 8);
+    readBytes(reader, readUint32(reader));
+    fields = string_view(payload.data(), size_t(reader.position - payload.data()));
+    uint32_t length = readUint32(reader);
+    const char* bytes = readBytes(reader, length);
+    signature = bytes != nullptr ? string_view(bytes, length) : string_view();
+    return reader.ok && reader.position == reader.end;
+}
+
+// Function to check one range of the chain: recompute every hash (eight at a time) and check every link,
+// including the link from the range's first block back to the block before it. Transaction signatures are
+// collected and checked SIGNATURE_BATCH_SIZE at a time
+static void verifyRange(const StoreReadView& view, uint64_t begin, uint64_t end, atomic<uint64_t>& firstBad, VerifyReport& local) {
+    const uint8_t* data[8];
+    size_t lengths[8];
+    uint8_t digests[8 * 32];
+    string_view records[8];
+    string expanded[8], previousScratch, targetScratch; // Canonical forms of encoded records
+    uint8_t batchContent[8][BATCH_BODY_OFFSET + BLOCK_FOOTER_SIZE]; // Hashed part of a batch block: its record minus the transactions
+    vector<string_view> leaves;
+    MerkleTree tree;
+    BlockHash zeroHash{};
+
+    // Records are only valid until the next read, so each signature and its message are copied out:
+    // [public key, signature, context and signed fields] back to back, ending at signedEnds[i]
+    string signedBytes;
+    vector<size_t> signedEnds;
+    vector<uint64_t> signedPositions;
+    vector<SignatureCheck> checks;
+    vector<char> valid;
+    auto recordFailure = [&](uint64_t position, const char* reason) {
+        // Keep only the earliest failure across all threads
+        uint64_t current = firstBad.load();
+        while (position < current && !firstBad.compare_exchange_weak(current, position)) {
+        }
+        if (position < local.firstBadIndex) {
+            local.firstBadIndex = position;
+            local.reason = reason;
+        }
+    };
+    auto checkSignatures = [&]() {
+        checks.resize(signedEnds.size());
+        for (size_t i = 0, start = 0; i < checks.size(); start = signedEnds[i++]) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(signedBytes.data() + start);
+            checks[i] = SignatureCheck{bytes, bytes + 32, string_view(signedBytes).substr(start + 96, signedEnds[i] - start - 96)};
+        }
+        valid.resize(checks.size());
+        ed25519VerifyBatch(checks.data(), checks.size(), valid.data(), 1); // This range already has a core to itself
+        local.signaturesChecked += checks.size();
+        auto bad = find(valid.begin(), valid.end(), 0);
+        if (bad != valid.end()) {
+            recordFailure(signedPositions[size_t(bad - valid.begin())], "transaction signature does not verify");
+        }
+        signedBytes.clear();
+        signedEnds.clear();
+        signedPositions.clear();
+        return bad == valid.end();
+    };
+    // Queues the signature of one transaction payload; returns why the payload cannot pass (nullptr if it may)
+    auto collectSignature = [&](uint64_t position, string_view payload) -> const char* {
+        string_view fields, sender, signature;
+        if (!splitTransactionPayload(payload, fields, sender, signature)) {
+            return "transaction payload is malformed";
+        }
+        const SignerKey* key = findSignerKey(sender);
+        if (signature.empty()) {
+            return key == nullptr ? nullptr : "transaction of a sender with a registered key is unsigned";
+        }
+        if (signature.size() != TRANSACTION_SIGNATURE_SIZE) {
+            return "transaction signature field is malformed";
+        }
+        if (key != nullptr && memcmp(signature.data(), key->publicKey.data(), 32) != 0) {
+            return "transaction is signed with a key not registered for its sender";
+        }
+        // Without a registered key the signature only shows the transaction is unchanged, not who authorized it
+        local.signaturesUnregistered += key == nullptr;
+        signedBytes.append(signature.data(), signature.size());
+        signedBytes += TRANSACTION_SIGNING_CONTEXT;
+        signedBytes.append(fields.data(), fields.size());
+        signedEnds.push_back(signedBytes.size());
+        signedPositions.push_back(position);
+        return nullptr;
+    };
+
+    for (uint64_t index = begin; index < end && index < firstBad.load(memory_order_relaxed); index += 8) {
+        size_t lanes = size_t(min<uint64_t>(8, end - index));
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            records[lane] = storeViewRecord(view, index + lane, expanded[lane]);
+            data[lane] = reinterpret_cast<const uint8_t*>(records[lane].data());
+            lengths[lane] = records[lane].size() >= 32 ? records[lane].size() - 32 : 0;
+            if (batchHashedContent(records[lane], batchContent[lane])) {
+                data[lane] = batchContent[lane];
+                lengths[lane] = sizeof(batchContent[lane]);
+            }
+        }
+        sha256Batch(data, lengths, lanes, digests);
+
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint64_t position = index + lane;
+            string_view record = records[lane];
+            const char* reason = nullptr;
+            if (record.empty()) {
+                reason = "stored record does not decode";
+            } else if (record.size() < 1 + 8 + 8 + BLOCK_FOOTER_SIZE + 32) {
+                reason = "record is truncated";
+            } else if (memcmp(digests + 32 * lane, record.data() + record.size() - 32, 32) != 0) {
+                reason = "stored hash does not match the block content";
+            } else if (leadingZeroBits(digests + 32 * lane) <
+                       max(unsigned(uint8_t(record[record.size() - 32 - BLOCK_FOOTER_SIZE])), proofOfWork.difficulty)) {
+                // The hash must meet the difficulty the block claims, and no block may claim less than required
+                reason = "block hash does not meet the proof-of-work difficulty";
+            } else {
+                // The previous hash is the last field of the content, just before the stored hash
+                const char* previousHash = record.data() + record.size() - 64;
+                const char* expected;
+                if (position == 0) {
+                    expected = reinterpret_cast<const char*>(zeroHash.data());
+                } else {
+                    string_view previous = lane > 0 ? records[lane - 1] : storeViewRecord(view, position - 1, previousScratch);
+                    expected = previous.size() >= 32 ? previous.data() + previous.size() - 32 : nullptr;
+                }
+                if (expected == nullptr || memcmp(previousHash, expected, 32) != 0) {
+                    reason = "previous block hash does not match the preceding block";
+                }
+            }
+            if (reason == nullptr && uint8_t(record[0]) == TRANSACTION_BATCH_STAGE) {
+                // The hash only covers the Merkle root, so the stored transactions are checked against it
+                uint32_t count;
+                memcpy(&count, record.data() + 17, 4);
+                if (!batchRecordLeaves(record, leaves) || leaves.size() != count) {
+                    reason = "stored transactions of the batch are malformed";
+                } else {
+                    buildMerkleTree(leaves, tree, 1);
+                    if (memcmp(merkleRoot(tree).data(), record.data() + 21, 32) != 0) {
+                        reason = "stored transactions do not match the batch's Merkle root";
+                    }
+                }
+                for (size_t leaf = 0; leaf < leaves.size() && reason == nullptr; ++leaf) {
+                    reason = collectSignature(position, leaves[leaf]);
+                }
+            }
+            if (reason == nullptr && uint8_t(record[0]) == 7) {
+                reason = collectSignature(position, record.substr(17, record.size() - 17 - BLOCK_FOOTER_SIZE - 32));
+            }
+            if (reason == nullptr && uint8_t(record[0]) == UPDATE_STAGE) {
+                // The block upstreamOffset back must be the target: the stage and the hash the update names
+                uint32_t back;
+                memcpy(&back, record.data() + record.size() - 68, 4);
+                string_view target = back != 0 && back <= position ? storeViewRecord(view, position - back, targetScratch) : string_view();
+                if (record.size() < 17 + 32 + 2 + BLOCK_FOOTER_SIZE + 32 || target.size() < 32 || target[0] != record[17 + 32] ||
+                    memcmp(target.data() + target.size() - 32, record.data() + 17, 32) != 0) {
+                    reason = "update does not name the block its upstream link reaches";
+                }
+            }
+            if (reason != nullptr) {
+                checkSignatures(); // Signatures queued so far belong to earlier blocks
+                recordFailure(position, reason);
+                return;
+            }
+            local.blocksChecked++;
+            local.bytesChecked += record.size();
+        }
+        if (signedEnds.size() >= SIGNATURE_BATCH_SIZE && !checkSignatures()) {
+            return;
+        }
+    }
+    checkSignatures();
+}
+
+// Function to verify the whole chain in the store on all cores: every hash is recomputed from the block
+// content and every previousBlockHash is checked against its predecessor
+VerifyReport verifyChainStore(ChainStore& store, unsigned threadCount) {
+    MetricTimer timer(METRIC_VERIFY);
+    VerifyReport report;
+    auto start = chrono::steady_clock::now();
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        report.ok = false;
+        report.reason = "store could not be read";
+        return report;
+    }
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+
+    // Split the chain into one contiguous range per thread; ranges join at their boundaries
+    uint64_t count = view.count;
+    uint64_t rangeSize = (count + threadCount - 1) / max(1u, threadCount);
+    atomic<uint64_t> firstBad(UINT64_MAX);
+    vector<VerifyReport> partial(threadCount);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        uint64_t begin = min(count, t * rangeSize);
+        uint64_t end = min(count, begin + rangeSize);
+        if (begin < end) {
+            workers.emplace_back(verifyRange, cref(view), begin, end, ref(firstBad), ref(partial[t]));
+        }
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Merge the per-thread results
+    for (const VerifyReport& part : partial) {
+        report.blocksChecked += part.blocksChecked;
+        report.bytesChecked += part.bytesChecked;
+        report.signaturesChecked += part.signaturesChecked;
+        report.signaturesUnregistered += part.signaturesUnregistered;
+        if (part.firstBadIndex < report.firstBadIndex) {
+            report.firstBadIndex = part.firstBadIndex;
+            report.reason = part.reason;
+        }
+    }
+    report.ok = report.firstBadIndex == UINT64_MAX;
+    countMetric(COUNTER_BLOCKS_VERIFIED, report.blocksChecked);
+    if (!report.ok) {
+        string scratch;
+        string_view bad = storeViewRecord(view, report.firstBadIndex, scratch);
+        ByteReader reader{bad.data() + min<size_t>(1, bad.size()), bad.data() + bad.size()};
+        report.firstBadBlockNumber = readUint64(reader);
+    }
+    closeStoreReadView(view);
+
+    report.threads = unsigned(workers.size());
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+// Function to warn about signatures verify could only check against the key they carry (nothing if there are none)
+static void printUnregisteredSignatures(uint64_t count) {
+    if (count != 0) {
+        cout << ANSI_RED << "Warning          : " << count << " signature(s) of senders with no registered key; "
+             << "they prove the transactions are intact, not who sent them (verify with --keys)" << ANSI_RESET << endl;
+    }
+}
+
+// Function to print the result of a chain verification
+void printVerifyReport(const VerifyReport& report) {
+    cout << "\n===== Chain Verification =====\n" << endl;
+    cout << (report.ok ? ANSI_GREEN : ANSI_RED);
+    cout << "Result           : " << (report.ok ? "OK - every hash and link is valid" : "FAILED") << endl;
+    if (!report.ok) {
+        if (report.firstBadBlockNumber != 0) {
+            cout << "First bad block  : #" << report.firstBadBlockNumber << " (chain position " << report.firstBadIndex << ")" << endl;
+        } else {
+            cout << "First bad block  : chain position " << report.firstBadIndex << " (its number cannot be read)" << endl;
+        }
+        cout << "Reason           : " << report.reason << endl;
+    }
+    cout << ANSI_RESET;
+    double seconds = max(report.seconds, 1e-9);
+    cout << "Blocks checked   : " << report.blocksChecked << endl;
+    cout << "Signatures       : " << report.signaturesChecked << " checked in batches of up to " << SIGNATURE_BATCH_SIZE << endl;
+    printUnregisteredSignatures(report.signaturesUnregistered);
+    cout << "Threads          : " << report.threads << endl;
+    if (proofOfWork.difficulty != 0) {
+        cout << "Proof of work    : at least " << proofOfWork.difficulty << " leading zero bits required" << endl;
+    }
+    cout << "Elapsed          : " << fixed << setprecision(3) << report.seconds << " s" << endl;
+    cout << "Throughput       : " << setprecision(0) << report.blocksChecked / seconds << " blocks/s, "
+         << setprecision(1) << report.bytesChecked / seconds / (1024 * 1024) << " MiB/s" << endl;
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// Console title, short name, payload columns and description of every stage (index stage - 1)
+static const StageRenderInfo STAGE_RENDER_INFO[8] = {
+    {"\n===== Stage 1 : Supply =====\n", "Supply", 7,
+     {{"Supplier ID    : ", "supplierId", "", false},
+      {"Supplier Name  : ", "supplierName", "", false},
+      {"Supplier Item  : ", "supplierItem", "", false},
+      {"Location       : ", "location", "", false},
+      {"Branch         : ", "branch", "", false},
+      {"Quantity       : ", "quantity", "", true},
+      {"Price          : ", "price", "", true}},
+     "1. [Supply Stage Overview]    : Initial phase of car manufacturing, sourcing raw materials and components.\n"
+     "2. [Key Activities]           : Identifying reliable suppliers, negotiating contracts, monitoring inventory.\n"
+     "3. [Materials and Components] : Metals, plastics, rubber, glass, electronics, and specialized parts.\n"
+     "4. [Quality Control]          : Ensuring received materials meet standards through inspections.\n"
+     "5. [Supply Chain Management]  : Efficient management practices to minimize delays and optimize production.\n"
+     "6. [Supplier Relationships]   : Building strong relationships for reliable and sustainable supply chains.\n"},
+    {"===== Stage 2 : Press =====\n", "Press", 6,
+     {{"Press ID            : ", "pressId", "", false},
+      {"Press Location      : ", "pressLocation", "", false},
+      {"Press Details       : ", "pressDetails", "", false},
+      {"Press Type          : ", "pressType", "", false},
+      {"Press Manufacturer  : ", "pressManufacturer", "", false},
+      {"Press Capacity      : ", "pressCapacity", " tons", true}},
+     "1. [Press Stage Overview]         : Shaping metal components using hydraulic or mechanical presses.\n"
+     "2. [Press Types]                  : Hydraulic press, mechanical press, stamping press, forging press.\n"
+     "3. [Press Capacity]               : Indicates the maximum force exerted by the press, measured in tons.\n"
+     "4. [Press Manufacturer]           : Company responsible for designing, manufacturing, and supplying the press.\n"
+     "5. [Quality Assurance]            : Ensuring precise and consistent shaping of metal parts for assembly.\n"
+     "6. [Efficiency and Productivity]  : Optimization of press operations for higher output and reduced cycle times.\n"},
+    {"===== Stage 3 : Welding =====\n", "Welding", 6,
+     {{"Welding ID           : ", "weldingId", "", false},
+      {"Welding Location     : ", "weldingLocation", "", false},
+      {"Welding Details      : ", "weldingDetails", "", false},
+      {"Welding Type         : ", "weldingType", "", false},
+      {"Welding Material     : ", "weldingMaterial", "", false},
+      {"Welding Temperature  : ", "weldingTemperature", " Celsius", true}},
+     "1. [Welding Stage Overview]   : Joining metal components using various welding techniques and materials.\n"
+     "2. [Welding Types]            : MIG (Metal Inert Gas), TIG (Tungsten Inert Gas), Arc welding, Spot welding.\n"
+     "3. [Welding Materials]        : Metals, alloys, plastics, composites.\n"
+     "4. [Welding Temperature]      : Temperature at which the welding process occurs, measured in Celsius.\n"
+     "5. [Quality Assurance]        : Ensuring structural integrity and proper bonding of welded components.\n"
+     "6. [Efficiency and Precision] : Optimization of welding parameters for consistent and high-quality welds.\n"},
+    {"===== Stage 4 : Paint =====\n", "Paint", 6,
+     {{"Painting ID          : ", "paintingId", "", false},
+      {"Painting Location    : ", "paintingLocation", "", false},
+      {"Painting Details     : ", "paintingDetails", "", false},
+      {"Painting Color       : ", "paintingColor", "", false},
+      {"Painting Type        : ", "paintingType", "", false},
+      {"Painting Thickness   : ", "paintingThickness", " mm", true}},
+     "1. [Painting Stage Overview]      : Applying protective and decorative coatings to car bodies.\n"
+     "2. [Painting Process]             : Surface preparation, primer application, base coat, clear coat.\n"
+     "3. [Painting Color]               : Choice of colors for aesthetics and brand identity.\n"
+     "4. [Painting Type]                : Solid, metallic, pearlescent, matte, gloss.\n"
+     "5. [Painting Thickness]           : Thickness of the paint layer applied, measured in millimeters.\n"
+     "6. [Quality Assurance]            : Ensuring uniformity, adhesion, and durability of the paint finish.\n"
+     "7. [Environmental Considerations] : Compliance with environmental regulations regarding paint application and waste disposal.\n"},
+    {"===== Stage 5 : Assembly =====\n", "Assembly", 6,
+     {{"Assembly ID        : ", "assemblyId", "", false},
+      {"Assembly Location  : ", "assemblyLocation", "", false},
+      {"Assembly Details   : ", "assemblyDetails", "", false},
+      {"Assembly Type      : ", "assemblyType", "", false},
+      {"Number of Parts    : ", "numberOfParts", "", true},
+      {"Assembly Weight    : ", "assemblyWeight", " kg", true}},
+     "1. [Assembly Stage Overview]  : Combining various components and subsystems to form complete vehicles.\n"
+     "2. [Assembly Process]         : Sequential assembly line process, with each station performing specific tasks.\n"
+     "3. [Assembly Type]            : Body assembly, chassis assembly, powertrain assembly, final assembly.\n"
+     "4. [Number of Parts]          : Total number of components required to assemble a vehicle.\n"
+     "5. [Assembly Weight]          : Total weight of the assembled vehicle, including all components.\n"
+     "6. [Quality Assurance]        : Ensuring fit, finish, and functionality of assembled vehicles.\n"
+     "7. [Testing]                  : Conducting final inspections and functional tests before vehicles are shipped.\n"},
+    {"===== Stage 6 : Shipping =====\n", "Shipping", 6,
+     {{"Shipping ID            : ", "shippingId", "", false},
+      {"Shipping Destination   : ", "shippingDestination", "", false},
+      {"Shipping Details       : ", "shippingDetails", "", false},
+      {"Shipping Type          : ", "shippingType", "", false},
+      {"Carrier Name           : ", "carrierName", "", false},
+      {"Shipping Status        : ", "shippingStatus", "", false}},
+     "1. [Shipping Stage Overview]  : Transporting assembled vehicles from manufacturing plants to distribution centers or dealerships.\n"
+     "2. [Shipping Process]         : Coordinating logistics, loading vehicles onto carriers, and delivering them to their destinations.\n"
+     "3. [Shipping Type]            : Different modes of transportation such as road, rail, sea, or air shipping.\n"
+     "4. [Carrier Name]             : Name of the shipping company or carrier responsible for transporting vehicles.\n"
+     "5. [Shipping Status]          : Tracking the status of shipments, including in transit, delivered, or awaiting delivery.\n"},
+    {"===== Stage 7 : Transaction =====\n", "Transaction", 7,
+     {{"Transaction ID      : ", "transactionId", "", false},
+      {"Transaction Type    : ", "transactionType", "", false},
+      {"Transaction Amount  : ", "transactionAmount", "", true},
+      {"Sender              : ", "sender", "", false},
+      {"Receiver            : ", "receiver", "", false},
+      {"Currency            : ", "currency", "", false},
+      {"Transaction Status  : ", "transactionStatus", "", false}},
+     "1. [Transaction Stage Overview] : Finalizing the purchase transaction for vehicles between entities involved, such as manufacturers, dealerships, or customers.\n"
+     "2. Transaction Type]            : Types of transactions include purchases, sales, payments, or transfers of ownership.\n"
+     "3. [Transaction Amount]         : Monetary value involved in the transaction, typically denoted in the specified currency.\n"
+     "4. [Sender and Receiver]        : Identifying parties involved in the transaction, indicating the entity sending or receiving the payment or vehicle.\n"
+     "5. [Currency]                   : The currency used for the transaction, such as USD (US Dollar), EUR (Euro), or any other applicable currency.\n"
+     "6. [Transaction Status]         : Indicating the status of the transaction, whether it's completed, pending, or failed.\n"},
+    {"===== Transaction Batch =====\n", "TransactionBatch", 2,
+     {{"Transactions        : ", "transactionCount", "", true},
+      {"Merkle Root         : ", "merkleRoot", "", false}},
+     "1. [Transaction Batch Overview] : Commits many transactions at once; only the Merkle root of their payloads is hashed into the chain.\n"
+     "2. [Merkle Root]                : Any single transaction can be proven part of the batch with one hash per tree level (look it up by its ID).\n"}
+};
+
+// Console title, short name and description of an update block; its changed columns are the target stage's
+static const StageRenderInfo UPDATE_RENDER_INFO = {
+    "===== Update =====\n", "Update", 1,
+    {{"Target Block Hash   : ", "targetHash", "", false}},
+    "1. [Update Overview]  : Records a later change to some fields of an earlier block, which itself stays unchanged.\n"
+    "2. [Target Block]     : The block whose fields change; its upstream link reaches it, so the change is covered by the chain.\n"};
+
+// Function to format a number into a scratch buffer without allocating
+template <typename Number, size_t Size>
+static string_view numberText(Number value, char (&scratch)[Size]) {
+    to_chars_result result = to_chars(scratch, scratch + sizeof(scratch), value);
+    return string_view(scratch, size_t(result.ptr - scratch));
+}
+
+// Function to format fixed-point Money into a scratch buffer
+template <size_t Size>
+static string_view moneyText(Money value, char (&scratch)[Size]) {
+    string text = formatMoney(value);
+    size_t length = min(text.size(), sizeof(scratch));
+    memcpy(scratch, text.data(), length);
+    return string_view(scratch, length);
+}
+
+// Function to collect the payload of a block as text, in the order of its stage's render columns
+static void stageFieldValues(const StageBlock& block, string_view (&values)[7], char (&scratch)[7][64]) {
+    switch (block.stage) {
+        case 1: {
+            const auto& b = block.supplier;
+            values[0] = lookupString(b.supplierId);
+            values[1] = lookupString(b.supplierName);
+            values[2] = lookupString(b.supplierItem);
+            values[3] = lookupString(b.location);
+            values[4] = lookupString(b.branch);
+            values[5] = numberText(b.quantity, scratch[5]);
+            values[6] = moneyText(b.price, scratch[6]);
+            break;
+        }
+        case 2: {
+            const auto& b = block.press;
+            values[0] = lookupString(b.pressId);
+            values[1] = lookupString(b.pressLocation);
+            values[2] = lookupString(b.pressDetails);
+            values[3] = lookupString(b.pressType);
+            values[4] = lookupString(b.pressManufacturer);
+            values[5] = numberText(b.pressCapacity, scratch[5]);
+            break;
+        }
+        case 3: {
+            const auto& b = block.welding;
+            values[0] = lookupString(b.weldingId);
+            values[1] = lookupString(b.weldingLocation);
+            values[2] = lookupString(b.weldingDetails);
+            values[3] = lookupString(b.weldingType);
+            values[4] = lookupString(b.weldingMaterial);
+            values[5] = numberText(b.weldingTemperature, scratch[5]);
+            break;
+        }
+        case 4: {
+            const auto& b = block.painting;
+            values[0] = lookupString(b.paintingId);
+            values[1] = lookupString(b.paintingLocation);
+            values[2] = lookupString(b.paintingDetails);
+            values[3] = lookupString(b.paintingColor);
+            values[4] = lookupString(b.paintingType);
+            values[5] = numberText(b.paintingThickness, scratch[5]);
+            break;
+        }
+        case 5: {
+            const auto& b = block.assembly;
+            values[0] = lookupString(b.assemblyId);
+            values[1] = lookupString(b.assemblyLocation);
+            values[2] = lookupString(b.assemblyDetails);
+            values[3] = lookupString(b.assemblyType);
+            values[4] = numberText(b.numberOfParts, scratch[4]);
+            values[5] = numberText(b.assemblyWeight, scratch[5]);
+            break;
+        }
+        case 6: {
+            const auto& b = block.shipping;
+            values[0] = lookupString(b.shippingId);
+            values[1] = lookupString(b.shippingDestination);
+            values[2] = lookupString(b.shippingDetails);
+            values[3] = lookupString(b.shippingType);
+            values[4] = lookupString(b.carrierName);
+            values[5] = lookupString(b.shippingStatus);
+            break;
+        }
+        case 7: {
+            const auto& b = block.transaction;
+            values[0] = lookupString(b.transactionId);
+            values[1] = lookupString(b.transactionType);
+            values[2] = moneyText(b.transactionAmount, scratch[2]);
+            values[3] = lookupString(b.sender);
+            values[4] = lookupString(b.receiver);
+            values[5] = lookupString(b.currency);
+            values[6] = lookupString(b.transactionStatus);
+            break;
+        }
+        case TRANSACTION_BATCH_STAGE: {
+            const auto& b = block.batch;
+            static const char hexDigits[] = "0123456789abcdef";
+            values[0] = numberText(b.transactionCount, scratch[0]);
+            for (size_t i = 0; i < b.merkleRoot.size(); ++i) {
+                scratch[1][2 * i] = hexDigits[b.merkleRoot[i] >> 4];
+                scratch[1][2 * i + 1] = hexDigits[b.merkleRoot[i] & 0x0f];
+            }
+            values[1] = string_view(scratch[1], 64);
+            break;
+        }
+        case UPDATE_STAGE: {
+            const auto& b = block.update;
+            static const char hexDigits[] = "0123456789abcdef";
+            for (size_t i = 0; i < b.targetHash.size(); ++i) {
+                scratch[0][2 * i] = hexDigits[b.targetHash[i] >> 4];
+                scratch[0][2 * i + 1] = hexDigits[b.targetHash[i] & 0x0f];
+            }
+            values[0] = string_view(scratch[0], 64);
+            for (uint8_t i = 0; i < b.fieldCount; ++i) {
+                values[1 + i] = lookupString(b.values[i]);
+            }
+            break;
+        }
+    }
+}
+
+// Function to parse an output format name (console, plain, jsonl, csv)
+bool parseRenderMode(string_view name, RenderMode& mode) {
+    if (name == "console") mode = RenderMode::Console;
+    else if (name == "plain") mode = RenderMode::Plain;
+    else if (name == "jsonl" || name == "json") mode = RenderMode::JsonLines;
+    else if (name == "csv") mode = RenderMode::Csv;
+    else return false;
+    return true;
+}
+
+// Function to append text as a JSON string literal
+static void appendJsonString(string& out, string_view text) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (uint8_t(c) < 0x20) {
+            out += "\\u00";
+            out.push_back(hexDigits[uint8_t(c) >> 4]);
+            out.push_back(hexDigits[c & 0x0f]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+// Function to append text as a CSV field, quoting it only when needed
+static void appendCsvField(string& out, string_view text) {
+    if (text.find_first_of(",\"\r\n") == string_view::npos) {
+        out.append(text.data(), text.size());
+        return;
+    }
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// Function to append text as a tab-separated field (tabs and line breaks become spaces)
+static void appendPlainField(string& out, string_view text) {
+    for (char c : text) {
+        out.push_back(c == '\t' || c == '\n' || c == '\r' ? ' ' : c);
+    }
+}
+
+// Function to append raw bytes as hexadecimal text without a temporary string
+static void appendBytesHex(string& out, string_view bytes) {
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t at = out.size();
+    out.resize(at + bytes.size() * 2);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        out[at + 2 * i] = hexDigits[uint8_t(bytes[i]) >> 4];
+        out[at + 2 * i + 1] = hexDigits[uint8_t(bytes[i]) & 0x0f];
+    }
+}
+
+// Function to append a block hash as hexadecimal text without a temporary string
+static void appendHashHex(string& out, const BlockHash& hash) {
+    appendBytesHex(out, string_view(reinterpret_cast<const char*>(hash.data()), hash.size()));
+}
+
+// Function to format a block into the renderer's buffer, writing it out when the buffer is full
+void renderBlock(Renderer& renderer, const StageBlock& block) {
+    // An update shows the target hash, then each changed column under its target stage's label
+    StageRenderInfo updateInfo;
+    if (block.stage == UPDATE_STAGE) {
+        updateInfo = UPDATE_RENDER_INFO;
+        for (uint8_t i = 0; i < block.update.fieldCount; ++i) {
+            updateInfo.columns[updateInfo.columnCount++] = STAGE_RENDER_INFO[block.update.targetStage - 1].columns[block.update.columns[i]];
+        }
+    }
+    const StageRenderInfo& info = block.stage == UPDATE_STAGE ? updateInfo : STAGE_RENDER_INFO[(block.stage - 1) % 8];
+    const BlockHeader& header = blockHeader(block);
+    string_view values[7];
+    char scratch[7][64];
+    stageFieldValues(block, values, scratch);
+    char number[32], timestamp[32];
+    string_view blockNumberText = numberText(header.blockNumber, number);
+    string& out = renderer.buffer;
+    // A signed transaction also shows its signer's public key and the signature (not in CSV, whose columns are fixed)
+    string_view signature = block.stage == 7 ? lookupString(block.transaction.signature) : string_view();
+    string_view signerKey = signature.substr(0, min<size_t>(32, signature.size()));
+    signature = signature.substr(signerKey.size());
+
+    switch (renderer.mode) {
+        case RenderMode::Console: {
+            static const string rule(183, '-');
+            out += info.title;
+            out += "\n";
+            out += ANSI_GREEN;
+            out += rule + "\n";
+            out += "|     Block Number     |                         Current Block Hash                         |                         Previous Block Hash                         |     Timestamp     |\n";
+            out += rule + "\n";
+            out += "|          ";
+            out += blockNumberText;
+            out += "           |  ";
+            appendHashHex(out, header.currentBlockHash);
+            out += "  |   ";
+            appendHashHex(out, header.previousBlockHash);
+            out += "  | ";
+            appendTimestamp(out, header.timestamp, false);
+            out += " |\n";
+            out += rule + "\n\n";
+            out += ANSI_RESET;
+            for (unsigned i = 0; i < info.columnCount; ++i) {
+                out += info.columns[i].label;
+                out += values[i];
+                out += info.columns[i].unit;
+                out += "\n";
+            }
+            if (!signerKey.empty()) {
+                out += "Signer Key          : ";
+                appendBytesHex(out, signerKey);
+                out += "\nSignature           : ";
+                appendBytesHex(out, signature);
+                out += "\n";
+            }
+            out += "\n";
+            if (!renderer.describeOnce || !renderer.described[block.stage]) {
+                out += ANSI_BLUE;
+                out += info.description;
+                out += "\n\n";
+                out += ANSI_RESET;
+                renderer.described[block.stage] = true;
+            }
+            break;
+        }
+        case RenderMode::Plain:
+            out += blockNumberText;
+            out += '\t';
+            out += info.name;
+            out += '\t';
+            appendTimestamp(out, header.timestamp, true);
+            out += '\t';
+            appendHashHex(out, header.currentBlockHash);
+            out += '\t';
+            appendHashHex(out, header.previousBlockHash);
+            for (unsigned i = 0; i < info.columnCount; ++i) {
+                out += '\t';
+                if (block.stage == UPDATE_STAGE && i > 0) {
+                    // Positional fields would not say which column changed, so they read like an UPDATE row
+                    out += info.columns[i].key;
+                    out += '=';
+                }
+                appendPlainField(out, values[i]);
+            }
+            if (!signerKey.empty()) {
+                out += "\tsignerKey=";
+                appendBytesHex(out, signerKey);
+                out += "\tsignature=";
+                appendBytesHex(out, signature);
+            }
+            out += '\n';
+            break;
+        case RenderMode::JsonLines:
+            out += "{\"blockNumber\":";
+            out += blockNumberText;
+            out += ",\"stage\":\"";
+            out += info.name;
+            out += "\",\"timestamp\":";
+            out += numberText(header.timestamp, timestamp);
+            out += ",\"currentBlockHash\":\"";
+            appendHashHex(out, header.currentBlockHash);
+            out += "\",\"previousBlockHash\":\"";
+            appendHashHex(out, header.previousBlockHash);
+            out += "\"";
+            for (unsigned i = 0; i < info.columnCount; ++i) {
+                out += ",\"";
+                out += info.columns[i].key;
+                out += "\":";
+                if (info.columns[i].numeric) {
+                    // JSON has no NaN or infinity
+                    out += values[i].find_first_of("ni") == string_view::npos ? values[i] : string_view("null");
+                } else {
+                    appendJsonString(out, values[i]);
+                }
+            }
+            if (!signerKey.empty()) {
+                out += ",\"signerKey\":\"";
+                appendBytesHex(out, signerKey);
+                out += "\",\"signature\":\"";
+                appendBytesHex(out, signature);
+                out += "\"";
+            }
+            out += "}\n";
+            break;
+        case RenderMode::Csv:
+            // Stages have different columns, so payload columns are positional (see STAGE_RENDER_INFO for their names)
+            if (!renderer.headerWritten) {
+                out += "blockNumber,stage,timestamp,currentBlockHash,previousBlockHash,field1,field2,field3,field4,field5,field6,field7\n";
+                renderer.headerWritten = true;
+            }
+            out += blockNumberText;
+            out += ',';
+            out += info.name;
+            out += ',';
+            appendTimestamp(out, header.timestamp, true);
+            out += ',';
+            appendHashHex(out, header.currentBlockHash);
+            out += ',';
+            appendHashHex(out, header.previousBlockHash);
+            for (unsigned i = 0; i < 7; ++i) {
+                out += ',';
+                if (block.stage == UPDATE_STAGE && i > 0 && i < info.columnCount) {
+                    appendCsvField(out, string(info.columns[i].key) + "=" + string(values[i]));
+                } else if (i < info.columnCount) {
+                    appendCsvField(out, values[i]);
+                }
+            }
+            out += '\n';
+            break;
+    }
+    if (out.size() >= renderer.flushSize) {
+        flushRenderer(renderer);
+    }
+}
+
+// Function to write out everything the renderer has buffered (one large write instead of a flush per line)
+bool flushRenderer(Renderer& renderer) {
+    if (renderer.fd == STDOUT_FILENO) {
+        cout.flush(); // Keep ordering with text already sent through cout
+    }
+    if (!renderer.buffer.empty() && !renderer.failed) {
+        MetricTimer timer(METRIC_RENDER_FLUSH);
+        renderer.failed = !writeAll(renderer.fd, renderer.buffer.data(), renderer.buffer.size());
+        countMetric(COUNTER_RENDER_BYTES, renderer.buffer.size());
+    }
+    renderer.buffer.clear(); // Keeps its capacity for the next blocks
+    return !renderer.failed;
+}
+
+// Function to render every block of the store in chain order; returns the number of blocks rendered
+uint64_t renderStoredChain(ChainStore& store, Renderer& renderer) {
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        return 0;
+    }
+    uint64_t rendered = 0;
+    StageBlock block;
+    string scratch;
+    for (uint64_t position = 0; position < view.count && !renderer.failed; ++position) {
+        if (decodeBlockRecord(storeViewRecord(view, position, scratch), block)) {
+            renderBlock(renderer, block);
+            rendered++;
+        }
+    }
+    closeStoreReadView(view);
+    flushRenderer(renderer);
+    return rendered;
+}
+
+// Function to render the stored blocks inside a time window in chain order, reading only what the time index
+// cannot rule out; returns the number of blocks rendered
+uint64_t renderStoredRange(ChainStore& store, const TimeRangeQuery& query, Renderer& renderer, TimeRangeStats& stats) {
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        return 0;
+    }
+    uint64_t rendered = 0;
+    StageBlock block;
+    string scratch;
+    scanTimeRange(view, query, stats, [&](uint64_t position, uint8_t, uint64_t) {
+        if (decodeBlockRecord(storeViewRecord(view, position, scratch), block)) {
+            renderBlock(renderer, block);
+            rendered++;
+        }
+        return !renderer.failed;
+    });
+    closeStoreReadView(view);
+    flushRenderer(renderer);
+    return rendered;
+}
+
+// Function to print a batched transaction with its inclusion proof and check the proof against the batch header
+void printTransactionProof(const TransactionBatchBlock& block, const TransactionBlockchain& transaction, const MerkleProof& proof) {
+    const StageRenderInfo& info = STAGE_RENDER_INFO[6];
+    string_view values[7];
+    char scratch[7][64];
+    stageFieldValues(toStageBlock(transaction), values, scratch);
+    string out = "===== Inclusion proof in block #" + to_string(block.header.blockNumber) + " =====\n\n";
+    for (unsigned i = 0; i < info.columnCount; ++i) {
+        out += info.columns[i].label;
+        out += values[i];
+        out += "\n";
+    }
+    out += "Leaf                : " + to_string(proof.leafIndex + 1) + " of " + to_string(proof.leafCount) + "\n";
+    out += "Proof size          : " + to_string(proof.siblings.size()) + " hashes (" + to_string(proof.siblings.size() * 32) + " bytes)\n";
+    for (const BlockHash& sibling : proof.siblings) {
+        out += "                      ";
+        appendHashHex(out, sibling);
+        out += "\n";
+    }
+    bool verified = verifyTransactionInclusion(block, transaction, proof);
+    out += verified ? ANSI_GREEN : ANSI_RED;
+    out += verified ? "Proof verified against the block header\n" : "Proof does NOT match the block header\n";
+    out += ANSI_RESET;
+    cout << out << endl;
+}
+
+// Function to store a hash in the tip ring slot of a block number
+static void storeChainTip(SharedChain& chain, uint64_t number, const BlockHash& hash) {
+    atomic<uint64_t>* slot = chain.tipRing[number % CHAIN_TIP_RING];
+    for (int word = 0; word < 4; ++word) {
+        uint64_t value;
+        memcpy(&value, hash.data() + 8 * word, 8);
+        slot[word].store(value, memory_order_relaxed);
+    }
+}
+
+// Function to load the hash in the tip ring slot of a block number
+static void loadChainTip(const SharedChain& chain, uint64_t number, BlockHash& hash) {
+    const atomic<uint64_t>* slot = chain.tipRing[number % CHAIN_TIP_RING];
+    for (int word = 0; word < 4; ++word) {
+        uint64_t value = slot[word].load(memory_order_relaxed);
+        memcpy(hash.data() + 8 * word, &value, 8);
+    }
+}
+
+// Function to start a shared chain after the given tip block (nullptr for an empty chain)
+void initSharedChain(SharedChain& chain, ChainStore* store, const BlockHeader* tip) {
+    BlockHash hash{};
+    uint64_t number = 0;
+    if (tip != nullptr) {
+        hash = tip->currentBlockHash;
+        number = tip->blockNumber;
+    }
+    storeChainTip(chain, number, hash);
+    chain.store = store;
+    chain.failed.store(false);
+    chain.nextNumber.store(number + 1);
+    chain.publishedNumber.store(number, memory_order_release);
+}
+
+// Function to tell the core a spin-wait is in progress (PAUSE on x86, a yield of the thread elsewhere)
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    this_thread::yield();
+#endif
+}
+
+// Function to number, link, hash and publish a block on a shared chain; safe to call from many threads.
+// upstreamNumber is the vehicle's previous-stage block (0 for a supplier block); batchBody holds the encoded
+// transactions of a batch block, which go to the store with the block but not into its hash.
+// The block's ticket fixes its number up front, so everything but the 32-byte previous hash at the end of
+// the content is hashed concurrently (sha256Begin); only the final compression, the store append and the
+// tip update run in ticket order, handed from thread to thread through publishedNumber without a lock
+bool appendToChain(SharedChain& chain, StageBlock& block, uint64_t upstreamNumber, string_view batchBody) {
+    MetricTimer timer(METRIC_LINK);
+    BlockHeader& header = block.supplier.header; // Every stage struct starts with its header
+    header.blockNumber = chain.nextNumber.fetch_add(1, memory_order_relaxed);
+    header.timestamp = generateTimestamp();
+    header.upstreamOffset = upstreamNumber != 0 ? uint32_t(header.blockNumber - upstreamNumber) : 0;
+    header.difficulty = uint8_t(proofOfWork.difficulty);
+    header.nonce = 0;
+    header.previousBlockHash.fill(0);
+    thread_local string record; // Reused by every block this thread appends
+    record.clear();
+    appendBlockContent(record, block);
+    size_t linkOffset = record.size() - header.previousBlockHash.size();
+    Sha256Midstate midstate;
+    if (header.difficulty == 0) {
+        sha256Begin(midstate, record.data(), linkOffset);
+    }
+
+    // Wait for the previous ticket to publish; spin briefly, then give the core away
+    uint64_t previous = header.blockNumber - 1;
+    for (unsigned spins = 0; chain.publishedNumber.load(memory_order_acquire) != previous; ++spins) {
+        if (spins < 256) {
+            cpuRelax();
+        } else {
+            this_thread::yield();
+        }
+    }
+
+    // Our turn: link to the tip, finish the hash and append in chain order
+    loadChainTip(chain, previous, header.previousBlockHash);
+    memcpy(&record[linkOffset], header.previousBlockHash.data(), header.previousBlockHash.size());
+    if (header.difficulty != 0) {
+        // The proof covers the previous hash, so the search can only start once the block is linked
+        header.currentBlockHash = sealProofOfWork(record, header);
+    } else {
+        sha256Finish(midstate, record.data() + midstate.length, record.size() - midstate.length, header.currentBlockHash.data());
+    }
+    bool stored = true;
+    if (chain.store != nullptr && !chain.failed.load(memory_order_relaxed)) {
+        if (block.stage == TRANSACTION_BATCH_STAGE) {
+            record.insert(BATCH_BODY_OFFSET, batchBody.data(), batchBody.size()); // Stored with the block, not hashed
+        }
+        record.append(reinterpret_cast<const char*>(header.currentBlockHash.data()), header.currentBlockHash.size());
+        stored = appendBlockRecord(*chain.store, record);
+        if (!stored) {
+            chain.failed.store(true);
+        }
+    }
+    // Publish even after a failure so later tickets are not stuck waiting
+    storeChainTip(chain, header.blockNumber, header.currentBlockHash);
+    chain.publishedNumber.store(header.blockNumber, memory_order_release);
+    return stored;
+}
+
+// Function to read the newest published block of a shared chain without blocking appenders; returns its number
+uint64_t sharedChainTip(const SharedChain& chain, BlockHash& hash) {
+    while (true) {
+        uint64_t number = chain.publishedNumber.load(memory_order_acquire);
+        loadChainTip(chain, number, hash);
+        atomic_thread_fence(memory_order_acquire);
+        // The slot is only reused a full ring later; retry if appenders lapped us while reading
+        if (chain.publishedNumber.load(memory_order_relaxed) - number < CHAIN_TIP_RING) {
+            return number;
+        }
+    }
+}
+
+// Function to pick the shard and the probe start of a block hash (SHA-256 output is already uniform)
+static uint64_t blockHashKey(const BlockHash& hash) {
+    uint64_t key;
+    memcpy(&key, hash.data(), sizeof(key));
+    return key;
+}
+
+// Function to mix a business ID into a well-spread 64-bit value (the high bits pick the shard)
+static uint64_t businessIdKey(StringId id) {
+    uint64_t key = (uint64_t(id) + 1) * 0x9e3779b97f4a7c15ULL;
+    return key ^ (key >> 29);
+}
+
+// Function to size a shard's tables for a number of additional entries, keeping them at most half full
+static void reserveIndexShard(BlockIndexShard& shard, size_t moreHashes, size_t moreIds) {
+    size_t wanted = max<size_t>(16, (shard.hashCount + moreHashes) * 2);
+    if (wanted > shard.hashSlots.size()) {
+        size_t capacity = 16;
+        while (capacity < wanted) capacity *= 2;
+        vector<HashIndexSlot> slots(capacity, HashIndexSlot{});
+        size_t mask = capacity - 1;
+        for (const HashIndexSlot& entry : shard.hashSlots) {
+            if (entry.blockNumber == 0) continue;
+            size_t slot = (blockHashKey(entry.hash) >> 4) & mask;
+            while (slots[slot].blockNumber != 0) slot = (slot + 1) & mask;
+            slots[slot] = entry;
+        }
+        shard.hashSlots.swap(slots);
+    }
+    wanted = max<size_t>(16, (shard.idCount + moreIds) * 2);
+    if (wanted > shard.idSlots.size()) {
+        size_t capacity = 16;
+        while (capacity < wanted) capacity *= 2;
+        vector<IdIndexSlot> slots(capacity, IdIndexSlot{});
+        size_t mask = capacity - 1;
+        for (const IdIndexSlot& entry : shard.idSlots) {
+            if (entry.key == 0) continue;
+            size_t slot = businessIdKey(entry.key - 1) & mask;
+            while (slots[slot].key != 0) slot = (slot + 1) & mask;
+            slots[slot] = entry;
+        }
+        shard.idSlots.swap(slots);
+    }
+}
+
+// Function to insert a block hash into its shard (the shard must have room)
+static void insertHashEntry(BlockIndexShard& shard, const BlockHash& hash, uint64_t number) {
+    size_t mask = shard.hashSlots.size() - 1;
+    size_t slot = (blockHashKey(hash) >> 4) & mask;
+    while (shard.hashSlots[slot].blockNumber != 0) {
+        if (shard.hashSlots[slot].hash == hash) {
+            shard.hashSlots[slot].blockNumber = number; // Re-indexing the same block keeps one entry
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    shard.hashSlots[slot] = HashIndexSlot{hash, number};
+    shard.hashCount++;
+}
+
+// Function to append a block to the posting list of its business ID (the shard must have room)
+static void insertIdEntry(BlockIndexShard& shard, StringId id, uint64_t number) {
+    size_t mask = shard.idSlots.size() - 1;
+    size_t slot = businessIdKey(id) & mask;
+    while (shard.idSlots[slot].key != 0 && shard.idSlots[slot].key != id + 1) {
+        slot = (slot + 1) & mask;
+    }
+    uint32_t posting = uint32_t(shard.postingNumber.size());
+    shard.postingNumber.push_back(number);
+    shard.postingNext.push_back(UINT32_MAX);
+    IdIndexSlot& entry = shard.idSlots[slot];
+    if (entry.key == 0) {
+        entry = IdIndexSlot{id + 1, posting, posting};
+        shard.idCount++;
+    } else {
+        shard.postingNext[entry.tail] = posting;
+        entry.tail = posting;
+    }
+}
+
+// Function to wait for a pipeline queue: spin briefly, then yield, then sleep so idle stages leave the cores alone
+static void pipelineBackoff(unsigned& spins) {
+    if (spins < 64) {
+        cpuRelax();
+    } else if (spins < 256) {
+        this_thread::yield();
+    } else {
+        this_thread::sleep_for(chrono::microseconds(50));
+    }
+    spins++;
+}
+
+// Function to set up an empty queue with room for at least the given number of vehicles
+static void initPipelineQueue(PipelineQueue& queue, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    queue.slots.assign(size, nullptr);
+    queue.mask = size - 1;
+}
+
+// Function to push a vehicle, waiting while the queue is full (this is how backpressure reaches upstream stages)
+static void pipelinePush(PipelineQueue& queue, PipelineVehicle* vehicle) {
+    size_t tail = queue.tail.load(memory_order_relaxed);
+    if (tail - queue.cachedHead > queue.mask) {
+        queue.cachedHead = queue.head.load(memory_order_acquire);
+        if (tail - queue.cachedHead > queue.mask) {
+            unsigned spins = 0;
+            queue.fullWaits++;
+            while (tail - (queue.cachedHead = queue.head.load(memory_order_acquire)) > queue.mask) {
+                pipelineBackoff(spins);
+            }
+        }
+    }
+    queue.slots[tail & queue.mask] = vehicle;
+    queue.tail.store(tail + 1, memory_order_release);
+}
+
+// Function to pop a vehicle, waiting while the queue is empty (nullptr marks the end of the input)
+static PipelineVehicle* pipelinePop(PipelineQueue& queue) {
+    size_t head = queue.head.load(memory_order_relaxed);
+    if (head == queue.cachedTail) {
+        queue.cachedTail = queue.tail.load(memory_order_acquire);
+        if (head == queue.cachedTail) {
+            unsigned spins = 0;
+            queue.emptyWaits++;
+            while (head == (queue.cachedTail = queue.tail.load(memory_order_acquire))) {
+                pipelineBackoff(spins);
+            }
+        }
+    }
+    size_t depth = queue.cachedTail - head;
+    queue.depthSum += depth;
+    queue.maxDepth = max(queue.maxDepth, depth);
+    queue.pops++;
+    PipelineVehicle* vehicle = queue.slots[head & queue.mask];
+    queue.head.store(head + 1, memory_order_release);
+    return vehicle;
+}
+
+// Function to run one stage worker: parse the vehicle's row for this stage, build and append the block, pass the
+// vehicle on. The Transaction worker checks signatures (dropping transactions that fail) and hands finished
+// vehicles back to the feeder for reuse.
+static void runPipelineStage(int stage, PipelineQueue& input, PipelineQueue& output, SharedChain& chain,
+                             const PipelineOptions& options, const function<void(const BlockBatch&)>& onBatch, uint64_t& built,
+                             uint64_t& signaturesVerified, uint64_t& signaturesRejected) {
+    BlockBatch batch;
+    vector<string_view> fields;
+    string scratch;
+    while (true) {
+        PipelineVehicle* vehicle = pipelinePop(input);
+        if (vehicle != nullptr && stage <= vehicle->stages) {
+            splitRow(vehicle->rows[stage - 1], vehicle->delimiter, fields, scratch);
+            StageBlock block = buildStageBlock(stage, fields);
+            if (stage == 7) {
+                bool signedRow = fields.size() > 7 && !fields[7].empty();
+                if (!attachTransactionSignature(block.transaction, signedRow ? fields[7] : string_view()) ||
+                    !verifyTransactionSignature(block.transaction)) {
+                    signaturesRejected++;
+                    pipelinePush(output, vehicle);
+                    continue;
+                }
+                signaturesVerified += signedRow;
+            }
+            appendToChain(chain, block, vehicle->upstream);
+            vehicle->upstream = blockHeader(block).blockNumber;
+            batch.blocks.push_back(block);
+            built++;
+            if (batch.blocks.size() >= options.batchLimit) {
+                onBatch(batch);
+                batch.blocks.clear();
+            }
+        }
+        if (vehicle != nullptr || stage < 7) {
+            pipelinePush(output, vehicle); // The end marker travels down the stages but is not recycled
+        }
+        if (vehicle == nullptr) {
+            break;
+        }
+    }
+    if (!batch.blocks.empty()) {
+        onBatch(batch);
+    }
+}
+
+// Function to run input files through the seven-stage pipeline onto a shared chain. The calling thread reads the
+// files and groups rows into vehicles; each stage runs on its own worker, connected by bounded SPSC queues, so
+// thousands of vehicles are in flight and every block is built as soon as its upstream block exists. The
+// vehicles themselves come from a fixed pool that the Transaction worker recycles through an eighth queue.
+bool runPipeline(const vector<string>& paths, SharedChain& chain, const PipelineOptions& options,
+                 const function<void(const BlockBatch&)>& onBatch, PipelineReport& report) {
+    report = PipelineReport();
+    auto start = chrono::steady_clock::now();
+    unique_ptr<PipelineQueue[]> queues(new PipelineQueue[8]); // 0..6 feed the stages, 7 recycles vehicles
+    for (int q = 0; q < 8; ++q) {
+        initPipelineQueue(queues[q], options.queueCapacity);
+    }
+    // Enough vehicles to fill every stage queue; the recycle queue must be able to hold all of them
+    size_t poolSize = queues[0].slots.size() * 7;
+    initPipelineQueue(queues[7], poolSize);
+    vector<PipelineVehicle> pool(poolSize);
+    size_t poolUsed = 0;
+
+    mutex batchLock;
+    auto consume = [&](const BlockBatch& batch) {
+        lock_guard<mutex> guard(batchLock);
+        if (onBatch) onBatch(batch);
+    };
+    vector<thread> workers;
+    for (int stage = 1; stage <= 7; ++stage) {
+        workers.emplace_back(runPipelineStage, stage, ref(queues[stage - 1]), ref(queues[stage]), ref(chain), cref(options), cref(consume),
+                             ref(report.stages[stage - 1].blocks), ref(report.signaturesVerified), ref(report.signaturesRejected));
+    }
+
+    // Feed: group each file's rows into vehicles in Supply -> ... -> Transaction order
+    PipelineVehicle* current = nullptr;
+    auto send = [&]() {
+        if (current != nullptr) {
+            pipelinePush(queues[0], current);
+            report.vehicles++;
+            current = nullptr;
+        }
+    };
+    for (const string& path : paths) {
+        int lastStage = 0;
+        bool read = scanFileRows(path, [&](const vector<string_view>& fields, string_view row, char delimiter) {
+            int stage = fields.empty() ? 0 : stageOfRow(fields[0]);
+            if (stage == 0 || stage != lastStage % 7 + 1 || !rowMoneyValid(stage, fields)) {
+                report.rowsSkipped++;
+                countMetric(COUNTER_ROWS_SKIPPED);
+                if (stage == 7 && lastStage == 6) {
+                    lastStage = 7; // A refused transaction ends its vehicle; the next one starts with its supplier row
+                    send();
+                }
+                return;
+            }
+            if (stage == 1) {
+                send(); // A new supplier row closes any unfinished vehicle
+                current = poolUsed < pool.size() ? &pool[poolUsed++] : pipelinePop(queues[7]);
+                current->stages = 0;
+                current->upstream = 0;
+                current->delimiter = delimiter;
+            }
+            current->rows[stage - 1].assign(row.data(), row.size());
+            current->stages = stage;
+            lastStage = stage;
+            if (stage == 7) {
+                send();
+            }
+        });
+        send();
+        report.ok = report.ok && read;
+    }
+    pipelinePush(queues[0], nullptr); // End of input
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    for (int stage = 1; stage <= 7; ++stage) {
+        PipelineStageStats& stats = report.stages[stage - 1];
+        const PipelineQueue& input = queues[stage - 1];
+        stats.averageDepth = input.pops > 0 ? double(input.depthSum) / double(input.pops) : 0;
+        stats.maxDepth = input.maxDepth;
+        stats.starved = input.emptyWaits;
+        stats.blocked = queues[stage].fullWaits;
+    }
+    report.ok = report.ok && !chain.failed.load();
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report.ok;
+}
+
+// Function to print the per-stage statistics of a pipeline run
+void printPipelineReport(const PipelineReport& report) {
+    static const char* stageNames[7] = {"Supply", "Press", "Welding", "Paint", "Assembly", "Shipping", "Transaction"};
+    cout << "\n===== Pipeline =====\n" << endl;
+    cout << "Vehicles       : " << report.vehicles << " in " << fixed << setprecision(3) << report.seconds << " s ("
+         << setprecision(0) << report.vehicles / max(report.seconds, 1e-9) << " vehicles/s)" << endl;
+    cout << "Rows skipped   : " << report.rowsSkipped << endl;
+    cout << "Signatures     : " << report.signaturesVerified << " verified, " << report.signaturesRejected << " rejected" << endl;
+    cout << "Stage         Blocks   Avg queue   Max queue   Starved   Blocked" << endl;
+    for (int stage = 0; stage < 7; ++stage) {
+        const PipelineStageStats& stats = report.stages[stage];
+        cout << left << setw(12) << stageNames[stage] << right << setw(8) << stats.blocks
+             << setw(12) << setprecision(1) << stats.averageDepth << setw(12) << stats.maxDepth
+             << setw(10) << stats.starved << setw(10) << stats.blocked << endl;
+    }
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// Function to add every block of a batch to the hash and business-ID indexes (called on every append)
+void indexBlocks(BlockIndex& index, const BlockBatch& batch) {
+    lock_guard<mutex> guard(index.lock);
+    for (const StageBlock& block : batch.blocks) {
+        const BlockHeader& header = blockHeader(block);
+        BlockIndexShard& hashShard = index.shards[blockHashKey(header.currentBlockHash) % BLOCK_INDEX_SHARDS];
+        reserveIndexShard(hashShard, 1, 0);
+        insertHashEntry(hashShard, header.currentBlockHash, header.blockNumber);
+        if (block.stage == TRANSACTION_BATCH_STAGE || (block.stage == UPDATE_STAGE && block.update.targetId == 0)) {
+            continue;
+        }
+        StringId id = stageBlockId(block);
+        BlockIndexShard& idShard = index.shards[(businessIdKey(id) >> 60) % BLOCK_INDEX_SHARDS];
+        reserveIndexShard(idShard, 0, 1);
+        insertIdEntry(idShard, id, header.blockNumber);
+    }
+    // Batched transactions resolve to the batch block that commits to them
+    for (const TransactionBlockchain& transaction : batch.batchedTransactions) {
+        BlockIndexShard& idShard = index.shards[(businessIdKey(transaction.transactionId) >> 60) % BLOCK_INDEX_SHARDS];
+        reserveIndexShard(idShard, 0, 1);
+        insertIdEntry(idShard, transaction.transactionId, transaction.header.blockNumber);
+    }
+    index.blocks += batch.blocks.size();
+}
+
+// Function to get the business ID of an update's target from the store, as the update does not carry it: the
+// first payload field of the record upstreamOffset back (0 if there is no such block)
+static StringId storeViewTargetId(const StoreReadView& view, uint64_t position, uint32_t back, string& scratch) {
+    if (back == 0 || back > position) {
+        return 0;
+    }
+    string_view target = storeViewRecord(view, position - back, scratch);
+    if (target.size() < 17 + BLOCK_FOOTER_SIZE + 32 || uint8_t(target[0]) < 1 || uint8_t(target[0]) > 7) {
+        return 0;
+    }
+    ByteReader reader{target.data() + 17, target.data() + target.size()};
+    return readField(reader);
+}
+
+// Function to rebuild the indexes from every block in the store on all cores. Each thread first decodes a
+// contiguous range of records into per-shard buckets, then each thread builds whole shards from the buckets
+// in range order, so no two threads ever touch the same table and posting lists stay in chain order
+void rebuildBlockIndex(BlockIndex& index, ChainStore& store, unsigned threadCount) {
+    lock_guard<mutex> guard(index.lock);
+    for (BlockIndexShard& shard : index.shards) {
+        shard = BlockIndexShard();
+    }
+    index.blocks = 0;
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        return;
+    }
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+
+    // Phase 1: decode the hash, number and business ID of every record
+    uint64_t count = view.count;
+    uint64_t rangeSize = (count + threadCount - 1) / threadCount;
+    vector<IndexRebuildPart> parts(threadCount);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            uint64_t begin = min(count, t * rangeSize);
+            uint64_t end = min(count, begin + rangeSize);
+            vector<string_view> leaves;
+            string scratch, targetScratch;
+            for (uint64_t position = begin; position < end; ++position) {
+                string_view record = storeViewRecord(view, position, scratch);
+                if (record.size() < 17 + BLOCK_FOOTER_SIZE + 32) {
+                    continue;
+                }
+                // Record layout: stage, number, timestamp, then the payload led by the business ID, hash last
+                ByteReader reader{record.data() + 1, record.data() + record.size()};
+                uint64_t number = readUint64(reader);
+                readUint64(reader);
+                BlockHash hash;
+                memcpy(hash.data(), record.data() + record.size() - hash.size(), hash.size());
+                parts[t].hashes[blockHashKey(hash) % BLOCK_INDEX_SHARDS].emplace_back(hash, number);
+                if (uint8_t(record[0]) == TRANSACTION_BATCH_STAGE) {
+                    // A batch is indexed under the transaction ID (first field) of every leaf it stores
+                    if (batchRecordLeaves(record, leaves)) {
+                        for (string_view leaf : leaves) {
+                            ByteReader leafReader{leaf.data(), leaf.data() + leaf.size()};
+                            StringId id = readField(leafReader);
+                            parts[t].ids[(businessIdKey(id) >> 60) % BLOCK_INDEX_SHARDS].emplace_back(id, number);
+                        }
+                    }
+                    continue;
+                }
+                if (uint8_t(record[0]) == UPDATE_STAGE) {
+                    // An update is indexed under its target's ID
+                    uint32_t back;
+                    memcpy(&back, record.data() + record.size() - 68, 4);
+                    StringId id = storeViewTargetId(view, position, back, targetScratch);
+                    if (id != 0) {
+                        parts[t].ids[(businessIdKey(id) >> 60) % BLOCK_INDEX_SHARDS].emplace_back(id, number);
+                    }
+                    continue;
+                }
+                StringId id = readField(reader);
+                parts[t].ids[(businessIdKey(id) >> 60) % BLOCK_INDEX_SHARDS].emplace_back(id, number);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    closeStoreReadView(view);
+
+    // Phase 2: every thread owns whole shards
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            for (unsigned s = t; s < BLOCK_INDEX_SHARDS; s += threadCount) {
+                size_t hashes = 0, ids = 0;
+                for (const IndexRebuildPart& part : parts) {
+                    hashes += part.hashes[s].size();
+                    ids += part.ids[s].size();
+                }
+                BlockIndexShard& shard = index.shards[s];
+                reserveIndexShard(shard, hashes, ids);
+                shard.postingNumber.reserve(ids);
+                shard.postingNext.reserve(ids);
+                for (const IndexRebuildPart& part : parts) {
+                    for (const auto& entry : part.hashes[s]) insertHashEntry(shard, entry.first, entry.second);
+                    for (const auto& entry : part.ids[s]) insertIdEntry(shard, entry.first, entry.second);
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    index.blocks = count;
+}
+
+// Function to find the number of the block with a given hash (0 if there is none)
+uint64_t findBlockByHash(BlockIndex& index, const BlockHash& hash) {
+    lock_guard<mutex> guard(index.lock);
+    const BlockIndexShard& shard = index.shards[blockHashKey(hash) % BLOCK_INDEX_SHARDS];
+    if (shard.hashSlots.empty()) {
+        return 0;
+    }
+    size_t mask = shard.hashSlots.size() - 1;
+    for (size_t slot = (blockHashKey(hash) >> 4) & mask; shard.hashSlots[slot].blockNumber != 0; slot = (slot + 1) & mask) {
+        if (shard.hashSlots[slot].hash == hash) {
+            return shard.hashSlots[slot].blockNumber;
+        }
+    }
+    return 0;
+}
+
+// Function to find the numbers of every block carrying a business ID, in chain order
+vector<uint64_t> findBlocksById(BlockIndex& index, string_view id) {
+    vector<uint64_t> numbers;
+    StringId handle;
+    if (id.empty() || !findString(id, handle)) {
+        return numbers; // Never seen, so no block carries it
+    }
+    lock_guard<mutex> guard(index.lock);
+    const BlockIndexShard& shard = index.shards[(businessIdKey(handle) >> 60) % BLOCK_INDEX_SHARDS];
+    if (shard.idSlots.empty()) {
+        return numbers;
+    }
+    size_t mask = shard.idSlots.size() - 1;
+    for (size_t slot = businessIdKey(handle) & mask; shard.idSlots[slot].key != 0; slot = (slot + 1) & mask) {
+        if (shard.idSlots[slot].key == handle + 1) {
+            for (uint32_t posting = shard.idSlots[slot].head; posting != UINT32_MAX; posting = shard.postingNext[posting]) {
+                numbers.push_back(shard.postingNumber[posting]);
+            }
+            break;
+        }
+    }
+    return numbers;
+}
+
+// Function to make room in the provenance graph for block numbers up to a limit
+static void growProvenanceGraph(ProvenanceGraph& graph, uint64_t maxNumber) {
+    if (graph.stage.size() < maxNumber) {
+        graph.stage.resize(maxNumber, 0);
+        graph.upstream.resize(maxNumber, 0);
+        graph.downstream.resize(maxNumber, 0);
+    }
+}
+
+// Function to add the vehicle edges of every block of a batch to the provenance graph (called on every append)
+void linkProvenance(ProvenanceGraph& graph, const BlockBatch& batch) {
+    lock_guard<mutex> guard(graph.lock);
+    for (const StageBlock& block : batch.blocks) {
+        if (block.stage == UPDATE_STAGE) {
+            continue; // Not part of any vehicle; its upstream link names the block it updates
+        }
+        const BlockHeader& header = blockHeader(block);
+        growProvenanceGraph(graph, header.blockNumber);
+        uint64_t slot = header.blockNumber - 1;
+        graph.stage[slot] = block.stage;
+        graph.upstream[slot] = header.upstreamOffset;
+        if (header.upstreamOffset != 0 && header.upstreamOffset <= slot) {
+            graph.downstream[slot - header.upstreamOffset] = header.upstreamOffset;
+        }
+    }
+}
+
+// Function to rebuild the provenance graph from every block in the store on all cores. Each block has exactly
+// one upstream edge, so each downstream slot is written by exactly one thread and no locking is needed
+void rebuildProvenanceGraph(ProvenanceGraph& graph, ChainStore& store, unsigned threadCount) {
+    lock_guard<mutex> guard(graph.lock);
+    graph.stage.clear();
+    graph.upstream.clear();
+    graph.downstream.clear();
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        return;
+    }
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    // Record layout: stage, number, ..., upstream offset, previous hash, hash
+    auto recordNumber = [](string_view record) {
+        uint64_t number = 0;
+        if (record.size() >= 17) memcpy(&number, record.data() + 1, 8);
+        return number;
+    };
+    uint64_t count = view.count;
+    if (count > 0) {
+        string scratch;
+        growProvenanceGraph(graph, max(count, recordNumber(storeViewRecord(view, count - 1, scratch))));
+    }
+    uint64_t size = graph.stage.size();
+    uint64_t rangeSize = (count + threadCount - 1) / threadCount;
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            uint64_t begin = min(count, t * rangeSize);
+            uint64_t end = min(count, begin + rangeSize);
+            string scratch;
+            for (uint64_t position = begin; position < end; ++position) {
+                string_view record = storeViewRecord(view, position, scratch);
+                uint64_t number = recordNumber(record);
+                if (record.size() < 17 + 4 + 64 || number == 0 || number > size || uint8_t(record[0]) == UPDATE_STAGE) {
+                    continue;
+                }
+                uint32_t offset;
+                memcpy(&offset, record.data() + record.size() - 68, 4);
+                uint64_t slot = number - 1;
+                graph.stage[slot] = uint8_t(record[0]);
+                graph.upstream[slot] = offset;
+                if (offset != 0 && offset <= slot) {
+                    graph.downstream[slot - offset] = offset;
+                }
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    closeStoreReadView(view);
+}
+
+// Function to trace one block's vehicle by walking the upstream edges to the supplier and the downstream
+// edges to the transaction (at most six hops each way)
+static VehicleTrace traceVehicle(const ProvenanceGraph& graph, uint64_t number) {
+    VehicleTrace trace{};
+    if (number == 0 || number > graph.stage.size() || graph.stage[number - 1] == 0) {
+        return trace;
+    }
+    for (uint64_t slot = number - 1;; slot -= graph.upstream[slot]) {
+        uint8_t stage = graph.stage[slot];
+        if (stage >= 1 && stage <= 7) trace[stage - 1] = slot + 1;
+        if (graph.upstream[slot] == 0 || graph.upstream[slot] > slot) break;
+    }
+    for (uint64_t slot = number - 1; graph.downstream[slot] != 0;) {
+        slot += graph.downstream[slot];
+        if (slot >= graph.stage.size()) break;
+        uint8_t stage = graph.stage[slot];
+        if (stage >= 1 && stage <= 7) trace[stage - 1] = slot + 1;
+    }
+    return trace;
+}
+
+// Function to trace the whole vehicle (supplier to transaction) of each of many blocks in one call;
+// large batches are split across threads since the graph is only read
+vector<VehicleTrace> traceVehicles(ProvenanceGraph& graph, const vector<uint64_t>& numbers, unsigned threadCount) {
+    lock_guard<mutex> guard(graph.lock);
+    vector<VehicleTrace> traces(numbers.size());
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    threadCount = unsigned(min<size_t>(threadCount, (numbers.size() + TRACE_BATCH_PER_THREAD - 1) / TRACE_BATCH_PER_THREAD));
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < numbers.size(); ++i) {
+            traces[i] = traceVehicle(graph, numbers[i]);
+        }
+        return traces;
+    }
+    size_t rangeSize = (numbers.size() + threadCount - 1) / threadCount;
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            size_t end = min(numbers.size(), (t + 1) * rangeSize);
+            for (size_t i = t * rangeSize; i < end; ++i) {
+                traces[i] = traceVehicle(graph, numbers[i]);
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    return traces;
+}
+
+// Storage kind of every payload column (index stage - 1, columns in STAGE_RENDER_INFO order)
+static const ColumnKind ANALYTICS_SCHEMA[7][7] = {
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Count, ColumnKind::Amount},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Measure},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Measure},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Measure},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Count, ColumnKind::Measure},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary},
+    {ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Amount, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary, ColumnKind::Dictionary},
+};
+
+// Function to find the code of a string in a column's dictionary without adding it
+static bool findDictionaryCode(const AnalyticsColumn& column, StringId id, uint32_t& code) {
+    if (column.codeSlots.empty()) {
+        return false;
+    }
+    size_t mask = column.codeSlots.size() - 1;
+    for (size_t slot = businessIdKey(id) & mask; column.codeSlots[slot] != 0; slot = (slot + 1) & mask) {
+        if ((column.codeSlots[slot] >> 32) == uint64_t(id) + 1) {
+            code = uint32_t(column.codeSlots[slot]);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to rebuild a column's code table from its dictionary with a number of slots (a power of two)
+static void rehashDictionary(AnalyticsColumn& column, size_t capacity) {
+    column.codeSlots.assign(capacity, 0);
+    size_t mask = capacity - 1;
+    for (uint32_t code = 0; code < column.dictionary.size(); ++code) {
+        size_t slot = businessIdKey(column.dictionary[code]) & mask;
+        while (column.codeSlots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        column.codeSlots[slot] = (uint64_t(column.dictionary[code]) + 1) << 32 | code;
+    }
+}
+
+// Function to get the code of a string in a column's dictionary, adding it the first time it is seen
+static uint32_t dictionaryCode(AnalyticsColumn& column, StringId id) {
+    // Grow the table at 50% load so probe sequences stay short
+    if ((column.dictionary.size() + 1) * 2 > column.codeSlots.size()) {
+        rehashDictionary(column, max<size_t>(64, column.codeSlots.size() * 2));
+    }
+    size_t mask = column.codeSlots.size() - 1;
+    size_t slot = businessIdKey(id) & mask;
+    for (; column.codeSlots[slot] != 0; slot = (slot + 1) & mask) {
+        if ((column.codeSlots[slot] >> 32) == uint64_t(id) + 1) {
+            return uint32_t(column.codeSlots[slot]);
+        }
+    }
+    uint32_t code = uint32_t(column.dictionary.size());
+    column.dictionary.push_back(id);
+    column.codeSlots[slot] = (uint64_t(id) + 1) << 32 | code;
+    return code;
+}
+
+// Function to hand every payload column of a Supply..Transaction block to the visitor of its kind
+template <typename Text, typename Integer, typename Measure>
+static void visitAnalyticsColumns(const StageBlock& block, Text&& text, Integer&& integer, Measure&& measure) {
+    switch (block.stage) {
+        case 1: {
+            const auto& b = block.supplier;
+            text(0, b.supplierId); text(1, b.supplierName); text(2, b.supplierItem); text(3, b.location); text(4, b.branch);
+            integer(5, b.quantity); integer(6, b.price);
+            break;
+        }
+        case 2: {
+            const auto& b = block.press;
+            text(0, b.pressId); text(1, b.pressLocation); text(2, b.pressDetails); text(3, b.pressType); text(4, b.pressManufacturer);
+            measure(5, b.pressCapacity);
+            break;
+        }
+        case 3: {
+            const auto& b = block.welding;
+            text(0, b.weldingId); text(1, b.weldingLocation); text(2, b.weldingDetails); text(3, b.weldingType); text(4, b.weldingMaterial);
+            measure(5, b.weldingTemperature);
+            break;
+        }
+        case 4: {
+            const auto& b = block.painting;
+            text(0, b.paintingId); text(1, b.paintingLocation); text(2, b.paintingDetails); text(3, b.paintingColor); text(4, b.paintingType);
+            measure(5, b.paintingThickness);
+            break;
+        }
+        case 5: {
+            const auto& b = block.assembly;
+            text(0, b.assemblyId); text(1, b.assemblyLocation); text(2, b.assemblyDetails); text(3, b.assemblyType);
+            integer(4, b.numberOfParts); measure(5, b.assemblyWeight);
+            break;
+        }
+        case 6: {
+            const auto& b = block.shipping;
+            text(0, b.shippingId); text(1, b.shippingDestination); text(2, b.shippingDetails); text(3, b.shippingType);
+            text(4, b.carrierName); text(5, b.shippingStatus);
+            break;
+        }
+        case 7: {
+            const auto& b = block.transaction;
+            text(0, b.transactionId); text(1, b.transactionType); integer(2, b.transactionAmount); text(3, b.sender);
+            text(4, b.receiver); text(5, b.currency); text(6, b.transactionStatus);
+            break;
+        }
+    }
+}
+
+// Function to apply an update block to its target's row, overwriting only the changed columns
+static void projectUpdate(AnalyticsStore& analytics, const UpdateBlock& update) {
+    AnalyticsTable& table = analytics.tables[update.targetStage - 1];
+    uint64_t target = update.header.blockNumber - update.header.upstreamOffset;
+    // Rows are in chain order, except that parallel producers hand over their batches in turn; then the row
+    // may need a scan
+    auto row = lower_bound(table.blockNumber.begin(), table.blockNumber.end(), target);
+    if (row == table.blockNumber.end() || *row != target) {
+        row = find(table.blockNumber.begin(), table.blockNumber.end(), target);
+        if (row == table.blockNumber.end()) {
+            return;
+        }
+    }
+    size_t r = size_t(row - table.blockNumber.begin());
+    // The new values are parsed the way a row of the target's stage is
+    vector<string_view> fields(7);
+    bool changed[7] = {};
+    for (uint8_t i = 0; i < update.fieldCount; ++i) {
+        fields[update.columns[i]] = lookupString(update.values[i]);
+        changed[update.columns[i]] = true;
+    }
+    visitAnalyticsColumns(buildStageBlock(update.targetStage, fields),
+        [&](size_t c, StringId id) { if (changed[c]) table.columns[c].codes[r] = dictionaryCode(table.columns[c], id); },
+        [&](size_t c, int64_t value) { if (changed[c]) table.columns[c].integers[r] = value; },
+        [&](size_t c, float value) { if (changed[c]) table.columns[c].measures[r] = value; });
+}
+
+// Function to append one block (or one batched transaction) as a row of its stage table; an update block
+// changes its target's row instead
+static void projectRow(AnalyticsStore& analytics, const StageBlock& block) {
+    if (block.stage == UPDATE_STAGE) {
+        projectUpdate(analytics, block.update);
+        return;
+    }
+    if (block.stage < 1 || block.stage > 7) {
+        return;
+    }
+    AnalyticsTable& table = analytics.tables[block.stage - 1];
+    if (table.columns.empty()) {
+        table.columns.resize(STAGE_RENDER_INFO[block.stage - 1].columnCount);
+        for (size_t c = 0; c < table.columns.size(); ++c) {
+            table.columns[c].kind = ANALYTICS_SCHEMA[block.stage - 1][c];
+        }
+    }
+    const BlockHeader& header = blockHeader(block);
+    table.blockNumber.push_back(header.blockNumber);
+    table.timestamp.push_back(header.timestamp);
+    visitAnalyticsColumns(block,
+        [&table](size_t c, StringId id) { table.columns[c].codes.push_back(dictionaryCode(table.columns[c], id)); },
+        [&table](size_t c, int64_t value) { table.columns[c].integers.push_back(value); },
+        [&table](size_t c, float value) { table.columns[c].measures.push_back(value); });
+}
+
+// Function to append every block of a batch to the columnar projection (called on every append)
+void projectBlocks(AnalyticsStore& analytics, const BlockBatch& batch) {
+    lock_guard<mutex> guard(analytics.lock);
+    for (const StageBlock& block : batch.blocks) {
+        projectRow(analytics, block);
+    }
+    // A batch block adds one Transaction row per transaction it commits to
+    for (const TransactionBlockchain& transaction : batch.batchedTransactions) {
+        projectRow(analytics, toStageBlock(transaction));
+    }
+}
+
+// Function to rebuild the columnar projection from every block in the store. Records are decoded on all cores
+// a round at a time, then appended in chain order so every dictionary assigns its codes deterministically
+void rebuildAnalytics(AnalyticsStore& analytics, ChainStore& store, unsigned threadCount) {
+    lock_guard<mutex> guard(analytics.lock);
+    for (AnalyticsTable& table : analytics.tables) {
+        table = AnalyticsTable();
+    }
+    StoreReadView view;
+    if (!openStoreReadView(store, view)) {
+        return;
+    }
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    vector<BlockBatch> parts(threadCount);
+    for (uint64_t round = 0; round < view.count; round += ANALYTICS_REBUILD_BATCH) {
+        uint64_t roundEnd = min<uint64_t>(view.count, round + ANALYTICS_REBUILD_BATCH);
+        uint64_t rangeSize = (roundEnd - round + threadCount - 1) / threadCount;
+        vector<thread> workers;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&, t]() {
+                BlockBatch& part = parts[t];
+                part.blocks.clear();
+                part.batchedTransactions.clear();
+                vector<TransactionBlockchain> transactions;
+                uint64_t begin = min(roundEnd, round + t * rangeSize);
+                uint64_t end = min(roundEnd, begin + rangeSize);
+                string scratch;
+                for (uint64_t position = begin; position < end; ++position) {
+                    string_view record = storeViewRecord(view, position, scratch);
+                    StageBlock block;
+                    if (!decodeBlockRecord(record, block)) {
+                        continue;
+                    }
+                    if (block.stage == TRANSACTION_BATCH_STAGE) {
+                        if (decodeBatchTransactions(record, transactions)) {
+                            part.batchedTransactions.insert(part.batchedTransactions.end(), transactions.begin(), transactions.end());
+                        }
+                    } else {
+                        part.blocks.push_back(block);
+                    }
+                }
+            });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (const BlockBatch& part : parts) {
+            for (const StageBlock& block : part.blocks) {
+                projectRow(analytics, block);
+            }
+            for (const TransactionBlockchain& transaction : part.batchedTransactions) {
+                projectRow(analytics, toStageBlock(transaction));
+            }
+        }
+    }
+    closeStoreReadView(view);
+}
+
+// Function to find a stage table by name (Supply ... Transaction); 0 if there is none
+int findAnalyticsStage(string_view name) {
+    for (int stage = 1; stage <= 7; ++stage) {
+        if (name == STAGE_RENDER_INFO[stage - 1].name) {
+            return stage;
+        }
+    }
+    return 0;
+}
+
+// Function to find a column of a stage table by its key (as in the JSON export); -1 if there is none
+int findAnalyticsColumn(int stage, string_view key) {
+    if (stage < 1 || stage > 7) {
+        return -1;
+    }
+    const StageRenderInfo& info = STAGE_RENDER_INFO[stage - 1];
+    for (unsigned c = 0; c < info.columnCount; ++c) {
+        if (key == info.columns[c].key) {
+            return int(c);
+        }
+    }
+    return -1;
+}
+
+// Function to select rows in the time window whose filter column holds the filter code: one bit per row,
+// eight rows per mask byte (filterCodes is nullptr without a filter)
+static void selectAnalyticsRows(const uint64_t* timestamps, const uint32_t* filterCodes, uint32_t filterCode,
+                                uint64_t from, uint64_t to, size_t rows, uint8_t* masks) {
+    for (size_t first = 0; first < rows; first += 8) {
+        uint8_t mask = 0;
+        for (size_t lane = 0; lane < 8 && first + lane < rows; ++lane) {
+            size_t row = first + lane;
+            bool keep = timestamps[row] >= from && timestamps[row] <= to && (filterCodes == nullptr || filterCodes[row] == filterCode);
+            mask |= uint8_t(keep) << lane;
+        }
+        masks[first / 8] = mask;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Function to select rows like selectAnalyticsRows, eight rows per step (AVX2)
+__attribute__((target("avx2")))
+static void selectAnalyticsRowsAvx2(const uint64_t* timestamps, const uint32_t* filterCodes, uint32_t filterCode,
+                                    uint64_t from, uint64_t to, size_t rows, uint8_t* masks) {
+    // AVX2 only compares signed 64-bit lanes, so flip the sign bit of both sides
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i lower = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(from)), sign);
+    const __m256i upper = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(to)), sign);
+    const __m256i wanted = _mm256_set1_epi32(int(filterCode));
+    size_t full = rows & ~size_t(7);
+    for (size_t first = 0; first < full; first += 8) {
+        unsigned mask = 0;
+        for (size_t half = 0; half < 2; ++half) {
+            __m256i time = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (timestamps + first + 4 * half)), sign);
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lower, time), _mm256_cmpgt_epi64(time, upper));
+            mask |= (~unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(outside))) & 0xf) << (4 * half);
+        }
+        if (filterCodes != nullptr) {
+            __m256i codes = _mm256_loadu_si256((const __m256i*) (filterCodes + first));
+            mask &= unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(codes, wanted))));
+        }
+        masks[first / 8] = uint8_t(mask);
+    }
+    if (full < rows) {
+        selectAnalyticsRows(timestamps + full, filterCodes != nullptr ? filterCodes + full : nullptr, filterCode, from, to, rows - full, masks + full / 8);
+    }
+}
+
+// Function to sum the selected values of an int64 column and track their range (AVX2)
+__attribute__((target("avx2")))
+static void sumIntegersAvx2(const int64_t* values, const uint8_t* masks, size_t rows, AnalyticsGroup& group) {
+    const __m256i bits = _mm256_setr_epi64x(1, 2, 4, 8);
+    __m256i sum = _mm256_setzero_si256();
+    __m256i low = _mm256_set1_epi64x(INT64_MAX);
+    __m256i high = _mm256_set1_epi64x(INT64_MIN);
+    uint64_t selected = 0;
+    for (size_t first = 0; first < rows; first += 8) {
+        unsigned mask = masks[first / 8];
+        if (mask == 0) {
+            continue;
+        }
+        selected += unsigned(__builtin_popcount(mask));
+        // A partial last step is padded with zeros so nothing is read past the column
+        alignas(32) int64_t tail[8] = {};
+        const int64_t* source = values + first;
+        if (first + 8 > rows) {
+            memcpy(tail, source, (rows - first) * sizeof(int64_t));
+            source = tail;
+        }
+        for (size_t half = 0; half < 2; ++half) {
+            // Expand four mask bits into four all-ones or all-zeros lanes
+            __m256i lanes = _mm256_set1_epi64x(int64_t((mask >> (4 * half)) & 0xf));
+            __m256i keep = _mm256_cmpeq_epi64(_mm256_and_si256(lanes, bits), bits);
+            if (_mm256_testz_si256(keep, keep)) {
+                continue;
+            }
+            __m256i value = _mm256_loadu_si256((const __m256i*) (source + 4 * half));
+            sum = _mm256_add_epi64(sum, _mm256_and_si256(value, keep));
+            low = _mm256_blendv_epi8(low, value, _mm256_and_si256(keep, _mm256_cmpgt_epi64(low, value)));
+            high = _mm256_blendv_epi8(high, value, _mm256_and_si256(keep, _mm256_cmpgt_epi64(value, high)));
+        }
+    }
+    alignas(32) int64_t sums[4], lows[4], highs[4];
+    _mm256_store_si256((__m256i*) sums, sum);
+    _mm256_store_si256((__m256i*) lows, low);
+    _mm256_store_si256((__m256i*) highs, high);
+    group.rows += selected;
+    for (int lane = 0; lane < 4 && selected != 0; ++lane) {
+        group.integerSum += sums[lane];
+        group.minimum = min(group.minimum, double(lows[lane]));
+        group.maximum = max(group.maximum, double(highs[lane]));
+    }
+}
+
+// Function to sum the selected values of a float column in double precision and track their range (AVX2)
+__attribute__((target("avx2")))
+static void sumMeasuresAvx2(const float* values, const uint8_t* masks, size_t rows, AnalyticsGroup& group) {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256d sumLow = _mm256_setzero_pd();
+    __m256d sumHigh = _mm256_setzero_pd();
+    __m256 low = _mm256_set1_ps(HUGE_VALF);
+    __m256 high = _mm256_set1_ps(-HUGE_VALF);
+    uint64_t selected = 0;
+    for (size_t first = 0; first < rows; first += 8) {
+        unsigned mask = masks[first / 8];
+        if (mask == 0) {
+            continue;
+        }
+        selected += unsigned(__builtin_popcount(mask));
+        __m256 keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int(mask)), bits), bits));
+        // A partial last step is padded with zeros so nothing is read past the column
+        alignas(32) float tail[8] = {};
+        const float* source = values + first;
+        if (first + 8 > rows) {
+            memcpy(tail, source, (rows - first) * sizeof(float));
+            source = tail;
+        }
+        __m256 value = _mm256_loadu_ps(source);
+        __m256 kept = _mm256_and_ps(value, keep);
+        sumLow = _mm256_add_pd(sumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(kept)));
+        sumHigh = _mm256_add_pd(sumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(kept, 1)));
+        low = _mm256_min_ps(low, _mm256_blendv_ps(_mm256_set1_ps(HUGE_VALF), value, keep));
+        high = _mm256_max_ps(high, _mm256_blendv_ps(_mm256_set1_ps(-HUGE_VALF), value, keep));
+    }
+    alignas(32) double sums[4];
+    alignas(32) float lows[8], highs[8];
+    _mm256_store_pd(sums, _mm256_add_pd(sumLow, sumHigh));
+    _mm256_store_ps(lows, low);
+    _mm256_store_ps(highs, high);
+    group.rows += selected;
+    for (int lane = 0; lane < 8 && selected != 0; ++lane) {
+        if (lane < 4) group.measureSum += sums[lane];
+        group.minimum = min(group.minimum, double(lows[lane]));
+        group.maximum = max(group.maximum, double(highs[lane]));
+    }
+}
+#endif
+
+// Function to add one row's value to a group
+static void addAnalyticsValue(AnalyticsGroup& group, const AnalyticsColumn* column, size_t row) {
+    group.rows++;
+    if (column == nullptr) {
+        return;
+    }
+    double value;
+    if (column->kind == ColumnKind::Measure) {
+        value = column->measures[row];
+        group.measureSum += value;
+    } else {
+        group.integerSum += column->integers[row];
+        value = double(column->integers[row]);
+    }
+    group.minimum = min(group.minimum, value);
+    group.maximum = max(group.maximum, value);
+}
+
+// Function to run the query over rows [begin, end) of a table into per-code group slots (one slot if ungrouped)
+static void scanAnalyticsRange(const AnalyticsTable& table, const AnalyticsQuery& query, uint32_t filterCode,
+                               size_t begin, size_t end, vector<AnalyticsGroup>& groups) {
+    const AnalyticsColumn* value = query.valueColumn >= 0 ? &table.columns[query.valueColumn] : nullptr;
+    const AnalyticsColumn* filter = query.filterColumn >= 0 ? &table.columns[query.filterColumn] : nullptr;
+    const AnalyticsColumn* group = query.groupColumn >= 0 ? &table.columns[query.groupColumn] : nullptr;
+    uint8_t masks[ANALYTICS_CHUNK / 8];
+    for (size_t first = begin; first < end; first += ANALYTICS_CHUNK) {
+        size_t rows = min(ANALYTICS_CHUNK, end - first);
+        const uint64_t* timestamps = table.timestamp.data() + first;
+        const uint32_t* filterCodes = filter != nullptr ? filter->codes.data() + first : nullptr;
+#if defined(__x86_64__) || defined(__i386__)
+        if (sha256Features.avx2) {
+            selectAnalyticsRowsAvx2(timestamps, filterCodes, filterCode, query.fromTimestamp, query.toTimestamp, rows, masks);
+            // Ungrouped sums stay in vector registers; grouped rows are scattered one by one below
+            if (group == nullptr && value != nullptr) {
+                if (value->kind == ColumnKind::Measure) {
+                    sumMeasuresAvx2(value->measures.data() + first, masks, rows, groups[0]);
+                } else {
+                    sumIntegersAvx2(value->integers.data() + first, masks, rows, groups[0]);
+                }
+                continue;
+            }
+        } else
+#endif
+        {
+            selectAnalyticsRows(timestamps, filterCodes, filterCode, query.fromTimestamp, query.toTimestamp, rows, masks);
+        }
+        const uint32_t* keys = group != nullptr ? group->codes.data() + first : nullptr;
+        for (size_t step = 0; step < (rows + 7) / 8; ++step) {
+            for (unsigned mask = masks[step]; mask != 0; mask &= mask - 1) {
+                size_t row = step * 8 + unsigned(__builtin_ctz(mask));
+                addAnalyticsValue(groups[keys != nullptr ? keys[row] : 0], value, first + row);
+            }
+        }
+    }
+}
+
+// Function to order the groups of a result: largest total first, then most rows
+static bool largerAnalyticsGroup(const AnalyticsGroup& a, const AnalyticsGroup& b) {
+    double left = double(a.integerSum) + a.measureSum, right = double(b.integerSum) + b.measureSum;
+    return left != right ? left > right : a.rows > b.rows;
+}
+
+// Function to run a filtered, grouped aggregation over one stage table. Rows are split into one range per
+// thread; each thread aggregates into its own group slots, which are merged at the end
+AnalyticsResult runAnalyticsQuery(AnalyticsStore& analytics, const AnalyticsQuery& query, unsigned threadCount) {
+    AnalyticsResult result;
+    auto start = chrono::steady_clock::now();
+    lock_guard<mutex> guard(analytics.lock);
+    if (query.stage < 1 || query.stage > 7) {
+        return result;
+    }
+    const AnalyticsTable& table = analytics.tables[query.stage - 1];
+    size_t rows = table.timestamp.size();
+    result.rowsScanned = rows;
+    if (rows == 0) {
+        result.threads = 1;
+        return result;
+    }
+    int columns = int(table.columns.size());
+    if (query.valueColumn >= columns || query.groupColumn >= columns || query.filterColumn >= columns ||
+        (query.valueColumn >= 0 && table.columns[query.valueColumn].kind == ColumnKind::Dictionary) ||
+        (query.groupColumn >= 0 && table.columns[query.groupColumn].kind != ColumnKind::Dictionary) ||
+        (query.filterColumn >= 0 && table.columns[query.filterColumn].kind != ColumnKind::Dictionary)) {
+        return result;
+    }
+    // A filter value the column has never held matches nothing
+    uint32_t filterCode = 0;
+    if (query.filterColumn >= 0 && !findDictionaryCode(table.columns[query.filterColumn], query.filterValue, filterCode)) {
+        rows = 0;
+    }
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    size_t groupCount = query.groupColumn >= 0 ? table.columns[query.groupColumn].dictionary.size() : 1;
+    result.threads = unsigned(min<size_t>(threadCount, max<size_t>(1, rows / ANALYTICS_ROWS_PER_THREAD)));
+    size_t rangeSize = ((rows + result.threads - 1) / result.threads + ANALYTICS_CHUNK - 1) / ANALYTICS_CHUNK * ANALYTICS_CHUNK;
+    vector<vector<AnalyticsGroup>> partial(result.threads, vector<AnalyticsGroup>(groupCount));
+    vector<thread> workers;
+    for (unsigned t = 1; t < result.threads; ++t) {
+        size_t begin = min(rows, t * rangeSize);
+        workers.emplace_back(scanAnalyticsRange, cref(table), cref(query), filterCode, begin, min(rows, begin + rangeSize), ref(partial[t]));
+    }
+    scanAnalyticsRange(table, query, filterCode, 0, min(rows, rangeSize), partial[0]);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Merge the per-thread slots and keep the groups that saw rows
+    for (size_t code = 0; code < groupCount; ++code) {
+        AnalyticsGroup merged;
+        merged.key = query.groupColumn >= 0 ? table.columns[query.groupColumn].dictionary[code] : 0;
+        for (const vector<AnalyticsGroup>& groups : partial) {
+            const AnalyticsGroup& part = groups[code];
+            merged.rows += part.rows;
+            merged.integerSum += part.integerSum;
+            merged.measureSum += part.measureSum;
+            merged.minimum = min(merged.minimum, part.minimum);
+            merged.maximum = max(merged.maximum, part.maximum);
+        }
+        if (merged.rows != 0) {
+            result.rowsSelected += merged.rows;
+            result.groups.push_back(merged);
+        }
+    }
+    sort(result.groups.begin(), result.groups.end(), largerAnalyticsGroup);
+    result.bytesScanned = rows * (sizeof(uint64_t) + (query.filterColumn >= 0 ? 4 : 0) + (query.groupColumn >= 0 ? 4 : 0) +
+                                  (query.valueColumn < 0 ? 0 : table.columns[query.valueColumn].kind == ColumnKind::Measure ? 4 : 8));
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Function to fold the result of the same query on another shard into a running total
+// (group keys are interned strings, so equal values have equal keys across shards)
+static void mergeAnalyticsResult(AnalyticsResult& total, const AnalyticsResult& part) {
+    map<StringId, size_t> slots;
+    for (size_t i = 0; i < total.groups.size(); ++i) {
+        slots[total.groups[i].key] = i;
+    }
+    for (const AnalyticsGroup& group : part.groups) {
+        auto slot = slots.find(group.key);
+        if (slot == slots.end()) {
+            slots[group.key] = total.groups.size();
+            total.groups.push_back(group);
+            continue;
+        }
+        AnalyticsGroup& merged = total.groups[slot->second];
+        merged.rows += group.rows;
+        merged.integerSum += group.integerSum;
+        merged.measureSum += group.measureSum;
+        merged.minimum = min(merged.minimum, group.minimum);
+        merged.maximum = max(merged.maximum, group.maximum);
+    }
+    sort(total.groups.begin(), total.groups.end(), largerAnalyticsGroup);
+    total.rowsScanned += part.rowsScanned;
+    total.rowsSelected += part.rowsSelected;
+    total.bytesScanned += part.bytesScanned;
+    total.threads = max(total.threads, part.threads);
+    total.seconds += part.seconds;
+}
+
+// Function to format one aggregate of a query's value column
+static string analyticsValueText(ColumnKind kind, double value) {
+    if (kind == ColumnKind::Amount) {
+        return formatMoney(Money(llround(value)));
+    }
+    ostringstream text;
+    text << fixed << setprecision(kind == ColumnKind::Count ? 0 : 3) << value;
+    return text.str();
+}
+
+// Function to print the groups and scan statistics of a query
+void printAnalyticsResult(const AnalyticsQuery& query, const AnalyticsResult& result) {
+    const StageRenderInfo& info = STAGE_RENDER_INFO[(query.stage - 1) % 7];
+    ColumnKind kind = query.valueColumn >= 0 ? ANALYTICS_SCHEMA[(query.stage - 1) % 7][query.valueColumn] : ColumnKind::Count;
+    cout << "\n===== Analytics : " << (query.valueColumn >= 0 ? info.columns[query.valueColumn].key : "rows") << " of " << info.name;
+    if (query.groupColumn >= 0) {
+        cout << " by " << info.columns[query.groupColumn].key;
+    }
+    cout << " =====\n";
+    if (query.filterColumn >= 0) {
+        cout << "Filter        : " << info.columns[query.filterColumn].key << " = " << lookupString(query.filterValue) << "\n";
+    }
+    if (query.fromTimestamp != 0 || query.toTimestamp != UINT64_MAX) {
+        cout << "Window        : " << formatTimestamp(query.fromTimestamp) << " .. "
+             << (query.toTimestamp == UINT64_MAX ? string("now") : formatTimestamp(query.toTimestamp)) << "\n";
+    }
+    cout << "\n" << left << setw(28) << "Group" << right << setw(12) << "Rows";
+    if (query.valueColumn >= 0) {
+        cout << setw(20) << "Sum" << setw(16) << "Average" << setw(16) << "Min" << setw(16) << "Max";
+    }
+    cout << "\n";
+    for (const AnalyticsGroup& group : result.groups) {
+        string key = query.groupColumn >= 0 ? string(lookupString(group.key)) : string("(all)");
+        cout << left << setw(28) << key << right << setw(12) << group.rows;
+        if (query.valueColumn >= 0) {
+            double sum = kind == ColumnKind::Measure ? group.measureSum : double(group.integerSum);
+            cout << setw(20) << analyticsValueText(kind, sum)
+                 << setw(16) << analyticsValueText(kind == ColumnKind::Count ? ColumnKind::Measure : kind, sum / double(group.rows))
+                 << setw(16) << analyticsValueText(kind, group.minimum)
+                 << setw(16) << analyticsValueText(kind, group.maximum);
+        }
+        cout << "\n";
+    }
+    double seconds = max(result.seconds, 1e-9);
+    cout << "\nRows scanned  : " << result.rowsScanned << " (" << result.rowsSelected << " selected, " << result.groups.size() << " groups)" << endl;
+    cout << "Elapsed       : " << fixed << setprecision(3) << result.seconds * 1000 << " ms on " << result.threads << " thread"
+         << (result.threads == 1 ? "" : "s") << " (" << setprecision(1) << result.bytesScanned / seconds / (1024 * 1024) << " MiB/s)" << endl;
+    cout << defaultfloat << setprecision(6) << endl;
+}
+
+// Function to turn the text of an analytics query (stage, value column, group column, column=value filter, hours) into a query
+// ("-" leaves a column out; a filter value that was never interned matches nothing)
+bool parseAnalyticsQuery(const string& stage, const string& value, const string& group, const string& filter, double hours,
+                         AnalyticsQuery& query, string& error) {
+    query = AnalyticsQuery();
+    query.stage = findAnalyticsStage(stage);
+    if (query.stage == 0) {
+        error = "Unknown stage " + stage;
+        return false;
+    }
+    query.valueColumn = value == "-" ? -1 : findAnalyticsColumn(query.stage, value);
+    query.groupColumn = group == "-" ? -1 : findAnalyticsColumn(query.stage, group);
+    size_t equals = filter.find('=');
+    if (filter != "-") {
+        query.filterColumn = equals == string::npos ? -1 : findAnalyticsColumn(query.stage, filter.substr(0, equals));
+        if (query.filterColumn >= 0 && !findString(string_view(filter).substr(equals + 1), query.filterValue)) {
+            query.filterValue = StringId(-1);
+        }
+    }
+    if ((value != "-" && query.valueColumn < 0) || (group != "-" && query.groupColumn < 0) || (filter != "-" && query.filterColumn < 0)) {
+        error = "Unknown column for " + stage;
+        return false;
+    }
+    if (hours > 0) {
+        uint64_t now = generateTimestamp();
+        query.fromTimestamp = now - min<uint64_t>(now, uint64_t(hours * 3600e9));
+    }
+    return true;
+}
+
+// Function to parse a local time written like the console shows it (YYYYMMDD, optionally followed by :HH, :HH:MM or
+// :HH:MM:SS) into nanoseconds since the Unix epoch; false if the text is not such a time
+bool parseLocalTime(string_view text, uint64_t& timestamp) {
+    int parts[6] = {0, 0, 0, 0, 0, 0};
+    if (text.size() < 8 || text.size() > 17 || (text.size() - 8) % 3 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        bool separator = i >= 8 && (i - 8) % 3 == 0;
+        if (separator ? text[i] != ':' : !isdigit(uint8_t(text[i]))) {
+            return false;
+        }
+    }
+    parts[0] = stoi(string(text.substr(0, 4)));
+    parts[1] = stoi(string(text.substr(4, 2)));
+    parts[2] = stoi(string(text.substr(6, 2)));
+    for (size_t part = 3, at = 9; at < text.size(); ++part, at += 3) {
+        parts[part] = stoi(string(text.substr(at, 2)));
+    }
+    if (parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > 31 || parts[3] > 23 || parts[4] > 59 || parts[5] > 60) {
+        return false;
+    }
+    tm local{};
+    local.tm_year = parts[0] - 1900;
+    local.tm_mon = parts[1] - 1;
+    local.tm_mday = parts[2];
+    local.tm_hour = parts[3];
+    local.tm_min = parts[4];
+    local.tm_sec = parts[5];
+    local.tm_isdst = -1; // Let the time zone rules decide
+    time_t seconds = mktime(&local);
+    if (seconds < 0) {
+        return false;
+    }
+    timestamp = uint64_t(seconds) * 1000000000ULL;
+    return true;
+}
+
+// Function to turn the --from, --to and --stage texts of a range export or report into a range query: --from is
+// included, --to is not, either may be empty for an open end; the stage is a name as in the JSON export (Supply ..
+// Transaction, TransactionBatch, Update) or a stage tag
+bool parseTimeRange(const string& from, const string& to, const string& stage, TimeRangeQuery& query, string& error) {
+    query = TimeRangeQuery();
+    if (!from.empty() && !parseLocalTime(from, query.fromTimestamp)) {
+        error = "--from takes a local time YYYYMMDD[:HH[:MM[:SS]]], not " + from;
+        return false;
+    }
+    uint64_t end = UINT64_MAX;
+    if (!to.empty() && !parseLocalTime(to, end)) {
+        error = "--to takes a local time YYYYMMDD[:HH[:MM[:SS]]], not " + to;
+        return false;
+    }
+    if (end <= query.fromTimestamp) {
+        error = "--to must be later than --from";
+        return false;
+    }
+    query.toTimestamp = to.empty() ? UINT64_MAX : end - 1;
+    if (stage.empty()) {
+        return true;
+    }
+    for (uint8_t tag = 1; tag <= TRANSACTION_BATCH_STAGE; ++tag) {
+        if (stage == STAGE_RENDER_INFO[tag - 1].name || stage == to_string(tag)) {
+            query.stage = tag;
+        }
+    }
+    if (stage == "Update" || stage == to_string(UPDATE_STAGE)) {
+        query.stage = UPDATE_STAGE;
+    }
+    if (query.stage == 0) {
+        error = "Unknown stage " + stage;
+        return false;
+    }
+    return true;
+}
+
+// Function to print the command-line usage
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [OPTIONS] [FILES...]            interactive menu\n"
+         << "       " << program << " ingest --store DIR [OPTIONS] FILES...\n"
+         << "       " << program << " verify --store DIR\n"
+         << "       " << program << " query --store DIR [--format F] KEYS...\n"
+         << "       " << program << " query --store DIR --stage S [--value C] [--group C] [--where C=V] [--hours H]\n"
+         << "       " << program << " export --store DIR [--format F] [--out FILE] [--from TIME] [--to TIME] [--stage S]\n"
+         << "       " << program << " report --store DIR [--by day|shift] [--from TIME] [--to TIME] [--stage S]\n"
+         << "       " << program << " serve [--store DIR] --socket PATH\n"
+         << "       " << program << " generate --vehicles N [--seed N] [--skew S] [--cardinality KEY=N] [--out FILE]\n"
+         << "Options: --parallel, --pipeline, --queue-depth N, --tx-batch N, --pow-difficulty BITS,\n"
+         << "         --durability block|batch|time, --segment-mb N, --checkpoint-blocks N (0 disables checkpoints),\n"
+         << "         --metrics FILE (Prometheus text written on exit; serve also writes it on SIGUSR1),\n"
+         << "         --shards N (split a new store into N chains by supplierId), --anchor-ms N (time between anchor blocks),\n"
+         << "         --vehicles N (ingest N generated vehicles after the files; --seed, --skew and --cardinality shape them),\n"
+         << "         --keys FILE (name,publicKey[,seed] rows in hex; a listed sender's transactions must be signed, and\n"
+         << "         generate or --vehicles create FILE when it is missing and sign every generated transaction)\n"
+         << "Input rows UPDATE,<hash or ID>,<column>=<value>,... append an update block changing those columns of an\n"
+         << "earlier block (column keys as in the JSON export, e.g. shippingStatus); queries show the updated values.\n"
+         << "A transaction row's eighth column is the sender's Ed25519 signature (128 hex digits) over the transaction;\n"
+         << "with --tx-batch the signatures of a batch are checked together, and verify checks every stored one. Without\n"
+         << "--keys verify can only check a signature against the key stored with it, which proves the transaction is\n"
+         << "intact but not who sent it; it then prints a warning with the number of such signatures.\n"
+         << "TIME is a local YYYYMMDD[:HH[:MM[:SS]]]; --from is included, --to is not. Shifts are " << SHIFT_HOURS << " hours from "
+         << setw(2) << setfill('0') << SHIFT_START_HOUR << ":00" << setfill(' ') << ". Export with a window and report read only\n"
+         << "the segments and groups of " << TIME_INDEX_STRIDE << " blocks whose time index overlaps the window" << endl;
+}
+
+// Function to read the subcommand, options, input files and lookup keys from the command line
+// Without a subcommand every unknown argument is an input file, as it always was; subcommands reject unknown options
+bool parseCommandLine(int argc, char* argv[], CommandOptions& options) {
+    static const char* const COMMANDS[] = {"ingest", "verify", "query", "export", "report", "serve", "generate"};
+    int first = 1;
+    if (argc > 1 && find_if(begin(COMMANDS), end(COMMANDS), [&](const char* name) { return strcmp(argv[1], name) == 0; }) != end(COMMANDS)) {
+        options.command = argv[1];
+        first = 2;
+    }
+    for (int i = first; i < argc; i++) {
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--parallel") {
+            options.parallelIngest = true;
+        } else if (argument == "--pipeline") {
+            options.pipelineIngest = true;
+        } else if (argument == "--tx-batch" && hasValue) {
+            options.transactionBatchSize = size_t(atol(argv[++i]));
+        } else if (argument == "--pow-difficulty" && hasValue) {
+            options.powDifficulty = unsigned(atoi(argv[++i]));
+            if (options.powDifficulty > POW_MAX_DIFFICULTY) {
+                cerr << "--pow-difficulty must be at most " << POW_MAX_DIFFICULTY << endl;
+                return false;
+            }
+        } else if (argument == "--checkpoint-blocks" && hasValue) {
+            options.checkpointInterval = uint64_t(atoll(argv[++i]));
+        } else if (argument == "--shards" && hasValue) {
+            options.shardCount = unsigned(atoi(argv[++i]));
+            if (options.shardCount == 0 || options.shardCount > MAX_SHARDS) {
+                cerr << "--shards must be between 1 and " << MAX_SHARDS << endl;
+                return false;
+            }
+        } else if (argument == "--vehicles" && hasValue) {
+            options.workload.vehicles = uint64_t(atoll(argv[++i]));
+        } else if (argument == "--seed" && hasValue) {
+            options.workload.seed = uint64_t(atoll(argv[++i]));
+        } else if (argument == "--skew" && hasValue) {
+            options.workload.skew = max(0.0, atof(argv[++i]));
+        } else if (argument == "--cardinality" && hasValue) {
+            // KEY=N sets how many distinct values one kind of field takes
+            string setting = argv[++i];
+            size_t equals = setting.find('=');
+            string key = setting.substr(0, equals);
+            uint32_t* target = key == "suppliers" ? &options.workload.suppliers : key == "products" ? &options.workload.products
+                             : key == "plants" ? &options.workload.plants : key == "stations" ? &options.workload.stations
+                             : key == "locations" ? &options.workload.locations : key == "companies" ? &options.workload.companies : nullptr;
+            if (target == nullptr || equals == string::npos || atol(setting.c_str() + equals + 1) <= 0) {
+                cerr << "--cardinality takes suppliers, products, plants, stations, locations or companies =N" << endl;
+                return false;
+            }
+            *target = uint32_t(atol(setting.c_str() + equals + 1));
+        } else if (argument == "--anchor-ms" && hasValue) {
+            options.anchorIntervalMs = unsigned(atoi(argv[++i]));
+        } else if (argument == "--metrics" && hasValue) {
+            options.metricsPath = argv[++i];
+        } else if (argument == "--keys" && hasValue) {
+            options.keysPath = argv[++i];
+        } else if (argument == "--queue-depth" && hasValue) {
+            options.pipelineOptions.queueCapacity = max<size_t>(2, size_t(atol(argv[++i])));
+        } else if (argument == "--store" && hasValue) {
+            options.storeOptions.directory = argv[++i];
+        } else if (argument == "--durability" && hasValue) {
+            string mode = argv[++i];
+            options.storeOptions.durability = mode == "block" ? Durability::PerBlock
+                                            : mode == "time" ? Durability::TimeBounded : Durability::PerBatch;
+        } else if (argument == "--segment-mb" && hasValue) {
+            options.storeOptions.segmentSize = size_t(atol(argv[++i])) * 1024 * 1024;
+        } else if (argument == "--format" && hasValue) {
+            options.format = argv[++i];
+        } else if (argument == "--out" && hasValue) {
+            options.outPath = argv[++i];
+        } else if (argument == "--socket" && hasValue) {
+            options.socketPath = argv[++i];
+        } else if (argument == "--stage" && hasValue) {
+            options.stage = argv[++i];
+        } else if (argument == "--value" && hasValue) {
+            options.value = argv[++i];
+        } else if (argument == "--group" && hasValue) {
+            options.group = argv[++i];
+        } else if (argument == "--where" && hasValue) {
+            options.filter = argv[++i];
+        } else if (argument == "--hours" && hasValue) {
+            options.hours = atof(argv[++i]);
+        } else if (argument == "--from" && hasValue) {
+            options.from = argv[++i];
+        } else if (argument == "--to" && hasValue) {
+            options.to = argv[++i];
+        } else if (argument == "--by" && hasValue) {
+            options.period = argv[++i];
+        } else if (!options.command.empty() && argument.size() > 2 && argument.compare(0, 2, "--") == 0) {
+            cerr << "Unknown option " << argument << endl;
+            return false;
+        } else {
+            options.arguments.push_back(argument);
+        }
+    }
+    return true;
+}
+
+// Function to tell whether a subcommand only reads the store: it is then opened read-only and never checkpointed
+static bool commandOnlyReads(const string& command) {
+    return command == "verify" || command == "query" || command == "export" || command == "report";
+}
+
+// Function to open the store (if any) and rebuild every lookup structure from it
+// A reopened store continues its chain and is indexed on all cores up front
+bool openSession(ChainSession& session, const CommandOptions& options) {
+    session.storeOptions = options.storeOptions;
+    session.storeOptions.readOnly = commandOnlyReads(options.command);
+    session.useStore = !options.storeOptions.directory.empty();
+    session.state.transactionBatchSize = options.transactionBatchSize;
+    session.checkpointInterval = session.storeOptions.readOnly ? 0 : options.checkpointInterval;
+    session.metricsPath = options.metricsPath;
+    // verify checks every record itself: it opens the store without recovery and needs no lookup structure
+    bool verifying = options.command == "verify";
+    session.storeOptions.recover = !verifying;
+    if (session.useStore) {
+        if (!openChainStore(session.store, session.storeOptions)) {
+            return false;
+        }
+        // The checkpoint goes first: it restores the string pool, which must still be empty
+        auto start = chrono::steady_clock::now();
+        if (!verifying && !loadCheckpoint(session)) {
+            rebuildBlockIndex(session.index, session.store);
+            rebuildProvenanceGraph(session.provenance, session.store);
+            rebuildAnalytics(session.analytics, session.store);
+            session.replayedBlocks = storeBlockCount(session.store);
+        }
+        if (!verifying) {
+            restoreIngestState(session.store, session.state);
+        }
+        session.startupSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    // Sequential ingestion appends every batch to the store and commits it as one group
+    session.state.onBatch = [&session](const BlockBatch& batch) {
+        session.totalBlocks += batch.blocks.size();
+        keepSessionBlocks(session, batch);
+        if (session.useStore && !session.storeFailed) {
+            size_t bodies = 0;
+            for (const StageBlock& block : batch.blocks) {
+                string_view body;
+                if (block.stage == TRANSACTION_BATCH_STAGE) {
+                    size_t start = bodies > 0 ? batch.batchBodyEnds[bodies - 1] : 0;
+                    body = string_view(batch.batchBodies).substr(start, batch.batchBodyEnds[bodies++] - start);
+                }
+                session.storeFailed = session.storeFailed || !appendBlock(session.store, block, body);
+            }
+            session.storeFailed = session.storeFailed ||
+                (session.storeOptions.durability == Durability::PerBatch && !commitChainStore(session.store));
+            maybeCheckpoint(session);
+        }
+    };
+    // Update rows find a target handed over earlier through the indexes; for an ID the newest block carrying it
+    // wins, and an update found there stands for the block it changes
+    session.state.findTarget = [&session](string_view key, StageBlock& target) {
+        vector<uint64_t> numbers = findSessionBlocks(session, string(key));
+        for (auto it = numbers.rbegin(); it != numbers.rend(); ++it) {
+            if (!fetchSessionBlock(session, *it, target)) {
+                continue;
+            }
+            if (target.stage == UPDATE_STAGE) {
+                uint64_t number = findBlockByHash(session.index, target.update.targetHash);
+                if (number == 0 || !fetchSessionBlock(session, number, target)) {
+                    continue;
+                }
+            }
+            if (target.stage >= 1 && target.stage <= 7) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return true;
+}
+
+// Function to close the session's store, checkpointing first so the next start replays nothing
+void closeSession(ChainSession& session) {
+    if (session.useStore) {
+        if (session.checkpointInterval != 0 && !session.storeFailed) {
+            writeCheckpoint(session);
+        }
+        closeChainStore(session.store);
+    }
+}
+
+// Checkpoint file layout: 96-byte header ("TMSSNAP2", store blocks covered, next block number, hash of the last
+// covered block, payload size, payload digest), then the payload: arrays of [u64 count][elements],
+// each padded to 8 bytes, so every array can be used straight from a mapping of the file
+const char CHECKPOINT_MAGIC[] = "TMSSNAP2";
+const size_t CHECKPOINT_HEADER = 8 + 8 + 8 + 32 + 8 + 32;
+
+// Function to append one array to a checkpoint payload
+template <typename T>
+static void appendSnapshotArray(string& out, const T* values, size_t count) {
+    appendUint64(out, count);
+    out.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+    out.append((8 - out.size() % 8) % 8, '\0');
+}
+
+// Function to read the location and length of one array of a checkpoint payload (nullptr when it runs past the end)
+template <typename T>
+static const T* readSnapshotSpan(ByteReader& reader, uint64_t& count) {
+    count = readUint64(reader);
+    if (!reader.ok || count > size_t(reader.end - reader.position) / sizeof(T)) {
+        reader.ok = false;
+        return nullptr;
+    }
+    size_t bytes = count * sizeof(T);
+    const char* data = readBytes(reader, bytes + (8 - bytes % 8) % 8);
+    return reinterpret_cast<const T*>(data);
+}
+
+// Function to copy one array of a checkpoint payload into a vector
+template <typename T>
+static void readSnapshotArray(ByteReader& reader, vector<T>& values) {
+    uint64_t count;
+    const T* data = readSnapshotSpan<T>(reader, count);
+    if (data != nullptr) {
+        values.assign(data, data + count);
+    } else {
+        values.clear();
+    }
+}
+
+// Function to compute the digest of a checkpoint payload: SHA-256 over the SHA-256 digests of its eight
+// equal slices, so the slices are hashed on all cores (or eight AVX2 lanes at a time on one)
+static void checkpointDigest(const char* payload, size_t size, uint8_t digest[32]) {
+    const uint8_t* slices[8];
+    size_t lengths[8];
+    size_t sliceSize = (size / 8 + 63) & ~size_t(63);
+    for (size_t i = 0; i < 8; ++i) {
+        size_t begin = min(size, i * sliceSize);
+        slices[i] = reinterpret_cast<const uint8_t*>(payload) + begin;
+        lengths[i] = min(size, begin + sliceSize) - begin;
+    }
+    uint8_t digests[8 * 32];
+    unsigned threadCount = min(8u, max(1u, thread::hardware_concurrency()));
+    if (threadCount == 1) {
+        sha256Batch(slices, lengths, 8, digests);
+    } else {
+        vector<thread> workers;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = t; i < 8; i += threadCount) {
+                    sha256(slices[i], lengths[i], digests + 32 * i);
+                }
+            });
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+    sha256(digests, sizeof(digests), digest);
+}
+
+// Function to build the file name of the checkpoint that covers a number of store blocks
+static string checkpointPath(const ChainStore& store, uint64_t blocks) {
+    char name[40];
+    snprintf(name, sizeof(name), "checkpoint-%016llx.snap", (unsigned long long) blocks);
+    return store.options.directory + "/" + name;
+}
+
+// Function to list the checkpoint files of a store, newest first
+static vector<string> listCheckpoints(const ChainStore& store) {
+    vector<string> paths;
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(store.options.directory, error)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("checkpoint-", 0) == 0 && name.size() > 5 && name.compare(name.size() - 5, 5, ".snap") == 0) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    sort(paths.rbegin(), paths.rend());
+    return paths;
+}
+
+// Function to write a checkpoint of the session's lookup structures: the string pool (so every StringId keeps
+// its value), the block indexes, the provenance graph and the columnar projection, as of the blocks committed
+// so far. Hash tables are written as their occupied entries only (loading rehashes them), and the dictionary
+// code tables not at all. The file is written beside the store, synced and renamed into place, so a crash
+// leaves either the old or the new checkpoint. Returns false if nothing could be written
+bool writeCheckpoint(ChainSession& session) {
+    MetricTimer timer(METRIC_CHECKPOINT);
+    if (!session.useStore || session.storeFailed || !commitChainStore(session.store)) {
+        return false;
+    }
+    StoreReadView view;
+    if (!openStoreReadView(session.store, view)) {
+        return false;
+    }
+    uint64_t count = view.count;
+    BlockHash tip{};
+    uint64_t nextNumber = 1;
+    string scratch;
+    if (count > 0) {
+        string_view last = storeViewRecord(view, count - 1, scratch);
+        if (last.size() >= 17 + 32) {
+            memcpy(tip.data(), last.data() + last.size() - 32, 32);
+            memcpy(&nextNumber, last.data() + 1, 8);
+            nextNumber++;
+        }
+    }
+    closeStoreReadView(view);
+    if (count == 0 || count == session.checkpointedBlocks) {
+        return true;
+    }
+
+    string payload;
+    appendUint64(payload, STRING_POOL_SHARDS);
+    appendUint64(payload, BLOCK_INDEX_SHARDS);
+    {
+        lock_guard<mutex> indexGuard(session.index.lock);
+        lock_guard<mutex> provenanceGuard(session.provenance.lock);
+        lock_guard<mutex> analyticsGuard(session.analytics.lock);
+        if (session.index.blocks != count) {
+            return false; // Blocks are still on their way into the indexes; the next checkpoint catches up
+        }
+        for (StringPoolShard& shard : stringPool.shards) {
+            lock_guard<mutex> guard(shard.lock);
+            uint32_t strings = shard.count.load();
+            vector<uint32_t> lengths(strings);
+            string text;
+            for (uint32_t local = 0; local < strings; ++local) {
+                string_view value = shard.pages[local / STRING_PAGE_SIZE].load()[local % STRING_PAGE_SIZE];
+                lengths[local] = uint32_t(value.size());
+                text.append(value);
+            }
+            appendSnapshotArray(payload, lengths.data(), lengths.size());
+            appendSnapshotArray(payload, text.data(), text.size());
+        }
+        vector<HashIndexSlot> hashes;
+        vector<IdIndexSlot> ids;
+        for (const BlockIndexShard& shard : session.index.shards) {
+            hashes.clear();
+            for (const HashIndexSlot& entry : shard.hashSlots) {
+                if (entry.blockNumber != 0) hashes.push_back(entry);
+            }
+            ids.clear();
+            for (const IdIndexSlot& entry : shard.idSlots) {
+                if (entry.key != 0) ids.push_back(entry);
+            }
+            appendSnapshotArray(payload, hashes.data(), hashes.size());
+            appendSnapshotArray(payload, ids.data(), ids.size());
+            appendSnapshotArray(payload, shard.postingNumber.data(), shard.postingNumber.size());
+            appendSnapshotArray(payload, shard.postingNext.data(), shard.postingNext.size());
+        }
+        const ProvenanceGraph& graph = session.provenance;
+        appendSnapshotArray(payload, graph.stage.data(), graph.stage.size());
+        appendSnapshotArray(payload, graph.upstream.data(), graph.upstream.size());
+        appendSnapshotArray(payload, graph.downstream.data(), graph.downstream.size());
+        for (const AnalyticsTable& table : session.analytics.tables) {
+            appendSnapshotArray(payload, table.blockNumber.data(), table.blockNumber.size());
+            appendSnapshotArray(payload, table.timestamp.data(), table.timestamp.size());
+            appendUint64(payload, table.columns.size());
+            for (const AnalyticsColumn& column : table.columns) {
+                appendUint64(payload, uint64_t(column.kind));
+                appendSnapshotArray(payload, column.codes.data(), column.codes.size());
+                appendSnapshotArray(payload, column.integers.data(), column.integers.size());
+                appendSnapshotArray(payload, column.measures.data(), column.measures.size());
+                appendSnapshotArray(payload, column.dictionary.data(), column.dictionary.size());
+            }
+        }
+    }
+
+    string header(CHECKPOINT_MAGIC, 8);
+    appendUint64(header, count);
+    appendUint64(header, nextNumber);
+    header.append(reinterpret_cast<const char*>(tip.data()), tip.size());
+    appendUint64(header, payload.size());
+    uint8_t digest[32];
+    checkpointDigest(payload.data(), payload.size(), digest);
+    header.append(reinterpret_cast<const char*>(digest), sizeof(digest));
+
+    string path = checkpointPath(session.store, count);
+    string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "Cannot create " << temporary << ": " << strerror(errno) << endl;
+        return false;
+    }
+    bool written = writeAll(fd, header.data(), header.size()) && writeAll(fd, payload.data(), payload.size()) && fdatasync(fd) == 0;
+    close(fd);
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        cerr << "Cannot write checkpoint " << path << endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    // The rename itself must reach the disk before older checkpoints go away
+    int directory = open(session.store.options.directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directory >= 0) {
+        fsync(directory);
+        close(directory);
+    }
+    session.checkpointedBlocks = count;
+    vector<string> paths = listCheckpoints(session.store);
+    for (size_t i = CHECKPOINTS_KEPT; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+    // Also drop temporary files of checkpoints a crash interrupted
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(session.store.options.directory, error)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("checkpoint-", 0) == 0 && name.size() > 9 && name.compare(name.size() - 9, 9, ".snap.tmp") == 0) {
+            unlink(entry.path().c_str());
+        }
+    }
+    return true;
+}
+
+// Function to write a checkpoint once enough blocks have been committed since the last one
+void maybeCheckpoint(ChainSession& session) {
+    if (session.useStore && session.checkpointInterval != 0 && !session.storeFailed &&
+        storeBlockCount(session.store) >= session.checkpointedBlocks + session.checkpointInterval) {
+        writeCheckpoint(session);
+    }
+}
+
+// Function to load one checkpoint file into the session if it is intact and matches the store; returns the
+// number of store blocks it covers (0 if it cannot be used)
+static uint64_t loadCheckpointFile(ChainSession& session, const string& path, const StoreReadView& view) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        return 0;
+    }
+    uint64_t covered = 0, nextNumber = 0, payloadSize = 0;
+    if (file.size >= CHECKPOINT_HEADER && memcmp(file.data, CHECKPOINT_MAGIC, 8) == 0) {
+        memcpy(&covered, file.data + 8, 8);
+        memcpy(&nextNumber, file.data + 16, 8);
+        memcpy(&payloadSize, file.data + 56, 8);
+    }
+    // The checkpoint must end on a block the store still holds, with the same hash
+    string scratch;
+    string_view last = covered != 0 && covered <= view.count ? storeViewRecord(view, covered - 1, scratch) : string_view();
+    const char* payload = file.data + CHECKPOINT_HEADER;
+    uint8_t digest[32];
+    if (last.size() < 32 || memcmp(last.data() + last.size() - 32, file.data + 24, 32) != 0 ||
+        payloadSize != file.size - CHECKPOINT_HEADER) {
+        unmapFile(file);
+        return 0;
+    }
+    checkpointDigest(payload, payloadSize, digest);
+    if (memcmp(digest, file.data + 64, 32) != 0) {
+        unmapFile(file);
+        return 0;
+    }
+
+    ByteReader reader{payload, payload + payloadSize};
+    bool ok = readUint64(reader) == STRING_POOL_SHARDS && readUint64(reader) == BLOCK_INDEX_SHARDS;
+    const uint32_t* lengths[STRING_POOL_SHARDS] = {};
+    const char* texts[STRING_POOL_SHARDS] = {};
+    uint64_t strings[STRING_POOL_SHARDS] = {};
+    for (unsigned s = 0; ok && s < STRING_POOL_SHARDS; ++s) {
+        uint64_t textSize, total = 0;
+        lengths[s] = readSnapshotSpan<uint32_t>(reader, strings[s]);
+        texts[s] = readSnapshotSpan<char>(reader, textSize);
+        for (uint64_t i = 0; lengths[s] != nullptr && i < strings[s]; ++i) {
+            total += lengths[s][i];
+        }
+        ok = reader.ok && total == textSize;
+    }
+    {
+        lock_guard<mutex> indexGuard(session.index.lock);
+        lock_guard<mutex> provenanceGuard(session.provenance.lock);
+        lock_guard<mutex> analyticsGuard(session.analytics.lock);
+        for (BlockIndexShard& shard : session.index.shards) {
+            // The entries come packed; growing from an empty count spreads them over tables of the usual size
+            readSnapshotArray(reader, shard.hashSlots);
+            readSnapshotArray(reader, shard.idSlots);
+            size_t hashes = shard.hashSlots.size(), ids = shard.idSlots.size();
+            shard.hashCount = 0;
+            shard.idCount = 0;
+            reserveIndexShard(shard, hashes, ids);
+            shard.hashCount = hashes;
+            shard.idCount = ids;
+            readSnapshotArray(reader, shard.postingNumber);
+            readSnapshotArray(reader, shard.postingNext);
+        }
+        session.index.blocks = covered;
+        ProvenanceGraph& graph = session.provenance;
+        readSnapshotArray(reader, graph.stage);
+        readSnapshotArray(reader, graph.upstream);
+        readSnapshotArray(reader, graph.downstream);
+        for (AnalyticsTable& table : session.analytics.tables) {
+            readSnapshotArray(reader, table.blockNumber);
+            readSnapshotArray(reader, table.timestamp);
+            table.columns.resize(size_t(min<uint64_t>(readUint64(reader), 7)));
+            for (AnalyticsColumn& column : table.columns) {
+                column.kind = ColumnKind(readUint64(reader));
+                readSnapshotArray(reader, column.codes);
+                readSnapshotArray(reader, column.integers);
+                readSnapshotArray(reader, column.measures);
+                readSnapshotArray(reader, column.dictionary);
+                column.codeSlots.clear();
+                if (!column.dictionary.empty()) {
+                    size_t capacity = 64;
+                    while ((column.dictionary.size() + 1) * 2 > capacity) capacity *= 2;
+                    rehashDictionary(column, capacity);
+                }
+            }
+        }
+        ok = ok && reader.ok && reader.position == reader.end;
+    }
+
+    // Every StringId in the tables above refers to the pool as it was written, so the pool is restored
+    // string by string into the same shard positions; that is only possible while it is still empty
+    ok = ok && stringPoolEmpty();
+    for (unsigned s = 0; ok && s < STRING_POOL_SHARDS; ++s) {
+        ok = restoreStringShard(s, lengths[s], texts[s], strings[s]);
+    }
+    unmapFile(file);
+    if (!ok) {
+        return 0;
+    }
+    if (nextNumber > blockNumber.load()) {
+        blockNumber.store(nextNumber);
+    }
+    return covered;
+}
+
+// Function to add the store blocks from a chain position on to the session's lookup structures, a batch at a time
+static void replayStoredBlocks(ChainSession& session, const StoreReadView& view, uint64_t first) {
+    BlockBatch batch;
+    vector<TransactionBlockchain> transactions;
+    string scratch, targetScratch;
+    for (uint64_t position = first; position < view.count; ++position) {
+        string_view record = storeViewRecord(view, position, scratch);
+        StageBlock block;
+        if (!decodeBlockRecord(record, block)) {
+            continue;
+        }
+        if (block.stage == UPDATE_STAGE) {
+            block.update.targetId = storeViewTargetId(view, position, block.update.header.upstreamOffset, targetScratch);
+        }
+        if (block.stage == TRANSACTION_BATCH_STAGE && decodeBatchTransactions(record, transactions)) {
+            batch.batchedTransactions.insert(batch.batchedTransactions.end(), transactions.begin(), transactions.end());
+        }
+        batch.blocks.push_back(block);
+        if (batch.blocks.size() >= CHECKPOINT_REPLAY_BATCH) {
+            keepSessionBlocks(session, batch);
+            batch.blocks.clear();
+            batch.batchedTransactions.clear();
+        }
+    }
+    keepSessionBlocks(session, batch);
+}
+
+// Function to restore the session's lookup structures from the newest valid checkpoint and replay only the
+// blocks appended after it, so startup time follows recent activity rather than the length of the chain.
+// Returns false when no checkpoint could be used (the caller then rebuilds everything from the store)
+bool loadCheckpoint(ChainSession& session) {
+    // A checkpoint restores string IDs, so only the first session a process opens (the first shard) can use one
+    if (session.checkpointInterval == 0 || !stringPoolEmpty()) {
+        return false;
+    }
+    vector<string> paths = listCheckpoints(session.store);
+    if (paths.empty()) {
+        return false;
+    }
+    StoreReadView view;
+    if (!openStoreReadView(session.store, view)) {
+        return false;
+    }
+    uint64_t covered = 0;
+    for (const string& path : paths) {
+        covered = loadCheckpointFile(session, path, view);
+        if (covered != 0) {
+            break;
+        }
+        cerr << "Ignoring checkpoint " << path << " (damaged or ahead of the store)" << endl;
+        if (!stringPoolEmpty()) {
+            break; // Strings were interned, so no other checkpoint can restore its IDs
+        }
+    }
+    if (covered != 0) {
+        replayStoredBlocks(session, view, covered);
+        session.checkpointedBlocks = covered;
+        session.restoredBlocks = covered;
+        session.replayedBlocks = view.count - covered;
+    }
+    closeStoreReadView(view);
+    return covered != 0;
+}
+
+// Function to add a batch of new blocks to the session's indexes (and its in-memory chain when there is no store)
+void keepSessionBlocks(ChainSession& session, const BlockBatch& batch) {
+    if (!session.useStore) {
+        lock_guard<mutex> guard(session.memoryChainLock);
+        for (const StageBlock& block : batch.blocks) {
+            uint64_t number = blockHeader(block).blockNumber;
+            if (session.memoryChain.size() < number) {
+                session.memoryChain.resize(number);
+            }
+            session.memoryChain[number - 1] = block;
+        }
+        for (const TransactionBlockchain& transaction : batch.batchedTransactions) {
+            session.memoryBatches[transaction.header.blockNumber].push_back(transaction);
+        }
+    }
+    linkProvenance(session.provenance, batch);
+    projectBlocks(session.analytics, batch);
+    // Indexed last: a producer resolving an update's target may fetch and project any block it can find
+    indexBlocks(session.index, batch);
+}
+
+// Function to fetch a block by number from the store or the in-memory chain
+bool fetchSessionBlock(ChainSession& session, uint64_t number, StageBlock& block) {
+    if (session.useStore) {
+        return readStoredBlock(session.store, number - 1, block);
+    }
+    lock_guard<mutex> guard(session.memoryChainLock);
+    if (number == 0 || number > session.memoryChain.size()) {
+        return false;
+    }
+    block = session.memoryChain[number - 1];
+    return true;
+}
+
+// Function to fetch the transactions a batch block commits to
+bool fetchSessionBatch(ChainSession& session, uint64_t number, vector<TransactionBlockchain>& transactions) {
+    if (session.useStore) {
+        string_view record;
+        string scratch;
+        return readStoreRecord(session.store, number - 1, record, scratch) && decodeBatchTransactions(record, transactions);
+    }
+    auto it = session.memoryBatches.find(number);
+    if (it == session.memoryBatches.end()) {
+        return false;
+    }
+    transactions = it->second;
+    return true;
+}
+
+// Function to find the blocks named by a hash (64 hex digits) or a business ID such as SUP001 or TRANS007
+vector<uint64_t> findSessionBlocks(ChainSession& session, const string& key) {
+    BlockHash hash;
+    vector<uint64_t> numbers;
+    if (hexToHash(key, hash)) {
+        uint64_t number = findBlockByHash(session.index, hash);
+        if (number != 0) numbers.push_back(number);
+    } else {
+        numbers = findBlocksById(session.index, key);
+    }
+    return numbers;
+}
+
+// Function to apply the changed columns of an update block to its target, keeping the target's header
+static void applyUpdate(StageBlock& target, const UpdateBlock& update) {
+    string_view values[7];
+    char scratch[7][64];
+    stageFieldValues(target, values, scratch);
+    vector<string_view> fields(values, values + 7);
+    for (uint8_t i = 0; i < update.fieldCount; ++i) {
+        fields[update.columns[i]] = lookupString(update.values[i]);
+    }
+    StageBlock merged = buildStageBlock(target.stage, fields);
+    merged.supplier.header = blockHeader(target); // The header is the first member of every stage
+    target = merged;
+}
+
+// Function to find the blocks named by a hash or business ID as they read now: every base block has the
+// changes of its later update blocks applied in chain order, while the hash of an update block names just that update
+vector<StageBlock> findSessionView(ChainSession& session, const string& key) {
+    vector<StageBlock> blocks, updates;
+    for (uint64_t number : findSessionBlocks(session, key)) {
+        StageBlock block;
+        if (fetchSessionBlock(session, number, block)) {
+            (block.stage == UPDATE_STAGE ? updates : blocks).push_back(block);
+        }
+    }
+    if (blocks.empty()) {
+        return updates;
+    }
+    // A base block named by its hash: its updates are indexed under its business ID
+    BlockHash hash;
+    if (hexToHash(key, hash) && blocks[0].stage != TRANSACTION_BATCH_STAGE) {
+        for (uint64_t number : findBlocksById(session.index, lookupString(stageBlockId(blocks[0])))) {
+            StageBlock block;
+            if (fetchSessionBlock(session, number, block) && block.stage == UPDATE_STAGE) {
+                updates.push_back(block);
+            }
+        }
+    }
+    for (StageBlock& block : blocks) {
+        for (const StageBlock& update : updates) {
+            if (block.stage != TRANSACTION_BATCH_STAGE && update.update.targetHash == blockHeader(block).currentBlockHash) {
+                applyUpdate(block, update.update);
+            }
+        }
+    }
+    return blocks;
+}
+
+// Function to ingest the input files, then any generated vehicles (sequentially, one thread per file or as a pipeline) into the session
+bool ingestInputs(ChainSession& session, const CommandOptions& options) {
+    IngestState& state = session.state;
+    const vector<string>& inputFiles = options.arguments;
+    if (options.pipelineIngest && options.transactionBatchSize > 0) {
+        cerr << "--tx-batch is not supported by --pipeline; every transaction gets its own block" << endl;
+    }
+    if (options.pipelineIngest && options.workload.vehicles != 0) {
+        cerr << "--vehicles is not supported by --pipeline, which reads its rows from files" << endl;
+        return false;
+    }
+    // Generated vehicles are split into one contiguous range per core in parallel mode
+    Workload workload;
+    if (options.workload.vehicles != 0) {
+        prepareWorkload(workload, options.workload);
+    }
+    size_t generators = options.workload.vehicles != 0 && options.parallelIngest ? max(1u, thread::hardware_concurrency()) : 0;
+    if (options.pipelineIngest && !inputFiles.empty()) {
+        // Stage-per-thread pipeline: many vehicles in flight, all appended to one shared chain
+        SharedChain chain;
+        initSharedChain(chain, session.useStore ? &session.store : nullptr, latestHeader(state));
+        atomic<size_t> pipelineBlocks(0);
+        auto consume = [&](const BlockBatch& batch) {
+            pipelineBlocks += batch.blocks.size();
+            keepSessionBlocks(session, batch);
+            if (session.useStore && session.storeOptions.durability == Durability::PerBatch && !commitChainStore(session.store)) {
+                chain.failed.store(true);
+            }
+        };
+        PipelineReport report;
+        bool pipelineOk = runPipeline(inputFiles, chain, options.pipelineOptions, consume, report);
+        printPipelineReport(report);
+        if (!pipelineOk && !chain.failed.load()) {
+            return false;
+        }
+        for (const PipelineStageStats& stats : report.stages) {
+            state.rowsRead += stats.blocks;
+            countMetric(COUNTER_ROWS_INGESTED, stats.blocks);
+        }
+        state.rowsSkipped += report.rowsSkipped + report.signaturesRejected;
+        state.signaturesVerified += report.signaturesVerified;
+        state.signaturesRejected += report.signaturesRejected;
+        session.totalBlocks += pipelineBlocks;
+        session.storeFailed = chain.failed.load();
+        blockNumber.store(chain.nextNumber.load());
+    } else if (options.parallelIngest && inputFiles.size() + generators > 1) {
+        // One producer thread per input file and per range of generated vehicles, all appending to the same
+        // chain (and store) as rows arrive
+        SharedChain chain;
+        initSharedChain(chain, session.useStore ? &session.store : nullptr, latestHeader(state));
+        size_t producerCount = inputFiles.size() + generators;
+        vector<IngestState> parts(producerCount);
+        vector<char> fileOk(producerCount, 0);
+        atomic<size_t> sharedBlocks(0);
+        vector<thread> producers;
+        for (size_t f = 0; f < producerCount; ++f) {
+            parts[f].chain = &chain;
+            parts[f].transactionBatchSize = options.transactionBatchSize;
+            parts[f].findTarget = state.findTarget;
+            parts[f].onBatch = [&](const BlockBatch& batch) {
+                sharedBlocks += batch.blocks.size();
+                keepSessionBlocks(session, batch);
+                if (session.useStore && session.storeOptions.durability == Durability::PerBatch && !commitChainStore(session.store)) {
+                    chain.failed.store(true);
+                }
+            };
+            producers.emplace_back([&, f]() {
+                if (f < inputFiles.size()) {
+                    fileOk[f] = ingestFile(inputFiles[f], parts[f]);
+                } else {
+                    uint64_t vehicles = options.workload.vehicles, range = f - inputFiles.size();
+                    ingestWorkload(workload, vehicles * range / generators, vehicles * (range + 1) / generators, parts[f]);
+                    fileOk[f] = 1;
+                }
+                finishIngest(parts[f]);
+            });
+        }
+        for (thread& producer : producers) {
+            producer.join();
+        }
+        if (find(fileOk.begin(), fileOk.end(), 0) != fileOk.end()) {
+            return false;
+        }
+
+        // Merge the per-file results: counts add up, the newest block of every stage wins
+        for (const IngestState& part : parts) {
+            state.rowsRead += part.rowsRead;
+            state.rowsSkipped += part.rowsSkipped;
+            state.updatesApplied += part.updatesApplied;
+            state.updatesMissed += part.updatesMissed;
+            state.signaturesVerified += part.signaturesVerified;
+            state.signaturesRejected += part.signaturesRejected;
+            if (part.supplier.header.blockNumber > state.supplier.header.blockNumber) state.supplier = part.supplier;
+            if (part.press.header.blockNumber > state.press.header.blockNumber) state.press = part.press;
+            if (part.welding.header.blockNumber > state.welding.header.blockNumber) state.welding = part.welding;
+            if (part.painting.header.blockNumber > state.painting.header.blockNumber) state.painting = part.painting;
+            if (part.assembly.header.blockNumber > state.assembly.header.blockNumber) state.assembly = part.assembly;
+            if (part.shipping.header.blockNumber > state.shipping.header.blockNumber) state.shipping = part.shipping;
+            if (part.transaction.header.blockNumber > state.transaction.header.blockNumber) state.transaction = part.transaction;
+            if (part.transactionBatch.header.blockNumber > state.transactionBatch.header.blockNumber) state.transactionBatch = part.transactionBatch;
+            if (part.update.header.blockNumber > state.update.header.blockNumber) state.update = part.update;
+        }
+        session.totalBlocks += sharedBlocks;
+        session.storeFailed = chain.failed.load();
+        blockNumber.store(chain.nextNumber.load());
+    } else {
+        for (const string& path : inputFiles) {
+            if (!ingestFile(path, state)) {
+                return false;
+            }
+        }
+        ingestWorkload(workload, 0, options.workload.vehicles, state);
+    }
+    finishIngest(state);
+    if (session.storeFailed) {
+        cerr << "Blocks could not be written to " << session.storeOptions.directory << endl;
+        return false;
+    }
+    maybeCheckpoint(session); // Parallel and pipeline consumers index from several threads, so they checkpoint only here
+    return true;
+}
+
+// Function to render every block of the session in chain order
+uint64_t exportSession(ChainSession& session, Renderer& renderer) {
+    if (session.useStore) {
+        return renderStoredChain(session.store, renderer);
+    }
+    uint64_t rendered = 0;
+    for (const StageBlock& block : session.memoryChain) {
+        if (block.stage != 0) {
+            renderBlock(renderer, block);
+            rendered++;
+        }
+    }
+    flushRenderer(renderer);
+    return rendered;
+}
+
+// Function to run an analytics query over the projections of one or more sessions (the shards of a store)
+// and print the merged groups; returns the process exit code
+static int runAnalyticsCommand(const vector<ChainSession*>& sessions, const CommandOptions& options) {
+    AnalyticsQuery query;
+    string error;
+    if (!parseAnalyticsQuery(options.stage, options.value, options.group, options.filter, options.hours, query, error)) {
+        cerr << error << endl;
+        return 2;
+    }
+    AnalyticsResult result;
+    for (ChainSession* session : sessions) {
+        AnalyticsResult part = runAnalyticsQuery(session->analytics, query);
+        if (part.threads == 0) {
+            cerr << "Only numeric columns can be aggregated and only text columns grouped or filtered" << endl;
+            return 2;
+        }
+        if (sessions.size() == 1) {
+            result = move(part);
+        } else {
+            mergeAnalyticsResult(result, part);
+        }
+    }
+    printAnalyticsResult(query, result);
+    return 0;
+}
+
+// Function to find the local day, or the shift of SHIFT_HOURS counted from SHIFT_START_HOUR, holding a timestamp;
+// start and end are nanoseconds since the Unix epoch, end excluded
+static void reportPeriod(uint64_t timestamp, bool shifts, uint64_t& start, uint64_t& end) {
+    time_t second = time_t(timestamp / 1000000000ULL);
+    tm local{};
+    localtime_r(&second, &local);
+    int sinceFirstShift = (local.tm_hour - SHIFT_START_HOUR + 24) % 24;
+    local.tm_hour = shifts ? local.tm_hour - sinceFirstShift % SHIFT_HOURS : 0; // mktime moves a negative hour to the day before
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    time_t first = mktime(&local);
+    local.tm_hour += shifts ? SHIFT_HOURS : 24;
+    local.tm_isdst = -1;
+    time_t next = mktime(&local);
+    start = uint64_t(max<time_t>(first, 0)) * 1000000000ULL;
+    end = max<uint64_t>(uint64_t(max<time_t>(next, 0)) * 1000000000ULL, timestamp + 1);
+}
+
+// Function to count the blocks of every stage per local day or shift inside a time window over one or more sessions
+// (the shards of a store) and print them; the scan reads only the segments and index entries that overlap the
+// window. Returns the process exit code
+static int runReportCommand(const vector<ChainSession*>& sessions, const CommandOptions& options) {
+    TimeRangeQuery query;
+    string error;
+    if (!parseTimeRange(options.from, options.to, options.stage, query, error)) {
+        cerr << error << endl;
+        return 2;
+    }
+    if (options.period != "day" && options.period != "shift") {
+        cerr << "--by takes day or shift" << endl;
+        return 2;
+    }
+    bool shifts = options.period == "shift";
+    auto start = chrono::steady_clock::now();
+    map<uint64_t, array<uint64_t, UPDATE_STAGE + 1>> periods; // Period start -> blocks per stage tag
+    TimeRangeStats stats;
+    for (ChainSession* session : sessions) {
+        StoreReadView view;
+        if (!openStoreReadView(session->store, view)) {
+            cerr << "Cannot read " << session->storeOptions.directory << endl;
+            return 1;
+        }
+        // Blocks arrive in chain order, so consecutive ones nearly always share a period
+        uint64_t periodStart = 0, periodEnd = 0;
+        array<uint64_t, UPDATE_STAGE + 1>* counts = nullptr;
+        scanTimeRange(view, query, stats, [&](uint64_t, uint8_t stage, uint64_t timestamp) {
+            if (counts == nullptr || timestamp < periodStart || timestamp >= periodEnd) {
+                reportPeriod(timestamp, shifts, periodStart, periodEnd);
+                counts = &periods[periodStart];
+            }
+            if (stage <= UPDATE_STAGE) {
+                (*counts)[stage]++;
+            }
+            return true;
+        });
+        closeStoreReadView(view);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Only stages that occur get a column
+    auto stageName = [](size_t tag) -> string {
+        return tag <= TRANSACTION_BATCH_STAGE ? STAGE_RENDER_INFO[tag - 1].name : tag == UPDATE_STAGE ? "Update" : "Anchor";
+    };
+    array<uint64_t, UPDATE_STAGE + 1> totals{};
+    for (const auto& period : periods) {
+        for (size_t tag = 1; tag <= UPDATE_STAGE; ++tag) {
+            totals[tag] += period.second[tag];
+        }
+    }
+    uint64_t blocks = 0;
+    for (uint64_t count : totals) {
+        blocks += count;
+    }
+    cout << "\n===== Block Report : blocks per " << options.period << " =====\n";
+    if (query.fromTimestamp != 0 || query.toTimestamp != UINT64_MAX) {
+        cout << "Window        : " << formatTimestamp(query.fromTimestamp) << " .. "
+             << (query.toTimestamp == UINT64_MAX ? string("now") : formatTimestamp(query.toTimestamp + 1)) << "\n";
+    }
+    if (query.stage != 0) {
+        cout << "Stage         : " << stageName(query.stage) << "\n";
+    }
+    cout << "\n" << left << setw(20) << (shifts ? "Shift" : "Day") << right;
+    for (size_t tag = 1; tag <= UPDATE_STAGE; ++tag) {
+        if (totals[tag] != 0) {
+            cout << setw(max<int>(10, int(stageName(tag).size()) + 2)) << stageName(tag);
+        }
+    }
+    cout << setw(12) << "Total" << "\n";
+    for (const auto& period : periods) {
+        string label = formatTimestamp(period.first);
+        cout << left << setw(20) << (shifts ? label : label.substr(0, 8)) << right;
+        uint64_t total = 0;
+        for (size_t tag = 1; tag <= UPDATE_STAGE; ++tag) {
+            if (totals[tag] != 0) {
+                cout << setw(max<int>(10, int(stageName(tag).size()) + 2)) << period.second[tag];
+                total += period.second[tag];
+            }
+        }
+        cout << setw(12) << total << "\n";
+    }
+    cout << "\nBlocks        : " << blocks << " in " << periods.size() << " " << options.period << (periods.size() == 1 ? "" : "s") << "\n"
+         << "Segments      : " << stats.segmentsRead << " read, " << stats.segmentsSkipped << " skipped by their time bounds\n"
+         << "Index entries : " << stats.groupsRead << " read, " << stats.groupsSkipped << " skipped (" << TIME_INDEX_STRIDE
+         << " records each)\n"
+         << "Records read  : " << stats.recordsRead << " (" << (stats.bytesRead + 1023) / 1024 << " KiB with the index)\n"
+         << "Elapsed       : " << fixed << setprecision(3) << seconds * 1000 << " ms" << defaultfloat << setprecision(6) << endl;
+    return 0;
+}
+
+// Function to run query (lookups) or export over one or more sessions (the shards of a store, in shard order);
+// returns the process exit code
+static int runRenderCommand(const vector<ChainSession*>& sessions, const CommandOptions& options) {
+    Renderer renderer;
+    if (!parseRenderMode(options.format, renderer.mode)) {
+        cerr << "Unknown format " << options.format << endl;
+        return 2;
+    }
+    renderer.describeOnce = true;
+    if (options.command == "query") {
+        if (options.arguments.empty()) {
+            cerr << "query needs a block hash or ID, or --stage for an analytics query" << endl;
+            return 2;
+        }
+        // Every key is looked up; a key without blocks is reported but does not stop the others
+        int status = 0;
+        for (const string& key : options.arguments) {
+            bool found = false;
+            for (ChainSession* session : sessions) {
+                for (const StageBlock& block : findSessionView(*session, key)) {
+                    renderBlock(renderer, block);
+                    found = true;
+                }
+            }
+            if (!found) {
+                cerr << "No block found for " << key << endl;
+                status = 1;
+            }
+        }
+        return flushRenderer(renderer) ? status : 1;
+    }
+    if (options.outPath != "-") {
+        renderer.fd = open(options.outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (renderer.fd < 0) {
+            cerr << "Cannot open " << options.outPath << ": " << strerror(errno) << endl;
+            return 1;
+        }
+    }
+    // --from, --to or --stage export only the blocks of a time window, found through the store's time index
+    TimeRangeQuery range;
+    string error;
+    bool ranged = !options.from.empty() || !options.to.empty() || !options.stage.empty();
+    if (ranged && !parseTimeRange(options.from, options.to, options.stage, range, error)) {
+        cerr << error << endl;
+        return 2;
+    }
+    auto start = chrono::steady_clock::now();
+    uint64_t rendered = 0;
+    TimeRangeStats stats;
+    for (ChainSession* session : sessions) {
+        rendered += ranged && session->useStore ? renderStoredRange(session->store, range, renderer, stats) : exportSession(*session, renderer);
+    }
+    if (renderer.fd != STDOUT_FILENO) {
+        close(renderer.fd);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Exported " << rendered << " blocks in " << fixed << setprecision(3) << seconds << " s"
+         << (renderer.failed ? " (write failed)" : "") << defaultfloat << setprecision(6) << endl;
+    if (ranged) {
+        cerr << "Time index    : " << stats.recordsRead << " records read; " << stats.segmentsSkipped << " of "
+             << stats.segmentsSkipped + stats.segmentsRead << " segments and " << stats.groupsSkipped << " of "
+             << stats.groupsSkipped + stats.groupsRead << " index entries skipped" << endl;
+    }
+    return renderer.failed ? 1 : 0;
+}
+
+// Function to run a headless subcommand; returns the process exit code
+// Machine-readable output goes to standard output, progress and errors to standard error
+int runCommand(ChainSession& session, const CommandOptions& options) {
+    const string& command = options.command;
+    if (command == "generate") {
+        if (options.workload.vehicles == 0) {
+            cerr << "generate needs --vehicles N" << endl;
+            return 2;
+        }
+        auto start = chrono::steady_clock::now();
+        Workload workload;
+        prepareWorkload(workload, options.workload);
+        if (!writeWorkloadFile(workload, options.outPath)) {
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cerr << "Generated " << options.workload.vehicles << " vehicles (" << options.workload.vehicles * 7 << " rows) in "
+             << fixed << setprecision(3) << seconds << " s" << defaultfloat << setprecision(6) << endl;
+        return 0;
+    }
+    if (command != "serve" && !session.useStore) {
+        cerr << command << " needs --store DIR" << endl;
+        return 2;
+    }
+    if (command == "ingest") {
+        if (options.arguments.empty() && options.workload.vehicles == 0) {
+            cerr << "ingest needs at least one input file or --vehicles N" << endl;
+            return 2;
+        }
+        auto start = chrono::steady_clock::now();
+        if (!ingestInputs(session, options)) {
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Startup       : " << fixed << setprecision(3) << session.startupSeconds << " s ("
+             << session.restoredBlocks << " blocks from a checkpoint, " << session.replayedBlocks << " replayed)\n"
+             << defaultfloat << setprecision(6)
+             << "Rows ingested : " << session.state.rowsRead << "\n"
+             << "Rows skipped  : " << session.state.rowsSkipped << "\n"
+             << "Updates       : " << session.state.updatesApplied << " applied, " << session.state.updatesMissed << " skipped\n"
+             << "Signatures    : " << session.state.signaturesVerified << " verified, " << session.state.signaturesRejected << " rejected\n"
+             << "Blocks built  : " << session.totalBlocks << "\n"
+             << "Blocks stored : " << storeBlockCount(session.store) << "\n"
+             << "Stored size   : " << session.store.storedBytes / 1024 << " KiB of " << session.store.canonicalBytes / 1024
+             << " KiB canonical records\n"
+             << "Elapsed       : " << fixed << setprecision(3) << seconds << " s" << defaultfloat << setprecision(6) << endl;
+        if (proofOfWork.difficulty != 0) {
+            printProofOfWorkReport();
+        }
+        return 0;
+    }
+    if (command == "verify") {
+        VerifyReport report = verifyChainStore(session.store);
+        printVerifyReport(report);
+        return report.ok ? 0 : 1;
+    }
+    if (command == "query" && !options.stage.empty()) {
+        return runAnalyticsCommand({&session}, options);
+    }
+    if (command == "report") {
+        return runReportCommand({&session}, options);
+    }
+    if (command == "query" || command == "export") {
+        return runRenderCommand({&session}, options);
+    }
+    if (options.socketPath.empty()) {
+        cerr << "serve needs --socket PATH" << endl;
+        return 2;
+    }
+    return runService(session, options.socketPath) ? 0 : 1;
+}
+
+// Function to get the directory of one shard chain of a sharded store
+static string shardDirectory(const string& directory, unsigned shard) {
+    char name[16];
+    snprintf(name, sizeof(name), "/shard-%03u", shard);
+    return directory + name;
+}
+
+// Function to find how many shard chains a store directory holds (0 for an unsharded store)
+// A sharded store has an anchors/ directory next to shard-000/, shard-001/, ...
+unsigned countShards(const string& directory) {
+    error_code error;
+    if (directory.empty() || !filesystem::is_directory(directory + "/anchors", error)) {
+        return 0;
+    }
+    unsigned count = 0;
+    while (count < MAX_SHARDS && filesystem::is_directory(shardDirectory(directory, count), error)) {
+        count++;
+    }
+    return count;
+}
+
+// Function to pick the shard of a vehicle: the hash of its supplierId, so a supplier's vehicles always share a chain
+unsigned shardOfSupplier(string_view supplierId, unsigned shardCount) {
+    return unsigned(hashString(supplierId) % max(1u, shardCount));
+}
+
+// Anchor record layout: stage tag, anchor number, timestamp, shard count, the (block number, hash) tip of every
+// shard, the Merkle root over those tips, the previous anchor's hash and the anchor's own hash
+// Function to read the shard tips an anchor record commits to; returns false if the record is malformed
+static bool readShardAnchor(string_view record, uint64_t& number, vector<uint64_t>& tipNumbers, vector<BlockHash>& tipHashes, BlockHash& root) {
+    if (record.size() < 1 + 8 + 8 + 4 || uint8_t(record[0]) != SHARD_ANCHOR_STAGE) {
+        return false;
+    }
+    ByteReader reader{record.data() + 1, record.data() + record.size()};
+    number = readUint64(reader);
+    readUint64(reader); // Timestamp
+    uint32_t count = readUint32(reader);
+    if (count > MAX_SHARDS || record.size() != 1 + 8 + 8 + 4 + size_t(count) * (8 + 32) + 3 * 32) {
+        return false;
+    }
+    tipNumbers.resize(count);
+    tipHashes.resize(count);
+    for (uint32_t shard = 0; shard < count; ++shard) {
+        tipNumbers[shard] = readUint64(reader);
+        readHash(reader, tipHashes[shard]);
+    }
+    readHash(reader, root);
+    return reader.ok;
+}
+
+// Function to compute the Merkle root over the shard tips of an anchor (one leaf of block number and hash per shard)
+static BlockHash shardTipsRoot(const vector<uint64_t>& tipNumbers, const vector<BlockHash>& tipHashes) {
+    string tips;
+    for (size_t shard = 0; shard < tipNumbers.size(); ++shard) {
+        appendUint64(tips, tipNumbers[shard]);
+        tips.append(reinterpret_cast<const char*>(tipHashes[shard].data()), tipHashes[shard].size());
+    }
+    vector<string_view> leaves;
+    for (size_t offset = 0; offset < tips.size(); offset += 8 + 32) {
+        leaves.push_back(string_view(tips).substr(offset, 8 + 32));
+    }
+    MerkleTree tree;
+    buildMerkleTree(leaves, tree, 1);
+    return merkleRoot(tree);
+}
+
+// Function to open every shard chain of a sharded store and its anchor chain. A new store takes its shard count
+// from --shards; an existing one keeps the count it was created with
+bool openShardedStore(ShardedStore& sharded, const CommandOptions& options) {
+    const string& directory = options.storeOptions.directory;
+    unsigned existing = countShards(directory);
+    unsigned count = existing != 0 ? existing : options.shardCount;
+    if (options.shardCount != 0 && existing != 0 && options.shardCount != existing) {
+        cerr << directory << " is split into " << existing << " shards, not " << options.shardCount << endl;
+        return false;
+    }
+    if (count > MAX_SHARDS) {
+        cerr << "--shards must be at most " << MAX_SHARDS << endl;
+        return false;
+    }
+    error_code error;
+    if (existing == 0 && filesystem::exists(directory, error) && !filesystem::is_empty(directory, error)) {
+        cerr << directory << " already holds an unsharded chain" << endl;
+        return false;
+    }
+
+    // The anchors directory goes first: it is what marks the directory as a sharded store
+    ChainStoreOptions anchorOptions = options.storeOptions;
+    anchorOptions.directory = directory + "/anchors";
+    anchorOptions.readOnly = commandOnlyReads(options.command);
+    anchorOptions.recover = options.command != "verify";
+    if (!openChainStore(sharded.anchors, anchorOptions)) {
+        return false;
+    }
+    for (unsigned shard = 0; shard < count; ++shard) {
+        CommandOptions shardOptions = options;
+        shardOptions.storeOptions.directory = shardDirectory(directory, shard);
+        sharded.shards.push_back(make_unique<ChainSession>());
+        if (!openSession(*sharded.shards.back(), shardOptions)) {
+            return false;
+        }
+    }
+
+    // New anchors continue after the newest one
+    sharded.anchoredNumbers.assign(count, 0);
+    sharded.anchorCount = storeBlockCount(sharded.anchors);
+    if (sharded.anchorCount != 0) {
+        string_view record;
+        string scratch;
+        uint64_t number;
+        vector<BlockHash> hashes;
+        BlockHash root;
+        if (!readStoreRecord(sharded.anchors, sharded.anchorCount - 1, record, scratch) ||
+            !readShardAnchor(record, number, sharded.anchoredNumbers, hashes, root) || sharded.anchoredNumbers.size() != count) {
+            cerr << "The newest anchor block of " << directory << " is damaged" << endl;
+            return false;
+        }
+        memcpy(sharded.anchorTip.data(), record.data() + record.size() - 32, 32);
+    }
+    return true;
+}
+
+// Function to close every shard chain and the anchor chain
+void closeShardedStore(ShardedStore& sharded) {
+    for (unique_ptr<ChainSession>& shard : sharded.shards) {
+        closeSession(*shard);
+    }
+    closeChainStore(sharded.anchors);
+}
+
+// Function to append an anchor block committing to the current tip of every shard; nothing is written while
+// no shard has moved. The shard stores are committed first, so an anchor never names a block a crash could
+// still take back. Returns false if a shard or the anchor could not be written
+bool anchorShards(ShardedStore& sharded, const vector<SharedChain>& chains) {
+    size_t count = sharded.shards.size();
+    vector<uint64_t> numbers(count);
+    vector<BlockHash> hashes(count);
+    for (size_t shard = 0; shard < count; ++shard) {
+        numbers[shard] = sharedChainTip(chains[shard], hashes[shard]);
+    }
+    if (numbers == sharded.anchoredNumbers) {
+        return true;
+    }
+    for (size_t shard = 0; shard < count; ++shard) {
+        if (chains[shard].failed.load() || !commitChainStore(sharded.shards[shard]->store)) {
+            return false;
+        }
+    }
+
+    string record;
+    record.push_back(char(SHARD_ANCHOR_STAGE));
+    appendUint64(record, sharded.anchorCount + 1);
+    appendUint64(record, generateTimestamp());
+    appendUint32(record, uint32_t(count));
+    for (size_t shard = 0; shard < count; ++shard) {
+        appendUint64(record, numbers[shard]);
+        record.append(reinterpret_cast<const char*>(hashes[shard].data()), hashes[shard].size());
+    }
+    BlockHash root = shardTipsRoot(numbers, hashes);
+    record.append(reinterpret_cast<const char*>(root.data()), root.size());
+    record.append(reinterpret_cast<const char*>(sharded.anchorTip.data()), sharded.anchorTip.size());
+    BlockHash hash;
+    sha256(record.data(), record.size(), hash.data());
+    record.append(reinterpret_cast<const char*>(hash.data()), hash.size());
+    if (!appendBlockRecord(sharded.anchors, record) || !commitChainStore(sharded.anchors)) {
+        return false;
+    }
+    sharded.anchorCount++;
+    sharded.anchorTip = hash;
+    sharded.anchoredNumbers = numbers;
+    return true;
+}
+
+// Function to ingest the rows of one input file that belong to a shard. A vehicle belongs to the shard its
+// supplierId hashes to; the rows of other shards' vehicles are passed over without being split, while update
+// rows go to every shard
+static bool ingestShardFile(const string& path, IngestState& state, unsigned shard, unsigned shardCount) {
+    bool owned = shard == 0; // Rows ahead of the first supplier row (a header) are counted by shard 0
+    return scanFileRows(path, [&state](const vector<string_view>& fields, string_view, char) {
+        ingestRow(state, fields);
+    }, [&](string_view row, char delimiter) {
+        string_view id = row.substr(0, row.find(delimiter));
+        if (id.size() >= 2 && id.front() == '"') {
+            id = id.substr(1, id.find('"', 1) - 1);
+        }
+        if (id == "UPDATE") {
+            return true; // Every shard tries it; only the one holding the target applies it
+        }
+        if (stageOfRow(id) == 1) {
+            owned = shardOfSupplier(id, shardCount) == shard;
+        }
+        return owned;
+    });
+}
+
+// Function to ingest the generated vehicles whose supplierId hashes to a shard (only the supplierId is drawn
+// for the vehicles of other shards)
+static void ingestShardWorkload(const Workload& workload, IngestState& state, unsigned shard, unsigned shardCount) {
+    string supplierId;
+    for (uint64_t vehicle = 0; vehicle < workload.options.vehicles; ++vehicle) {
+        workloadSupplierId(workload, vehicle, supplierId);
+        if (shardOfSupplier(supplierId, shardCount) == shard) {
+            ingestWorkload(workload, vehicle, vehicle + 1, state);
+        }
+    }
+}
+
+// Function to ingest the input files and any generated vehicles into a sharded store: one thread per shard reads
+// every file (and draws every vehicle), keeps the vehicles that hash to it and appends them to its own chain (own counter, own tip, own store), so shards
+// never wait on each other. Meanwhile this thread writes an anchor every anchorIntervalMs, and once at the end
+bool ingestShards(ShardedStore& sharded, const CommandOptions& options) {
+    size_t count = sharded.shards.size();
+    Workload workload;
+    prepareWorkload(workload, options.workload);
+    vector<SharedChain> chains(count);
+    vector<char> shardOk(count, 1);
+    size_t running = count;
+    mutex runningLock;
+    condition_variable finished;
+    vector<thread> workers;
+    for (size_t shard = 0; shard < count; ++shard) {
+        ChainSession& session = *sharded.shards[shard];
+        SharedChain& chain = chains[shard];
+        initSharedChain(chain, &session.store, latestHeader(session.state));
+        session.state.chain = &chain;
+        session.state.onBatch = [&session, &chain](const BlockBatch& batch) {
+            session.totalBlocks += batch.blocks.size();
+            keepSessionBlocks(session, batch);
+            if (session.storeOptions.durability == Durability::PerBatch && !commitChainStore(session.store)) {
+                chain.failed.store(true);
+            }
+            maybeCheckpoint(session);
+        };
+        workers.emplace_back([&, shard]() {
+            IngestState& state = sharded.shards[shard]->state;
+            for (const string& path : options.arguments) {
+                if (!ingestShardFile(path, state, unsigned(shard), unsigned(count))) {
+                    shardOk[shard] = 0;
+                    break;
+                }
+            }
+            ingestShardWorkload(workload, state, unsigned(shard), unsigned(count));
+            finishIngest(state);
+            lock_guard<mutex> guard(runningLock);
+            running--;
+            finished.notify_all();
+        });
+    }
+
+    bool anchored = true;
+    {
+        unique_lock<mutex> guard(runningLock);
+        while (running != 0) {
+            if (options.anchorIntervalMs == 0) {
+                finished.wait(guard);
+            } else if (!finished.wait_for(guard, chrono::milliseconds(options.anchorIntervalMs), [&] { return running == 0; })) {
+                guard.unlock();
+                anchored = anchorShards(sharded, chains) && anchored;
+                guard.lock();
+            }
+        }
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    bool ok = find(shardOk.begin(), shardOk.end(), 0) == shardOk.end();
+    for (size_t shard = 0; shard < count; ++shard) {
+        ChainSession& session = *sharded.shards[shard];
+        session.state.chain = nullptr;
+        if (session.storeFailed || chains[shard].failed.load()) {
+            session.storeFailed = true;
+            cerr << "Blocks could not be written to " << session.storeOptions.directory << endl;
+            ok = false;
+        }
+    }
+    anchored = anchored && ok && anchorShards(sharded, chains);
+    if (ok && !anchored) {
+        cerr << "Anchor blocks could not be written to " << sharded.anchors.options.directory << endl;
+    }
+    return ok && anchored;
+}
+
+// Function to verify a sharded store: every shard chain on all cores, then every anchor block's hash, link
+// and Merkle root, and that every shard tip it commits to is the block with that number in the shard's store
+ShardVerifyReport verifyShardedStore(ShardedStore& sharded) {
+    ShardVerifyReport report;
+    auto start = chrono::steady_clock::now();
+    for (unique_ptr<ChainSession>& shard : sharded.shards) {
+        report.shards.push_back(verifyChainStore(shard->store));
+        report.ok = report.ok && report.shards.back().ok;
+    }
+
+    size_t count = sharded.shards.size();
+    vector<uint64_t> numbers, previousNumbers(count, 0);
+    vector<BlockHash> hashes;
+    BlockHash root, previousHash{};
+    string scratch, shardScratch;
+    uint64_t anchors = storeBlockCount(sharded.anchors);
+    for (uint64_t index = 0; index < anchors && report.reason.empty(); ++index) {
+        string_view record;
+        uint64_t number = 0;
+        BlockHash hash{};
+        bool parsed = readStoreRecord(sharded.anchors, index, record, scratch) && readShardAnchor(record, number, numbers, hashes, root);
+        if (parsed) {
+            sha256(record.data(), record.size() - 32, hash.data());
+        }
+        if (!parsed) {
+            report.reason = "anchor record is malformed";
+        } else if (number != index + 1 || numbers.size() != count) {
+            report.reason = "anchor is out of sequence or covers a different number of shards";
+        } else if (memcmp(hash.data(), record.data() + record.size() - 32, 32) != 0) {
+            report.reason = "stored hash does not match the anchor content";
+        } else if (memcmp(record.data() + record.size() - 64, previousHash.data(), 32) != 0) {
+            report.reason = "previous anchor hash does not match the preceding anchor";
+        } else if (shardTipsRoot(numbers, hashes) != root) {
+            report.reason = "Merkle root does not match the shard tips";
+        }
+        for (size_t shard = 0; shard < count && report.reason.empty(); ++shard) {
+            // A shard tip never moves back, and must still be in the shard's store with the same hash
+            string_view tip;
+            if (numbers[shard] < previousNumbers[shard]) {
+                report.reason = "a shard tip moved back";
+            } else if (numbers[shard] != 0 && (!readStoreRecord(sharded.shards[shard]->store, numbers[shard] - 1, tip, shardScratch) ||
+                                               tip.size() < 32 || memcmp(tip.data() + tip.size() - 32, hashes[shard].data(), 32) != 0)) {
+                report.reason = "shard " + to_string(shard) + " no longer holds the anchored block #" + to_string(numbers[shard]);
+            }
+        }
+        if (!report.reason.empty()) {
+            report.firstBadAnchor = index + 1;
+            break;
+        }
+        memcpy(previousHash.data(), record.data() + record.size() - 32, 32);
+        previousNumbers = numbers;
+        report.anchorsChecked++;
+    }
+    report.ok = report.ok && report.reason.empty();
+    for (size_t shard = 0; shard < count; ++shard) {
+        report.unanchoredBlocks.push_back(storeBlockCount(sharded.shards[shard]->store) - previousNumbers[shard]);
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+// Function to print the result of a sharded store verification: one line per shard, then the anchors
+void printShardVerifyReport(const ShardVerifyReport& report) {
+    cout << "\n===== Sharded Chain Verification =====\n" << endl;
+    cout << (report.ok ? ANSI_GREEN : ANSI_RED);
+    cout << "Result           : " << (report.ok ? "OK - every shard, anchor and anchored tip is valid" : "FAILED") << endl;
+    cout << ANSI_RESET;
+    for (size_t shard = 0; shard < report.shards.size(); ++shard) {
+        const VerifyReport& part = report.shards[shard];
+        cout << "Shard " << setw(3) << shard << "        : " << part.blocksChecked << " blocks, "
+             << report.unanchoredBlocks[shard] << " after the newest anchor";
+        if (!part.ok) {
+            cout << ANSI_RED << " - FAILED at #" << part.firstBadBlockNumber << ": " << part.reason << ANSI_RESET;
+        }
+        cout << endl;
+    }
+    uint64_t unregistered = 0;
+    for (const VerifyReport& part : report.shards) {
+        unregistered += part.signaturesUnregistered;
+    }
+    printUnregisteredSignatures(unregistered);
+    cout << "Anchors checked  : " << report.anchorsChecked << endl;
+    if (!report.reason.empty()) {
+        cout << ANSI_RED << "First bad anchor : #" << report.firstBadAnchor << endl;
+        cout << "Reason           : " << report.reason << ANSI_RESET << endl;
+    }
+    cout << "Elapsed          : " << fixed << setprecision(3) << report.seconds << " s" << defaultfloat << setprecision(6) << endl;
+}
+
+// Function to run a headless subcommand on a sharded store; returns the process exit code
+// Lookups, analytics and exports run over every shard in shard order
+int runShardedCommand(ShardedStore& sharded, const CommandOptions& options) {
+    const string& command = options.command;
+    vector<ChainSession*> sessions;
+    for (unique_ptr<ChainSession>& shard : sharded.shards) {
+        sessions.push_back(shard.get());
+    }
+    if (command == "ingest") {
+        if (options.arguments.empty() && options.workload.vehicles == 0) {
+            cerr << "ingest needs at least one input file or --vehicles N" << endl;
+            return 2;
+        }
+        if (options.parallelIngest || options.pipelineIngest) {
+            cerr << "--parallel and --pipeline do not apply to a sharded store; every shard has its own thread" << endl;
+        }
+        auto start = chrono::steady_clock::now();
+        if (!ingestShards(sharded, options)) {
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        double startup = 0;
+        uint64_t restored = 0, replayed = 0, rows = 0, skipped = 0, built = 0, stored = 0, storedBytes = 0, canonicalBytes = 0;
+        uint64_t updates = sessions[0]->state.updatesApplied + sessions[0]->state.updatesMissed, applied = 0;
+        uint64_t signaturesVerified = 0, signaturesRejected = 0;
+        string perShard;
+        for (ChainSession* session : sessions) {
+            startup += session->startupSeconds;
+            restored += session->restoredBlocks;
+            replayed += session->replayedBlocks;
+            rows += session->state.rowsRead;
+            // Every shard sees every update row but at most one holds its target, so the misses are counted once
+            skipped += session->state.rowsSkipped - session->state.updatesMissed;
+            applied += session->state.updatesApplied;
+            signaturesVerified += session->state.signaturesVerified;
+            signaturesRejected += session->state.signaturesRejected;
+            built += session->totalBlocks;
+            stored += storeBlockCount(session->store);
+            storedBytes += session->store.storedBytes;
+            canonicalBytes += session->store.canonicalBytes;
+            perShard += (perShard.empty() ? "" : " / ") + to_string(storeBlockCount(session->store));
+        }
+        cout << "Startup       : " << fixed << setprecision(3) << startup << " s ("
+             << restored << " blocks from a checkpoint, " << replayed << " replayed)\n"
+             << defaultfloat << setprecision(6)
+             << "Shards        : " << sessions.size() << " (" << perShard << " blocks)\n"
+             << "Rows ingested : " << rows << "\n"
+             << "Rows skipped  : " << skipped + (updates - min(updates, applied)) << "\n"
+             << "Updates       : " << applied << " applied, " << updates - min(updates, applied) << " skipped\n"
+             << "Signatures    : " << signaturesVerified << " verified, " << signaturesRejected << " rejected\n"
+             << "Blocks built  : " << built << "\n"
+             << "Blocks stored : " << stored << "\n"
+             << "Anchors       : " << sharded.anchorCount << "\n"
+             << "Stored size   : " << storedBytes / 1024 << " KiB of " << canonicalBytes / 1024 << " KiB canonical records\n"
+             << "Elapsed       : " << fixed << setprecision(3) << seconds << " s" << defaultfloat << setprecision(6) << endl;
+        if (proofOfWork.difficulty != 0) {
+            printProofOfWorkReport();
+        }
+        return 0;
+    }
+    if (command == "verify") {
+        ShardVerifyReport report = verifyShardedStore(sharded);
+        printShardVerifyReport(report);
+        return report.ok ? 0 : 1;
+    }
+    if (command == "query" && !options.stage.empty()) {
+        return runAnalyticsCommand(sessions, options);
+    }
+    if (command == "report") {
+        return runReportCommand(sessions, options);
+    }
+    if (command == "query" || command == "export") {
+        return runRenderCommand(sessions, options);
+    }
+    cerr << "serve does not take a sharded store" << endl;
+    return 2;
+}
+
+// Function to apply one request line of the service protocol and append its reply:
+//   APPEND <csv row>   -> OK <block number> | OK batched (waits for its Merkle batch) | ERR <reason>
+//   GET <hash or ID>   -> OK <n>, then the n blocks as JSON lines
+//   VERIFY             -> OK <blocks checked> | ERR <reason>
+//   STATS              -> OK blocks=<n> rows=<n> skipped=<n>
+//   METRICS            -> OK <n>, then n lines of metrics in the Prometheus text format
+//   QUIT               -> OK, then the connection is closed
+// Returns false when the connection should be closed
+static bool handleServiceRequest(ChainSession& session, ServiceClient& client, string_view line, vector<string_view>& fields, string& scratch) {
+    MetricTimer timer(METRIC_SERVICE_REQUEST);
+    string& reply = client.output;
+    size_t space = line.find(' ');
+    string_view verb = line.substr(0, space);
+    string_view rest = space == string_view::npos ? string_view() : line.substr(space + 1);
+    if (verb == "APPEND") {
+        splitRow(rest, rest.find('\t') != string_view::npos ? '\t' : ',', fields, scratch);
+        if (!ingestRow(client.ingest, fields)) {
+            session.state.rowsSkipped++;
+            reply += "ERR row skipped (unknown stage, out of vehicle order or no such update target)\n";
+            return true;
+        }
+        session.state.rowsRead++;
+        if (client.ingest.tipStage != UPDATE_STAGE && client.ingest.lastStage == 7 && client.ingest.transactionBatchSize > 0) {
+            reply += "OK batched\n";
+        } else {
+            reply += "OK " + to_string(latestHeader(client.ingest)->blockNumber) + "\n";
+        }
+        return true;
+    }
+    // Reads see every earlier append of the same connection, including earlier lines of the same pass
+    flushBatch(client.ingest);
+    if (verb == "GET") {
+        vector<StageBlock> blocks = findSessionView(session, string(rest));
+        Renderer renderer;
+        renderer.mode = RenderMode::JsonLines;
+        renderer.flushSize = SIZE_MAX; // Collect the blocks here; the loop sends them with the other replies
+        for (const StageBlock& block : blocks) {
+            renderBlock(renderer, block);
+        }
+        reply += "OK " + to_string(blocks.size()) + "\n" + renderer.buffer;
+    } else if (verb == "VERIFY") {
+        if (!session.useStore) {
+            reply += "ERR no chain store is open\n";
+            return true;
+        }
+        VerifyReport report = verifyChainStore(session.store);
+        reply += report.ok ? "OK " + to_string(report.blocksChecked) + "\n"
+                           : "ERR block " + to_string(report.firstBadBlockNumber) + ": " + report.reason + "\n";
+    } else if (verb == "STATS") {
+        reply += "OK blocks=" + to_string(session.useStore ? storeBlockCount(session.store) : uint64_t(session.totalBlocks)) +
+                 " rows=" + to_string(session.state.rowsRead) + " skipped=" + to_string(session.state.rowsSkipped) + "\n";
+    } else if (verb == "METRICS") {
+        string text = formatMetrics();
+        reply += "OK " + to_string(count(text.begin(), text.end(), '\n')) + "\n" + text;
+    } else if (verb == "QUIT") {
+        reply += "OK\n";
+        return false;
+    } else {
+        reply += "ERR unknown request " + string(verb) + "\n";
+    }
+    return true;
+}
+
+// Function to serve appends and lookups on a Unix domain socket until SIGINT or SIGTERM
+// One thread runs an epoll loop over every connection. Clients may pipeline any number of requests: each pass
+// applies every complete line that has arrived, flushes and commits the appends as one group, and only then
+// sends the replies, so an OK means the block is in the store. Replies are sent in request order. Every
+// connection appends to one shared chain, like the producer threads of --parallel
+bool runService(ChainSession& session, const string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path is too long: " << socketPath << endl;
+        return false;
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    // Replace a socket left behind by an earlier run, but never anything else
+    struct stat existing;
+    if (lstat(socketPath.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            cerr << socketPath << " exists and is not a socket" << endl;
+            return false;
+        }
+        unlink(socketPath.c_str());
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    // Only the owner may connect: the socket replaces the menu's login
+    mode_t previousMask = umask(0077);
+    bool bound = listener >= 0 && bind(listener, (const sockaddr*) &address, sizeof(address)) == 0;
+    umask(previousMask);
+    if (!bound || listen(listener, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+        if (listener >= 0) close(listener);
+        return false;
+    }
+
+    // SIGINT and SIGTERM arrive as readable events, so shutdown happens between passes; SIGUSR1 dumps the metrics
+    // (main already blocked them for every thread; blocking again covers callers that did not)
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int loop = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(loop, EPOLL_CTL_ADD, listener, &event);
+    event.data.fd = signalFd;
+    epoll_ctl(loop, EPOLL_CTL_ADD, signalFd, &event);
+    cerr << "Serving " << (session.useStore ? session.storeOptions.directory : string("an in-memory chain")) << " on " << socketPath << endl;
+    if (session.useStore) {
+        cerr << "Restored in " << fixed << setprecision(3) << session.startupSeconds << " s: " << session.restoredBlocks
+             << " blocks from a checkpoint, " << session.replayedBlocks << " replayed" << defaultfloat << setprecision(6) << endl;
+    }
+
+    SharedChain chain;
+    initSharedChain(chain, session.useStore ? &session.store : nullptr, latestHeader(session.state));
+    auto keep = [&session](const BlockBatch& batch) {
+        session.totalBlocks += batch.blocks.size();
+        keepSessionBlocks(session, batch);
+    };
+    // Dropping a connection seals what it still holds (its pending transactions)
+    map<int, ServiceClient> clients;
+    auto disconnect = [&](int fd) {
+        finishIngest(clients[fd].ingest);
+        epoll_ctl(loop, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        clients.erase(fd);
+    };
+    vector<epoll_event> events(SERVICE_MAX_EVENTS);
+    vector<int> active;
+    vector<string_view> fields;
+    string scratch;
+    char chunk[65536];
+    bool running = true;
+    while (running) {
+        int ready = epoll_wait(loop, events.data(), SERVICE_MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Service loop failed: " << strerror(errno) << endl;
+            break;
+        }
+        active.clear();
+        for (int e = 0; e < ready; ++e) {
+            int fd = events[e].data.fd;
+            if (fd == signalFd) {
+                // Consume the signal so it is not delivered again once it is unblocked
+                signalfd_siginfo signal;
+                while (read(signalFd, &signal, sizeof(signal)) == sizeof(signal)) {
+                    if (signal.ssi_signo != SIGUSR1) {
+                        running = false;
+                    } else if (session.metricsPath.empty() || writeMetricsFile(session.metricsPath)) {
+                        printMetricsReport(cerr);
+                    }
+                }
+            } else if (fd == listener) {
+                int connection;
+                while ((connection = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    ServiceClient& client = clients[connection];
+                    client.fd = connection;
+                    client.ingest.chain = &chain;
+                    client.ingest.transactionBatchSize = session.state.transactionBatchSize;
+                    client.ingest.onBatch = keep;
+                    client.ingest.findTarget = session.state.findTarget;
+                    event.events = EPOLLIN;
+                    event.data.fd = connection;
+                    epoll_ctl(loop, EPOLL_CTL_ADD, connection, &event);
+                }
+            } else {
+                ServiceClient& client = clients[fd];
+                // A client with a full reply backlog is not read from until it catches up
+                bool hungUp = false;
+                while (!client.closing && client.output.size() < SERVICE_OUTPUT_LIMIT) {
+                    ssize_t received = read(fd, chunk, sizeof(chunk));
+                    if (received > 0) {
+                        client.input.append(chunk, size_t(received));
+                        if (size_t(received) < sizeof(chunk)) break;
+                    } else {
+                        hungUp = received == 0 || (errno != EAGAIN && errno != EINTR);
+                        break;
+                    }
+                }
+                size_t position = 0, end;
+                while (!client.closing && (end = client.input.find('\n', position)) != string::npos) {
+                    string_view line(client.input.data() + position, end - position);
+                    if (!line.empty() && line.back() == '\r') {
+                        line.remove_suffix(1);
+                    }
+                    position = end + 1;
+                    if (!line.empty()) {
+                        client.closing = !handleServiceRequest(session, client, line, fields, scratch);
+                    }
+                }
+                client.input.erase(0, position);
+                if (client.input.size() > SERVICE_MAX_LINE) {
+                    client.output += "ERR request line too long\n";
+                    client.closing = true;
+                }
+                // Requests that arrived before the end of input are still answered
+                client.closing = client.closing || hungUp;
+                active.push_back(fd);
+            }
+        }
+
+        // Group commit: every append of this pass reaches the store before any reply goes out
+        for (int fd : active) {
+            flushBatch(clients[fd].ingest);
+        }
+        session.storeFailed = chain.failed.load() || (session.useStore && session.storeOptions.durability == Durability::PerBatch &&
+                                                      !active.empty() && !commitChainStore(session.store));
+        if (session.storeFailed) {
+            cerr << "Blocks could not be written to " << session.storeOptions.directory << endl;
+            running = false;
+        } else if (!active.empty()) {
+            maybeCheckpoint(session);
+        }
+        bool disconnected = false;
+        for (int fd : active) {
+            ServiceClient& client = clients[fd];
+            size_t sent = 0;
+            while (sent < client.output.size()) {
+                ssize_t written = send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+                if (written <= 0) {
+                    if (written < 0 && errno != EAGAIN && errno != EINTR) {
+                        client.output.clear();
+                        sent = 0;
+                        client.closing = true;
+                    }
+                    break;
+                }
+                sent += size_t(written);
+            }
+            client.output.erase(0, sent);
+            if (client.closing && client.output.empty()) {
+                disconnect(fd);
+                disconnected = true;
+                continue;
+            }
+            // Wait for room in the socket while replies are pending, for requests otherwise
+            event.events = client.output.empty() ? EPOLLIN : client.output.size() < SERVICE_OUTPUT_LIMIT && !client.closing ? EPOLLIN | EPOLLOUT : EPOLLOUT;
+            event.data.fd = fd;
+            epoll_ctl(loop, EPOLL_CTL_MOD, fd, &event);
+        }
+        // A closed connection's last transactions were just sealed into a batch block
+        if (disconnected && session.useStore && session.storeOptions.durability == Durability::PerBatch) {
+            session.storeFailed = !commitChainStore(session.store) || session.storeFailed;
+        }
+    }
+
+    // Seal any transactions still waiting for their batch block before the store is closed
+    while (!clients.empty()) {
+        disconnect(clients.begin()->first);
+    }
+    session.storeFailed = chain.failed.load() || (session.useStore && !commitChainStore(session.store));
+    blockNumber.store(chain.nextNumber.load());
+    close(loop);
+    close(signalFd);
+    close(listener);
+    unlink(socketPath.c_str());
+    sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+    cerr << "Service stopped after " << session.totalBlocks << " blocks" << endl;
+    if (proofOfWork.difficulty != 0) {
+        printProofOfWorkReport();
+    }
+    return !session.storeFailed;
+}
+
+// The benchmark suite (bench.cpp) includes this file with TMS_NO_MAIN defined and brings its own main
+#ifndef TMS_NO_MAIN
+//Main function allows users to display the dataset, view the blockchains, or quit the program based on their input
+//A subcommand (ingest, verify, query, export, report, serve, generate) runs headless instead: no login, no menu, an exit code per outcome
+int main(int argc, char* argv[]) {
+
+    // Read the command-line options: subcommand, input files or lookup keys, plus optional persistent store settings
+    CommandOptions options;
+    if (!parseCommandLine(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    proofOfWork.difficulty = options.powDifficulty;
+    if (!prepareSignerKeys(options)) {
+        return 1;
+    }
+    ChainSession session;
+    if (!options.command.empty()) {
+        if (options.command == "serve") {
+            // The service takes SIGINT, SIGTERM and SIGUSR1 as loop events; block them before the store starts any thread,
+            // since threads inherit the mask and an unblocked one would take the signal's default action
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGINT);
+            sigaddset(&signals, SIGTERM);
+            sigaddset(&signals, SIGUSR1);
+            sigprocmask(SIG_BLOCK, &signals, nullptr);
+        }
+        int status;
+        if (options.shardCount != 0 || countShards(options.storeOptions.directory) != 0) {
+            // Sharded stores keep one session per shard chain
+            ShardedStore sharded;
+            bool opened = openShardedStore(sharded, options);
+            status = opened ? runShardedCommand(sharded, options) : 1;
+            closeShardedStore(sharded);
+        } else {
+            if (!openSession(session, options)) {
+                return 1;
+            }
+            status = runCommand(session, options);
+            closeSession(session);
+        }
+        if (!options.metricsPath.empty()) {
+            printMetricsReport(cerr);
+            if (!writeMetricsFile(options.metricsPath) && status == 0) {
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    if (options.shardCount != 0 || countShards(options.storeOptions.directory) != 0) {
+        cerr << "The menu works on one chain; use the subcommands for a sharded store" << endl;
+        return 2;
+    }
+
+    // Define a valid user
+    User validUser;
+    validUser.username = "username";
+    validUser.password = "password";
+    bool isAuthenticated = false;
+    while (!isAuthenticated){
+        // Get input username and password from the user
+        string inputUsername, inputPassword;
+        cout << "=== User Authentication ===\n";
+        cout << "Enter username: ";
+        cin >> inputUsername;
+        cout << "Enter password: ";
+        cin >> inputPassword;
+        cout << endl;
+
+        // Perform user authentication
+        if (authenticateUser(inputUsername, inputPassword, validUser)) {
+            cout << "Authentication successful.Welcome, " << inputUsername << "!\n" <<endl;
+            break;
+        } else {
+            cout << "Authentication failed. Invalid username or password.\n" << endl;
+        }
+    }
+
+    // Reopen the store, if any, so new blocks continue its chain
+    if (!openSession(session, options)) {
+        return 1;
+    }
+    IngestState& state = session.state;
+    ChainStore& store = session.store;
+    bool useStore = session.useStore;
+    const vector<string>& inputFiles = options.arguments;
+
+    // Generate the blockchain blocks from the input files, or from the built-in dataset when starting from nothing
+    if (!inputFiles.empty() || options.workload.vehicles != 0) {
+        if (!ingestInputs(session, options)) {
+            return 1;
+        }
+    } else if (state.lastStage == 0) {
+        ingestDataset(dataset, state);
+        finishIngest(state);
+        if (session.storeFailed) {
+            cerr << "Blocks could not be written to " << options.storeOptions.directory << endl;
+            return 1;
+        }
+    }
+    if (proofOfWork.difficulty != 0) {
+        printProofOfWorkReport();
+    }
+
+    // Menu loop for interacting with the blockchains
+    int input;
+    bool isLoop = true;
+    while (isLoop) {
+
+        // Display menu options
+        cout << "--------------- Menu --------------" << endl;
+        cout << "|   1. Display the dataset        |" << endl;
+        cout << "|   2. Display the blockchains    |" << endl;
+        cout << "|   3. Verify the blockchains     |" << endl;
+        cout << "|   4. Look up a block            |" << endl;
+        cout << "|   5. Trace a vehicle            |" << endl;
+        cout << "|   6. Export the blockchains     |" << endl;
+        cout << "|   7. Run an analytics query     |" << endl;
+        cout << "|   8. Quit                       |" << endl;
+        cout << "-----------------------------------" << endl;
+        cout << "Enter the number: ";
+        cin >> input;
+
+        // Perform action based on user input
+        switch (input) {
+            case 1:
+                if (!inputFiles.empty() || useStore) {
+                    cout << "\n===== Dataset =====\n" << endl;
+                    cout << "Rows ingested : " << state.rowsRead << endl;
+                    cout << "Rows skipped  : " << state.rowsSkipped << endl;
+                    cout << "Blocks built  : " << session.totalBlocks << endl;
+                    if (useStore) {
+                        cout << "Blocks stored : " << storeBlockCount(store) << endl;
+                    }
+                    cout << endl;
+                } else {
+                    printDataset(dataset);
+                }
+                break;
+            case 2:
+                // Show the most recent block of every stage that has been ingested
+                // (block numbers start at 1, so a zero header means the stage has no block yet)
+                if (state.supplier.header.blockNumber != 0) printSupplierBlockchain(state.supplier);
+                if (state.press.header.blockNumber != 0) printPressBlockchain(state.press);
+                if (state.welding.header.blockNumber != 0) printWeldingBlockchain(state.welding);
+                if (state.painting.header.blockNumber != 0) printPaintingBlockchain(state.painting);
+                if (state.assembly.header.blockNumber != 0) printAssemblyBlockchain(state.assembly);
+                if (state.shipping.header.blockNumber != 0) printShippingBlockchain(state.shipping);
+                if (state.transaction.header.blockNumber != 0) printTransactionBlockchain(state.transaction);
+                if (state.transactionBatch.header.blockNumber != 0) printStageBlock(toStageBlock(state.transactionBatch));
+                break;
+            case 3:
+                if (useStore) {
+                    printVerifyReport(verifyChainStore(store));
+                } else {
+                    cout << "\nNo chain store is open. Start the program with --store DIR to verify the chain.\n" << endl;
+                }
+                break;
+            case 4: {
+                string key;
+                cout << "Enter a block hash or ID: ";
+                cin >> key;
+                vector<StageBlock> blocks = findSessionView(session, key);
+                if (blocks.empty()) {
+                    cout << "\nNo block found for " << key << "\n" << endl;
+                }
+                for (const StageBlock& block : blocks) {
+                    printStageBlock(block);
+                    // A batched transaction is shown with the proof that ties it to the batch header
+                    vector<TransactionBlockchain> transactions;
+                    MerkleProof proof;
+                    if (block.stage == TRANSACTION_BATCH_STAGE && fetchSessionBatch(session, blockHeader(block).blockNumber, transactions) &&
+                        proveTransaction(transactions, key, proof)) {
+                        printTransactionProof(block.batch, transactions[proof.leafIndex], proof);
+                    }
+                }
+                break;
+            }
+            case 5: {
+                // Trace every vehicle that went through the named blocks: a TRANS or SHIP ID traces back to its
+                // supplier, a SUP ID lists every vehicle built from that supplier's lots
+                string key;
+                cout << "Enter a block hash or ID: ";
+                cin >> key;
+                vector<uint64_t> numbers = findSessionBlocks(session, key);
+                if (numbers.empty()) {
+                    cout << "\nNo block found for " << key << "\n" << endl;
+                    break;
+                }
+                vector<VehicleTrace> traces = traceVehicles(session.provenance, numbers);
+                // Update blocks carry the ID of their target but are not part of any vehicle
+                traces.erase(remove(traces.begin(), traces.end(), VehicleTrace{}), traces.end());
+                cout << "\n===== Provenance of " << key << " (" << traces.size() << " vehicle" << (traces.size() == 1 ? "" : "s") << ") =====\n" << endl;
+                for (const VehicleTrace& trace : traces) {
+                    string line;
+                    for (uint64_t number : trace) {
+                        StageBlock block;
+                        if (number == 0 || !fetchSessionBlock(session, number, block)) {
+                            continue;
+                        }
+                        line += (line.empty() ? "" : " -> ") + string(lookupString(stageBlockId(block))) + " (#" + to_string(number) + ")";
+                    }
+                    cout << line << endl;
+                }
+                cout << endl;
+                break;
+            }
+            case 6: {
+                // Dump the whole chain through the buffered renderer; "-" writes to the terminal
+                string format, path;
+                cout << "Enter the format (console, plain, jsonl, csv): ";
+                cin >> format;
+                cout << "Enter the output file (- for the screen): ";
+                cin >> path;
+                Renderer renderer;
+                if (!parseRenderMode(format, renderer.mode)) {
+                    cout << "Unknown format " << format << endl;
+                    break;
+                }
+                renderer.describeOnce = true;
+                if (path != "-") {
+                    renderer.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                    if (renderer.fd < 0) {
+                        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+                        break;
+                    }
+                }
+                auto start = chrono::steady_clock::now();
+                uint64_t rendered = exportSession(session, renderer);
+                if (renderer.fd != STDOUT_FILENO) {
+                    close(renderer.fd);
+                }
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                cout << "\nExported " << rendered << " blocks in " << fixed << setprecision(3) << seconds << " s"
+                     << (renderer.failed ? " (write failed)" : "") << defaultfloat << setprecision(6) << "\n" << endl;
+                break;
+            }
+            case 7: {
+                // Aggregate one stage's column, optionally grouped, filtered and limited to recent blocks
+                AnalyticsQuery query;
+                string stageName, valueKey, groupKey, filter;
+                double hours;
+                cout << "Enter the stage (Supply, Press, Welding, Paint, Assembly, Shipping, Transaction): ";
+                cin >> stageName;
+                cout << "Enter the value column (- to count rows): ";
+                cin >> valueKey;
+                cout << "Enter the group column (- for none): ";
+                cin >> groupKey;
+                cout << "Enter the filter as column=value (- for none): ";
+                cin >> filter;
+                cout << "Enter the time window in hours (0 for all blocks): ";
+                cin >> hours;
+                string error;
+                if (!parseAnalyticsQuery(stageName, valueKey, groupKey, filter, hours, query, error)) {
+                    cout << error << "\n" << endl;
+                    break;
+                }
+                AnalyticsResult result = runAnalyticsQuery(session.analytics, query);
+                if (result.threads == 0) {
+                    cout << "Only numeric columns can be aggregated and only text columns grouped or filtered\n" << endl;
+                    break;
+                }
+                printAnalyticsResult(query, result);
+                break;
+            }
+            case 8:
+                isLoop = false;
+                break;
+            default:
+                cout << "Please enter the correct number!" << endl;
+        }
+    }
+
+    closeSession(session);
+    if (!options.metricsPath.empty()) {
+        writeMetricsFile(options.metricsPath);
+    }
+    return 0;
+}
+#endif // TMS_NO_MAIN
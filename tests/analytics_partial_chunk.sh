@@ -0,0 +1,21 @@
+#!/bin/sh
+# Sum a column over a row count that is not a multiple of eight and expect the vectorized ungrouped total to
+# match the row-by-row grouped totals. Run with "make check" (TMS names the program under test).
+TMS=${TMS:-./tms}
+DIR=$(mktemp -d /tmp/tms-check-XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+"$TMS" ingest --store "$DIR/store" --vehicles 2003 > /dev/null || fail "ingest"
+"$TMS" query --store "$DIR/store" --stage Supply --value quantity > "$DIR/total.txt" || fail "ungrouped query"
+"$TMS" query --store "$DIR/store" --stage Supply --value quantity --group supplierName > "$DIR/groups.txt" || fail "grouped query"
+
+TOTAL=$(awk '$1 == "(all)" { print $2, $3 }' "$DIR/total.txt")
+GROUPS=$(awk '$1 == "Supplier" { rows += $(NF-4); sum += $(NF-3) } END { print rows, sum }' "$DIR/groups.txt")
+[ "$(echo "$TOTAL" | cut -d' ' -f1)" = "2003" ] || fail "ungrouped query did not select all 2003 rows: $TOTAL"
+[ "$TOTAL" = "$GROUPS" ] || fail "ungrouped total ($TOTAL) differs from the grouped totals ($GROUPS)"
+echo "PASS: column sums over a partial last chunk"
@@ -0,0 +1,604 @@
+// Unit checks for code paths the command-line tests cannot observe directly.
+// Build and run with "make check"; every failed check prints its name and the program exits non-zero.
+#define TMS_NO_MAIN
+#include "../code.cpp"  // The program is a single translation unit; pull it in without its main
+#include <sys/wait.h>   // Waiting for the child processes of the checkpoint check
+
+
+// Global variables
+unsigned checkFailures = 0;  // Checks that failed so far
+
+// Function to record the outcome of one check
+static void expect(bool ok, const string& name) {
+    if (!ok) {
+        cout << "FAIL: " << name << endl;
+        checkFailures++;
+    }
+}
+
+// Function to allocate a buffer whose last byte sits right before an unreadable page, so any read past the
+// end faults; returns the start of the usable bytes (release with releaseGuarded)
+static char* allocateGuarded(size_t bytes, void*& mapping, size_t& mapped) {
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t usable = (bytes + page - 1) / page * page;
+    mapped = usable + page;
+    mapping = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    mprotect(static_cast<char*>(mapping) + usable, page, PROT_NONE);
+    return static_cast<char*>(mapping) + usable - bytes;
+}
+
+// Function to release a buffer from allocateGuarded
+static void releaseGuarded(void* mapping, size_t mapped) {
+    munmap(mapping, mapped);
+}
+
+// Known SHA-256 digests: the empty message, one block, the longest and shortest lengths whose padding does and
+// does not fit in the last block (55 and 56 bytes), exactly one block, and messages of two and sixteen blocks
+static const pair<string, const char*> SHA256_VECTORS[] = {
+    {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {string(55, 'a'), "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {string(64, 'a'), "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+     "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+    {string(1000, 'a'), "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3"},
+};
+
+// Function to hash a message with one single-stream compression function
+static string sha256HexWith(void (*compress)(uint32_t*, const uint8_t*, size_t), const string& message) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(message.data());
+    uint32_t state[8];
+    memcpy(state, SHA256_INIT, sizeof(state));
+    compress(state, bytes, message.size() / 64);
+    uint8_t tail[128], digest[32];
+    compress(state, tail, sha256PadTail(bytes, message.size(), message.size(), tail));
+    sha256StoreDigest(state, digest);
+    return hashToHex(digest, sizeof(digest));
+}
+
+// Function to check every SHA-256 path against the known digests: the portable compression, SHA-NI and the
+// eight AVX2 lanes (where the CPU has them), sha256 itself, and sha256Batch on a batch of mixed lengths, whose
+// longer messages finish outside the lanes
+static void checkSha256Vectors() {
+    vector<const uint8_t*> data;
+    vector<size_t> lengths;
+    for (const auto& [message, expected] : SHA256_VECTORS) {
+        string name = " (" + to_string(message.size()) + " bytes)";
+        expect(sha256HexWith(sha256CompressScalar, message) == expected, "portable SHA-256" + name);
+        uint8_t digest[32];
+        sha256(message.data(), message.size(), digest);
+        expect(hashToHex(digest, sizeof(digest)) == expected, "sha256" + name);
+        data.push_back(reinterpret_cast<const uint8_t*>(message.data()));
+        lengths.push_back(message.size());
+#if defined(__x86_64__) || defined(__i386__)
+        if (sha256Features.shaNi) {
+            expect(sha256HexWith(sha256CompressShaNi, message) == expected, "SHA-NI SHA-256" + name);
+        }
+        if (sha256Features.avx2) {
+            // The same message in all eight lanes, each of which must come out with the known digest
+            uint8_t tail[128];
+            size_t fullBlocks = message.size() / 64;
+            size_t blocks = fullBlocks + sha256PadTail(data.back(), message.size(), message.size(), tail);
+            uint32_t states[8][8];
+            for (auto& state : states) memcpy(state, SHA256_INIT, sizeof(SHA256_INIT));
+            for (size_t block = 0; block < blocks; ++block) {
+                const uint8_t* pointer = block < fullBlocks ? data.back() + 64 * block : tail + 64 * (block - fullBlocks);
+                const uint8_t* pointers[8] = {pointer, pointer, pointer, pointer, pointer, pointer, pointer, pointer};
+                sha256Compress8Avx2(states, pointers);
+            }
+            bool lanes = true;
+            for (const auto& state : states) {
+                sha256StoreDigest(state, digest);
+                lanes = lanes && hashToHex(digest, sizeof(digest)) == expected;
+            }
+            expect(lanes, "AVX2 SHA-256" + name);
+        }
+#endif
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    if (!sha256Features.shaNi) cout << "skipped: SHA-NI SHA-256 vectors (no SHA extensions)" << endl;
+    if (!sha256Features.avx2) cout << "skipped: AVX2 SHA-256 vectors (no AVX2)" << endl;
+#endif
+
+    // Every message in one batch (lanes of one to sixteen blocks), then the same batch from each offset
+    for (size_t first = 0; first < data.size(); ++first) {
+        size_t count = data.size() - first;
+        vector<uint8_t> digests(32 * count);
+        sha256Batch(data.data() + first, lengths.data() + first, count, digests.data());
+        bool same = true;
+        for (size_t i = 0; i < count; ++i) {
+            same = same && hashToHex(&digests[32 * i], 32) == SHA256_VECTORS[first + i].second;
+        }
+        expect(same, "sha256Batch of " + to_string(count) + " mixed-length messages");
+    }
+}
+
+// Function to check the vectorized column sums against the row-by-row path for row counts that do not fill
+// the last step of eight, with the column ending right before an unreadable page
+static void checkAnalyticsSums() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (!sha256Features.avx2) {
+        cout << "skipped: analytics sums (no AVX2)" << endl;
+        return;
+    }
+    for (size_t rows = 1; rows <= 41; ++rows) {
+        void* integerMapping;
+        void* measureMapping;
+        size_t integerMapped, measureMapped;
+        int64_t* integers = reinterpret_cast<int64_t*>(allocateGuarded(rows * sizeof(int64_t), integerMapping, integerMapped));
+        float* measures = reinterpret_cast<float*>(allocateGuarded(rows * sizeof(float), measureMapping, measureMapped));
+        if (integers == nullptr || measures == nullptr) {
+            expect(false, "guarded column allocation");
+            return;
+        }
+        AnalyticsColumn integerColumn, measureColumn;
+        integerColumn.kind = ColumnKind::Count;
+        measureColumn.kind = ColumnKind::Measure;
+        vector<uint8_t> masks((rows + 7) / 8, 0);
+        for (size_t row = 0; row < rows; ++row) {
+            integers[row] = int64_t(row * 37 % 101) - 50;
+            measures[row] = float(row) * 0.25f - 3.0f;
+            integerColumn.integers.push_back(integers[row]);
+            measureColumn.measures.push_back(measures[row]);
+            if (row % 3 != 1) {
+                masks[row / 8] |= uint8_t(1u << (row % 8));
+            }
+        }
+        AnalyticsGroup integerExpected, measureExpected, integerActual, measureActual;
+        for (size_t row = 0; row < rows; ++row) {
+            if (masks[row / 8] & (1u << (row % 8))) {
+                addAnalyticsValue(integerExpected, &integerColumn, row);
+                addAnalyticsValue(measureExpected, &measureColumn, row);
+            }
+        }
+        sumIntegersAvx2(integers, masks.data(), rows, integerActual);
+        sumMeasuresAvx2(measures, masks.data(), rows, measureActual);
+        string rowsText = " (" + to_string(rows) + " rows)";
+        expect(integerActual.rows == integerExpected.rows && integerActual.integerSum == integerExpected.integerSum &&
+               integerActual.minimum == integerExpected.minimum && integerActual.maximum == integerExpected.maximum,
+               "AVX2 integer column sum" + rowsText);
+        expect(measureActual.rows == measureExpected.rows && measureActual.measureSum == measureExpected.measureSum &&
+               measureActual.minimum == measureExpected.minimum && measureActual.maximum == measureExpected.maximum,
+               "AVX2 measure column sum" + rowsText);
+        releaseGuarded(integerMapping, integerMapped);
+        releaseGuarded(measureMapping, measureMapped);
+    }
+#endif
+}
+
+// Function to check that decimal amounts parse exactly and that anything else is refused rather than read as 0
+static void checkParseMoney() {
+    const pair<const char*, Money> accepted[] = {
+        {"1500.75", 15007500}, {"0", 0}, {"-12.5", -125000}, {".5", 5000}, {"7.", 70000}, {"0.123456", 1234},
+    };
+    for (const auto& [text, expected] : accepted) {
+        Money value = -1;
+        expect(parseMoney(text, value) && value == expected, string("parseMoney accepts \"") + text + "\"");
+    }
+    const char* refused[] = {"", "-", ".", "Company A", "USD", "12a", "1.2.3", "1,5", " 1", "99999999999999999999"};
+    for (const char* text : refused) {
+        Money value = -1;
+        expect(!parseMoney(text, value) && value == 0, string("parseMoney refuses \"") + text + "\"");
+    }
+}
+
+// Function to store one signed transaction, intact or with a flipped signature bit, and check that both the
+// ingestion-time checks and verify reject the tampered one; then drop the key and expect a warning count instead
+static void checkTamperedSignature() {
+    char directory[] = "/tmp/tms-checks-XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        expect(false, "temporary directory for the signature check");
+        return;
+    }
+    SignerKey key;
+    key.seed.fill(7);
+    ed25519PublicKey(key.seed.data(), key.publicKey.data());
+    key.canSign = true;
+    signerKeys["Company 0001"] = key;
+
+    vector<TransactionBlockchain> transactions;
+    for (bool tamper : {false, true}) {
+        string name = tamper ? "tampered" : "intact";
+        vector<string_view> fields = {"TRANS0001", "Purchase", "12.50", "Company 0001", "Company 0002", "EUR", "Completed"};
+        StageBlock block = buildStageBlock(7, fields);
+        string message;
+        transactionSigningMessage(message, block.transaction);
+        uint8_t signature[64];
+        ed25519Sign(key.seed.data(), key.publicKey.data(), message, signature);
+        signature[10] ^= tamper ? 1 : 0;
+        expect(attachTransactionSignature(block.transaction, hashToHex(signature, sizeof(signature))), "attach " + name + " signature");
+        expect(verifyTransactionSignature(block.transaction) == !tamper, "single check of the " + name + " signature");
+        transactions.push_back(block.transaction);
+
+        ChainStoreOptions options;
+        options.directory = string(directory) + "/" + name;
+        ChainStore store;
+        if (!openChainStore(store, options)) {
+            expect(false, "open the " + name + " store");
+            continue;
+        }
+        sealStageBlock(block, nullptr, nullptr);
+        expect(appendBlock(store, block) && commitChainStore(store), "store the " + name + " transaction");
+        VerifyReport report = verifyChainStore(store, 1);
+        expect(report.ok == !tamper && report.signaturesUnregistered == 0, "verify of the " + name + " transaction");
+        expect(!tamper || report.reason == "transaction signature does not verify", "reason for the tampered signature: " + report.reason);
+        closeChainStore(store);
+    }
+    vector<char> valid;
+    expect(verifyTransactionSignatures(transactions, valid) == 1 && valid == vector<char>{1, 0}, "batch check rejects only the tampered signature");
+
+    // Without the registry the intact signature still verifies, but only against the key stored with it
+    signerKeys.clear();
+    ChainStoreOptions options;
+    options.directory = string(directory) + "/intact";
+    options.readOnly = true;
+    ChainStore store;
+    if (openChainStore(store, options)) {
+        VerifyReport report = verifyChainStore(store, 1);
+        expect(report.ok && report.signaturesChecked == 1 && report.signaturesUnregistered == 1, "verify without a key registry counts the unregistered signature");
+        closeChainStore(store);
+    } else {
+        expect(false, "reopen the intact store");
+    }
+    error_code error;
+    filesystem::remove_all(directory, error);
+}
+
+// Function to read the bytes a record is stored as (encoded or canonical), from its sealed segment or the active one
+static string storedRecordBytes(ChainStore& store, uint64_t index) {
+    lock_guard<mutex> guard(store.lock);
+    uint32_t length = 0;
+    string stored;
+    if (index >= store.activeFirstIndex) {
+        uint32_t offset = store.activeOffsets[index - store.activeFirstIndex];
+        if (readActiveBytes(store, offset, 4, reinterpret_cast<char*>(&length))) {
+            stored.resize(length);
+            readActiveBytes(store, offset + 4, length, &stored[0]);
+        }
+        return stored;
+    }
+    for (const StoreSegment& segment : store.segments) {
+        if (index >= segment.firstIndex && index < segment.firstIndex + segment.count) {
+            const char* record = segment.data + segment.offsets[index - segment.firstIndex];
+            memcpy(&length, record, 4);
+            stored.assign(record + 4, length);
+        }
+    }
+    return stored;
+}
+
+// Function to get the first chain position of the segment holding a record
+static uint64_t segmentStart(const ChainStore& store, uint64_t index) {
+    uint64_t start = 0;
+    for (const StoreSegment& segment : store.segments) {
+        if (segment.firstIndex <= index) start = segment.firstIndex;
+    }
+    return index >= store.activeFirstIndex ? store.activeFirstIndex : start;
+}
+
+// Function to compare a block read back from the store with the one written, header and payload field by field
+static bool sameStoredBlock(const StageBlock& written, const StageBlock& read) {
+    const BlockHeader& a = blockHeader(written);
+    const BlockHeader& b = blockHeader(read);
+    if (written.stage != read.stage || a.blockNumber != b.blockNumber || a.timestamp != b.timestamp ||
+        a.currentBlockHash != b.currentBlockHash || a.previousBlockHash != b.previousBlockHash ||
+        a.upstreamOffset != b.upstreamOffset || a.difficulty != b.difficulty || a.nonce != b.nonce) {
+        return false;
+    }
+    if (written.stage == UPDATE_STAGE) {
+        const UpdateBlock& x = written.update;
+        const UpdateBlock& y = read.update;
+        bool same = x.targetHash == y.targetHash && x.targetStage == y.targetStage && x.fieldCount == y.fieldCount;
+        for (uint8_t i = 0; i < x.fieldCount && same; ++i) {
+            same = x.columns[i] == y.columns[i] && x.values[i] == y.values[i];
+        }
+        return same;
+    }
+    string_view left[7], right[7];
+    char leftScratch[7][64], rightScratch[7][64];
+    stageFieldValues(written, left, leftScratch);
+    stageFieldValues(read, right, rightScratch);
+    return equal(begin(left), end(left), begin(right));
+}
+
+// Function to check that blocks come back from the store as they were written: payloads whose repeated fields
+// are dictionary codes and updates whose target hash was left out, read from sealed segments and from the active
+// segment before and after a reopen (which rebuilds its dictionary). Then trace one vehicle with an update
+// between two of its stages through the provenance graph, as linked on append and as rebuilt from the store
+static void checkStoreRoundTrip() {
+    char directory[] = "/tmp/tms-checks-XXXXXX";
+    if (mkdtemp(directory) == nullptr) {
+        expect(false, "temporary directory for the round-trip check");
+        return;
+    }
+    ChainStoreOptions options;
+    options.directory = directory;
+    options.segmentSize = 16 * 1024; // Several sealed segments, so some updates reach into an earlier one
+    ChainStore store;
+    if (!openChainStore(store, options)) {
+        expect(false, "open the round-trip store");
+        return;
+    }
+
+    blockNumber.store(1); // A new chain, so block number n is written[n - 1]
+    vector<StageBlock> written;
+    bool appended = true;
+    // Seal a block onto the newest one, linked upstream to the block with the given number (0 = none), and store it
+    auto append = [&](StageBlock block, uint64_t upstream) {
+        sealStageBlock(block, written.empty() ? nullptr : &blockHeader(written.back()),
+                       upstream != 0 ? &blockHeader(written[upstream - 1]) : nullptr);
+        appended = appended && appendBlock(store, block);
+        written.push_back(block);
+    };
+    // Store an update of one or two columns of an earlier block
+    auto update = [&](uint64_t target, vector<pair<uint8_t, string>> changes) {
+        UpdateBlock block{};
+        const StageBlock& targetBlock = written[target - 1];
+        block.targetHash = blockHeader(targetBlock).currentBlockHash;
+        block.targetId = stageBlockId(targetBlock);
+        block.targetStage = targetBlock.stage;
+        for (const auto& [column, value] : changes) {
+            block.columns[block.fieldCount] = column;
+            block.values[block.fieldCount++] = internString(value);
+        }
+        append(toStageBlock(block), target);
+    };
+
+    const uint64_t VEHICLES = 120;
+    const uint64_t TRACED = 50; // Vehicle with an update between its welding and painting blocks
+    VehicleTrace traced{};
+    vector<uint64_t> updates;
+    for (uint64_t v = 0; v < VEHICLES; ++v) {
+        string id = to_string(1000 + v), site = "Plant " + to_string(v % 2), maker = "Maker " + to_string(v % 3);
+        // IDs are new every time; sites, makers and types repeat, and details differ only in their middle
+        const vector<vector<string>> rows = {
+            {"SUP" + id, maker, "Steel", site, "Branch A", to_string(10 + v % 5), "12.50"},
+            {"PRESS" + id, site, "Press run " + id + " ok", "Hydraulic", maker, "250.5"},
+            {"WELD" + id, site, "Weld run " + id + " ok", "MIG", "Steel", "1500"},
+            {"PAINT" + id, site, "Paint run " + id + " ok", v % 2 ? "Red" : "Blue", "Spray", "0.12"},
+            {"ASSY" + id, site, "Assembly run " + id + " ok", "Vehicle", to_string(200 + v % 7), "1450.5"},
+            {"SHIP" + id, "Port " + to_string(v % 4), "Vehicle " + id, "Sea", "Carrier", "Delivered"},
+            {"TRANS" + id, "Purchase", "1500.75", "Company A", "Company B", "USD", "Completed"},
+        };
+        for (int stage = 1; stage <= 7; ++stage) {
+            vector<string_view> fields(rows[stage - 1].begin(), rows[stage - 1].end());
+            uint64_t upstream = stage == 1 ? 0 : v == TRACED ? traced[stage - 2] : written.size();
+            append(buildStageBlock(stage, fields), upstream);
+            if (v == TRACED) {
+                traced[stage - 1] = written.size();
+                if (stage == 3) {
+                    update(traced[1], {{1, "Plant 9"}}); // Press location, one block back past the welding
+                    updates.push_back(written.size());
+                }
+            }
+        }
+        if (v % 10 == 9) {
+            update(written.size() - 1, {{5, "Returned"}}); // Shipping status, two blocks back
+            updates.push_back(written.size());
+        }
+    }
+    update(1, {{4, "Branch B"}, {6, "15.00"}}); // First supplier, long since sealed: the target hash is stored
+    updates.push_back(written.size());
+    expect(appended && commitChainStore(store) && !store.segments.empty(), "store vehicles and updates across segments");
+
+    // Updates whose target sits in their own segment leave its hash out; the last one cannot
+    bool elided = true;
+    for (uint64_t number : updates) {
+        string stored = storedRecordBytes(store, number - 1);
+        ByteReader reader{stored.data(), stored.data() + stored.size()};
+        const char* stage = readBytes(reader, 1);
+        readVarint(reader);
+        readBytes(reader, 8);
+        const char* implied = readBytes(reader, 1);
+        bool sameSegment = segmentStart(store, number - 1) == segmentStart(store, number - 1 - blockHeader(written[number - 1]).upstreamOffset);
+        elided = elided && stage != nullptr && (uint8_t(*stage) & ENCODED_RECORD_FLAG) && implied != nullptr && (*implied == 1) == sameSegment;
+        elided = elided && sameSegment == (number != written.size());
+    }
+    expect(elided, "encoded updates leave out exactly the target hashes found in their segment");
+    bool coded = store.activeDictionary->values[0][1].size() <= 3 && store.activeDictionary->values[0][1].size() >= 1;
+    for (const StoreSegment& segment : store.segments) {
+        coded = coded && segment.dictionary->values[0][1].size() <= 3 && segment.dictionary->values[1][3].size() == 1;
+    }
+    expect(coded, "repeated fields are defined once per segment");
+
+    // Every record expands to the canonical record that was written and decodes to the same fields
+    auto readBack = [&](const string& when) {
+        bool same = storeBlockCount(store) == written.size();
+        string record, scratch;
+        for (uint64_t index = 0; index < written.size() && same; ++index) {
+            string_view read;
+            StageBlock block;
+            encodeBlockRecord(record, written[index]);
+            same = readStoreRecord(store, index, read, scratch) && read == record && decodeBlockRecord(read, block) &&
+                   sameStoredBlock(written[index], block);
+            if (!same) cout << "block " << index + 1 << " differs " << when << endl;
+        }
+        expect(same, "records read back field by field " + when);
+    };
+    readBack("after writing");
+    closeChainStore(store);
+    if (!openChainStore(store, options)) {
+        expect(false, "reopen the round-trip store");
+        return;
+    }
+    readBack("after reopening");
+
+    // The traced vehicle's edges skip the update, which is not part of any vehicle
+    ProvenanceGraph linked, rebuilt;
+    BlockBatch batch;
+    batch.blocks = written;
+    linkProvenance(linked, batch);
+    rebuildProvenanceGraph(rebuilt, store, 2);
+    for (ProvenanceGraph* graph : {&linked, &rebuilt}) {
+        string name = graph == &linked ? " (linked)" : " (rebuilt)";
+        bool edges = true;
+        for (size_t stage = 0; stage < 7 && edges; ++stage) {
+            uint64_t slot = traced[stage] - 1;
+            edges = graph->stage[slot] == stage + 1 &&
+                    graph->upstream[slot] == (stage == 0 ? 0 : traced[stage] - traced[stage - 1]) &&
+                    graph->downstream[slot] == (stage == 6 ? 0 : traced[stage + 1] - traced[stage]);
+        }
+        // The update follows the welding block (slot traced[2]) and has no edges
+        expect(edges && graph->stage[traced[2]] == 0 && graph->upstream[traced[2]] == 0, "upstream and downstream edges of the traced vehicle" + name);
+        vector<VehicleTrace> traces = traceVehicles(*graph, {traced[0], traced[3], traced[6], traced[2] + 1}, 1);
+        expect(traces[0] == traced && traces[1] == traced && traces[2] == traced && traces[3] == VehicleTrace{}, "trace of the vehicle from any of its blocks" + name);
+    }
+    closeChainStore(store);
+    error_code error;
+    filesystem::remove_all(directory, error);
+}
+
+// Function to run part of a check in a child process, which starts from this process's still empty string pool
+static bool runInChild(const function<bool()>& body) {
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        _exit(body() ? 0 : 1);
+    }
+    int status = 0;
+    return child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Function to count the checkpoint files of a store directory
+static size_t countCheckpointFiles(const string& directory) {
+    size_t files = 0;
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(directory, error)) {
+        string name = entry.path().filename().string();
+        files += name.rfind("checkpoint-", 0) == 0;
+    }
+    return files;
+}
+
+// Function to ingest generated vehicles [first, end) into a session and commit them
+static void ingestVehicles(ChainSession& session, uint64_t first, uint64_t end) {
+    Workload workload;
+    prepareWorkload(workload, WorkloadOptions());
+    ingestWorkload(workload, first, end, session.state);
+    finishIngest(session.state);
+    commitChainStore(session.store);
+}
+
+// Function to check that lookups restored from a checkpoint (and the blocks replayed after it) equal a cold
+// rebuild from the store: block count, tip, hash and ID lookups, provenance, analytics columns and dictionaries.
+// Runs first, while the string pool is still empty, because only then can a checkpoint be loaded
+static void checkCheckpointRestore() {
+    char directory[] = "/tmp/tms-checks-XXXXXX";
+    if (mkdtemp(directory) == nullptr || !stringPoolEmpty()) {
+        expect(false, "fresh process and directory for the checkpoint check");
+        return;
+    }
+    CommandOptions options;
+    options.command = "ingest";
+    options.storeOptions.directory = directory;
+    options.checkpointInterval = 500;
+
+    // Ingest with checkpoints along the way and one on close; only the newest may remain
+    bool ingested = runInChild([&]() {
+        ChainSession session;
+        if (!openSession(session, options)) {
+            return false;
+        }
+        ingestVehicles(session, 0, 300);
+        closeSession(session);
+        return session.checkpointedBlocks == 2100;
+    });
+    expect(ingested, "ingest 300 vehicles with checkpoints");
+    expect(countCheckpointFiles(directory) == CHECKPOINTS_KEPT, "only the newest checkpoint is kept");
+
+    // Reopen from the checkpoint, append more blocks and an update, and close without a new checkpoint so the
+    // next open restores and then replays
+    bool appended = runInChild([&]() {
+        ChainSession session;
+        if (!openSession(session, options) || session.restoredBlocks != 2100 || session.replayedBlocks != 0) {
+            return false;
+        }
+        ingestVehicles(session, 300, 350);
+        vector<string_view> update = {"UPDATE", "SHIP0000000005", "shippingStatus=Returned"};
+        bool updated = ingestRow(session.state, update);
+        finishIngest(session.state);
+        commitChainStore(session.store);
+        session.checkpointInterval = 0;
+        closeSession(session);
+        return updated;
+    });
+    expect(appended, "reopen from the checkpoint and append");
+
+    ChainSession restored, cold;
+    CommandOptions coldOptions = options;
+    coldOptions.command = "query"; // Read-only, so it ignores the checkpoint and rebuilds everything
+    if (!openSession(restored, options) || !openSession(cold, coldOptions)) {
+        expect(false, "open the restored and the cold session");
+        return;
+    }
+    uint64_t blocks = storeBlockCount(restored.store);
+    expect(blocks == 2100 + 350 + 1 && storeBlockCount(cold.store) == blocks, "block count after reopening");
+    expect(restored.restoredBlocks == 2100 && restored.replayedBlocks == 351 && cold.replayedBlocks == blocks, "restored and replayed blocks");
+    expect(restored.store.lastHash == cold.store.lastHash &&
+           latestHeader(restored.state)->currentBlockHash == latestHeader(cold.state)->currentBlockHash, "restored tip");
+
+    // Every block is found by its hash and by its business ID, with the same postings in both sessions
+    bool lookups = restored.index.blocks == blocks && cold.index.blocks == blocks;
+    for (uint64_t number = 1; number <= blocks && lookups; ++number) {
+        StageBlock block;
+        lookups = fetchSessionBlock(cold, number, block);
+        const BlockHash& hash = blockHeader(block).currentBlockHash;
+        lookups = lookups && findBlockByHash(restored.index, hash) == number && findBlockByHash(cold.index, hash) == number;
+        string id(lookupString(stageBlockId(block)));
+        lookups = lookups && findSessionBlocks(restored, id) == findSessionBlocks(cold, id);
+    }
+    expect(lookups, "hash and ID lookups match a cold rebuild");
+    // Slots past the end of the graph count as blocks outside it (the cold rebuild also sizes it for updates)
+    auto edges = [](const ProvenanceGraph& graph, uint64_t slot) {
+        return slot < graph.stage.size() ? tuple(graph.stage[slot], graph.upstream[slot], graph.downstream[slot]) : tuple(uint8_t(0), 0u, 0u);
+    };
+    bool provenance = true;
+    for (uint64_t slot = 0; slot < blocks && provenance; ++slot) {
+        provenance = edges(restored.provenance, slot) == edges(cold.provenance, slot);
+    }
+    expect(provenance, "provenance matches a cold rebuild");
+
+    // Columns match value for value, and every dictionary value still finds its code after the rehash
+    bool columns = true;
+    for (size_t stage = 0; stage < 7 && columns; ++stage) {
+        const AnalyticsTable& left = restored.analytics.tables[stage];
+        const AnalyticsTable& right = cold.analytics.tables[stage];
+        columns = left.blockNumber == right.blockNumber && left.timestamp == right.timestamp && left.columns.size() == right.columns.size();
+        for (size_t c = 0; c < left.columns.size() && columns; ++c) {
+            const AnalyticsColumn& a = left.columns[c];
+            const AnalyticsColumn& b = right.columns[c];
+            columns = a.kind == b.kind && a.codes == b.codes && a.integers == b.integers && a.measures == b.measures && a.dictionary == b.dictionary;
+            for (uint32_t code = 0; code < a.dictionary.size() && columns; ++code) {
+                uint32_t found;
+                columns = findDictionaryCode(a, a.dictionary[code], found) && found == code;
+            }
+        }
+    }
+    expect(columns, "analytics columns and dictionaries match a cold rebuild");
+    closeSession(cold);
+
+    // Closing writes a checkpoint of everything, which replaces the older one
+    closeSession(restored);
+    expect(restored.checkpointedBlocks == blocks && countCheckpointFiles(directory) == CHECKPOINTS_KEPT, "closing replaces the checkpoint");
+    error_code error;
+    filesystem::remove_all(directory, error);
+}
+
+int main() {
+    checkCheckpointRestore();
+    checkSha256Vectors();
+    checkAnalyticsSums();
+    checkParseMoney();
+    checkTamperedSignature();
+    checkStoreRoundTrip();
+    if (checkFailures != 0) {
+        cout << checkFailures << " unit check(s) failed" << endl;
+        return 1;
+    }
+    cout << "PASS: unit checks" << endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Cut the active segment at the last record boundary, inside the last record and inside its length prefix, and
+# expect verify to leave the file alone, the next writer to drop exactly the torn bytes, and appends to carry on
+# from the surviving tip. Run with "make check" (TMS names the program under test).
+TMS=${TMS:-./tms}
+DIR=$(mktemp -d /tmp/tms-check-XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+# Function to print the number of blocks verify checks (and fail unless the chain is intact)
+blocks() {
+    "$TMS" verify --store "$DIR/store" > "$DIR/verify.txt" || fail "verify $1"
+    grep -q "OK - every hash and link is valid" "$DIR/verify.txt" || fail "store not reported OK $1"
+    awk '/Blocks checked/ { print $NF }' "$DIR/verify.txt"
+}
+
+# Every cut loses the last vehicle's transaction, and ingestion carries on with that vehicle, so the rows
+# appended afterwards are one transaction row and then a whole vehicle
+"$TMS" generate --vehicles 1 --out "$DIR/vehicle.csv" > /dev/null 2>&1 || fail "generate"
+{ tail -n 1 "$DIR/vehicle.csv"; cat "$DIR/vehicle.csv"; } > "$DIR/append.csv"
+
+for CUT in boundary record prefix; do
+    rm -rf "$DIR/store"
+    "$TMS" ingest --store "$DIR/store" --vehicles 20 > /dev/null || fail "ingest"
+    SEGMENT=$(ls "$DIR"/store/segment-*.log | tail -n 1)
+    FULL=$(blocks "of the intact store")
+
+    # Walk the [u32 length][record] entries after the 16-byte preamble to find where the last record starts
+    SIZE=$(wc -c < "$SEGMENT")
+    OFFSET=16
+    while [ "$OFFSET" -lt "$SIZE" ]; do
+        LAST=$OFFSET
+        LENGTH=$(od -An -tu4 -j "$OFFSET" -N4 "$SEGMENT" | tr -d ' ')
+        OFFSET=$((OFFSET + 4 + LENGTH))
+    done
+    [ "$OFFSET" -eq "$SIZE" ] || fail "segment does not end on a record boundary"
+    case $CUT in
+        boundary) KEEP=$LAST ;;
+        record) KEEP=$((LAST + 4 + LENGTH / 2)) ;;
+        prefix) KEEP=$((LAST + 2)) ;;
+    esac
+    truncate -s "$KEEP" "$SEGMENT"
+
+    # Readers see every whole record before the cut and change nothing
+    [ "$(blocks "after a cut at the $CUT")" -eq $((FULL - 1)) ] || fail "verify after a cut at the $CUT did not see $((FULL - 1)) blocks"
+    [ "$(wc -c < "$SEGMENT")" -eq "$KEEP" ] || fail "verify changed the segment after a cut at the $CUT"
+
+    # The next writer drops exactly the torn bytes and appends after the surviving tip
+    "$TMS" ingest --store "$DIR/store" "$DIR/append.csv" > /dev/null 2> "$DIR/ingest.txt" || fail "ingest after a cut at the $CUT"
+    if [ "$KEEP" -eq "$LAST" ]; then
+        grep -q "Dropping" "$DIR/ingest.txt" && fail "a cut at a record boundary dropped data"
+    else
+        grep -q "Dropping a torn record of $((KEEP - LAST)) bytes" "$DIR/ingest.txt" || fail "torn $CUT not dropped exactly: $(cat "$DIR/ingest.txt")"
+    fi
+    [ "$(blocks "after appending past a cut at the $CUT")" -eq $((FULL - 1 + 8)) ] || fail "appends after a cut at the $CUT"
+done
+echo "PASS: a torn active segment tail is dropped exactly and appends continue"
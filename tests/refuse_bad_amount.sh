@@ -0,0 +1,24 @@
+#!/bin/sh
+# Put text in a transaction's amount column and expect ingestion (serial and pipelined) to refuse that row while
+# keeping the rest of the file. Run with "make check" (TMS names the program under test).
+TMS=${TMS:-./tms}
+DIR=$(mktemp -d /tmp/tms-check-XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+"$TMS" generate --vehicles 3 --out "$DIR/rows.csv" > /dev/null 2>&1 || fail "generate"
+awk -F, 'BEGIN { OFS = "," } /^TRANS/ && ++n == 2 { $3 = "Company 0001" } { print }' "$DIR/rows.csv" > "$DIR/bad.csv"
+
+for MODE in "" --pipeline; do
+    rm -rf "$DIR/store"
+    "$TMS" ingest $MODE --store "$DIR/store" "$DIR/bad.csv" > "$DIR/ingest.txt" || fail "ingest $MODE"
+    grep -q "Rows skipped  *: 1$" "$DIR/ingest.txt" || fail "bad amount not refused $MODE"
+    grep -q "Blocks stored : 20$" "$DIR/ingest.txt" || fail "rows around the bad amount not kept $MODE"
+done
+"$TMS" query --store "$DIR/store" TRANS0000000002 > "$DIR/query.txt" || fail "query"
+grep -q "Company 0" "$DIR/query.txt" || fail "transaction after the refused row not stored"
+echo "PASS: a non-numeric amount is refused"
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Flip one digit of a signed transaction's signature and expect every ingestion path to refuse that row; then
+# expect verify to pass with the key registry and to warn about unregistered signatures without it.
+# Run with "make check" (TMS names the program under test).
+TMS=${TMS:-./tms}
+DIR=$(mktemp -d /tmp/tms-check-XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+"$TMS" generate --vehicles 20 --keys "$DIR/keys.csv" --out "$DIR/rows.csv" > /dev/null 2>&1 || fail "generate"
+awk -F, 'BEGIN { OFS = "," }
+    /^TRANS/ && ++n == 3 { digit = substr($8, 1, 1); $8 = (digit == "0" ? "1" : "0") substr($8, 2) }
+    { print }' "$DIR/rows.csv" > "$DIR/tampered.csv"
+cmp -s "$DIR/rows.csv" "$DIR/tampered.csv" && fail "no signature was changed"
+
+for MODE in "" "--tx-batch 4" --pipeline; do
+    rm -rf "$DIR/store"
+    "$TMS" ingest $MODE --keys "$DIR/keys.csv" --store "$DIR/store" "$DIR/tampered.csv" > "$DIR/ingest.txt" 2>&1 || fail "ingest $MODE"
+    grep -q "Rows skipped  *: 1$" "$DIR/ingest.txt" || fail "tampered signature not refused ($MODE)"
+    grep -q "Signatures *: 19 verified, 1 rejected" "$DIR/ingest.txt" || fail "signature counts ($MODE)"
+    "$TMS" verify --keys "$DIR/keys.csv" --store "$DIR/store" > "$DIR/verify.txt" || fail "verify with keys ($MODE)"
+    grep -q "Warning" "$DIR/verify.txt" && fail "warning with every sender's key registered ($MODE)"
+done
+
+"$TMS" verify --store "$DIR/store" > "$DIR/verify.txt" || fail "verify without keys"
+grep -q "OK - every hash and link is valid" "$DIR/verify.txt" || fail "intact store not reported OK without keys"
+grep -q "Warning *: 19 signature(s) of senders with no registered key" "$DIR/verify.txt" || fail "no warning without a key registry"
+echo "PASS: a tampered signature is refused and unregistered signatures are flagged"
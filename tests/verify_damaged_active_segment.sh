@@ -0,0 +1,28 @@
+#!/bin/sh
+# Damage one record in the middle of the active segment and expect verify to report it without touching the store.
+# Run with "make check" (TMS names the program under test).
+TMS=${TMS:-./tms}
+DIR=$(mktemp -d /tmp/tms-check-XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+"$TMS" ingest --store "$DIR/store" --vehicles 4000 > /dev/null || fail "ingest"
+"$TMS" verify --store "$DIR/store" > "$DIR/before.txt" || fail "verify of the intact store"
+grep -q "OK - every hash and link is valid" "$DIR/before.txt" || fail "intact store not reported OK"
+
+SEGMENT=$(ls "$DIR"/store/segment-*.log | tail -n 1)
+SIZE=$(wc -c < "$SEGMENT")
+printf '\377' | dd of="$SEGMENT" bs=1 seek=50000 conv=notrunc 2> /dev/null
+
+"$TMS" verify --store "$DIR/store" > "$DIR/after.txt" && fail "verify exited 0 on a damaged store"
+grep -q "FAILED" "$DIR/after.txt" || fail "damaged store not reported FAILED"
+grep -q "First bad block" "$DIR/after.txt" || fail "no first bad block reported"
+[ "$(wc -c < "$SEGMENT")" -eq "$SIZE" ] || fail "verify changed the segment size"
+
+"$TMS" ingest --store "$DIR/store" --vehicles 1 > /dev/null 2>&1 && fail "ingest opened a damaged store"
+[ "$(wc -c < "$SEGMENT")" -eq "$SIZE" ] || fail "ingest truncated the damaged segment"
+echo "PASS: damaged active segment reported by verify and left in place"